@@ -0,0 +1,343 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "backgroundquery.h"
+#include "backgroundqueryprivate.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QSqlQuery>
+#include <QThread>
+
+#include "xsqlquery.h"
+
+#define DEBUG false
+
+// hand over the first screenful right away, then bigger batches
+#define FIRSTBATCHROWS  50
+#define BATCHROWS       500
+#define BATCHMSECS      250
+
+BackgroundQueryShared::BackgroundQueryShared()
+  : generation(0),
+    executing(0),
+    pid(0)
+{
+}
+
+BackgroundQueryWorker::BackgroundQueryWorker(BackgroundQueryShared *shared, const QSqlDatabase &db)
+  : QObject(0),
+    _shared(shared),
+    _driver(db.driverName()),
+    _databaseName(db.databaseName()),
+    _hostName(db.hostName()),
+    _port(db.port()),
+    _userName(db.userName()),
+    _password(db.password()),
+    _connectOptions(db.connectOptions())
+{
+  _name = QString("backgroundquery%1").arg((quintptr)this, 0, 16);
+}
+
+/* open the worker's connection in the worker's thread, as Qt requires,
+   and give it the same search path and time zone as the main session.
+ */
+QSqlError BackgroundQueryWorker::open(const QString &searchPath, const QString &timeZone)
+{
+  QSqlDatabase db = QSqlDatabase::database(_name, false);
+  if (db.isOpen())
+    return QSqlError();
+
+  if (! db.isValid())
+  {
+    db = QSqlDatabase::addDatabase(_driver, _name);
+    db.setDatabaseName(_databaseName);
+    db.setHostName(_hostName);
+    db.setPort(_port);
+    db.setUserName(_userName);
+    db.setPassword(_password);
+    db.setConnectOptions(_connectOptions);
+  }
+
+  if (! db.open())
+    return db.lastError();
+
+  if (_driver == "QPSQL")
+  {
+    QSqlQuery session(db);
+    session.prepare("SELECT set_config('search_path',"
+                    "         COALESCE(NULLIF(:path, ''), current_setting('search_path')), false),"
+                    "       set_config('TimeZone',"
+                    "         COALESCE(NULLIF(:tz, ''), current_setting('TimeZone')), false),"
+                    "       pg_backend_pid() AS pid;");
+    session.bindValue(":path", searchPath);
+    session.bindValue(":tz",   timeZone);
+    if (! session.exec() || ! session.first())
+    {
+      QSqlError err = session.lastError();
+      db.close();
+      return err;
+    }
+    QMutexLocker locker(&_shared->lock);
+    _shared->pid = session.value("pid").toInt();
+  }
+
+  if (DEBUG)
+    qDebug("BackgroundQueryWorker::open() opened %s", qPrintable(_name));
+  return QSqlError();
+}
+
+void BackgroundQueryWorker::close()
+{
+  {
+    QSqlDatabase db = QSqlDatabase::database(_name, false);
+    if (db.isValid())
+      db.close();
+  }
+  if (QSqlDatabase::contains(_name))
+    QSqlDatabase::removeDatabase(_name);
+}
+
+/* the BackgroundQuery is gone. the worker owns the shared state now, and
+   the thread goes away once the worker has finished with it.
+ */
+void BackgroundQueryWorker::shutdown()
+{
+  close();
+  delete _shared;
+  _shared = 0;
+  deleteLater();        // done when the thread finishes
+  thread()->quit();
+}
+
+/* pass a batch of rows to the BackgroundQuery unless the query has been
+   cancelled or replaced. only signal when the queue was empty so a busy
+   GUI thread collects several batches at once.
+ */
+bool BackgroundQueryWorker::deliver(QList<QSqlRecord> &batch, int generation)
+{
+  bool wake = false;
+  {
+    QMutexLocker locker(&_shared->lock);
+    if (generation != _shared->generation.load())
+    {
+      batch.clear();
+      return false;
+    }
+    if (! batch.isEmpty())
+    {
+      wake = _shared->rows.isEmpty();
+      _shared->rows.append(batch);
+    }
+  }
+  batch.clear();
+
+  if (wake)
+    emit rowsReady(generation);
+  return true;
+}
+
+void BackgroundQueryWorker::exec(const QString &sql, const QVariantMap &bindings,
+                                 int generation, const QString &searchPath,
+                                 const QString &timeZone)
+{
+  if (generation != _shared->generation.load())
+    return;     // cancelled before it got here
+
+  QSqlError error = open(searchPath, timeZone);
+  if (error.type() == QSqlError::NoError)
+  {
+    QSqlQuery query(QSqlDatabase::database(_name, false));
+    query.setForwardOnly(true);   // lets the driver return rows as they arrive
+    query.prepare(sql);
+    for (QVariantMap::const_iterator it = bindings.constBegin(); it != bindings.constEnd(); ++it)
+      query.bindValue(it.key(), it.value());
+
+    {
+      QMutexLocker locker(&_shared->lock);
+      if (generation != _shared->generation.load())
+        return;
+      _shared->executing = generation;
+    }
+
+    if (query.exec())
+    {
+      QList<QSqlRecord> batch;
+      int               limit = FIRSTBATCHROWS;
+      QElapsedTimer     elapsed;
+      elapsed.start();
+
+      while (query.next())
+      {
+        batch.append(query.record());
+        if (batch.size() >= limit || elapsed.elapsed() >= BATCHMSECS)
+        {
+          if (! deliver(batch, generation))
+            break;
+          limit = BATCHROWS;
+          elapsed.restart();
+        }
+      }
+      deliver(batch, generation);
+    }
+    error = query.lastError();
+    query.finish();
+
+    QMutexLocker locker(&_shared->lock);
+    _shared->executing = 0;
+  }
+
+  {
+    QMutexLocker locker(&_shared->lock);
+    if (generation != _shared->generation.load())
+      return;
+    _shared->error = error;
+  }
+
+  if (DEBUG)
+    qDebug("BackgroundQueryWorker::exec() finished %d: %s",
+           generation, qPrintable(error.text()));
+  emit finished(generation);
+}
+
+BackgroundQuery::BackgroundQuery(QObject *parent, QSqlDatabase db)
+  : QObject(parent),
+    _db(db),
+    _active(false),
+    _sessionKnown(false)
+{
+  _shared = new BackgroundQueryShared();
+  _worker = new BackgroundQueryWorker(_shared, db);
+  _thread = new QThread();    // outlives this, see ~BackgroundQuery()
+  _worker->moveToThread(_thread);
+  connect(_thread, SIGNAL(finished()), _thread, SLOT(deleteLater()));
+
+  connect(_worker, SIGNAL(rowsReady(int)), this, SLOT(sRowsReady(int)));
+  connect(_worker, SIGNAL(finished(int)),  this, SLOT(sFinished(int)));
+
+  _thread->start();
+}
+
+/* the worker may still be waiting for the server to give up on a
+   cancelled query, so don't wait for it here. it closes the connection
+   and cleans up after itself.
+ */
+BackgroundQuery::~BackgroundQuery()
+{
+  cancel();
+  QMetaObject::invokeMethod(_worker, "shutdown", Qt::QueuedConnection);
+}
+
+bool BackgroundQuery::isActive() const
+{
+  return _active;
+}
+
+QSqlError BackgroundQuery::lastError() const
+{
+  QMutexLocker locker(&_shared->lock);
+  return _shared->error;
+}
+
+QList<QSqlRecord> BackgroundQuery::takeRows()
+{
+  QList<QSqlRecord> rows;
+  QMutexLocker locker(&_shared->lock);
+  rows.swap(_shared->rows);
+  return rows;
+}
+
+/* stop the running query. if the server is still working on it, ask the
+   server to cancel it rather than wait for rows nobody will look at.
+ */
+void BackgroundQuery::cancel()
+{
+  if (! _active)
+    return;
+  _active = false;
+
+  int pid = 0;
+  int cancelled;
+  {
+    QMutexLocker locker(&_shared->lock);
+    cancelled = _shared->generation.fetchAndAddOrdered(1);
+    if (_shared->executing == cancelled)
+      pid = _shared->pid;
+    _shared->rows.clear();
+  }
+
+  /* don't hold the lock for the round trip, the worker needs it. only
+     this thread starts queries, so nothing new can be running on that
+     backend by the time the cancel gets there.
+   */
+  if (pid > 0)
+  {
+    XSqlQuery killq(_db);
+    killq.prepare("SELECT pg_cancel_backend(:pid);");
+    killq.bindValue(":pid", pid);
+    killq.exec();
+    if (DEBUG)
+      qDebug("BackgroundQuery::cancel() cancelled %d on backend %d",
+             cancelled, pid);
+  }
+}
+
+bool BackgroundQuery::exec(const QSqlQuery &query)
+{
+  return exec(query.lastQuery(), query.boundValues());
+}
+
+bool BackgroundQuery::exec(const QString &sql, const QVariantMap &bindings)
+{
+  cancel();
+
+  if (! _sessionKnown && _db.driverName() == "QPSQL")
+  {
+    XSqlQuery session(_db);
+    session.exec("SELECT current_setting('search_path') AS path,"
+                 "       current_setting('TimeZone') AS tz;");
+    if (session.first())
+    {
+      _searchPath   = session.value("path").toString();
+      _timeZone     = session.value("tz").toString();
+      _sessionKnown = true;
+    }
+  }
+
+  int generation = _shared->generation.fetchAndAddOrdered(1) + 1;
+  {
+    QMutexLocker locker(&_shared->lock);
+    _shared->rows.clear();
+    _shared->error = QSqlError();
+  }
+  _active = true;
+
+  return QMetaObject::invokeMethod(_worker, "exec", Qt::QueuedConnection,
+                                   Q_ARG(QString,     sql),
+                                   Q_ARG(QVariantMap, bindings),
+                                   Q_ARG(int,         generation),
+                                   Q_ARG(QString,     _searchPath),
+                                   Q_ARG(QString,     _timeZone));
+}
+
+void BackgroundQuery::sRowsReady(int generation)
+{
+  if (_active && generation == _shared->generation.load())
+    emit rowsReady();
+}
+
+void BackgroundQuery::sFinished(int generation)
+{
+  if (! _active || generation != _shared->generation.load())
+    return;
+
+  _active = false;
+  emit finished(lastError().type() == QSqlError::NoError);
+}
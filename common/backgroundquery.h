@@ -0,0 +1,78 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __BACKGROUNDQUERY_H__
+#define __BACKGROUNDQUERY_H__
+
+#include <QList>
+#include <QObject>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlRecord>
+#include <QVariantMap>
+
+class QSqlQuery;
+class QThread;
+class BackgroundQueryShared;
+class BackgroundQueryWorker;
+
+/* BackgroundQuery runs a query on its own database connection in its own
+   thread and hands the rows back in batches while they arrive, so the
+   GUI thread never waits on the server. Prepare and bind the query on
+   the main connection as usual but don't exec() it; exec() here copies
+   the text and bound values. Queries that never touch the main
+   connection can pass the text and bindings directly. The connection is
+   opened the first time it is needed, with the search path and time
+   zone of the main session, and is kept until the BackgroundQuery is
+   deleted. The worker then closes it and cleans up on its own thread.
+
+   Connect to rowsReady() and call takeRows() to collect what has arrived
+   so far, and call it once more on finished(), which says whether the
+   query succeeded; after a failure lastError() has the details. cancel()
+   and exec() both abandon the running query, on the server too, and
+   nothing more is heard from it.
+ */
+class BackgroundQuery : public QObject
+{
+  Q_OBJECT
+
+  public:
+    BackgroundQuery(QObject *parent = 0, QSqlDatabase db = QSqlDatabase::database());
+    virtual ~BackgroundQuery();
+
+    bool              isActive()  const;
+    QSqlError         lastError() const;
+    QList<QSqlRecord> takeRows();
+
+  public slots:
+    void  cancel();
+    bool  exec(const QSqlQuery &query);
+    bool  exec(const QString &sql, const QVariantMap &bindings = QVariantMap());
+
+  signals:
+    void  rowsReady();
+    void  finished(bool ok);
+
+  private slots:
+    void  sRowsReady(int generation);
+    void  sFinished(int generation);
+
+  private:
+    QSqlDatabase           _db;
+    QThread               *_thread;
+    BackgroundQueryShared *_shared;
+    BackgroundQueryWorker *_worker;
+    bool                   _active;
+    bool                   _sessionKnown;
+    QString                _searchPath;
+    QString                _timeZone;
+};
+
+#endif
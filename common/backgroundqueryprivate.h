@@ -0,0 +1,73 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __BACKGROUNDQUERYPRIVATE_H__
+#define __BACKGROUNDQUERYPRIVATE_H__
+
+#include <QAtomicInt>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlRecord>
+#include <QString>
+#include <QVariant>
+
+/* state shared between a BackgroundQuery and its worker thread.
+   generation changes every time a query is started or cancelled so the
+   worker can tell that the rows it is fetching are no longer wanted.
+ */
+class BackgroundQueryShared
+{
+  public:
+    BackgroundQueryShared();
+
+    QAtomicInt        generation;
+    QMutex            lock;       // guards everything below
+    int               executing;  // generation on the server right now, 0 if none
+    int               pid;        // server process of the worker connection
+    QList<QSqlRecord> rows;
+    QSqlError         error;
+};
+
+class BackgroundQueryWorker : public QObject
+{
+  Q_OBJECT
+
+  public:
+    BackgroundQueryWorker(BackgroundQueryShared *shared, const QSqlDatabase &db);
+
+  public slots:
+    void  close();
+    void  exec(const QString &sql, const QVariantMap &bindings, int generation,
+               const QString &searchPath, const QString &timeZone);
+    void  shutdown();
+
+  signals:
+    void  rowsReady(int generation);
+    void  finished(int generation);
+
+  private:
+    bool       deliver(QList<QSqlRecord> &batch, int generation);
+    QSqlError  open(const QString &searchPath, const QString &timeZone);
+
+    BackgroundQueryShared *_shared;
+    QString                _name;
+    QString                _driver;
+    QString                _databaseName;
+    QString                _hostName;
+    int                    _port;
+    QString                _userName;
+    QString                _password;
+    QString                _connectOptions;
+};
+
+#endif
@@ -28,6 +28,7 @@ QMAKE_LIBDIR += $${OPENRPT_LIBDIR}
 LIBS += -lopenrptcommon -lMetaSQL -lz
 
 SOURCES = applock.cpp              \
+          backgroundquery.cpp      \
           calendarcontrol.cpp      \
           calendargraphicsitem.cpp \
           checkForUpdates.cpp      \
@@ -51,12 +52,16 @@ SOURCES = applock.cpp              \
           tarfile.cpp \
           xabstractmessagehandler.cpp \
           xbase32.cpp \
+          xblobcache.cpp \
           xcachedhash.cpp               \
           xtupleproductkey.cpp \
           xtNetworkRequestManager.cpp \
-          xtsettings.cpp
+          xtsettings.cpp \
+          zipwriter.cpp
 
 HEADERS = applock.h              \
+          backgroundquery.h      \
+          backgroundqueryprivate.h \
           calendarcontrol.h      \
           calendargraphicsitem.h \
           cmdlinemessagehandler.h \
@@ -80,10 +85,12 @@ HEADERS = applock.h              \
           tarfile.h \
           xabstractmessagehandler.h \
           xbase32.h \
+          xblobcache.h \
           xcachedhash.h                 \
           xtupleproductkey.h \
           xtNetworkRequestManager.h \
-          xtsettings.h
+          xtsettings.h \
+          zipwriter.h
 
 FORMS = login2.ui checkForUpdates.ui
 
@@ -11,11 +11,13 @@
 #include "errorReporter.h"
 
 #include <QApplication>
+#include <QHash>
 #include <QMap>
 #include <QMessageBox>
 #include <QRegExp>
 #include <QSourceLocation>
 #include <QVariant>
+#include <QVector>
 
 #include "storedProcErrorLookup.h"
 
@@ -29,10 +31,10 @@ enum StatementType { Unknown = 0, Select = 1, Delete = 2,
    longer term: combine the lists of messages and have a single lookup table
  */
 const struct {
-  QString constraint;
-  int     type;
-  int     lookup;       // != 0 implies msg is a storedproc lookup key
-  QString msg;
+  const char *constraint;
+  int         type;
+  int         lookup;   // != 0 implies msg is a storedproc lookup key
+  const char *msg;
 } dberrs[] = {
 // TODO: fill in with appropriate text and uncomment
 //{ "accnt_accnt_company_fkey",         Delete,  0, QT_TRANSLATE_NOOP("errorReporter", "") },
@@ -470,7 +472,7 @@ const struct {
 //{ "incdt_incdt_aropen_id_fkey",               Upsert,  0, QT_TRANSLATE_NOOP("errorReporter", "") },
   { "incdt_incdt_cntct_id_fkey",                Delete,  0, QT_TRANSLATE_NOOP("errorReporter", "This Contact cannot be deleted as s/he is the Contact for an Incident.") },
 //{ "incdt_incdt_cntct_id_fkey",                Upsert,  0, QT_TRANSLATE_NOOP("errorReporter", "") },
-  { "incdt_incdt_crmacct_id_fkey",              Delete,  0, QT_TRANSLATE_NOOP("ErrorReporter", "The selected Account cannot be deleted as it has related Incidents.") },
+  { "incdt_incdt_crmacct_id_fkey",              Delete,  0, QT_TRANSLATE_NOOP("errorReporter", "The selected Account cannot be deleted as it has related Incidents.") },
   { "incdt_incdt_crmacct_id_fkey",              Upsert,  0, QT_TRANSLATE_NOOP("errorReporter", "Cannot save the Incident with an invalid Account.") },
 //{ "incdt_incdt_incdtcat_id_fkey",             Delete,  0, QT_TRANSLATE_NOOP("errorReporter", "") },
 //{ "incdt_incdt_incdtcat_id_fkey",             Upsert,  0, QT_TRANSLATE_NOOP("errorReporter", "") },
@@ -929,8 +931,8 @@ const struct {
   { "rsncode_rsncode_code_key",                 Upsert,  0, QT_TRANSLATE_NOOP("errorReporter", "A Reason Code already exists with this code.") },
   { "sale_sale_name_check",                     Upsert,  0, QT_TRANSLATE_NOOP("errorReporter", "The Sale name is required.") },
   { "sale_sale_name_key",                       Upsert,  0, QT_TRANSLATE_NOOP("errorReporter", "A Sale name already exists with this name.") },
-  { "salescat_salescat_number_check",           Upsert,  0, QT_TRANSLATE_NOOP("errorcatorter", "The Sales Category number is required.") },
-  { "salescat_salescat_number_key",             Upsert,  0, QT_TRANSLATE_NOOP("errorcatorter", "A Sales Category already exists with this number.") },
+  { "salescat_salescat_number_check",           Upsert,  0, QT_TRANSLATE_NOOP("errorReporter", "The Sales Category number is required.") },
+  { "salescat_salescat_number_key",             Upsert,  0, QT_TRANSLATE_NOOP("errorReporter", "A Sales Category already exists with this number.") },
   { "salesrep_salesrep_emp_id_fkey",            Delete,  0, QT_TRANSLATE_NOOP("errorReporter", "Cannot delete this Sales Rep as it is associated with an Employee.") },
 //{ "salesrep_salesrep_emp_id_fkey",            Upsert,  0, QT_TRANSLATE_NOOP("errorReporter", "") },
   { "salesrep_salesrep_number_check",           Upsert,  0, QT_TRANSLATE_NOOP("errorReporter", "The Sales Rep number is required.") },
@@ -1251,6 +1253,110 @@ const struct {
 
 };
 
+/* ConstraintMatcher finds which dberrs constraint names appear in an error
+   message. It walks an Aho-Corasick automaton built from all of the names,
+   so it looks at each character of the message once instead of searching
+   the message for every name in turn.
+ */
+class ConstraintMatcher
+{
+  public:
+    ConstraintMatcher();
+
+    int match(const QString &msg, int type) const;
+
+  private:
+    static quint64 key(int state, ushort c) { return ((quint64)state << 16) | c; }
+    int edge(int state, ushort c) const     { return _edges.value(key(state, c), -1); }
+
+    QHash<quint64, int>    _edges;  // (state, character) -> next state
+    QVector<int>           _fail;   // longest proper suffix that's also a state
+    QVector<QVector<int> > _out;    // dberrs entries whose names end at a state
+};
+
+ConstraintMatcher::ConstraintMatcher()
+{
+  QVector<QVector<QPair<ushort, int> > > children(1);
+  _fail.append(0);
+  _out.append(QVector<int>());
+
+  for (unsigned int i = 0; i < sizeof(dberrs) / sizeof(dberrs[0]); i++)
+  {
+    if (! dberrs[i].lookup && ! *dberrs[i].msg)
+      continue;         // nothing to say about this one
+
+    int state = 0;
+    for (const char *c = dberrs[i].constraint; *c; c++)
+    {
+      int next = edge(state, (uchar)*c);
+      if (next < 0)
+      {
+        next = _fail.size();
+        _fail.append(0);
+        _out.append(QVector<int>());
+        children.append(QVector<QPair<ushort, int> >());
+        _edges.insert(key(state, (uchar)*c), next);
+        children[state].append(qMakePair((ushort)(uchar)*c, next));
+      }
+      state = next;
+    }
+    _out[state].append(i);
+  }
+
+  // breadth first, so every state's fail link is known before its children's
+  QList<int> queue;
+  for (int i = 0; i < children.at(0).size(); i++)
+    queue.append(children.at(0).at(i).second);
+
+  while (! queue.isEmpty())
+  {
+    int state = queue.takeFirst();
+    for (int i = 0; i < children.at(state).size(); i++)
+    {
+      ushort c     = children.at(state).at(i).first;
+      int    child = children.at(state).at(i).second;
+
+      int fail = _fail.at(state);
+      while (fail && edge(fail, c) < 0)
+        fail = _fail.at(fail);
+      int next = edge(fail, c);
+
+      _fail[child] = next < 0 ? 0 : next;
+      _out[child] += _out.at(_fail.at(child));
+      queue.append(child);
+    }
+  }
+}
+
+/* the first dberrs entry for the statement type whose constraint is in msg,
+   or -1 if there isn't one
+ */
+int ConstraintMatcher::match(const QString &msg, int type) const
+{
+  int best  = -1;
+  int state = 0;
+  for (int i = 0; i < msg.length(); i++)
+  {
+    ushort c = msg.at(i).unicode();
+    int    next;
+    while ((next = edge(state, c)) < 0 && state)
+      state = _fail.at(state);
+    state = next < 0 ? 0 : next;
+
+    const QVector<int> &found = _out.at(state);
+    for (int j = 0; j < found.size(); j++)
+      if (dberrs[found.at(j)].type & type && (best < 0 || found.at(j) < best))
+        best = found.at(j);
+  }
+  return best;
+}
+
+static const ConstraintMatcher &constraintMatcher()
+{
+  static ConstraintMatcher matcher;
+  return matcher;
+}
+
 // TODO: consider using a QAbstractMessageHandler instead of QMessageBox
 
 class ErrorReporterPrivate : public QObject
@@ -1294,7 +1400,6 @@ QString ErrorReporterPrivate::text(QSqlError err, StatementType type)
   return text(err.text(), type);
 }
 
-// TODO: find a better way to handle the lookups - binary search or hash table
 QString ErrorReporterPrivate::text(QString msg, StatementType type)
 {
   if (msg.isEmpty())
@@ -1308,17 +1413,15 @@ QString ErrorReporterPrivate::text(QString msg, StatementType type)
     return storedProcErrorLookup(_xtupleError.cap(1),
                                  _xtupleError.cap(2).toInt());
   }
-  else
+  else if (type != Unknown)     // no entry applies to an Unknown statement
   {
-    for (unsigned int i = 0; i < sizeof(dberrs) / sizeof(dberrs[0]); i++)
+    int i = constraintMatcher().match(msg, type);
+    if (i >= 0)
     {
-      if (dberrs[i].type & type && msg.contains(dberrs[i].constraint))
-      {
-        if (dberrs[i].lookup)
-          return storedProcErrorLookup(dberrs[i].msg, dberrs[i].lookup);
-        else if (! dberrs[i].msg.isEmpty())
-          return dberrs[i].msg;
-      }
+      if (dberrs[i].lookup)
+        return storedProcErrorLookup(dberrs[i].msg, dberrs[i].lookup);
+      else
+        return QCoreApplication::translate("errorReporter", dberrs[i].msg);
     }
   }
 
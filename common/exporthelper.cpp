@@ -10,32 +10,532 @@
 
 #include "exporthelper.h"
 
+#include <QBuffer>
 #include <QDir>
 #include <QDomDocument>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QMessageBox>
 #include <QProcess>
+#include <QProgressDialog>
 #include <QScriptEngine>
 #include <QScriptValue>
+#include <QSqlDriver>
 #include <QSqlError>
+#include <QSqlField>
 #include <QSqlRecord>
 #include <QTemporaryFile>
 #include <QTextCursor>
 #include <QTextDocument>
+#include <QXmlStreamWriter>
 
 #include "metasql.h"
 #include "mqlutil.h"
 #include "xsqlquery.h"
 
-
 #define DEBUG false
 
-bool ExportHelper::exportHTML(const int qryheadid, ParameterList &params, QString &filename, QString &errmsg)
+// rows per FETCH from an export cursor and rows between progress updates
+#define FETCHROWS     1000
+#define PROGRESSROWS  500
+
+/* get the query text for one qryitem record */
+static QString qryitemText(const XSqlQuery &itemq, QString &errmsg)
+{
+  QString qtext;
+  if (itemq.value("qryitem_src").toString() == "REL")
+  {
+    QString schemaName = itemq.value("qryitem_group").toString();
+    qtext = "SELECT * FROM " +
+            (schemaName.isEmpty() ? QString("") : schemaName + QString(".")) +
+            itemq.value("qryitem_detail").toString();
+  }
+  else if (itemq.value("qryitem_src").toString() == "MQL")
+  {
+    QString tmpmsg;
+    bool valid;
+    qtext = MQLUtil::mqlLoad(itemq.value("qryitem_group").toString(),
+                             itemq.value("qryitem_detail").toString(),
+                             tmpmsg, &valid);
+    if (! valid)
+      errmsg = tmpmsg;
+  }
+  else if (itemq.value("qryitem_src").toString() == "CUSTOM")
+    qtext = itemq.value("qryitem_detail").toString();
+
+  return qtext;
+}
+
+/* write the values bound to sql into it as literals, formatted by the
+   driver. placeholders are found the way the driver finds them when it
+   binds: not inside string literals, quoted identifiers or comments,
+   and never in a :: cast. returns false if a placeholder has no value.
+ */
+static bool bindLiterals(QString &sql, const QMap<QString, QVariant> &bindings,
+                         QSqlDriver *driver)
+{
+  QString result;
+  result.reserve(sql.size());
+
+  int len = sql.length();
+  int i   = 0;
+  while (i < len)
+  {
+    QChar ch = sql.at(i);
+    int   end = i + 1;
+
+    if (ch == '\'' || ch == '"')                       // literal or identifier
+    {
+      bool backslash = (ch == '\'' && i > 0 && sql.at(i - 1).toUpper() == 'E');
+      while (end < len)
+      {
+        if (backslash && sql.at(end) == '\\')
+          end += 2;
+        else if (sql.at(end) == ch && end + 1 < len && sql.at(end + 1) == ch)
+          end += 2;                                     // doubled quote
+        else if (sql.at(end++) == ch)
+          break;
+      }
+    }
+    else if (ch == '-' && sql.mid(i, 2) == "--")        // comment to the end of the line
+    {
+      end = sql.indexOf('\n', i);
+      end = (end < 0) ? len : end + 1;
+    }
+    else if (ch == '/' && sql.mid(i, 2) == "/*")
+    {
+      end = sql.indexOf("*/", i + 2);
+      end = (end < 0) ? len : end + 2;
+    }
+    else if (ch == '$')                                 // $tag$ ... $tag$
+    {
+      QRegExp tag("\\$[A-Za-z_]*\\$");
+      if (tag.indexIn(sql, i) == i && (i == 0 || ! sql.at(i - 1).isLetterOrNumber()))
+      {
+        end = sql.indexOf(tag.cap(0), i + tag.matchedLength());
+        end = (end < 0) ? len : end + tag.matchedLength();
+      }
+    }
+    else if (ch == ':' && i + 1 < len && sql.at(i + 1) == ':')
+      end = i + 2;                                      // a cast
+    else if (ch == ':' && i + 1 < len &&
+             (sql.at(i + 1).isLetter() || sql.at(i + 1) == '_'))
+    {
+      while (end < len && (sql.at(end).isLetterOrNumber() || sql.at(end) == '_'))
+        end++;
+
+      QString name = sql.mid(i, end - i);
+      if (! bindings.contains(name))
+        return false;
+
+      QVariant  value = bindings.value(name);
+      QSqlField field(QString(), value.type());
+      field.setValue(value);
+      result += driver->formatValue(field);
+      i = end;
+      continue;
+    }
+
+    result += sql.midRef(i, end - i);
+    i = end;
+  }
+
+  sql = result;
+  return true;
+}
+
+/* ExportCursor walks the results of a MetaSQL query through a server-side
+   cursor, FETCHROWS at a time, so neither the client nor the driver ever
+   holds the whole result. the driver prepares statements with PREPARE,
+   which won't take a DECLARE CURSOR, so the bound values go into the
+   declaration as literals. if the cursor can't be declared the query
+   runs forward-only instead.
+ */
+class ExportCursor
+{
+  public:
+    ExportCursor(const QString &qtext, ParameterList &params);
+    ~ExportCursor();
+
+    bool       next();
+    QSqlRecord record()    const;
+    QSqlError  lastError() const;
+
+  private:
+    bool declare();
+
+    XSqlQuery _query;
+    XSqlQuery _fetch;
+    QString   _name;
+    bool      _declared;
+    bool      _ownTransaction;
+    bool      _done;
+    int       _batchRows;
+    QSqlError _error;
+};
+
+ExportCursor::ExportCursor(const QString &qtext, ParameterList &params)
+  : _declared(false),
+    _ownTransaction(false),
+    _done(false),
+    _batchRows(FETCHROWS)
+{
+  static int cursors = 0;
+  _name = QString("xtexport%1").arg(++cursors);
+
+  MetaSQLQuery mql(qtext);
+  _query = mql.toQuery(params, QSqlDatabase(), false);
+  if (_query.lastError().type() != QSqlError::NoError)
+  {
+    _error = _query.lastError();
+    _done  = true;
+    return;
+  }
+
+  if (! declare())
+  {
+    _query.setForwardOnly(true);
+    _query.exec();
+  }
+}
+
+ExportCursor::~ExportCursor()
+{
+  if (! _declared)
+    return;
+
+  // a failed FETCH leaves the transaction aborted, so undo back to before it
+  bool      failed = (_error.type() != QSqlError::NoError);
+  XSqlQuery closeq;
+  if (_ownTransaction)
+    closeq.exec(failed ? "ROLLBACK;" : "COMMIT;");
+  else if (failed)
+    closeq.exec("ROLLBACK TO SAVEPOINT " + _name + "; RELEASE SAVEPOINT " + _name + ";");
+  else
+    closeq.exec("CLOSE " + _name + "; RELEASE SAVEPOINT " + _name + ";");
+}
+
+bool ExportCursor::declare()
+{
+  QSqlDriver *driver = QSqlDatabase::database().driver();
+  if (! driver || QSqlDatabase::database().driverName() != "QPSQL")
+    return false;
+
+  QString sql = _query.lastQuery().trimmed();
+  while (sql.endsWith(";"))
+  {
+    sql.chop(1);
+    sql = sql.trimmed();
+  }
+
+  if (! bindLiterals(sql, _query.boundValues(), driver))
+    return false;
+
+  /* the first statement of a transaction starts it, so the two times
+     only differ if the caller already has a transaction open
+   */
+  XSqlQuery declareq;
+  if (! declareq.exec("SELECT transaction_timestamp() <> statement_timestamp() AS intransaction;") ||
+      ! declareq.first())
+    return false;
+
+  _ownTransaction = ! declareq.value("intransaction").toBool();
+  if (! declareq.exec(_ownTransaction ? QString("BEGIN;") : "SAVEPOINT " + _name + ";"))
+    return false;
+
+  if (! declareq.exec("DECLARE " + _name + " NO SCROLL CURSOR FOR " + sql + ";"))
+  {
+    if (DEBUG)
+      qDebug("ExportCursor::declare() falling back: %s",
+             qPrintable(declareq.lastError().text()));
+    declareq.exec(_ownTransaction ? QString("ROLLBACK;")
+                                  : "ROLLBACK TO SAVEPOINT " + _name + "; "
+                                    "RELEASE SAVEPOINT " + _name + ";");
+    return false;
+  }
+
+  _fetch.setForwardOnly(true);
+  _declared = true;
+  return true;
+}
+
+bool ExportCursor::next()
+{
+  if (! _declared)
+    return ! _done && _query.next();
+
+  while (! _done)
+  {
+    if (_fetch.isActive() && _fetch.next())
+    {
+      _batchRows++;
+      return true;
+    }
+    if (_batchRows < FETCHROWS)   // the last FETCH came up short
+      break;
+
+    _batchRows = 0;
+    if (! _fetch.exec(QString("FETCH FORWARD %1 FROM %2;").arg(FETCHROWS).arg(_name)))
+    {
+      _error = _fetch.lastError();
+      break;
+    }
+  }
+  _done = true;
+  return false;
+}
+
+QSqlRecord ExportCursor::record() const
+{
+  return _declared ? _fetch.record() : _query.record();
+}
+
+QSqlError ExportCursor::lastError() const
+{
+  if (_error.type() != QSqlError::NoError || _declared)
+    return _error;
+  return _query.lastError();
+}
+
+/* count exported rows and keep the progress dialog, if any, up to date.
+   step() returns false when the user asks to stop.
+ */
+class ExportProgress
+{
+  public:
+    ExportProgress(QProgressDialog *progress)
+      : _progress(progress),
+        _rows(0)
+    {
+      _elapsed.start();
+      if (_progress)
+        _progress->setRange(0, 0);
+    }
+
+    bool step()
+    {
+      _rows++;
+      if (! _progress || _rows % PROGRESSROWS)
+        return true;
+
+      _progress->setLabelText(ExportHelper::tr("Exported %1 rows (%2 rows/sec)")
+                              .arg(_rows)
+                              .arg(_rows * 1000 / qMax(_elapsed.elapsed(), (qint64)1)));
+      _progress->setValue(0);
+      return ! _progress->wasCanceled();
+    }
+
+    qint64 rows() const { return _rows; }
+
+  private:
+    QProgressDialog *_progress;
+    QElapsedTimer    _elapsed;
+    qint64           _rows;
+};
+
+static bool writeString(QIODevice *out, const QString &text, QString &errmsg)
+{
+  if (out->write(text.toUtf8()) < 0)
+  {
+    errmsg = ExportHelper::tr("Error writing export: %1").arg(out->errorString());
+    return false;
+  }
+  return true;
+}
+
+static bool writeDelimitedRows(QString qtext, ParameterList &params, QIODevice *out,
+                               QString &errmsg, ExportProgress &progress, bool &started)
+{
+  if (qtext.isEmpty())
+    return true;
+
+  bool valid;
+  QString delim = params.value("delim", &valid).toString();
+  if (! valid)
+    delim = ",";
+
+  QVariant includeheaderVar = params.value("includeHeaderLine", &valid);
+  bool includeheader = (valid ? includeheaderVar.toBool() : false);
+  if (DEBUG)
+    qDebug("writeDelimitedRows() delim = %s, includeheader = %d",
+           qPrintable(delim), includeheader);
+
+  ExportCursor qry(qtext, params);
+  bool first = true;
+  while (qry.next())
+  {
+    QSqlRecord  record = qry.record();
+    QStringList field;
+    if (first && includeheader)
+    {
+      for (int p = 0; p < record.count(); p++)
+        field.append(record.fieldName(p));
+      if (! writeString(out, (started ? "\n" : "") + field.join(delim), errmsg))
+        return false;
+      started = true;
+      field.clear();
+    }
+    first = false;
+
+    for (int p = 0; p < record.count(); p++)
+    {
+      QString tmp = record.value(p).toString();
+      if (tmp.contains(delim))
+      {
+        tmp.replace("\"", "\"\"");
+        tmp = "\"" + tmp + "\"";
+      }
+      field.append(tmp);
+    }
+    if (! writeString(out, (started ? "\n" : "") + field.join(delim), errmsg))
+      return false;
+    started = true;
+
+    if (! progress.step())
+    {
+      errmsg = ExportHelper::tr("The export was canceled.");
+      return false;
+    }
+  }
+  if (qry.lastError().type() != QSqlError::NoError)
+    errmsg = qry.lastError().text();
+
+  return true;
+}
+
+static bool writeHTMLTable(QString qtext, ParameterList &params, QIODevice *out,
+                           QString &errmsg, ExportProgress &progress)
+{
+  if (qtext.isEmpty())
+    return true;
+
+  bool valid;
+  QVariant includeheaderVar = params.value("includeHeaderLine", &valid);
+  bool includeheader = (valid ? includeheaderVar.toBool() : false);
+
+  ExportCursor qry(qtext, params);
+  bool first = true;
+  while (qry.next())
+  {
+    QSqlRecord record = qry.record();
+    QString    line;
+    if (first)
+    {
+      line = "<table border=\"1\" cellspacing=\"0\" cellpadding=\"2\">\n";
+      if (includeheader)
+      {
+        line += "<tr>";
+        for (int p = 0; p < record.count(); p++)
+          line += "<th>" + record.fieldName(p).toHtmlEscaped() + "</th>";
+        line += "</tr>\n";
+      }
+      first = false;
+    }
+
+    line += "<tr>";
+    for (int i = 0; i < record.count(); i++)
+      line += "<td>" + record.value(i).toString().toHtmlEscaped() + "</td>";
+    line += "</tr>\n";
+    if (! writeString(out, line, errmsg))
+      return false;
+
+    if (! progress.step())
+    {
+      errmsg = ExportHelper::tr("The export was canceled.");
+      return false;
+    }
+  }
+  if (! first && ! writeString(out, "</table>\n", errmsg))
+    return false;
+  if (qry.lastError().type() != QSqlError::NoError)
+    errmsg = qry.lastError().text();
+
+  return true;
+}
+
+static bool writeXMLElements(QString qtext, const QString &tableElemName,
+                             const QString &schemaName, ParameterList &params,
+                             QXmlStreamWriter &xml, QString &errmsg,
+                             ExportProgress &progress)
+{
+  if (qtext.isEmpty())
+    return true;
+
+  ExportCursor qry(qtext, params);
+  while (qry.next())
+  {
+    QSqlRecord record = qry.record();
+    xml.writeStartElement(tableElemName);
+    if (! schemaName.isEmpty())
+      xml.writeAttribute("schema", schemaName);
+    for (int i = 0; i < record.count(); i++)
+      xml.writeTextElement(record.fieldName(i),
+                           record.value(i).isNull() ? QString("[NULL]")
+                                                    : record.value(i).toString());
+    xml.writeEndElement();
+
+    if (xml.hasError())
+    {
+      errmsg = ExportHelper::tr("Error writing export: %1")
+                 .arg(xml.device()->errorString());
+      return false;
+    }
+    if (! progress.step())
+    {
+      errmsg = ExportHelper::tr("The export was canceled.");
+      return false;
+    }
+  }
+  if (qry.lastError().type() != QSqlError::NoError)
+    errmsg = qry.lastError().text();
+
+  return true;
+}
+
+/* run the XSLT export map xsltmapid on the xml in a temporary file and
+   copy the result to out
+ */
+static bool writeXSLTConverted(QTemporaryFile &input, int xsltmapid,
+                               QIODevice *out, QString &errmsg)
+{
+  QTemporaryFile output(QDir::tempPath() + QDir::separator() + "exportOutput.XXXXXX.xml");
+  if (! output.open())
+  {
+    errmsg = ExportHelper::tr("Could not open temporary output file (%1).")
+               .arg(output.error());
+    return false;
+  }
+  output.close();   // windows won't let the xslt processor write it otherwise
+  input.close();
+
+  bool ok = ExportHelper::XSLTConvertFile(input.fileName(), output.fileName(),
+                                          xsltmapid, errmsg);
+  input.remove();
+  if (ok && ! output.open())
+  {
+    errmsg = ExportHelper::tr("Could not open temporary output file (%1).")
+               .arg(output.error());
+    ok = false;
+  }
+  while (ok && ! output.atEnd())
+  {
+    if (out->write(output.read(64 * 1024)) < 0)
+    {
+      errmsg = ExportHelper::tr("Error writing export: %1").arg(out->errorString());
+      ok = false;
+    }
+  }
+  output.remove();
+  return ok;
+}
+
+bool ExportHelper::exportHTML(const int qryheadid, ParameterList &params, QString &filename, QString &errmsg, QProgressDialog *progress)
 {
   if (DEBUG)
     qDebug("ExportHelper::exportHTML(%d, %d params, %s, errmsg) entered",
            qryheadid, params.size(), qPrintable(filename));
   bool returnVal = false;
+  bool written   = false;
 
   XSqlQuery setq;
   setq.prepare("SELECT * FROM qryhead WHERE qryhead_id=:id;");
@@ -49,16 +549,16 @@ bool ExportHelper::exportHTML(const int qryheadid, ParameterList &params, QStrin
       filename = fileinfo.absoluteFilePath();
     }
 
-    QFile *exportfile = new QFile(filename);
-    if (! exportfile->open(QIODevice::ReadWrite | QIODevice::Truncate | QIODevice::Text))
+    QFile exportfile(filename);
+    if (! exportfile.open(QIODevice::ReadWrite | QIODevice::Truncate | QIODevice::Text))
       errmsg = tr("Could not open %1: %2.")
-                                      .arg(filename, exportfile->errorString());
+                                      .arg(filename, exportfile.errorString());
     else
     {
-      if (exportfile->write(generateHTML(qryheadid, params, errmsg).toUtf8()) < 0)
-        errmsg = tr("Error writing to %1: %2")
-                                      .arg(filename, exportfile->errorString());
-      exportfile->close();
+      written = writeHTML(qryheadid, params, &exportfile, errmsg, progress);
+      exportfile.close();
+      if (! written)
+        exportfile.remove();    // don't leave a partial export behind
     }
   }
   else if (setq.lastError().type() != QSqlError::NoError)
@@ -67,6 +567,8 @@ bool ExportHelper::exportHTML(const int qryheadid, ParameterList &params, QStrin
     errmsg = tr("<p>Cannot export data because the query set with "
                 "id %1 was not found.").arg(qryheadid);
 
+  returnVal = written && errmsg.isEmpty();
+
   if (DEBUG)
     qDebug("ExportHelper::exportHTML returning %d, filename %s, and errmsg %s",
            returnVal, qPrintable(filename), qPrintable(errmsg));
@@ -103,12 +605,13 @@ bool ExportHelper::exportHTML(const int qryheadid, ParameterList &params, QStrin
                      field of this record and the XSLTDefaultDir will be used
                      to find the XSLT script to run on the generated XML.
   */
-bool ExportHelper::exportXML(const int qryheadid, ParameterList &params, QString &filename, QString &errmsg, const int xsltmapid)
+bool ExportHelper::exportXML(const int qryheadid, ParameterList &params, QString &filename, QString &errmsg, const int xsltmapid, QProgressDialog *progress)
 {
   if (DEBUG)
     qDebug("ExportHelper::exportXML(%d, %d params, %s, errmsg, %d) entered",
            qryheadid, params.size(), qPrintable(filename), xsltmapid);
   bool returnVal = false;
+  bool written   = false;
 
   XSqlQuery setq;
   setq.prepare("SELECT * FROM qryhead WHERE qryhead_id=:id;");
@@ -127,8 +630,10 @@ bool ExportHelper::exportXML(const int qryheadid, ParameterList &params, QString
       errmsg = tr("Could not open %1 (%2).").arg(filename,exportfile.error());
     else
     {
-      exportfile.write(generateXML(qryheadid, params, errmsg, xsltmapid).toUtf8());
+      written = writeXML(qryheadid, params, &exportfile, errmsg, xsltmapid, progress);
       exportfile.close();
+      if (! written)
+        exportfile.remove();    // don't leave a partial export behind
     }
   }
   else if (setq.lastError().type() != QSqlError::NoError)
@@ -141,17 +646,50 @@ bool ExportHelper::exportXML(const int qryheadid, ParameterList &params, QString
     qDebug("ExportHelper::exportXML returning %d, filename %s, and errmsg %s",
            returnVal, qPrintable(filename), qPrintable(errmsg));
 
-  returnVal = errmsg.isEmpty();
+  returnVal = written && errmsg.isEmpty();
   return returnVal;
 }
 
 QString ExportHelper::generateDelimited(const int qryheadid, ParameterList &params, QString &errmsg)
+{
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  writeDelimited(qryheadid, params, &buffer, errmsg);
+  return QString::fromUtf8(buffer.data());
+}
+
+QString ExportHelper::generateDelimited(QString qtext, ParameterList &params, QString &errmsg)
+{
+  if (qtext.isEmpty())
+    return QString::null;
+
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  writeDelimited(qtext, params, &buffer, errmsg);
+  return QString::fromUtf8(buffer.data());
+}
+
+/** \brief Write the results of a query set to a device as delimited text.
+
+  The rows are written as they are fetched, so the export never has to fit
+  in memory. The results of the queries in the set are separated by a
+  newline. The @c delim and @c includeHeaderLine parameters work as they
+  do for generateDelimited.
+
+  \param progress An optional dialog to show the number of rows written
+                  and rows per second. Canceling it stops the export.
+
+  \return false if writing failed or was canceled; query errors are
+          reported in errmsg.
+ */
+bool ExportHelper::writeDelimited(const int qryheadid, ParameterList &params, QIODevice *out, QString &errmsg, QProgressDialog *progress)
 {
   if (DEBUG)
-    qDebug("ExportHelper::exportDelimited(%d, %d params, errmsgd) entered",
+    qDebug("ExportHelper::writeDelimited(%d, %d params, out, errmsg) entered",
            qryheadid, params.size());
 
-  QStringList result;
+  ExportProgress counter(progress);
+  bool           started = false;
 
   XSqlQuery itemq;
   itemq.prepare("SELECT *"
@@ -162,104 +700,32 @@ QString ExportHelper::generateDelimited(const int qryheadid, ParameterList &para
   itemq.exec();
   while (itemq.next())
   {
-    QString qtext;
-    if (itemq.value("qryitem_src").toString() == "REL")
-    {
-      QString schemaName = itemq.value("qryitem_group").toString();
-      qtext = "SELECT * FROM " +
-              (schemaName.isEmpty() ? QString("") : schemaName + QString(".")) +
-              itemq.value("qryitem_detail").toString();
-    }
-    else if (itemq.value("qryitem_src").toString() == "MQL")
-    {
-      QString tmpmsg;
-      bool valid;
-      qtext = MQLUtil::mqlLoad(itemq.value("qryitem_group").toString(),
-                               itemq.value("qryitem_detail").toString(),
-                               tmpmsg, &valid);
-      if (! valid)
-        errmsg = tmpmsg;
-    }
-    else if (itemq.value("qryitem_src").toString() == "CUSTOM")
-      qtext = itemq.value("qryitem_detail").toString();
-
-    if (! qtext.isEmpty())
-    {
-      QString oneresult = generateDelimited(qtext, params, errmsg);
-      if (! oneresult.isEmpty())
-        result.append(oneresult);
-    }
+    QString qtext = qryitemText(itemq, errmsg);
+    if (! writeDelimitedRows(qtext, params, out, errmsg, counter, started))
+      return false;
   }
   if (itemq.lastError().type() != QSqlError::NoError)
     errmsg = itemq.lastError().text();
 
-  return result.join("\n");
+  return true;
 }
 
-QString ExportHelper::generateDelimited(QString qtext, ParameterList &params, QString &errmsg)
+bool ExportHelper::writeDelimited(QString qtext, ParameterList &params, QIODevice *out, QString &errmsg, QProgressDialog *progress)
 {
   if (DEBUG)
-    qDebug("ExportHelper::generateDelimited(%s..., %d params, errmsg) entered",
+    qDebug("ExportHelper::writeDelimited(%s..., %d params, out, errmsg) entered",
            qPrintable(qtext.left(80)), params.size());
-  if (qtext.isEmpty())
-    return QString::null;
-
   if (DEBUG)
   {
     QStringList plist;
     for (int i = 0; i < params.size(); i++)
       plist.append("\t" + params.name(i) + ":\t" + params.value(i).toString());
-    qDebug("generateDelimited parameters:\n%s", qPrintable(plist.join("\n")));
-  }
-
-  bool valid;
-  QString delim = params.value("delim", &valid).toString();
-  if (! valid)
-    delim = ",";
-  if (DEBUG)
-    qDebug("generateDelimited(qtest, params, errmsg) delim = %s, valid = %d",
-           qPrintable(delim), valid);
-
-  QVariant includeheaderVar = params.value("includeHeaderLine", &valid);
-  bool includeheader = (valid ? includeheaderVar.toBool() : false);
-  if (DEBUG)
-    qDebug("generateDelimited(qtest, params, errmsg) includeheader = %d, valid = %d",
-           includeheader, valid);
-
-  QStringList line;
-  MetaSQLQuery mql(qtext);
-  XSqlQuery qry = mql.toQuery(params);
-  if (qry.first())
-  {
-    QStringList field;
-    int cols = qry.record().count();
-    if (includeheader)
-    {
-      for (int p = 0; p < cols; p++)
-        field.append(qry.record().fieldName(p));
-      line.append(field.join(delim));
-    }
-
-    QString tmp;
-    do {
-      field.clear();
-      for (int p = 0; p < cols; p++)
-      {
-        tmp = qry.value(p).toString();
-        if (tmp.contains(delim))
-        {
-          tmp.replace("\"", "\"\"");
-          tmp = "\"" + tmp + "\"";
-        }
-        field.append(tmp);
-      }
-      line.append(field.join(delim));
-    } while (qry.next());
+    qDebug("writeDelimited parameters:\n%s", qPrintable(plist.join("\n")));
   }
-  if (qry.lastError().type() != QSqlError::NoError)
-    errmsg = qry.lastError().text();
 
-  return line.join("\n");
+  ExportProgress counter(progress);
+  bool           started = false;
+  return writeDelimitedRows(qtext, params, out, errmsg, counter, started);
 }
 
 QString ExportHelper::generateHTML(const int qryheadid, ParameterList &params, QString &errmsg)
@@ -276,27 +742,7 @@ QString ExportHelper::generateHTML(const int qryheadid, ParameterList &params, Q
   itemq.exec();
   while (itemq.next())
   {
-    QString qtext;
-    if (itemq.value("qryitem_src").toString() == "REL")
-    {
-      QString schemaName = itemq.value("qryitem_group").toString();
-      qtext = "SELECT * FROM " +
-              (schemaName.isEmpty() ? QString("") : schemaName + QString(".")) +
-              itemq.value("qryitem_detail").toString();
-    }
-    else if (itemq.value("qryitem_src").toString() == "MQL")
-    {
-      QString tmpmsg;
-      bool valid;
-      qtext = MQLUtil::mqlLoad(itemq.value("qryitem_group").toString(),
-                               itemq.value("qryitem_detail").toString(),
-                               tmpmsg, &valid);
-      if (! valid)
-        errmsg = tmpmsg;
-    }
-    else if (itemq.value("qryitem_src").toString() == "CUSTOM")
-      qtext = itemq.value("qryitem_detail").toString();
-
+    QString qtext = qryitemText(itemq, errmsg);
     if (! qtext.isEmpty())
       cursor.insertHtml(generateHTML(qtext, params, errmsg));
   }
@@ -360,22 +806,108 @@ QString ExportHelper::generateHTML(QString qtext, ParameterList &params, QString
   return doc.toHtml();
 }
 
+/** \brief Write the results of a query set to a device as an HTML page.
+
+  Each query in the set becomes a plain HTML table, written row by row as
+  the rows are fetched. Unlike generateHTML this does not build a
+  QTextDocument, so the markup is simpler but the size of the export is
+  not limited by memory.
+ */
+bool ExportHelper::writeHTML(const int qryheadid, ParameterList &params, QIODevice *out, QString &errmsg, QProgressDialog *progress)
+{
+  if (DEBUG)
+    qDebug("ExportHelper::writeHTML(%d, %d params, out, errmsg) entered",
+           qryheadid, params.size());
+
+  ExportProgress counter(progress);
+  if (! writeString(out, "<html><head><meta http-equiv=\"Content-Type\""
+                         " content=\"text/html; charset=utf-8\"/></head><body>\n",
+                    errmsg))
+    return false;
+
+  XSqlQuery itemq;
+  itemq.prepare("SELECT * FROM qryitem WHERE qryitem_qryhead_id=:id ORDER BY qryitem_order;");
+  itemq.bindValue(":id", qryheadid);
+  itemq.exec();
+  while (itemq.next())
+  {
+    QString qtext = qryitemText(itemq, errmsg);
+    if (! writeHTMLTable(qtext, params, out, errmsg, counter))
+      return false;
+  }
+  if (itemq.lastError().type() != QSqlError::NoError)
+    errmsg = itemq.lastError().text();
+
+  return writeString(out, "</body></html>\n", errmsg);
+}
+
+bool ExportHelper::writeHTML(QString qtext, ParameterList &params, QIODevice *out, QString &errmsg, QProgressDialog *progress)
+{
+  if (DEBUG)
+    qDebug("ExportHelper::writeHTML(%s..., %d params, out, errmsg) entered",
+           qPrintable(qtext.left(80)), params.size());
+
+  ExportProgress counter(progress);
+  return writeString(out, "<html><head><meta http-equiv=\"Content-Type\""
+                          " content=\"text/html; charset=utf-8\"/></head><body>\n",
+                     errmsg) &&
+         writeHTMLTable(qtext, params, out, errmsg, counter) &&
+         writeString(out, "</body></html>\n", errmsg);
+}
+
 QString ExportHelper::generateXML(const int qryheadid, ParameterList &params, QString &errmsg, int xsltmapid)
+{
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  writeXML(qryheadid, params, &buffer, errmsg, xsltmapid);
+  return QString::fromUtf8(buffer.data());
+}
+
+QString ExportHelper::generateXML(QString qtext, QString tableElemName, ParameterList &params, QString &errmsg, int xsltmapid)
+{
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  writeXML(qtext, tableElemName, params, &buffer, errmsg, xsltmapid);
+  return QString::fromUtf8(buffer.data());
+}
+
+/** \brief Write the results of a query set to a device as xtupleimport XML.
+
+  This writes the same XML as generateXML but streams it to out as the rows
+  are fetched. If xsltmapid is set, the XML goes to a temporary file first
+  so the XSLT processor can convert it, and the result is copied to out.
+ */
+bool ExportHelper::writeXML(const int qryheadid, ParameterList &params, QIODevice *out, QString &errmsg, int xsltmapid, QProgressDialog *progress)
 {
   if (DEBUG)
-    qDebug("ExportHelper::generateXML(%d, %d params, errmsg, %d) entered",
+    qDebug("ExportHelper::writeXML(%d, %d params, out, errmsg, %d) entered",
            qryheadid, params.size(), xsltmapid);
   if (DEBUG)
   {
     QStringList plist;
     for (int i = 0; i < params.size(); i++)
       plist.append("\t" + params.name(i) + ":\t" + params.value(i).toString());
-    qDebug("generateXML parameters:\n%s", qPrintable(plist.join("\n")));
+    qDebug("writeXML parameters:\n%s", qPrintable(plist.join("\n")));
+  }
+
+  QTemporaryFile xmlfile(QDir::tempPath() + QDir::separator() + "exportInput.XXXXXX.xml");
+  QIODevice *dest = out;
+  if (xsltmapid >= 0)
+  {
+    if (! xmlfile.open())
+    {
+      errmsg = tr("Could not open temporary input file (%1).").arg(xmlfile.error());
+      return false;
+    }
+    dest = &xmlfile;
   }
 
-  QDomDocument xmldoc("xtupleimport");
-  QDomElement rootelem = xmldoc.createElement("xtupleimport");
-  xmldoc.appendChild(rootelem);
+  ExportProgress   counter(progress);
+  QXmlStreamWriter xml(dest);
+  xml.setAutoFormatting(true);
+  xml.setAutoFormattingIndent(1);
+  xml.writeDTD("<!DOCTYPE xtupleimport>");
+  xml.writeStartElement("xtupleimport");
 
   XSqlQuery itemq;
   QString tableElemName;
@@ -385,115 +917,66 @@ QString ExportHelper::generateXML(const int qryheadid, ParameterList &params, QS
   itemq.exec();
   while (itemq.next())
   {
-    QString qtext;
     tableElemName = itemq.value("qryitem_name").toString();
     if (itemq.value("qryitem_src").toString() == "REL")
-    {
       schemaName = itemq.value("qryitem_group").toString();
-      qtext = "SELECT * FROM " +
-              (schemaName.isEmpty() ? QString("") : schemaName + QString(".")) +
-              itemq.value("qryitem_detail").toString();
-    }
-    else if (itemq.value("qryitem_src").toString() == "MQL")
-    {
-      QString tmpmsg;
-      bool valid;
-      qtext = MQLUtil::mqlLoad(itemq.value("qryitem_group").toString(),
-                               itemq.value("qryitem_detail").toString(),
-                               tmpmsg, &valid);
-      if (! valid)
-        errmsg = tmpmsg;
-    }
-    else if (itemq.value("qryitem_src").toString() == "CUSTOM")
-      qtext = itemq.value("qryitem_detail").toString();
 
-    if (! qtext.isEmpty())
+    QString qtext = qryitemText(itemq, errmsg);
+    if (! writeXMLElements(qtext, tableElemName, schemaName, params, xml, errmsg, counter))
     {
-      MetaSQLQuery mql(qtext);
-      XSqlQuery qry = mql.toQuery(params);
-      if (qry.first())
-      {
-        do {
-          QDomElement tableElem = xmldoc.createElement(tableElemName);
-
-          if (DEBUG)
-            qDebug("exportXML starting %s", qPrintable(tableElemName));
-          if (! schemaName.isEmpty())
-            tableElem.setAttribute("schema", schemaName);
-          for (int i = 0; i < qry.record().count(); i++)
-          {
-            QDomElement fieldElem = xmldoc.createElement(qry.record().fieldName(i));
-            if (qry.record().value(i).isNull())
-              fieldElem.appendChild(xmldoc.createTextNode("[NULL]"));
-            else
-              fieldElem.appendChild(xmldoc.createTextNode(qry.record().value(i).toString()));
-            tableElem.appendChild(fieldElem);
-          }
-          rootelem.appendChild(tableElem);
-        } while (qry.next());
-      }
-      if (qry.lastError().type() != QSqlError::NoError)
-        errmsg = qry.lastError().text();
+      if (xsltmapid >= 0)
+        xmlfile.remove();       // canceled or failed before the transform
+      return false;
     }
   }
   if (itemq.lastError().type() != QSqlError::NoError)
     errmsg = itemq.lastError().text();
 
-  if (xsltmapid < 0)
-    return xmldoc.toString();
-  else
-    return XSLTConvertString(xmldoc.toString(), xsltmapid, errmsg);
+  xml.writeEndDocument();
+
+  if (xsltmapid >= 0)
+    return writeXSLTConverted(xmlfile, xsltmapid, out, errmsg);
+  return true;
 }
 
-QString ExportHelper::generateXML(QString qtext, QString tableElemName, ParameterList &params, QString &errmsg, int xsltmapid)
+bool ExportHelper::writeXML(QString qtext, QString tableElemName, ParameterList &params, QIODevice *out, QString &errmsg, int xsltmapid, QProgressDialog *progress)
 {
   if (DEBUG)
-    qDebug("ExportHelper::generateXML(%s..., %s, %d params, errmsg, %d) entered",
+    qDebug("ExportHelper::writeXML(%s..., %s, %d params, out, errmsg, %d) entered",
            qPrintable(qtext.left(80)), qPrintable(tableElemName),
            params.size(), xsltmapid);
-  if (DEBUG)
+
+  QTemporaryFile xmlfile(QDir::tempPath() + QDir::separator() + "exportInput.XXXXXX.xml");
+  QIODevice *dest = out;
+  if (xsltmapid >= 0)
   {
-    QStringList plist;
-    for (int i = 0; i < params.size(); i++)
-      plist.append("\t" + params.name(i) + ":\t" + params.value(i).toString());
-    qDebug("generateXML parameters:\n%s", qPrintable(plist.join("\n")));
+    if (! xmlfile.open())
+    {
+      errmsg = tr("Could not open temporary input file (%1).").arg(xmlfile.error());
+      return false;
+    }
+    dest = &xmlfile;
   }
 
-  QDomDocument xmldoc("xtupleimport");
-  QDomElement rootelem = xmldoc.createElement("xtupleimport");
-  xmldoc.appendChild(rootelem);
+  ExportProgress   counter(progress);
+  QXmlStreamWriter xml(dest);
+  xml.setAutoFormatting(true);
+  xml.setAutoFormattingIndent(1);
+  xml.writeDTD("<!DOCTYPE xtupleimport>");
+  xml.writeStartElement("xtupleimport");
 
-  if (! qtext.isEmpty())
+  if (! writeXMLElements(qtext, tableElemName, QString(), params, xml, errmsg, counter))
   {
-    MetaSQLQuery mql(qtext);
-    XSqlQuery qry = mql.toQuery(params);
-    if (qry.first())
-    {
-      do {
-        QDomElement tableElem = xmldoc.createElement(tableElemName);
-
-        if (DEBUG)
-          qDebug("generateXML starting %s", qPrintable(tableElemName));
-        for (int i = 0; i < qry.record().count(); i++)
-        {
-          QDomElement fieldElem = xmldoc.createElement(qry.record().fieldName(i));
-          if (qry.record().value(i).isNull())
-            fieldElem.appendChild(xmldoc.createTextNode("[NULL]"));
-          else
-            fieldElem.appendChild(xmldoc.createTextNode(qry.record().value(i).toString()));
-          tableElem.appendChild(fieldElem);
-        }
-        rootelem.appendChild(tableElem);
-      } while (qry.next());
-    }
-    if (qry.lastError().type() != QSqlError::NoError)
-      errmsg = qry.lastError().text();
+    if (xsltmapid >= 0)
+      xmlfile.remove();         // canceled or failed before the transform
+    return false;
   }
 
-  if (xsltmapid < 0)
-    return xmldoc.toString();
-  else
-    return XSLTConvertString(xmldoc.toString(), xsltmapid, errmsg);
+  xml.writeEndDocument();
+
+  if (xsltmapid >= 0)
+    return writeXSLTConverted(xmlfile, xsltmapid, out, errmsg);
+  return true;
 }
 
 bool ExportHelper::XSLTConvertFile(QString inputfilename, QString outputfilename, int xsltmapid, QString &errmsg)
@@ -19,6 +19,8 @@
 
 #include <parameter.h>
 
+class QIODevice;
+class QProgressDialog;
 class QScriptEngine;
 
 class ExportHelper : public QObject
@@ -28,14 +30,20 @@ class ExportHelper : public QObject
   public:
     enum delimCheck{valid=0, tooLong=1, disallowed=2, disencouraged=3};
 
-    static bool exportHTML(const int qryheadid, ParameterList &params, QString &filename, QString &errmsg);
-    static bool exportXML(const int qryheadid, ParameterList &params, QString &filename, QString &errmsg, const int xsltmapid = -1);
+    static bool exportHTML(const int qryheadid, ParameterList &params, QString &filename, QString &errmsg, QProgressDialog *progress = 0);
+    static bool exportXML(const int qryheadid, ParameterList &params, QString &filename, QString &errmsg, const int xsltmapid = -1, QProgressDialog *progress = 0);
     static QString generateDelimited(const int qryheadid, ParameterList &params, QString &errmsg);
     static QString generateDelimited(QString qtext, ParameterList &params, QString &errmsg);
     static QString generateHTML(const int qryheadid, ParameterList &params, QString &errmsg);
     static QString generateHTML(QString qtext, ParameterList &params, QString &errmsg);
     static QString generateXML(const int qryheadid, ParameterList &params, QString &errmsg, int xsltmapid = -1);
     static QString generateXML(QString qtext, QString tableElemName, ParameterList &params, QString &errmsg, int xsltmapid = -1);
+    static bool    writeDelimited(const int qryheadid, ParameterList &params, QIODevice *out, QString &errmsg, QProgressDialog *progress = 0);
+    static bool    writeDelimited(QString qtext, ParameterList &params, QIODevice *out, QString &errmsg, QProgressDialog *progress = 0);
+    static bool    writeHTML(const int qryheadid, ParameterList &params, QIODevice *out, QString &errmsg, QProgressDialog *progress = 0);
+    static bool    writeHTML(QString qtext, ParameterList &params, QIODevice *out, QString &errmsg, QProgressDialog *progress = 0);
+    static bool    writeXML(const int qryheadid, ParameterList &params, QIODevice *out, QString &errmsg, int xsltmapid = -1, QProgressDialog *progress = 0);
+    static bool    writeXML(QString qtext, QString tableElemName, ParameterList &params, QIODevice *out, QString &errmsg, int xsltmapid = -1, QProgressDialog *progress = 0);
     static bool    XSLTConvertFile(QString inputfilename, QString outputfilename, QString xsltfilename, QString &errmsg);
     static bool    XSLTConvertFile(QString inputfilename, QString outputfilename, int xsltmapid, QString &errmsg);
     static QString XSLTConvertString(QString input, int xsltmapid, QString &errmsg);
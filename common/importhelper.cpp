@@ -14,15 +14,19 @@
 #include <QDate>
 #include <QDateTime>
 #include <QDirIterator>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QMessageBox>
 #include <QPluginLoader>
 #include <QProcess>
+#include <QProgressDialog>
 #include <QScriptEngine>
 #include <QScriptValue>
 #include <QSqlError>
 #include <QTemporaryFile>
 #include <QVariant>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
 #include <xsqlquery.h>
 
@@ -34,6 +38,11 @@
 #define DEFAULT_SAVE_SUFFIX ".done"
 #define DEFAULT_ERR_SUFFIX  ".err"
 
+// how many xml import elements to send at once and how often to report progress
+#define BATCHROWS           100
+#define BATCHCHARS          (1024 * 1024)
+#define PROGRESSROWS        100
+
 #define DEBUG false
 
 static QString getUniqueFileName(QString poriginalname)
@@ -293,6 +302,377 @@ bool ImportHelper::handleFilePostImport(const QString &pfilename, bool success,
   return returnValue;
 }
 
+/* one view-level element of an xtupleimport file, read straight from the
+   stream so the file never has to fit in memory as a DOM.
+ */
+class XmlImportColumn
+{
+  public:
+    QString              name;
+    QXmlStreamAttributes attributes;
+    QString              text;
+};
+
+class XmlImportElement
+{
+  public:
+    XmlImportElement() : ignoreErr(false), silent(false) {}
+
+    void read(QXmlStreamReader &reader);
+    void write(QXmlStreamWriter &writer, const QString &comment = QString()) const;
+    bool hasColumn(const QString &name) const;
+    QString attribute(const QString &name, const QString &defaultValue = QString()) const;
+
+    QString                tagName;
+    QXmlStreamAttributes   attributes;
+    QList<XmlImportColumn> columns;
+
+    // filled in by XmlImportBatch::add()
+    bool        ignoreErr;
+    bool        silent;
+    QString     mode;
+    QString     viewName;
+    QString     savepointName;
+    QString     sql;
+};
+
+void XmlImportElement::read(QXmlStreamReader &reader)
+{
+  tagName    = reader.name().toString();
+  attributes = reader.attributes();
+  while (reader.readNextStartElement())
+  {
+    XmlImportColumn column;
+    column.name       = reader.name().toString();
+    column.attributes = reader.attributes();
+    column.text       = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+    columns.append(column);
+  }
+}
+
+void XmlImportElement::write(QXmlStreamWriter &writer, const QString &comment) const
+{
+  writer.writeStartElement(tagName);
+  writer.writeAttributes(attributes);
+  foreach (const XmlImportColumn &column, columns)
+  {
+    writer.writeStartElement(column.name);
+    writer.writeAttributes(column.attributes);
+    if (! column.text.isEmpty())
+      writer.writeCharacters(column.text);
+    writer.writeEndElement();
+  }
+  if (! comment.isEmpty())
+    writer.writeComment(comment);
+  writer.writeEndElement();
+}
+
+bool XmlImportElement::hasColumn(const QString &name) const
+{
+  foreach (const XmlImportColumn &column, columns)
+  {
+    if (column.name == name)
+      return true;
+  }
+  return false;
+}
+
+QString XmlImportElement::attribute(const QString &name, const QString &defaultValue) const
+{
+  return attributes.hasAttribute(name) ? attributes.value(name).toString()
+                                       : defaultValue;
+}
+
+/* collects consecutive elements for the same view and mode and sends them
+   to the server as one string of statements inside a savepoint. if that
+   fails, the savepoint is rolled back and the elements are run again one
+   at a time, so each gets the same ignore/silent/error-file treatment it
+   would have gotten on its own. the statements are not merged into one
+   multi-row INSERT because the api views' rules may rely on running once
+   per row.
+ */
+class XmlImportBatch
+{
+  public:
+    XmlImportBatch(const QString &fileName, bool saveErrorXML,
+                   QStringList &errors, QStringList &warnings);
+
+    void    add(XmlImportElement &elem);
+    void    flush();
+    QString errorXML();
+
+  private:
+    void    run(const XmlImportElement &elem);
+    void    saveError(const XmlImportElement &elem, const QString &comment = QString());
+
+    QString                 _fileName;
+    bool                    _saveErrorXML;
+    QStringList            &_errors;
+    QStringList            &_warnings;
+    QList<XmlImportElement> _pending;
+    QString                 _pendingKey;
+    int                     _pendingLength;
+    QString                 _errorXML;
+    QXmlStreamWriter        _errorWriter;
+    bool                    _errorStarted;
+};
+
+XmlImportBatch::XmlImportBatch(const QString &fileName, bool saveErrorXML,
+                               QStringList &errors, QStringList &warnings)
+  : _fileName(fileName),
+    _saveErrorXML(saveErrorXML),
+    _errors(errors),
+    _warnings(warnings),
+    _pendingLength(0),
+    _errorWriter(&_errorXML),
+    _errorStarted(false)
+{
+  _errorWriter.setAutoFormatting(true);
+  _errorWriter.setAutoFormattingIndent(1);
+}
+
+void XmlImportBatch::add(XmlImportElement &elem)
+{
+  QRegExp apos("\\\\*'");
+
+  elem.ignoreErr = (elem.attribute("ignore", "false").isEmpty() ||
+                    elem.attribute("ignore", "false") == "true");
+
+  elem.silent = (elem.attribute("silent", "false").isEmpty() ||
+                 elem.attribute("silent", "false") == "true");
+
+  elem.mode = elem.attribute("mode", "insert");
+  QStringList keyList;
+  if (! elem.attribute("key").isEmpty())
+    keyList = elem.attribute("key").split(QRegExp(",\\s*"));
+
+  elem.viewName = elem.tagName;
+  if (elem.viewName.indexOf(".") > 0)
+    ; // viewName contains . so accept that it's schema-qualified
+  else if (! elem.attribute("schema").isEmpty())
+    elem.viewName = elem.attribute("schema") + "." + elem.viewName;
+  else // backwards compatibility - must be in the api schema
+    elem.viewName = "api." + elem.viewName;
+
+  elem.savepointName = elem.viewName;
+  elem.savepointName.remove(".");
+
+  if (elem.mode.isEmpty())
+    elem.mode = "insert";
+  else if (elem.mode == "update" && keyList.isEmpty())
+  {
+    if (elem.hasColumn(elem.viewName + "_number"))
+      keyList.append(elem.viewName + "_number");
+    else if (elem.hasColumn("order_number"))
+      keyList.append("order_number");
+    else
+    {
+      flush();
+      QString msg = ImportHelper::tr("Cannot process %1 element without a key attribute")
+                      .arg(elem.tagName);
+      if (elem.ignoreErr || _saveErrorXML)
+      {
+        _warnings.append(msg);
+        if (_saveErrorXML)
+          saveError(elem);
+      }
+      else
+        _errors.append(msg);
+      return;
+    }
+    if (elem.hasColumn("line_number"))
+      keyList.append("line_number");
+  }
+
+  QStringList columnNameList;
+  QStringList columnValueList;
+  foreach (const XmlImportColumn &column, elem.columns)
+  {
+    QString value = column.attributes.value("value").isEmpty() ?
+                            column.text : column.attributes.value("value").toString();
+    if (DEBUG)
+      qDebug("%s before transformation: /%s/",
+             qPrintable(column.name), qPrintable(value));
+
+    columnNameList.append(column.name);
+
+    if (value.trimmed() == "[NULL]")
+      columnValueList.append("NULL");
+    else if (value.trimmed().startsWith("SELECT"))
+      columnValueList.append("(" + value.trimmed() + ")");
+    else if (column.attributes.value("quote") == "false")
+      columnValueList.append(value);
+    else
+      columnValueList.append("'" + value.replace(apos, "''") + "'");
+
+    if (DEBUG)
+      qDebug("%s after transformation: /%s/",
+             qPrintable(column.name), qPrintable(value));
+  }
+
+  if (elem.mode == "update")
+  {
+    QStringList whereList;
+    for (int i = 0; i < keyList.size(); i++)
+      whereList.append("(" + keyList[i] + "=" +
+                       columnValueList[columnNameList.indexOf(keyList[i])] + ")");
+
+    for (int i = 0; i < columnNameList.size(); i++)
+      columnNameList[i].append("=" + columnValueList[i]);
+
+    elem.sql = "UPDATE " + elem.viewName + " SET " +
+               columnNameList.join(", ") +
+               " WHERE (" + whereList.join(" AND ") + ");";
+  }
+  else if (elem.mode == "insert")
+    elem.sql = "INSERT INTO " + elem.viewName + " (" +
+               columnNameList.join(", ") +
+               " ) SELECT " +
+               columnValueList.join(", ") + ";" ;
+  else
+  {
+    flush();
+    if (! elem.ignoreErr)
+      _errors.append(ImportHelper::tr("Could not process %1: invalid mode %2")
+                     .arg(elem.tagName, elem.mode));
+    return;
+  }
+
+  QString key = elem.viewName + " " + elem.mode;
+  if (key != _pendingKey || _pending.size() >= BATCHROWS ||
+      _pendingLength + elem.sql.length() > BATCHCHARS)
+    flush();
+
+  _pendingKey     = key;
+  _pendingLength += elem.sql.length();
+  _pending.append(elem);
+}
+
+void XmlImportBatch::flush()
+{
+  QList<XmlImportElement> pending;
+  pending.swap(_pending);
+  _pendingKey.clear();
+  _pendingLength = 0;
+
+  if (pending.size() > 1)
+  {
+    QStringList statements;
+    foreach (const XmlImportElement &elem, pending)
+      statements.append(elem.sql);
+
+    XSqlQuery q;
+    if (DEBUG) qDebug("About to run %d statements", pending.size());
+    q.exec("SAVEPOINT xtimportbatch; " + statements.join(" ") +
+           " RELEASE SAVEPOINT xtimportbatch;");
+    if (q.lastError().type() == QSqlError::NoError)
+      return;
+
+    q.exec("ROLLBACK TO SAVEPOINT xtimportbatch;");
+    q.exec("RELEASE SAVEPOINT xtimportbatch;");
+  }
+
+  foreach (const XmlImportElement &elem, pending)
+    run(elem);
+}
+
+void XmlImportBatch::run(const XmlImportElement &elem)
+{
+  XSqlQuery q;
+  bool haveSavepoint = (elem.ignoreErr || _saveErrorXML);
+
+  if (DEBUG) qDebug("About to run this: %s", qPrintable(elem.sql));
+  if (haveSavepoint)
+    q.exec("SAVEPOINT " + elem.savepointName + "; " + elem.sql +
+           " RELEASE SAVEPOINT " + elem.savepointName + ";");
+  else
+    q.exec(elem.sql);
+
+  if (q.lastError().type() == QSqlError::NoError)
+    return;
+
+  QSqlError err = q.lastError();
+  if (haveSavepoint)
+    q.exec("ROLLBACK TO SAVEPOINT " + elem.savepointName + ";");
+  if (elem.ignoreErr)
+  {
+    if (! elem.silent)
+      _warnings.append(ImportHelper::tr("Ignored error while importing %1:\n%2")
+                          .arg(elem.tagName, err.text()));
+  }
+  else if (_saveErrorXML)
+  {
+    _warnings.append(ImportHelper::tr("Error processing %1. Saving to retry later:\t%2")
+                          .arg(elem.tagName, err.text()));
+    saveError(elem, err.text());
+  }
+  else
+    _errors.append(ImportHelper::tr("Error importing %1: %2")
+                  .arg(_fileName, err.databaseText()));
+}
+
+void XmlImportBatch::saveError(const XmlImportElement &elem, const QString &comment)
+{
+  if (! _errorStarted)
+  {
+    _errorWriter.writeStartElement("xtupleimport");
+    _errorStarted = true;
+  }
+  elem.write(_errorWriter, comment);
+}
+
+/* the contents for the error file, or an empty string if there were no
+   elements to save
+ */
+QString XmlImportBatch::errorXML()
+{
+  if (! _errorStarted)
+    return QString();
+
+  _errorWriter.writeEndElement();
+  _errorStarted = false;
+  return _errorXML;
+}
+
+/* find the document type without reading more of the file than needed */
+static bool readDocType(const QString &pFileName, QString &doctype,
+                        QString &systemId, QString &errmsg)
+{
+  QFile file(pFileName);
+  if (! file.open(QIODevice::ReadOnly))
+  {
+    errmsg = ImportHelper::tr("<p>Could not open file %1 (error %2)")
+                      .arg(pFileName, file.error());
+    return false;
+  }
+
+  QXmlStreamReader reader(&file);
+  while (! reader.atEnd())
+  {
+    reader.readNext();
+    if (reader.isDTD())
+    {
+      doctype  = reader.dtdName().toString();
+      systemId = reader.dtdSystemId().toString();
+      if (DEBUG) qDebug("initial doctype = %s", qPrintable(doctype));
+    }
+    else if (reader.isStartElement())
+    {
+      if (doctype.isEmpty())
+      {
+        doctype = reader.name().toString();
+        if (DEBUG) qDebug("changed doctype to %s", qPrintable(doctype));
+      }
+      return true;
+    }
+  }
+
+  errmsg = ImportHelper::tr("Problem reading %1, line %2 column %3:<br>%4")
+                    .arg(pFileName).arg(reader.lineNumber())
+                    .arg(reader.columnNumber()).arg(reader.errorString());
+  return false;
+}
+
 bool ImportHelper::importCSV(const QString &pFileName, QString &errmsg)
 {
   errmsg = QString::null;
@@ -359,7 +739,7 @@ bool ImportHelper::importCSV(const QString &pFileName, QString &errmsg)
   return errmsg.isEmpty();
 }
 
-bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString &warnmsg)
+bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString &warnmsg, QProgressDialog *progress)
 {
   if (DEBUG)
     qDebug("ImportHelper::importXML(%s, errmsg)", qPrintable(pFileName));
@@ -411,18 +791,12 @@ bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString
   if (xmldir.isEmpty())
     xmldir = ".";
 
-  QDomDocument doc(pFileName);
-  if (!openDomDocument(pFileName, doc, errmsg))
+  QString doctype;
+  QString systemId;
+  if (! readDocType(pFileName, doctype, systemId, errmsg))
     return false;
 
-  QString doctype = doc.doctype().name();
-  if (DEBUG) qDebug("initial doctype = %s", qPrintable(doctype));
-  if (doctype.isEmpty())
-  {
-    doctype = doc.documentElement().tagName();
-    if (DEBUG) qDebug("changed doctype to %s", qPrintable(doctype));
-  }
-
+  QString importFileName = pFileName;
   QString tmpfileName;
   if (doctype != "xtupleimport")
   {
@@ -432,7 +806,7 @@ bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString
               "WHERE ((xsltmap_doctype=:doctype OR xsltmap_doctype='')"
               "   AND (xsltmap_system=:system   OR xsltmap_system=''));");
     q.bindValue(":doctype", doctype);
-    q.bindValue(":system",  doc.doctype().systemId());
+    q.bindValue(":system",  systemId);
     q.exec();
     if (q.first())
       xsltfile = q.value("xsltmap_import").toString();
@@ -446,7 +820,7 @@ bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString
       errmsg = tr("<p>Could not find a map for doctype '%1' and system id '%2'"
                   ". Write an XSLT stylesheet to convert this to valid xtuple "
                   "import XML and add it to the Map of XSLT Import Filters.")
-                    .arg(doctype, doc.doctype().systemId());
+                    .arg(doctype, systemId);
       return false;
     }
 
@@ -457,8 +831,15 @@ bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString
                                         errmsg))
       return false;
 
-    if (! openDomDocument(tmpfileName, doc, errmsg))
-      return false;
+    importFileName = tmpfileName;
+  }
+
+  QFile file(importFileName);
+  if (! file.open(QIODevice::ReadOnly))
+  {
+    errmsg = tr("<p>Could not open file %1 (error %2)")
+                      .arg(importFileName, file.error());
+    return false;
   }
 
   /* xtupleimport format is very straightforward:
@@ -471,13 +852,16 @@ bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString
      we can reimport files which have failures. however, if a
      view-level element has the ignore attribute set to true then
      rollback just that view-level element if it generates an error.
+
+     the file is read one view-level element at a time. consecutive
+     elements for the same view and mode are sent to the server together,
+     see XmlImportBatch.
   */
 
   // the silent attribute provides the user the option to turn off 
   // the interactive message for the view-level element
 
-  QDomDocument errorDoc;
-  QDomElement errorRoot = errorDoc.appendChild(errorDoc.createElement("xtupleimport")).toElement();
+  XmlImportBatch batch(pFileName, saveErrorXML, errors, warnings);
 
   q.exec("BEGIN;");
   if (q.lastError().type() != QSqlError::NoError)
@@ -489,155 +873,54 @@ bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString
   XSqlQuery rollback;
   rollback.prepare("ROLLBACK;");
 
-  QRegExp apos("\\\\*'");
-
-  for (QDomElement viewElem = doc.documentElement().firstChildElement();
-       ! viewElem.isNull();
-       viewElem = viewElem.nextSiblingElement())
+  if (progress)
   {
-    QStringList columnNameList;
-    QStringList columnValueList;
-
-    bool ignoreErr = (viewElem.attribute("ignore", "false").isEmpty() ||
-                      viewElem.attribute("ignore", "false") == "true");
+    progress->setRange(0, (int)(qMax(file.size(), (qint64)1) / 1024));
+    progress->setValue(0);
+  }
 
-    bool silent = (viewElem.attribute("silent", "false").isEmpty() ||
-                   viewElem.attribute("silent", "false") == "true");
+  QXmlStreamReader reader(&file);
+  QElapsedTimer    elapsed;
+  qint64           rows = 0;
+  bool             cancelled = false;
+  elapsed.start();
 
-    QString mode = viewElem.attribute("mode", "insert");
-    QStringList keyList;
-    if (! viewElem.attribute("key").isEmpty())
-      keyList = viewElem.attribute("key").split(QRegExp(",\\s*"));
+  reader.readNextStartElement();       // xtupleimport
+  while (! cancelled && reader.readNextStartElement())
+  {
+    XmlImportElement elem;
+    elem.read(reader);
+    if (reader.hasError())
+      break;
 
-    QString viewName = viewElem.tagName();
-    if (viewName.indexOf(".") > 0)
-      ; // viewName contains . so accept that it's schema-qualified
-    else if (! viewElem.attribute("schema").isEmpty())
-      viewName = viewElem.attribute("schema") + "." + viewName;
-    else // backwards compatibility - must be in the api schema
-      viewName = "api." + viewName;
+    batch.add(elem);
+    rows++;
 
-    QString savepointName = viewName;
-    savepointName.remove(".");
-    XSqlQuery rollbacktosavepoint;
-    if (ignoreErr || saveErrorXML)
+    if (progress && rows % PROGRESSROWS == 0)
     {
-      q.exec("SAVEPOINT " + savepointName + ";");
-      rollbacktosavepoint.prepare("ROLLBACK TO SAVEPOINT " + savepointName + ";");
+      progress->setValue((int)(file.pos() / 1024));
+      progress->setLabelText(tr("Imported %1 rows (%2 rows/sec)")
+                             .arg(rows)
+                             .arg(rows * 1000 / qMax(elapsed.elapsed(), (qint64)1)));
+      cancelled = progress->wasCanceled();
     }
-    bool haveSavepoint = (ignoreErr || saveErrorXML);
-
-    if (mode.isEmpty())
-      mode = "insert";
-    else if (mode == "update" && keyList.isEmpty())
-    {
-      if (! viewElem.namedItem(viewName + "_number").isNull())
-        keyList.append(viewName + "_number");
-      else if (! viewElem.namedItem("order_number").isNull())
-        keyList.append("order_number");
-      else
-      {
-        if (haveSavepoint)
-          rollbacktosavepoint.exec();
-        if (ignoreErr || saveErrorXML)
-        {
-          warnings.append(tr("Cannot process %1 element without a key attribute"));
-          if (saveErrorXML)
-            errorRoot.appendChild(errorDoc.importNode(viewElem, true));
-        }
-        else
-          errors.append(tr("Cannot process %1 element without a key attribute"));
-        continue;       // back to top of viewElem for loop
-      }
-      if (! viewElem.namedItem("line_number").isNull())
-        keyList.append("line_number");
-    }
-
-    for (QDomElement columnElem = viewElem.firstChildElement();
-         ! columnElem.isNull();
-         columnElem = columnElem.nextSiblingElement())
-    {
-      QString value = columnElem.attribute("value").isEmpty() ?
-                              columnElem.text() : columnElem.attribute("value");
-      if (DEBUG)
-        qDebug("%s before transformation: /%s/",
-               qPrintable(columnElem.tagName()), qPrintable(value));
-
-      columnNameList.append(columnElem.tagName());
-
-      if (value.trimmed() == "[NULL]")
-        columnValueList.append("NULL");
-      else if (value.trimmed().startsWith("SELECT"))
-        columnValueList.append("(" + value.trimmed() + ")");
-      else if (columnElem.attribute("quote") == "false")
-        columnValueList.append(value);
-      else
-        columnValueList.append("'" + value.replace(apos, "''") + "'");
-
-      if (DEBUG)
-        qDebug("%s after transformation: /%s/",
-               qPrintable(columnElem.tagName()), qPrintable(value));
-    }
-
-    QString sql;
-    if (mode == "update")
-    {
-      QStringList whereList;
-      for (int i = 0; i < keyList.size(); i++)
-        whereList.append("(" + keyList[i] + "=" +
-                         columnValueList[columnNameList.indexOf(keyList[i])] + ")");
+  }
+  batch.flush();
 
-      for (int i = 0; i < columnNameList.size(); i++)
-        columnNameList[i].append("=" + columnValueList[i]);
+  if (DEBUG)
+    qDebug("ImportHelper::importXML() read %lld rows in %lld msec",
+           rows, elapsed.elapsed());
 
-      sql = "UPDATE " + viewName + " SET " +
-            columnNameList.join(", ") +
-            " WHERE (" + whereList.join(" AND ") + ");";
-    }
-    else if (mode == "insert")
-      sql = "INSERT INTO " + viewName + " (" +
-            columnNameList.join(", ") +
-            " ) SELECT " +
-            columnValueList.join(", ") + ";" ;
+  if (reader.hasError() || cancelled)
+  {
+    rollback.exec();
+    if (cancelled)
+      errmsg = tr("The import of %1 was canceled.").arg(pFileName);
     else
-    {
-      if (haveSavepoint)
-        rollbacktosavepoint.exec();
-      if (! ignoreErr)
-        errors.append(tr("Could not process %1: invalid mode %2")
-                      .arg(viewElem.tagName(), mode));
-      continue;       // back to top of viewElem for loop
-    }
-
-    if (DEBUG) qDebug("About to run this: %s", qPrintable(sql));
-    q.exec(sql);
-    if (q.lastError().type() != QSqlError::NoError)
-    {
-      if (haveSavepoint)
-        rollbacktosavepoint.exec();
-      if (ignoreErr)
-      {
-        if (! silent)
-          warnings.append(tr("Ignored error while importing %1:\n%2")
-                              .arg(viewElem.tagName(), q.lastError().text()));
-      }
-      else if (saveErrorXML)
-      {
-        warnings.append(tr("Error processing %1. Saving to retry later:\t%2")
-                              .arg(viewElem.tagName(), q.lastError().text()));
-        QDomNode nodecopy = errorDoc.importNode(viewElem, true);
-        nodecopy.appendChild(errorDoc.createComment(q.lastError().text()));
-        errorRoot.appendChild(nodecopy);
-      }
-      else
-      {
-        errors.append(tr("Error importing %1: %2")
-                      .arg(pFileName, q.lastError().databaseText()));
-        continue;       // back to top of viewElem for loop
-      }
-    }
-    else if (haveSavepoint)
-      q.exec("RELEASE SAVEPOINT " + savepointName + ";");
+      errmsg = tr("Problem reading %1, line %2 column %3:<br>%4")
+                        .arg(importFileName).arg(reader.lineNumber())
+                        .arg(reader.columnNumber()).arg(reader.errorString());
+    return false;
   }
 
   q.exec("COMMIT;");
@@ -648,6 +931,7 @@ bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString
     return false;
   }
 
+  file.close();
   if (! tmpfileName.isEmpty())
     QFile::remove(tmpfileName);
 
@@ -658,8 +942,7 @@ bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString
   if (! handleFilePostImport(pFileName,
                              errors.size() == 0,
                              fileerrmsg,
-                             errorRoot.hasChildNodes() ? errorDoc.toString()
-                                                       : QString()))
+                             batch.errorXML()))
   {
     errors.append(fileerrmsg);
     return false;
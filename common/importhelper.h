@@ -20,6 +20,7 @@
 
 #include <csvimpplugininterface.h>
 
+class QProgressDialog;
 class QScriptEngine;
 
 class ImportHelper : public QObject
@@ -30,7 +31,7 @@ class ImportHelper : public QObject
     static CSVImpPluginInterface *getCSVImpPlugin(QObject *parent = 0);
     static bool handleFilePostImport(const QString &pFileName, bool success, QString &errmsg, const QString &saveToErrorFile = QString::null);
     static bool importCSV(const QString &pFileName, QString &errmsg);
-    static bool importXML(const QString &pFileName, QString &errmsg, QString &warnmsg);
+    static bool importXML(const QString &pFileName, QString &errmsg, QString &warnmsg, QProgressDialog *progress = 0);
     static bool openDomDocument(const QString &pFileName, QDomDocument &pDoc, QString &errmsg);
 
   protected:
@@ -13,6 +13,7 @@
 #include <QSqlDatabase>
 #include <QSqlDriver>
 #include <QSqlError>
+#include <QVarLengthArray>
 #include <QVariant>
 #include <QtScript>
 
@@ -45,6 +46,15 @@ void Parameters::load()
   emit loaded();
 }
 
+/* take values read some other way, e.g. by the startup bootstrap */
+void Parameters::loadValues(const MetricMap &pValues)
+{
+  _values = pValues;
+  _dirty  = false;
+
+  emit loaded();
+}
+
 void Parameters::sSetDirty(const QString &note)
 {
     if(note == _notifyName)
@@ -144,15 +154,37 @@ QString Parameters::parent(const QString &pValue)
 }
 
 Metrics::Metrics()
+{
+  init();
+  load();
+}
+
+Metrics::Metrics(const MetricMap &pValues)
+{
+  init();
+  loadValues(pValues);
+}
+
+void Metrics::init()
 {
   _notifyName = "metricsUpdated";
   _readSql = "SELECT metric_name AS key, metric_value AS value FROM metric;";
   _setSql  = "SELECT setMetric(:name, :value);";
+}
 
+Preferences::Preferences(const QString &pUsername)
+{
+  init(pUsername);
   load();
 }
 
-Preferences::Preferences(const QString &pUsername)
+Preferences::Preferences(const QString &pUsername, const MetricMap &pValues)
+{
+  init(pUsername);
+  loadValues(pValues);
+}
+
+void Preferences::init(const QString &pUsername)
 {
   _notifyName = "preferencesUpdated";
   _readSql  = "SELECT usrpref_name AS key, usrpref_value AS value "
@@ -160,8 +192,6 @@ Preferences::Preferences(const QString &pUsername)
               "WHERE (usrpref_username=:username);";
   _setSql   = "SELECT setUserPreference(:username, :name, :value);";
   _username = pUsername;
-
-  load();
 }
 
 void Preferences::remove(const QString &pPrefName)
@@ -175,8 +205,8 @@ void Preferences::remove(const QString &pPrefName)
 }
 
 Privileges::Privileges()
+  : _grantedStale(true)
 {
-  _notifyName = "usrprivUpdated";
   QString user;
   XSqlQuery userq("SELECT getEffectiveXtUser() AS user;");
   if (userq.lastError().type() != QSqlError::NoError)
@@ -184,6 +214,21 @@ Privileges::Privileges()
   if (userq.first())
     user = userq.value("user").toString();
 
+  init(user);
+  load();
+}
+
+/* pUsername is the effective xTuple user, not necessarily the login name */
+Privileges::Privileges(const QString &pUsername, const MetricMap &pValues)
+  : _grantedStale(true)
+{
+  init(pUsername);
+  loadValues(pValues);
+}
+
+void Privileges::init(const QString &pUser)
+{
+  _notifyName = "usrprivUpdated";
   _readSql = QString("SELECT priv_name AS key, TEXT('t') AS value "
              "  FROM usrpriv, priv "
              " WHERE((usrpriv_priv_id=priv_id)"
@@ -193,45 +238,166 @@ Privileges::Privileges()
              "  FROM priv, grppriv, usrgrp"
              " WHERE((usrgrp_grp_id=grppriv_grp_id)"
              "   AND (grppriv_priv_id=priv_id)"
-             "   AND (usrgrp_username='%1'));").arg(user);
+             "   AND (usrgrp_username='%1'));").arg(pUser);
 
   QSqlDatabase::database().driver()->subscribeToNotification("usrprivUpdated");
   QObject::connect(QSqlDatabase::database().driver(), SIGNAL(notification(const QString&)),
            this, SLOT(sSetDirty(const QString &)));
+}
 
-  load();
+void Privileges::load()
+{
+  _grantedStale = true;
+  Parameters::load();
 }
 
-bool Privileges::check(const QString &pName)
+void Privileges::loadValues(const MetricMap &pValues)
 {
-    if (pName == "#superuser")
-      return isDba();
+  _grantedStale = true;
+  Parameters::loadValues(pValues);
+}
 
-    if(_dirty)
-      load();
+void Privileges::_set(const QString &pName, QVariant pValue)
+{
+  _grantedStale = true;
+  Parameters::_set(pName, pValue);
+}
 
-    MetricMap::iterator it = _values.find(pName);
-    if (it != _values.end())
-      return true;
+int Privileges::intern(const QString &pName)
+{
+  QHash<QString, int>::const_iterator it = _ids.constFind(pName);
+  if (it != _ids.constEnd())
+    return it.value();
 
-    if (pName.contains(" ")) {
-      QStringList privlist = pName.split(' ', QString::SkipEmptyParts);
-      foreach (QString priv, privlist) {
-        if (check(priv))
-          return true;
-      }
-    }
+  int id = _ids.size();
+  _ids.insert(pName, id);
+  return id;
+}
+
+/* rebuild the bit set from the privilege names load() read */
+void Privileges::updateGranted()
+{
+  QList<int> granted;
+  for (MetricMap::const_iterator it = _values.constBegin(); it != _values.constEnd(); ++it)
+    granted.append(intern(it.key()));
+
+  _granted = QBitArray(_ids.size());
+  foreach (int id, granted)
+    _granted.setBit(id);
+  _grantedStale = false;
+}
+
+/* mirror what check() has always done: an expression is true if the user
+   has it as a single privilege, if any of its space-separated parts is
+   true, or if all of its +-separated parts are true.
+ */
+void Privileges::emitOps(const QString &pName, QVector<Op> &ops)
+{
+  Op op;
+  if (pName == "#superuser")
+  {
+    op.code = Op::Dba;
+    op.arg  = 0;
+    ops.append(op);
+    return;
+  }
+
+  op.code = Op::Priv;
+  op.arg  = intern(pName);
+  ops.append(op);
+  int terms = 1;
+
+  if (pName.contains(" "))
+  {
+    QStringList privlist = pName.split(' ', QString::SkipEmptyParts);
+    foreach (QString priv, privlist)
+      emitOps(priv, ops);
+    op.code = Op::Any;
+    op.arg  = privlist.size();
+    ops.append(op);
+    terms++;
+  }
 
-    if (pName.contains("+")) {
-      bool anded = true;
-      QStringList privlist = pName.split('+', QString::SkipEmptyParts);
-      foreach (QString priv, privlist) {
-        anded = anded && check(priv);
+  if (pName.contains("+"))
+  {
+    QStringList privlist = pName.split('+', QString::SkipEmptyParts);
+    foreach (QString priv, privlist)
+      emitOps(priv, ops);
+    op.code = Op::All;
+    op.arg  = privlist.size();
+    ops.append(op);
+    terms++;
+  }
+
+  if (terms > 1)
+  {
+    op.code = Op::Any;
+    op.arg  = terms;
+    ops.append(op);
+  }
+}
+
+/* the id of the compiled form of a privilege expression, for callers that
+   check the same expression often enough to want to skip the lookup
+ */
+int Privileges::compile(const QString &pName)
+{
+  QHash<QString, int>::const_iterator it = _programIds.constFind(pName);
+  if (it != _programIds.constEnd())
+    return it.value();
+
+  QVector<Op> ops;
+  emitOps(pName, ops);
+  int id = _programs.size();
+  _programs.append(ops);
+  _programIds.insert(pName, id);
+  return id;
+}
+
+bool Privileges::check(int pProgram)
+{
+  if (pProgram < 0 || pProgram >= _programs.size())
+    return false;
+
+  if (_dirty)
+    load();
+  if (_grantedStale)
+    updateGranted();
+
+  const QVector<Op>         &ops = _programs.at(pProgram);
+  QVarLengthArray<bool, 32>  stack;
+  for (int i = 0; i < ops.size(); i++)
+  {
+    const Op &op = ops.at(i);
+    switch (op.code)
+    {
+      case Op::Priv:
+        stack.append(op.arg < _granted.size() && _granted.testBit(op.arg));
+        break;
+
+      case Op::Dba:
+        stack.append(isDba());
+        break;
+
+      case Op::Any:
+      case Op::All:
+      {
+        bool result = (op.code == Op::All);
+        for (int j = stack.size() - op.arg; j < stack.size(); j++)
+          result = (op.code == Op::All) ? (result && stack.at(j)) : (result || stack.at(j));
+        stack.resize(stack.size() - op.arg);
+        stack.append(result);
+        break;
       }
-      return anded;
     }
+  }
 
- return false;
+  return ! stack.isEmpty() && stack.last();
+}
+
+bool Privileges::check(const QString &pName)
+{
+  return check(compile(pName));
 }
 
 bool Privileges::isDba()
@@ -12,9 +12,12 @@
 #ifndef metrics_h
 #define metrics_h
 
+#include <QBitArray>
+#include <QHash>
 #include <QObject>
 #include <QString>
 #include <QMap>
+#include <QVector>
 
 class QScriptEngine;
 
@@ -37,6 +40,7 @@ class Parameters : public QObject
     virtual ~Parameters() {};
 
     virtual void load();
+    virtual void loadValues(const MetricMap &);
 
     virtual QString value(const char *);
     virtual bool    boolean(const char *);
@@ -69,6 +73,10 @@ class Metrics : public Parameters
 
   public:
     Metrics();
+    Metrics(const MetricMap &);
+
+  private:
+    void init();
 };
 
 class Preferences : public Parameters
@@ -78,20 +86,59 @@ class Preferences : public Parameters
   public:
     Preferences() {};
     Preferences(const QString &);
+    Preferences(const QString &, const MetricMap &);
 
     void remove(const QString &);
+
+  private:
+    void init(const QString &);
 };
 
+/* Privileges interns each privilege name as a small integer and keeps
+   the user's privileges as a bit set. check() compiles an expression
+   like "PrivA PrivB+PrivC" into a short postfix program the first time
+   it sees it, so later checks of the same expression are a hash lookup
+   and a few bit tests.
+ */
 class Privileges : public Parameters
 {
   Q_OBJECT
 
   public:
     Privileges();
+    Privileges(const QString &, const MetricMap &);
+
+    virtual void load();
+    virtual void loadValues(const MetricMap &);
+
+    int  compile(const QString &);
+    bool check(int);
 
   public slots:
     bool check(const QString &);
     bool isDba();
+
+  protected:
+    virtual void _set(const QString &, QVariant);
+
+  private:
+    struct Op
+    {
+      enum Code { Priv, Dba, Any, All };
+      Code code;
+      int  arg;   // the privilege id for Priv, the operand count otherwise
+    };
+
+    void emitOps(const QString &, QVector<Op> &);
+    void init(const QString &);
+    int  intern(const QString &);
+    void updateGranted();
+
+    QHash<QString, int>   _ids;
+    QBitArray             _granted;
+    bool                  _grantedStale;
+    QHash<QString, int>   _programIds;
+    QVector<QVector<Op> > _programs;
 };
 
 void setupParameters(QScriptEngine *engine, QString name, Parameters *params);
@@ -12,14 +12,30 @@
 
 #include <QVariant>
 
+#include <metasql.h>
+
 #include "xsqlquery.h"
 
+#define DEBUG false
+
+// scripts can build MetaSQL text on the fly so don't keep it all
+#define MAXPARSED 500
+
 MqlHash::MqlHash(QObject *pParent, QSqlDatabase pDb)
-  : XCachedHash<QString, QString>(pParent, QString(), pDb)
+  : XCachedHash<QString, QString>(pParent, QString(), pDb),
+    _parsed(MAXPARSED),
+    _hits(0),
+    _misses(0)
 {
   setNotification(QStringList() << "metasql" << "pkgmetasql");
 }
 
+void MqlHash::clear()
+{
+  XCachedHash<QString, QString>::clear();
+  _parsed.clear();
+}
+
 bool MqlHash::refresh(const QString &key)
 {
   QStringList parts = key.split("%");   // must match value(pGroup, pName) below
@@ -45,3 +61,25 @@ const QString MqlHash::value(const QString &pGroup, const QString &pName)
   return value(pGroup + "%" + pName);   // must match key.split() above
 }
 
+QSharedPointer<MetaSQLQuery> MqlHash::query(const QString &pGroup, const QString &pName)
+{
+  return parse(value(pGroup, pName));
+}
+
+QSharedPointer<MetaSQLQuery> MqlHash::parse(const QString &pText)
+{
+  QSharedPointer<MetaSQLQuery> *cached = _parsed.object(pText);
+  if (cached)
+  {
+    _hits++;
+    return *cached;
+  }
+
+  _misses++;
+  QSharedPointer<MetaSQLQuery> mql(new MetaSQLQuery(pText));
+  _parsed.insert(pText, new QSharedPointer<MetaSQLQuery>(mql));
+
+  if (DEBUG)
+    qDebug("MqlHash::parse() %d hits, %d misses", _hits, _misses);
+  return mql;
+}
@@ -11,8 +11,19 @@
 #ifndef mqlcache_h
 #define mqlcache_h
 
+#include <QCache>
+#include <QSharedPointer>
+
 #include "xcachedhash.h"
 
+class MetaSQLQuery;
+
+/* MqlHash caches the text of the queries in the metasql table, and the
+   parsed form of MetaSQL text so callers that run the same MetaSQL over
+   and over skip the parse. query() and parse() hand out shared pointers
+   so a cached query stays valid for its user even if a metasql or
+   pkgmetasql notification empties the cache in the meantime.
+ */
 class MqlHash : public XCachedHash<QString, QString>
 {
   Q_OBJECT
@@ -23,6 +34,20 @@ class MqlHash : public XCachedHash<QString, QString>
 
     virtual       bool    refresh(const QString &key);
     virtual const QString value(const QString &pGroup, const QString &pName);
+
+    QSharedPointer<MetaSQLQuery> query(const QString &pGroup, const QString &pName);
+    QSharedPointer<MetaSQLQuery> parse(const QString &pText);
+
+    int hits()   const { return _hits;   }  // parse() calls answered from the cache
+    int misses() const { return _misses; }  // parse() calls that had to parse
+
+  protected:
+    virtual void clear();
+
+  private:
+    QCache<QString, QSharedPointer<MetaSQLQuery> > _parsed; // by MetaSQL text
+    int _hits;
+    int _misses;
 };
 
 #endif
@@ -12,123 +12,167 @@
 
 #include <QString>
 #include <QIODevice>
-#include <QTextStream>
-#include <QBuffer>
+
+#define PACKETSPERLINE 19  // 3 bytes in, 4 characters out per packet
 
 static const char _base64Table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-static char getValue(char c) {
-    int i = 0;
-    while(_base64Table[i] != '\0') {
-        if(_base64Table[i] == c) return (char)i;
-        i++;
-    }
-    return (char)-1;
-}
+/* the value of each base64 character, -1 for everything else */
+struct Base64Values
+{
+  Base64Values()
+  {
+    for (int i = 0; i < 256; i++)
+      value[i] = -1;
+    for (int i = 0; i < 64; i++)
+      value[(unsigned char)_base64Table[i]] = i;
+  }
+
+  signed char value[256];
+};
+
+static const Base64Values _base64Values;
 
 QString QBase64Encode(QIODevice & iod) {
-    QString value;  // the string that holds the final encoded values
-    int packet = 0; // there are 19 packets per line (packet=3 bytes in)
-
-    char _in[3];
-    unsigned char in[3];
-    char out[4];
-    qint64 didRead = 0;
-
-    while(!iod.atEnd()) {
-        // set the values to 0 in case we don't read all 3
-        _in[0] = _in[1] = _in[2] = (char)0;
-
-        // read in up to the next 3 chars
-        didRead = iod.read(&_in[0], 3);
-
-        in[0] = (unsigned char)_in[0];
-        in[1] = (unsigned char)_in[1];
-        in[2] = (unsigned char)_in[2];
-
-        if(didRead > 0) {
-            // determine the encoded chars
-            out[0] = _base64Table[ in[0] >> 2 ];
-            out[1] = _base64Table[ ((in[0] & 0x03) << 4) | (in[1] >> 4) ];
-            out[2] = _base64Table[ ((in[1] & 0x0F) << 2) | (in[2] >> 6) ];
-            out[3] = _base64Table[ in[2] & 0x3F ];
-
-            // modify the chars if we were short
-            if(didRead < 3) {
-                out[3] = '=';
-                if(didRead < 2) {
-                    out[2] = '=';
-                }
-            }
-
-            // place the final chars in the value
-            value += out[0];
-            value += out[1];
-            value += out[2];
-            value += out[3];
-        }
+    return QString::fromLatin1(QBase64Encode(iod.readAll()));
+}
+
+/* encode all of data at once, PACKETSPERLINE packets to a line */
+QByteArray QBase64Encode(const QByteArray & data) {
+    const unsigned char *in  = (const unsigned char *)data.constData();
+    int                  len = data.size();
+    int                  packets = (len + 2) / 3;
 
+    QByteArray value;
+    value.resize(packets * 4 + packets / PACKETSPERLINE + 1);
+    char *out = value.data();
 
-        if(++packet >= 19) {
-            packet = 0;    // reset the packet count
-            value += '\n'; // add a newline to the value
+    int i = 0;
+    int packet = 0;
+    for (; i + 2 < len; i += 3) {
+        unsigned int bits = (in[i] << 16) | (in[i + 1] << 8) | in[i + 2];
+        *out++ = _base64Table[(bits >> 18) & 0x3F];
+        *out++ = _base64Table[(bits >> 12) & 0x3F];
+        *out++ = _base64Table[(bits >>  6) & 0x3F];
+        *out++ = _base64Table[ bits        & 0x3F];
+        if (++packet >= PACKETSPERLINE) {
+            packet = 0;
+            *out++ = '\n';
         }
     }
-    value += '\n'; // throw one last newline onto the end
 
+    // pad the short packet at the end, if there is one
+    if (i < len) {
+        unsigned int bits = in[i] << 16;
+        if (i + 1 < len)
+            bits |= in[i + 1] << 8;
+        *out++ = _base64Table[(bits >> 18) & 0x3F];
+        *out++ = _base64Table[(bits >> 12) & 0x3F];
+        *out++ = (i + 1 < len) ? _base64Table[(bits >> 6) & 0x3F] : '=';
+        *out++ = '=';
+        if (++packet >= PACKETSPERLINE)
+            *out++ = '\n';
+    }
+    *out++ = '\n'; // throw one last newline onto the end
+
+    value.truncate(out - value.constData());
     return value;
 }
 
-QByteArray QBase64Decode(const QString & _source) {
-    QString source = _source;
-    QByteArray value;
+QByteArray QBase64Decode(const QString & source) {
+    return QBase64Decode(source.toLatin1());
+}
 
-    // empty string -- nothing to do
-    if(source.isEmpty()) return value;
-
-    QTextStream in(&source, QIODevice::ReadOnly);
-
-    QBuffer buf(&value);
-    buf.open(QIODevice::WriteOnly);
-
-    char a[4], b[4], o[3];
-    qint64 n = 0;
-    int p = 0; // current position in string
-    int l = source.length(); // length of string
-    char c = 0;
-    while (p < l) {
-        // read in the next 4 valid bytes
-        n = 0;
-        while(n < 4 && p < l) {
-            c = ((QChar)source.at(p++)).toLatin1();
-            a[n] = c;
-            b[n] = (c == '=' ? 0 : getValue(c));
-            if(b[n] != -1) {
-                n++;
-            }
-        }
+/* decode all of source at once, skipping characters that aren't base64
+   such as line breaks. decoding stops at the first padded group.
+ */
+QByteArray QBase64Decode(const QByteArray & source) {
+    const unsigned char *in  = (const unsigned char *)source.constData();
+    int                  len = source.size();
 
-        if(n < 4 && n != 0) {
-            // whoops we have a mismatch in the number of bytes we need
+    QByteArray value;
+    value.resize((len / 4) * 3 + 3);
+    char *out = value.data();
+
+    unsigned int bits = 0;
+    int          n    = 0;  // characters in the current group
+    int          pad  = 0;
+    for (int p = 0; p < len; p++) {
+        int v = _base64Values.value[in[p]];
+        if (in[p] == '=') {
+            v = 0;
+            pad++;
         }
+        else if (v < 0)
+            continue;
+
+        bits = (bits << 6) | v;
+        if (++n == 4) {
+            *out++ = (char)(bits >> 16);
+            if (pad < 2)
+                *out++ = (char)(bits >> 8);
+            if (pad < 1)
+                *out++ = (char)bits;
+            if (pad)
+                break; // we've reached the end of the data we have to read so just stop
+            bits = 0;
+            n    = 0;
+        }
+    }
 
-        // convert from base64 to binary
-        o[0] = (b[0] << 2) | (b[1] >> 4);
-        o[1] = (b[1] << 4) | (b[2] >> 2);
-        o[2] = (b[2] << 6) | b[3];
+    value.truncate(out - value.constData());
+    return value;
+}
+
+/* decode uuencoded text, as written by QUUEncode, all at once. the data
+   starts on the line after "begin" and each line starts with a character
+   giving the number of bytes it holds. returns an empty array, and sets
+   ok to false, if there's no begin line.
+ */
+QByteArray QUUDecodeBuffer(const QByteArray & source, bool *ok) {
+    const char *in  = source.constData();
+    int         len = source.size();
+
+    int p = source.startsWith("begin") ? 0 : source.indexOf("\nbegin");
+    if (p < 0) {
+        if (ok) *ok = false;
+        return QByteArray();
+    }
+    if (ok) *ok = true;
 
-        // determine how many bytes we should be reading
-        if(a[2] == '=')      n = 1;
-        else if(a[3] == '=') n = 2;
-        else                 n = 3;
+    p = source.indexOf('\n', p + 1);
+    if (p < 0)
+        return QByteArray();
+    p++;
 
-        if(n != buf.write(&o[0], n)) {
-            // eek we didn't write the number of block we were supposed to
+    QByteArray value;
+    value.resize((len / 4) * 3);
+    char *out = value.data();
+
+    while (p < len) {
+        int count = (in[p] - ' ') & 0x3F;
+        if (count == 0)
+            break;     // the empty line before "end"
+        p++;
+
+        for (; count > 0 && p + 3 < len; count -= 3, p += 4) {
+            unsigned int bits = (((in[p]     - ' ') & 0x3F) << 18)
+                              | (((in[p + 1] - ' ') & 0x3F) << 12)
+                              | (((in[p + 2] - ' ') & 0x3F) <<  6)
+                              |  ((in[p + 3] - ' ') & 0x3F);
+            *out++ = (char)(bits >> 16);
+            if (count > 1)
+                *out++ = (char)(bits >> 8);
+            if (count > 2)
+                *out++ = (char)bits;
         }
 
-        if(n < 3) break; // we've reached the end of the data we have to read so just stop
+        int eol = source.indexOf('\n', p);
+        if (eol < 0)
+            break;
+        p = eol + 1;
     }
 
+    value.truncate(out - value.constData());
     return value;
 }
-
@@ -11,12 +11,16 @@
 #ifndef __QBASE64ENCODE_H__
 #define __QBASE64ENCODE_H__
 
+#include <QByteArray>
 #include <QString>
 
 class QIODevice;
 
 QString    QBase64Encode(QIODevice &);
+QByteArray QBase64Encode(const QByteArray &);
 QByteArray QBase64Decode(const QString &);
+QByteArray QBase64Decode(const QByteArray &);
 
-#endif
+QByteArray QUUDecodeBuffer(const QByteArray &, bool *ok = 0);
 
+#endif
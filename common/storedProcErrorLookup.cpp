@@ -8,8 +8,8 @@
  * to be bound by its terms.
  */
 
+#include <QHash>
 #include <QMessageBox>
-#include <QMultiHash>
 #include <QObject>
 #include <QPair>
 #include <QString>
@@ -21,21 +21,25 @@
   return negative integers on failure
  */
 
-QMultiHash< QString, QPair<int, QString> >	ErrorLookupHash;
+typedef QPair<QString, int> ErrorKey;   // (upper-case procName, retVal)
+
+// index into errors[] of the message for each key
+static QHash<ErrorKey, int>	ErrorLookupHash;
 
 /*
   developers add error messages to an array for ease of adding new ones.
-  initErrorLookupHash then inserts these into a QMultiHash(key, value).
-  The key is the stored procedure name.
-  The value is a QPair* of (return value, error message).
+  the array holds nothing but plain old data so it's built by the compiler,
+  not at program start. initErrorLookupHash then indexes it the first time
+  an error needs to be looked up, resolving proxy entries to the entry
+  whose message they share. messages are only translated when they're used.
 */
 
 const struct {
-  QString	procName;	// name of the stored procedure
+  const char*	procName;	// name of the stored procedure
   int		retVal;		// return value from the stored procedure
   const char*	msg;		// msg to display, but see msgPtr and proxyName
   int		msgPtr;		// if <> 0 then look up (procName, msgPtr)
-  QString	proxyName;	// look up (proxyName, retVal)
+  const char*	proxyName;	// look up (proxyName, retVal)
 } errors[] = {
 
   { "_aropenTrigger", -1, QT_TRANSLATE_NOOP("storedProcErrorLookup", 
@@ -1853,80 +1857,56 @@ void initErrorLookupHash()
   }
 
   unsigned int numElems = sizeof(errors) / sizeof(errors[0]);
+  ErrorLookupHash.reserve(numElems);
+
+  // the real messages first so proxies can point forward or backward
+  QList<unsigned int> proxies;
   for (unsigned int i = 0; i < numElems; i++)
   {
-    QPair<int, QString> currPair;
     if (errors[i].msgPtr == 0)
-      currPair = qMakePair(errors[i].retVal, QCoreApplication::translate("storedProcErrorLookup", errors[i].msg));
+      ErrorLookupHash.insert(ErrorKey(QString(errors[i].procName).toUpper(), errors[i].retVal), i);
     else
+      proxies.append(i);
+  }
+
+  /* a proxy can point at another proxy, so keep resolving until a pass
+     finds nothing new. whatever is left points nowhere.
+   */
+  bool resolved = true;
+  while (resolved && ! proxies.isEmpty())
+  {
+    resolved = false;
+    for (int p = proxies.size() - 1; p >= 0; p--)
     {
-      QList<QPair<int, QString> > proxyList;
-
-      QString proxyname;
-      if (errors[i].proxyName.isEmpty())
-	proxyname = errors[i].procName.toUpper();
-      else
-	proxyname = errors[i].proxyName.toUpper();
-
-      proxyList = ErrorLookupHash.values(proxyname);
-
-      if (proxyList.size() > 0)
-      {
-	int proxyIndex;
-	for (proxyIndex = 0; proxyIndex < proxyList.size(); proxyIndex++)
-	{
-	  if (proxyList.at(proxyIndex).first == errors[i].msgPtr)
-	  {
-	    currPair = qMakePair(errors[i].retVal,
-				 QString(proxyList.at(proxyIndex).second));
-	    break;
-	  }
-	}
-
-	if (proxyIndex >= proxyList.size())
-	{
-          QMessageBox::critical(0, QCoreApplication::translate("storedProcErrorLookup", "Lookup Error"),
-                                QCoreApplication::translate("storedProcErrorLookup",
-                                   "Could not find (%1, %2) in ErrorLookupHash "
-                                   "when trying to insert proxy entry for "
-                                   "(%3, %4).")
-			   .arg(proxyname).arg(errors[i].msgPtr)
-			   .arg(errors[i].procName).arg(errors[i].retVal));
-	  continue;
-	}
-      }
-      else // couldn't find proxyList => forward reference
-      {
-	unsigned int j;
-	for (j = i + 1; j < numElems; j++)
-	{
-	  if (errors[j].retVal == errors[i].msgPtr &&
-	      errors[j].procName.toUpper() == proxyname)
-	    {
-	    currPair = qMakePair(errors[i].retVal,
-				 QString(QCoreApplication::translate("storedProcErrorLookup", errors[j].msg)));
-	    break;
-	    }
-	}
-	if (j >= numElems)
-	{
-          QMessageBox::critical(0, QCoreApplication::translate("storedProcErrorLookup", "Lookup Error"),
-                                QCoreApplication::translate("storedProcErrorLookup",
-                                   "Could not find (%1, %2) in ErrorLookupHash "
-                                   "when trying to insert proxy entry for "
-                                   "(%3, %4).")
-			  .arg(errors[i].proxyName).arg(errors[i].msgPtr)
-			  .arg(errors[i].procName).arg(errors[i].retVal));
-	continue;
-	}
-      }
+      unsigned int i = proxies.at(p);
+      QString proxyname = QString(*errors[i].proxyName ? errors[i].proxyName
+                                                       : errors[i].procName).toUpper();
+      QHash<ErrorKey, int>::const_iterator proxy =
+                            ErrorLookupHash.constFind(ErrorKey(proxyname, errors[i].msgPtr));
+      if (proxy == ErrorLookupHash.constEnd())
+        continue;
+
+      ErrorLookupHash.insert(ErrorKey(QString(errors[i].procName).toUpper(), errors[i].retVal),
+                             proxy.value());
+      proxies.removeAt(p);
+      resolved = true;
     }
+  }
 
-    ErrorLookupHash.insert(errors[i].procName.toUpper(), currPair);
-  } // for
+  foreach (unsigned int i, proxies)
+  {
+    QString proxyname = QString(*errors[i].proxyName ? errors[i].proxyName
+                                                     : errors[i].procName).toUpper();
+    QMessageBox::critical(0, QCoreApplication::translate("storedProcErrorLookup", "Lookup Error"),
+                          QCoreApplication::translate("storedProcErrorLookup",
+                             "Could not find (%1, %2) in ErrorLookupHash "
+                             "when trying to insert proxy entry for "
+                             "(%3, %4).")
+                     .arg(proxyname).arg(errors[i].msgPtr)
+                     .arg(errors[i].procName).arg(errors[i].retVal));
+  }
 }
 
-
 QString storedProcErrorLookup(const QString procName, const int retVal)
 {
   QString returnStr = "";
@@ -1934,16 +1914,10 @@ QString storedProcErrorLookup(const QString procName, const int retVal)
   if (ErrorLookupHash.isEmpty())
     initErrorLookupHash();
 
-  QList<QPair<int, QString> > list = ErrorLookupHash.values(procName.toUpper());
-
-  for (int i = 0; i < list.size(); i++)
-  {
-    if (list.at(i).first == retVal)
-    {
-      returnStr = list.at(i).second;
-      break;
-    }
-  }
+  QHash<ErrorKey, int>::const_iterator it =
+                        ErrorLookupHash.constFind(ErrorKey(procName.toUpper(), retVal));
+  if (it != ErrorLookupHash.constEnd())
+    returnStr = QCoreApplication::translate("storedProcErrorLookup", errors[it.value()].msg);
 
   if (returnStr.isEmpty())
     returnStr = QCoreApplication::translate("storedProcErrorLookup", "A Stored Procedure failed to run properly.");
@@ -10,8 +10,25 @@
 
 #include "tarfile.h"
 
+#ifdef _MSC_VER
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
 #include <qtextstream.h>
 #include <qbuffer.h>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QObject>
+
+#include <cstddef>
+
+#define DEBUG false
+
+#define TARBLOCKSIZE  512
+#define TARBUFFERSIZE (256 * 1024)  // for inflating and for copying members out
 
 struct tarHeaderBlock {
     char name[100];     // name of file
@@ -113,3 +130,187 @@ TarFile::TarFile(const QByteArray & bytes)
 TarFile::~TarFile()
 {
 }
+
+TarReader::TarReader(const QString &pFileName)
+  : _file(0),
+    _padding(0),
+    _remaining(0),
+    _size(0),
+    _valid(false)
+{
+  gzFile file = gzopen(QFile::encodeName(pFileName).constData(), "rb");
+  if (! file)
+  {
+    _error = QObject::tr("Could not open %1").arg(pFileName);
+    return;
+  }
+  gzbuffer(file, TARBUFFERSIZE);
+
+  _file  = file;
+  _valid = true;
+  _buffer.resize(TARBUFFERSIZE);
+}
+
+TarReader::~TarReader()
+{
+  if (_file)
+    gzclose((gzFile)_file);
+}
+
+bool TarReader::readBlock(char *pBlock)
+{
+  int bytes = gzread((gzFile)_file, pBlock, TARBLOCKSIZE);
+  if (bytes == TARBLOCKSIZE)
+    return true;
+
+  if (bytes != 0)
+  {
+    _valid = false;
+    _error = QObject::tr("The archive is truncated or damaged");
+  }
+  return false;
+}
+
+bool TarReader::skip(qint64 pBytes)
+{
+  while (pBytes > 0)
+  {
+    int bytes = gzread((gzFile)_file, _buffer.data(), (unsigned)qMin(pBytes, (qint64)_buffer.size()));
+    if (bytes <= 0)
+    {
+      _valid = false;
+      _error = QObject::tr("The archive is truncated or damaged");
+      return false;
+    }
+    pBytes -= bytes;
+  }
+  return true;
+}
+
+/* move to the next regular file in the archive. returns false at the end
+   of the archive or if it can't be read, in which case isValid() is false.
+ */
+bool TarReader::next()
+{
+  if (! _valid)
+    return false;
+
+  if (! skip(_remaining + _padding))
+    return false;
+  _remaining = _padding = _size = 0;
+  _name.clear();
+
+  tarHeaderBlock head;
+  while (readBlock((char*)&head))
+  {
+    if(head.name[0] == '\0' && head.size[0] == '\0' && head.typeflag == '\0')
+      continue;
+
+    if (QByteArray(head.magic, 5) != "ustar")
+    {
+      _valid = false;
+      _error = QObject::tr("This is not a tar archive");
+      return false;
+    }
+
+    // the checksum is figured with the checksum field itself all spaces
+    const unsigned char *bytes = (const unsigned char *)&head;
+    long sum = 0;
+    for (int i = 0; i < TARBLOCKSIZE; i++)
+      sum += (i >= (int)offsetof(tarHeaderBlock, chksum) &&
+              i <  (int)(offsetof(tarHeaderBlock, chksum) + sizeof head.chksum)) ? ' ' : bytes[i];
+    bool valid = false;
+    if (QByteArray(head.chksum, sizeof head.chksum).trimmed().toLong(&valid, 8) != sum || ! valid)
+    {
+      _valid = false;
+      _error = QObject::tr("The archive is damaged");
+      return false;
+    }
+
+    qint64 size = QByteArray(head.size, sizeof head.size).trimmed().toLongLong(&valid, 8);
+    if (! valid || size < 0)
+    {
+      _valid = false;
+      _error = QObject::tr("The archive is damaged");
+      return false;
+    }
+    qint64 padding = (TARBLOCKSIZE - size % TARBLOCKSIZE) % TARBLOCKSIZE;
+
+    if (head.typeflag == TYPE_REGULAR || head.typeflag == TYPE_REGULAR_ALT)
+    {
+      _name = QString::fromUtf8(head.name, qstrnlen(head.name, sizeof head.name));
+      if (head.prefix[0] != '\0')
+        _name = QString::fromUtf8(head.prefix, qstrnlen(head.prefix, sizeof head.prefix))
+              + "/" + _name;
+      _size      = size;
+      _remaining = size;
+      _padding   = padding;
+      if (DEBUG)
+        qDebug("TarReader::next() %s, %lld bytes", qPrintable(_name), _size);
+      return true;
+    }
+
+    if (! skip(size + padding))
+      return false;
+  }
+
+  return false;
+}
+
+/* read up to pMax bytes of the current member */
+qint64 TarReader::read(char *pData, qint64 pMax)
+{
+  if (! _valid || _remaining <= 0)
+    return 0;
+
+  int bytes = gzread((gzFile)_file, pData, (unsigned)qMin(qMin(pMax, _remaining), (qint64)TARBUFFERSIZE));
+  if (bytes <= 0)
+  {
+    _valid = false;
+    _error = QObject::tr("The archive is truncated or damaged");
+    return -1;
+  }
+  _remaining -= bytes;
+  return bytes;
+}
+
+/* write the current member to its path under pDir. members whose paths
+   would end up outside pDir are refused.
+ */
+bool TarReader::extract(const QString &pDir)
+{
+  QString path = QDir::cleanPath(_name);
+  if (path.isEmpty() || QDir::isAbsolutePath(path) || path == ".." || path.startsWith("../"))
+  {
+    _error = QObject::tr("Refusing to extract %1").arg(_name);
+    return false;
+  }
+
+  QFileInfo info(QDir(pDir), path);
+  if (! QDir().mkpath(info.absolutePath()))
+  {
+    _error = QObject::tr("Could not create %1").arg(info.absolutePath());
+    return false;
+  }
+
+  QFile file(info.absoluteFilePath());
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    _error = file.errorString();
+    return false;
+  }
+
+  while (_remaining > 0)
+  {
+    qint64 bytes = read(_buffer.data(), _buffer.size());
+    if (bytes <= 0)
+      return false;
+    if (file.write(_buffer.constData(), bytes) != bytes)
+    {
+      _error = file.errorString();
+      return false;
+    }
+  }
+
+  return true;
+}
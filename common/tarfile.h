@@ -11,6 +11,7 @@
 #ifndef __TARFILE_H__
 #define __TARFILE_H__
 
+#include <QByteArray>
 #include <QString>
 #include <QMap>
 
@@ -27,5 +28,47 @@ class TarFile {
     bool _valid;
 };
 
+/* TarReader reads a tar archive, gzipped or not, straight from the file
+   one member at a time, so neither the archive nor its members need to
+   fit in memory:
+
+     TarReader archive(fileName);
+     while (archive.next())
+       if (! archive.extract(destination))
+         ...
+     if (! archive.isValid())
+       ... archive.errorString()
+
+   Only regular files are returned by next(). Directories are created as
+   needed by extract().
+ */
+class TarReader {
+  public:
+    TarReader(const QString &pFileName);
+    virtual ~TarReader();
+
+    bool    isValid()     const { return _valid; }
+    QString errorString() const { return _error; }
+
+    bool    next();
+    QString name()  const { return _name; }
+    qint64  size()  const { return _size; }
+    qint64  read(char *pData, qint64 pMax);
+    bool    extract(const QString &pDir);
+
+  private:
+    bool    readBlock(char *pBlock);
+    bool    skip(qint64 pBytes);
+
+    QByteArray _buffer;
+    QString    _error;
+    void      *_file;       // a gzFile
+    QString    _name;
+    qint64     _padding;    // after the member's data, to fill its last block
+    qint64     _remaining;  // of the member's data
+    qint64     _size;
+    bool       _valid;
+};
+
 #endif
 
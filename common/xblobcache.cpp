@@ -0,0 +1,183 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xblobcache.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSqlError>
+#include <QStandardPaths>
+#include <QVariant>
+
+#include <xsqlquery.h>
+
+#include "qbase64encode.h"
+
+#define DEBUG false
+
+/* the decoded image, as a png or whatever format it was saved in */
+QByteArray XBlobCache::image(int pImageId, const QString &pChecksum)
+{
+  QString sum = pChecksum;
+  if (sum.isEmpty())
+    sum = checksum("SELECT md5(image_data) FROM image WHERE (image_id=:id);", pImageId);
+  if (sum.isEmpty())
+    return QByteArray();
+
+  QString    file = fileName("image", pImageId, sum);
+  QByteArray data;
+  if (read(file, data))
+    return data;
+
+  XSqlQuery imageq;
+  imageq.prepare("SELECT image_data FROM image WHERE (image_id=:id);");
+  imageq.bindValue(":id", pImageId);
+  imageq.exec();
+  if (! imageq.first())
+  {
+    if (imageq.lastError().type() != QSqlError::NoError)
+      qWarning("XBlobCache could not get image %d: %s", pImageId,
+               qPrintable(imageq.lastError().text()));
+    return QByteArray();
+  }
+
+  bool ok = false;
+  data = QUUDecodeBuffer(imageq.value("image_data").toString().toLatin1(), &ok);
+  if (ok)
+    write("image", pImageId, sum, file, data);
+  return data;
+}
+
+/* the image scaled down to fit pSize, or as it is if it already fits */
+QImage XBlobCache::thumbnail(int pImageId, const QSize &pSize, const QString &pChecksum)
+{
+  QString sum = pChecksum;
+  if (sum.isEmpty())
+    sum = checksum("SELECT md5(image_data) FROM image WHERE (image_id=:id);", pImageId);
+  if (sum.isEmpty())
+    return QImage();
+
+  QString    file = fileName("image", pImageId, sum,
+                             QString("-%1x%2.png").arg(pSize.width()).arg(pSize.height()));
+  QByteArray data;
+  QImage     thumbnail;
+  if (read(file, data) && thumbnail.loadFromData(data, "PNG"))
+    return thumbnail;
+
+  if (! thumbnail.loadFromData(image(pImageId, sum)))
+    return QImage();
+
+  if (thumbnail.width() > pSize.width() || thumbnail.height() > pSize.height())
+    thumbnail = thumbnail.scaled(pSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+  QBuffer buffer(&data);
+  buffer.open(QIODevice::WriteOnly);
+  if (thumbnail.save(&buffer, "PNG"))
+    write("image", pImageId, sum, file, buffer.data());
+
+  return thumbnail;
+}
+
+/* the contents of a file stored in the database as a document */
+QByteArray XBlobCache::document(int pUrlId, const QString &pChecksum)
+{
+  QString sum = pChecksum;
+  if (sum.isEmpty())
+    sum = checksum("SELECT md5(url_stream) FROM url WHERE (url_id=:id);", pUrlId);
+  if (sum.isEmpty())
+    return QByteArray();
+
+  QString    file = fileName("document", pUrlId, sum);
+  QByteArray data;
+  if (read(file, data))
+    return data;
+
+  XSqlQuery urlq;
+  urlq.prepare("SELECT url_stream FROM url WHERE (url_id=:id);");
+  urlq.bindValue(":id", pUrlId);
+  urlq.exec();
+  if (! urlq.first())
+  {
+    if (urlq.lastError().type() != QSqlError::NoError)
+      qWarning("XBlobCache could not get document %d: %s", pUrlId,
+               qPrintable(urlq.lastError().text()));
+    return QByteArray();
+  }
+
+  data = urlq.value("url_stream").toByteArray();
+  write("document", pUrlId, sum, file, data);
+  return data;
+}
+
+QString XBlobCache::checksum(const QString &pSql, int pId)
+{
+  XSqlQuery sumq;
+  sumq.prepare(pSql);
+  sumq.bindValue(":id", pId);
+  sumq.exec();
+  if (sumq.first())
+    return sumq.value(0).toString();
+
+  if (sumq.lastError().type() != QSqlError::NoError)
+    qWarning("XBlobCache could not get the checksum for %d: %s", pId,
+             qPrintable(sumq.lastError().text()));
+  return QString();
+}
+
+QString XBlobCache::fileName(const QString &pKind, int pId, const QString &pChecksum,
+                             const QString &pSuffix)
+{
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+         + "/blobs/" + pKind + "/" + QString::number(pId) + "-" + pChecksum + pSuffix;
+}
+
+bool XBlobCache::read(const QString &pFile, QByteArray &pData)
+{
+  QFile file(pFile);
+  if (! file.open(QIODevice::ReadOnly))
+    return false;
+
+  pData = file.readAll();
+  if (DEBUG)
+    qDebug("XBlobCache::read(%s) %d bytes", qPrintable(pFile), pData.size());
+  return true;
+}
+
+/* save pData and drop what's left from earlier versions of the record.
+   documents can be private so only the user can read the files.
+ */
+void XBlobCache::write(const QString &pKind, int pId, const QString &pChecksum,
+                       const QString &pFile, const QByteArray &pData)
+{
+  QDir    dir(QFileInfo(pFile).absolutePath());
+  QString current = QString::number(pId) + "-" + pChecksum;
+  if (! dir.mkpath("."))
+    return;
+
+  foreach (QString stale, dir.entryList(QStringList(QString::number(pId) + "-*"), QDir::Files))
+    if (! stale.startsWith(current))
+      dir.remove(stale);
+
+  QSaveFile file(pFile);
+  if (! file.open(QIODevice::WriteOnly))
+  {
+    qWarning("XBlobCache could not save the %s for %d: %s", qPrintable(pKind), pId,
+             qPrintable(file.errorString()));
+    return;
+  }
+  file.setPermissions(QFile::ReadOwner | QFile::WriteOwner);
+  file.write(pData);
+  if (! file.commit())
+    qWarning("XBlobCache could not save the %s for %d: %s", qPrintable(pKind), pId,
+             qPrintable(file.errorString()));
+}
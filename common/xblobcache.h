@@ -0,0 +1,48 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __XBLOBCACHE_H__
+#define __XBLOBCACHE_H__
+
+#include <QByteArray>
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+/* XBlobCache keeps decoded copies of image and document blobs on disk so
+   each workstation fetches and decodes a given blob only once.
+
+   Files are named by the record's id and the md5 of the blob as the
+   database stores it. Asking for a blob costs one small query for the
+   checksum; the blob itself only crosses the network when the cache has
+   no file with that checksum, e.g. the first time or after the record
+   changed. Older copies of the same record are removed then.
+
+   Callers that already know the checksum, say from the query that found
+   the record, can pass it and skip that query.
+ */
+class XBlobCache
+{
+  public:
+    static QByteArray image(int pImageId, const QString &pChecksum = QString());
+    static QImage     thumbnail(int pImageId, const QSize &pSize,
+                                const QString &pChecksum = QString());
+    static QByteArray document(int pUrlId, const QString &pChecksum = QString());
+
+  private:
+    static QString    checksum(const QString &pSql, int pId);
+    static QString    fileName(const QString &pKind, int pId, const QString &pChecksum,
+                               const QString &pSuffix = QString());
+    static bool       read(const QString &pFile, QByteArray &pData);
+    static void       write(const QString &pKind, int pId, const QString &pChecksum,
+                            const QString &pFile, const QByteArray &pData);
+};
+
+#endif
@@ -10,33 +10,188 @@
 
 #include "xtsettings.h"
 
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QRunnable>
 #include <QSettings>
+#include <QThread>
+#include <QTimer>
 
-QVariant xtsettingsValue(const QString & key, const QVariant & defaultValue)
+#define DEBUG false
+
+#define FLUSHDELAY 1000   // ms to collect changes before writing them
+
+/* writes a batch of changes. the pool runs one at a time, in order */
+class XtSettingsWriter : public QRunnable
+{
+  public:
+    XtSettingsWriter(const QHash<QString, QVariant> &values)
+      : _values(values)
+    {
+    }
+
+    virtual void run()
+    {
+      QSettings settings(QSettings::UserScope, "xTuple.com", "xTuple");
+      QHash<QString, QVariant>::const_iterator it;
+      for (it = _values.constBegin(); it != _values.constEnd(); ++it)
+        settings.setValue(it.key(), it.value());
+      settings.sync();
+
+      if (DEBUG)
+        qDebug("XtSettingsWriter::run() wrote %d settings", _values.size());
+    }
+
+  private:
+    QHash<QString, QVariant> _values;
+};
+
+static XtSettings *_instance = 0;
+
+XtSettings::XtSettings()
+  : QObject(0)
+{
+  _writer.setMaxThreadCount(1);
+  _flushTimer = new QTimer(this);
+  _flushTimer->setSingleShot(true);
+  _flushTimer->setInterval(FLUSHDELAY);
+  connect(_flushTimer, SIGNAL(timeout()), this, SLOT(sFlush()));
+
+  load();
+}
+
+XtSettings::~XtSettings()
+{
+  sync();
+  if (_instance == this)
+    _instance = 0;
+}
+
+XtSettings *XtSettings::instance()
+{
+  static QMutex creating;
+  QMutexLocker locker(&creating);
+  if (! _instance)
+    _instance = new XtSettings();
+
+  // it has to live where the event loop runs for the timer to fire
+  QCoreApplication *app = QCoreApplication::instance();
+  if (app && _instance->parent() != app)
+  {
+    _instance->moveToThread(app->thread());
+    _instance->setParent(app);
+    connect(app, SIGNAL(aboutToQuit()), _instance, SLOT(sync()));
+  }
+  return _instance;
+}
+
+/* the form QSettings keeps keys in, so "/a//b/" and "a/b" are the same */
+QString XtSettings::normalize(const QString &key)
+{
+  QString result;
+  result.reserve(key.size());
+  for (int i = 0; i < key.size(); i++)
+  {
+    QChar c = key.at(i);
+    if (c == '\\')
+      c = '/';
+    if (c == '/' && (result.isEmpty() || result.endsWith('/')))
+      continue;
+    result.append(c);
+  }
+  if (result.endsWith('/'))
+    result.chop(1);
+  return result;
+}
+
+/* read every setting, then bring over the old OpenMFG settings that were
+   never copied. the xTuple settings used to be /OpenMFG/ there.
+ */
+void XtSettings::load()
 {
   QSettings settings(QSettings::UserScope, "xTuple.com", "xTuple");
-  QString key2 = key;
-  if(key.startsWith("/xTuple/"))
-    key2 = key2.replace(0, 8, QString("/OpenMFG/"));
-  if(settings.contains(key))
-    return settings.value(key, defaultValue);
-  else
+  foreach (QString key, settings.allKeys())
+    _values.insert(key, settings.value(key));
+
+  QSettings oldsettings(QSettings::UserScope, "OpenMFG.com", "OpenMFG");
+  foreach (QString oldkey, oldsettings.allKeys())
   {
-    QSettings oldsettings(QSettings::UserScope, "OpenMFG.com", "OpenMFG");
-    if(oldsettings.contains(key2))
+    QString key = oldkey;
+    if (key.startsWith("OpenMFG/"))
+      key.replace(0, 7, QString("xTuple"));
+    if (! _values.contains(key))
     {
-      QVariant val = oldsettings.value(key2, defaultValue);
-      xtsettingsSetValue(key, val);
-      return val;
+      QVariant value = oldsettings.value(oldkey);
+      _values.insert(key, value);
+      _pending.insert(key, value);
     }
   }
-  return defaultValue;
+
+  if (DEBUG)
+    qDebug("XtSettings::load() read %d settings, %d from OpenMFG",
+           _values.size(), _pending.size());
+
+  if (! _pending.isEmpty() && QCoreApplication::instance())
+    _flushTimer->start();
+}
+
+QVariant XtSettings::value(const QString &key, const QVariant &defaultValue)
+{
+  QMutexLocker locker(&_mutex);
+  QHash<QString, QVariant>::const_iterator it = _values.constFind(normalize(key));
+  return it == _values.constEnd() ? defaultValue : it.value();
+}
+
+void XtSettings::setValue(const QString &key, const QVariant &value)
+{
+  QMutexLocker locker(&_mutex);
+  QString normalized = normalize(key);
+  _values.insert(normalized, value);
+  _pending.insert(normalized, value);
+
+  if (! QCoreApplication::instance())
+  {
+    locker.unlock();
+    sync();     // no event loop to write it later
+  }
+  else if (QThread::currentThread() == thread())
+    _flushTimer->start();
+  else
+    QMetaObject::invokeMethod(_flushTimer, "start", Qt::QueuedConnection);
+}
+
+/* hand whatever has changed to the writer */
+void XtSettings::sFlush()
+{
+  QMutexLocker locker(&_mutex);
+  if (_pending.isEmpty())
+    return;
+
+  _writer.start(new XtSettingsWriter(_pending));
+  _pending.clear();
+}
+
+/* write everything that has changed and wait until it has been written */
+void XtSettings::sync()
+{
+  _flushTimer->stop();
+  sFlush();
+  _writer.waitForDone();
+}
+
+QVariant xtsettingsValue(const QString & key, const QVariant & defaultValue)
+{
+  return XtSettings::instance()->value(key, defaultValue);
 }
 
 void xtsettingsSetValue(const QString & key, const QVariant & value)
 {
-  QSettings settings(QSettings::UserScope, "xTuple.com", "xTuple");
-  settings.setValue(key, value);
+  XtSettings::instance()->setValue(key, value);
+}
+
+void xtsettingsSync()
+{
+  XtSettings::instance()->sync();
 }
 
 QScriptValue xtsettingsValueProto(QScriptContext *context, QScriptEngine *engine)
@@ -69,8 +224,22 @@ QScriptValue xtsettingsSetValueProto(QScriptContext *context, QScriptEngine *eng
   return QScriptValue();
 }
 
+QScriptValue xtsettingsSyncProto(QScriptContext *context, QScriptEngine *engine)
+{
+  Q_UNUSED(engine)
+
+  if (context->argumentCount() == 0)
+    xtsettingsSync();
+  else
+    context->throwError(QScriptContext::UnknownError,
+                        "Could not find appropriate xtsettingsSync()");
+
+  return QScriptValue();
+}
+
 void setupXtSettings(QScriptEngine *engine)
 {
   engine->globalObject().setProperty("xtsettingsValue", engine->newFunction(xtsettingsValueProto));
   engine->globalObject().setProperty("xtsettingsSetValue", engine->newFunction(xtsettingsSetValueProto));
+  engine->globalObject().setProperty("xtsettingsSync", engine->newFunction(xtsettingsSyncProto));
 }
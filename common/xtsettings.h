@@ -12,12 +12,56 @@
 #ifndef __XTSETTINGS_H__
 #define __XTSETTINGS_H__
 
+#include <QHash>
+#include <QMutex>
+#include <QObject>
 #include <QString>
+#include <QThreadPool>
 #include <QVariant>
 #include <QtScript>
 
+class QTimer;
+
 QVariant xtsettingsValue(const QString & key, const QVariant & defaultValue = QVariant());
 void xtsettingsSetValue(const QString & key, const QVariant & value);
+void xtsettingsSync();
+
+/* XtSettings holds the user's client settings in memory so the functions
+   above don't go to QSettings on every call. Everything is read once,
+   along with whatever the old OpenMFG settings still hold that the
+   xTuple settings don't. Changes are collected for a moment and written
+   together on a background thread. sync() writes anything pending and
+   waits for it; it runs when the application quits.
+ */
+class XtSettings : public QObject
+{
+  Q_OBJECT
+
+  public:
+    static XtSettings *instance();
+
+    QVariant value(const QString &key, const QVariant &defaultValue = QVariant());
+    void     setValue(const QString &key, const QVariant &value);
+
+  public slots:
+    void     sync();
+
+  protected slots:
+    void     sFlush();
+
+  private:
+    XtSettings();
+    virtual ~XtSettings();
+
+    void           load();
+    static QString normalize(const QString &key);
+
+    QTimer                  *_flushTimer;
+    QMutex                   _mutex;
+    QHash<QString, QVariant> _pending;
+    QHash<QString, QVariant> _values;
+    QThreadPool              _writer;
+};
 
 void setupXtSettings(QScriptEngine *engine);
 
@@ -0,0 +1,355 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "zipwriter.h"
+
+#ifdef _MSC_VER
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+#include <QDateTime>
+
+#define DEBUG false
+
+// collect this much before handing it to zlib
+#define INPUTBUFSIZE   65536
+#define OUTPUTBUFSIZE  65536
+
+#define FLAG_DESCRIPTOR 0x0008   // sizes and crc follow the data
+#define FLAG_UTF8       0x0800   // member name is utf-8
+
+struct ZipEntry
+{
+  QByteArray name;
+  quint16    flags;
+  quint16    method;
+  quint32    crc;
+  quint32    compressedSize;
+  quint32    size;
+  quint32    offset;
+};
+
+class ZipWriterPrivate
+{
+  public:
+    ZipWriterPrivate(QIODevice *device)
+      : device(device),
+        offset(0),
+        streaming(false),
+        failed(false)
+    {
+      QDateTime now = QDateTime::currentDateTime();
+      dosTime = (now.time().hour() << 11) | (now.time().minute() << 5)
+              | (now.time().second() / 2);
+      dosDate = ((now.date().year() - 1980) << 9) | (now.date().month() << 5)
+              | now.date().day();
+    }
+
+    static void put16(QByteArray &buf, quint16 value)
+    {
+      buf.append((char)(value & 0xff));
+      buf.append((char)((value >> 8) & 0xff));
+    }
+
+    static void put32(QByteArray &buf, quint32 value)
+    {
+      put16(buf, value & 0xffff);
+      put16(buf, (value >> 16) & 0xffff);
+    }
+
+    bool send(const QByteArray &buf)
+    {
+      return send(buf.constData(), buf.size());
+    }
+
+    bool send(const char *data, qint64 len)
+    {
+      if (failed)
+        return false;
+      if (device->write(data, len) != len)
+      {
+        failed = true;
+        return false;
+      }
+      offset += len;
+      return true;
+    }
+
+    bool writeLocalHeader(const ZipEntry &entry)
+    {
+      QByteArray header;
+      put32(header, 0x04034b50);
+      put16(header, 20);
+      put16(header, entry.flags);
+      put16(header, entry.method);
+      put16(header, dosTime);
+      put16(header, dosDate);
+      put32(header, entry.crc);
+      put32(header, entry.compressedSize);
+      put32(header, entry.size);
+      put16(header, entry.name.size());
+      put16(header, 0);
+      header.append(entry.name);
+      return send(header);
+    }
+
+    bool deflate(int flush)
+    {
+      char out[OUTPUTBUFSIZE];
+      zs.next_in  = (Bytef*)input.data();
+      zs.avail_in = input.size();
+      do
+      {
+        zs.next_out  = (Bytef*)out;
+        zs.avail_out = sizeof(out);
+        if (::deflate(&zs, flush) == Z_STREAM_ERROR)
+          return false;
+        int produced = sizeof(out) - zs.avail_out;
+        current.compressedSize += produced;
+        if (produced > 0 && ! send(out, produced))
+          return false;
+      } while (zs.avail_out == 0);
+      input.resize(0);
+      return true;
+    }
+
+    QIODevice       *device;
+    quint32          offset;
+    quint16          dosTime;
+    quint16          dosDate;
+    QList<ZipEntry>  entries;
+    ZipEntry         current;
+    bool             streaming;
+    bool             failed;
+    QByteArray       input;
+    z_stream         zs;
+};
+
+ZipWriter::ZipWriter(QIODevice *device, QObject *parent)
+  : QIODevice(parent)
+{
+  _data = new ZipWriterPrivate(device);
+  setOpenMode(QIODevice::WriteOnly);
+}
+
+ZipWriter::~ZipWriter()
+{
+  if (isOpen())
+    close();
+  delete _data;
+  _data = 0;
+}
+
+bool ZipWriter::hasError() const
+{
+  return _data->failed;
+}
+
+bool ZipWriter::isSequential() const
+{
+  return true;
+}
+
+/* add a member whose contents are already in memory. ODF requires its
+   mimetype member to be stored this way, uncompressed and with the sizes
+   in the local header.
+ */
+bool ZipWriter::addFile(const QString &name, const QByteArray &data, bool compress)
+{
+  if (_data->streaming && ! endFile())
+    return false;
+
+  ZipEntry entry;
+  entry.name   = name.toUtf8();
+  entry.flags  = FLAG_UTF8;
+  entry.method = compress ? Z_DEFLATED : 0;
+  entry.crc    = crc32(0, (const Bytef*)data.constData(), data.size());
+  entry.size   = data.size();
+  entry.offset = _data->offset;
+
+  QByteArray stored = data;
+  if (compress)
+  {
+    uLongf len = compressBound(data.size());
+    QByteArray packed(len, '\0');
+    z_stream zs;
+    zs.zalloc = Z_NULL;
+    zs.zfree  = Z_NULL;
+    zs.opaque = Z_NULL;
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+      setErrorString(tr("Could not start compressing %1").arg(name));
+      return false;
+    }
+    zs.next_in   = (Bytef*)data.constData();
+    zs.avail_in  = data.size();
+    zs.next_out  = (Bytef*)packed.data();
+    zs.avail_out = packed.size();
+    int result = ::deflate(&zs, Z_FINISH);
+    packed.truncate(zs.total_out);
+    deflateEnd(&zs);
+    if (result != Z_STREAM_END)
+    {
+      setErrorString(tr("Could not compress %1").arg(name));
+      return false;
+    }
+    stored = packed;
+  }
+  entry.compressedSize = stored.size();
+
+  if (! _data->writeLocalHeader(entry) || ! _data->send(stored))
+  {
+    setErrorString(_data->device->errorString());
+    return false;
+  }
+  _data->entries.append(entry);
+  return true;
+}
+
+/* start a member whose contents will be written to this device. the
+   size and checksum aren't known yet so they follow the data.
+ */
+bool ZipWriter::beginFile(const QString &name)
+{
+  if (_data->streaming && ! endFile())
+    return false;
+
+  _data->current.name           = name.toUtf8();
+  _data->current.flags          = FLAG_UTF8 | FLAG_DESCRIPTOR;
+  _data->current.method         = Z_DEFLATED;
+  _data->current.crc            = crc32(0, Z_NULL, 0);
+  _data->current.compressedSize = 0;
+  _data->current.size           = 0;
+  _data->current.offset         = _data->offset;
+
+  _data->zs.zalloc = Z_NULL;
+  _data->zs.zfree  = Z_NULL;
+  _data->zs.opaque = Z_NULL;
+  if (deflateInit2(&_data->zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+  {
+    setErrorString(tr("Could not start compressing %1").arg(name));
+    return false;
+  }
+
+  if (! _data->writeLocalHeader(_data->current))
+  {
+    deflateEnd(&_data->zs);
+    setErrorString(_data->device->errorString());
+    return false;
+  }
+  _data->input.reserve(INPUTBUFSIZE);
+  _data->streaming = true;
+  return true;
+}
+
+bool ZipWriter::endFile()
+{
+  if (! _data->streaming)
+    return true;
+  _data->streaming = false;
+
+  bool ok = _data->deflate(Z_FINISH);
+  deflateEnd(&_data->zs);
+
+  QByteArray descriptor;
+  ZipWriterPrivate::put32(descriptor, 0x08074b50);
+  ZipWriterPrivate::put32(descriptor, _data->current.crc);
+  ZipWriterPrivate::put32(descriptor, _data->current.compressedSize);
+  ZipWriterPrivate::put32(descriptor, _data->current.size);
+  if (! ok || ! _data->send(descriptor))
+  {
+    setErrorString(_data->device->errorString());
+    return false;
+  }
+
+  _data->entries.append(_data->current);
+  if (DEBUG)
+    qDebug("ZipWriter::endFile() %s: %u bytes, %u compressed",
+           _data->current.name.constData(), _data->current.size,
+           _data->current.compressedSize);
+  return true;
+}
+
+qint64 ZipWriter::readData(char *data, qint64 maxlen)
+{
+  Q_UNUSED(data);
+  Q_UNUSED(maxlen);
+  return -1;
+}
+
+qint64 ZipWriter::writeData(const char *data, qint64 len)
+{
+  if (! _data->streaming || _data->failed)
+    return -1;
+
+  _data->current.crc   = crc32(_data->current.crc, (const Bytef*)data, len);
+  _data->current.size += len;
+  _data->input.append(data, len);
+  if (_data->input.size() >= INPUTBUFSIZE && ! _data->deflate(Z_NO_FLUSH))
+  {
+    setErrorString(_data->device->errorString());
+    return -1;
+  }
+  return len;
+}
+
+/* finish the last member and write the central directory. the device
+   the archive was written to is left open.
+ */
+void ZipWriter::close()
+{
+  if (! isOpen())
+    return;
+
+  endFile();
+
+  QByteArray directory;
+  for (int i = 0; i < _data->entries.size(); i++)
+  {
+    const ZipEntry &entry = _data->entries.at(i);
+    ZipWriterPrivate::put32(directory, 0x02014b50);
+    ZipWriterPrivate::put16(directory, 20);
+    ZipWriterPrivate::put16(directory, 20);
+    ZipWriterPrivate::put16(directory, entry.flags);
+    ZipWriterPrivate::put16(directory, entry.method);
+    ZipWriterPrivate::put16(directory, _data->dosTime);
+    ZipWriterPrivate::put16(directory, _data->dosDate);
+    ZipWriterPrivate::put32(directory, entry.crc);
+    ZipWriterPrivate::put32(directory, entry.compressedSize);
+    ZipWriterPrivate::put32(directory, entry.size);
+    ZipWriterPrivate::put16(directory, entry.name.size());
+    ZipWriterPrivate::put16(directory, 0);  // extra field
+    ZipWriterPrivate::put16(directory, 0);  // comment
+    ZipWriterPrivate::put16(directory, 0);  // disk number
+    ZipWriterPrivate::put16(directory, 0);  // internal attributes
+    ZipWriterPrivate::put32(directory, 0);  // external attributes
+    ZipWriterPrivate::put32(directory, entry.offset);
+    directory.append(entry.name);
+  }
+
+  quint32 start = _data->offset;
+  quint32 size  = directory.size();
+  ZipWriterPrivate::put32(directory, 0x06054b50);
+  ZipWriterPrivate::put16(directory, 0);
+  ZipWriterPrivate::put16(directory, 0);
+  ZipWriterPrivate::put16(directory, _data->entries.size());
+  ZipWriterPrivate::put16(directory, _data->entries.size());
+  ZipWriterPrivate::put32(directory, size);
+  ZipWriterPrivate::put32(directory, start);
+  ZipWriterPrivate::put16(directory, 0);
+  if (! _data->send(directory))
+    setErrorString(_data->device->errorString());
+
+  QIODevice::close();
+}
@@ -0,0 +1,52 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __ZIPWRITER_H__
+#define __ZIPWRITER_H__
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+#include <QString>
+
+class ZipWriterPrivate;
+
+/* ZipWriter writes a zip archive to another device, one member at a time.
+   Small members can be added whole with addFile(). Large ones are
+   streamed: call beginFile(), write() the contents to the ZipWriter
+   itself (directly or through a QTextStream or QXmlStreamWriter), then
+   endFile(). close() writes the archive's directory.
+   Archives are limited to 4GB - there is no zip64 support.
+ */
+class ZipWriter : public QIODevice
+{
+  Q_OBJECT
+
+  public:
+    ZipWriter(QIODevice *device, QObject *parent = 0);
+    virtual ~ZipWriter();
+
+    bool addFile(const QString &name, const QByteArray &data, bool compress = true);
+    bool beginFile(const QString &name);
+    bool endFile();
+    bool hasError() const;
+
+    virtual void close();
+    virtual bool isSequential() const;
+
+  protected:
+    virtual qint64 readData(char *data, qint64 maxlen);
+    virtual qint64 writeData(const char *data, qint64 len);
+
+  private:
+    ZipWriterPrivate *_data;
+};
+
+#endif
@@ -10,10 +10,12 @@
 
 #include <QApplication>
 #include <QDir>
+#include <QEventLoop>
 #include <QFile>
 #include <QMessageBox>
 #include <QProcess>
 #include <QSqlError>
+#include <QTimer>
 #if QT_VERSION < 0x050000
 #include <QHttp>
 #else
@@ -45,6 +47,9 @@
 
 #define DEBUG false
 
+// how long to wait for the gateway before giving up on a request
+#define HTTPTIMEOUT (120 * 1000)
+
 /* TODO: split this into CreditCardProcessor and CreditCardTransaction.
          the _passedAvs and _passedCvv flags are examples of why the
          current structure is problematic. bug 8215 might be another example.
@@ -237,6 +242,7 @@ static struct {
 	    "Please enter one and try again.")				},
   { -99, QT_TRANSLATE_NOOP("CreditCardProcessor", "The CVV value is not valid.")				},
   {-100, QT_TRANSLATE_NOOP("CreditCardProcessor", "No approval code was received:\n%1\n%2\n%3")		},
+  {-101, QT_TRANSLATE_NOOP("CreditCardProcessor", "The request was sent and is waiting for a response.")	},
 
   // accounting setup errors
   {-110, QT_TRANSLATE_NOOP("CreditCardProcessor", "Accounting Configuration Error: %1") },
@@ -299,6 +305,23 @@ bool CreditCardProcessor::certificateIsValid(const QSslCertificate *cert)
 #endif
 }
 
+#if QT_VERSION >= 0x050000
+static QNetworkAccessManager *_session = 0;
+
+/* every processor shares one network session so connections to the
+   gateway, and their TLS sessions, are kept alive from one transaction
+   to the next instead of being set up again each time
+ */
+static QNetworkAccessManager *gatewaySession()
+{
+  if (! _session)
+    _session = new QNetworkAccessManager(qApp);
+  return _session;
+}
+#endif
+
+static CreditCardBatch *_batch = 0;
+
 /** @brief Construct and initialize a default CreditCardProcessor.
 
     This should never be called except by the constructor of a subclass.
@@ -314,7 +337,7 @@ CreditCardProcessor::CreditCardProcessor()
     _defaultLivePort(0),
     _defaultTestPort(0),
 #if QT_VERSION >= 0x050000
-    _manager(0)
+    _manager(gatewaySession())
 #else
     _http(0)
 #endif
@@ -568,6 +591,7 @@ int CreditCardProcessor::authorize(const int pccardid, const QString &pcvv, cons
   }
 
   if (_metrics->boolean("CCConfirmPreauth") &&
+      ! CreditCardBatch::resuming() &&
       QMessageBox::question(0,
 		    tr("Confirm Preauthorization of Credit Card Purchase"),
 		    tr("<p>Are you sure that you want to preauthorize "
@@ -585,7 +609,7 @@ int CreditCardProcessor::authorize(const int pccardid, const QString &pcvv, cons
   ParameterList dbupdateinfo;
   double amount = pamount;
   returnVal = doAuthorize(pccardid, pcvv, amount, ptax, ptaxexempt, pfreight, pduty, pcurrid, pneworder, preforder, pccpayid, dbupdateinfo);
-  if (returnVal == -70 || returnVal == -18)
+  if (returnVal == -70 || returnVal == -18 || returnVal == -101)
     return returnVal;
   else if (returnVal > 0)
     _errorMsg = errorMsg(4).arg(_errorMsg);
@@ -946,6 +970,7 @@ int CreditCardProcessor::chargePreauthorized(const QString &pcvv, const double p
   }
 
   if (_metrics->boolean("CCConfirmChargePreauth") &&
+      ! CreditCardBatch::resuming() &&
       QMessageBox::question(0,
 	      tr("Confirm Post-authorization of Credit Card Purchase"),
               tr("Are you sure that you want to charge a pre-authorized "
@@ -962,7 +987,7 @@ int CreditCardProcessor::chargePreauthorized(const QString &pcvv, const double p
 
   ParameterList dbupdateinfo;
   returnVal = doChargePreauthorized(ccardid, pcvv, pamount, pcurrid, pneworder, preforder, pccpayid, dbupdateinfo);
-  if (returnVal == -71 || returnVal == -18)
+  if (returnVal == -71 || returnVal == -18 || returnVal == -101)
     return returnVal;
   else if (returnVal > 0)
     _errorMsg = errorMsg(4).arg(_errorMsg);
@@ -1926,53 +1951,32 @@ int CreditCardProcessor::sendViaHTTP(const QString &prequest,
     }
     presponse = _http->readAll();
 #else
-    QNetworkRequest request;
-    QUrl ccurl(buildURL(_metrics->value("CCServer"), _metrics->value("CCPort"), true));
-
-    request.setUrl(ccurl);
-
-    if (!_extraHeaders.isEmpty())
-    {
-      QPair<QString,QString> pair;
-      foreach(pair, _extraHeaders)
-        request.setRawHeader(pair.first.toLatin1(), pair.second.toLatin1());
-    }
-
-    if(ccurl.scheme().compare("https", Qt::CaseInsensitive) == 0)
-       request.setSslConfiguration(QSslConfiguration::defaultConfiguration());
-
-    _manager = new QNetworkAccessManager(this);
-    connect(_manager, SIGNAL(sslErrors(QNetworkReply*, const QList<QSslError> &)),
-            this,  SLOT(sslErrors(QNetworkReply*, const QList<QSslError> &)));
-
-    if(_metrics->boolean("CCUseProxyServer"))
+    // a batch hands back the reply to a request it sent earlier
+    QNetworkReply *reply = CreditCardBatch::takeReply();
+    if (! reply)
     {
-      _manager->setProxy(QNetworkProxy(QNetworkProxy::HttpProxy,
-                                       _metrics->value("CCProxyServer"),
-                                       _metrics->value("CCProxyPort").toInt(),
-                                       _metricsenc->value("CCProxyLogin"),
-                                       _metricsenc->value("CCPassword")));
+      reply = postViaHTTP(prequest);
+      if (CreditCardBatch::defer(reply))
+      {
+        _errorMsg = errorMsg(-101);
+        return -101;
+      }
+      QApplication::setOverrideCursor( QCursor(Qt::WaitCursor) );
+      waitForHTTP(reply);
+      QApplication::restoreOverrideCursor();
     }
 
-    QApplication::setOverrideCursor( QCursor(Qt::WaitCursor) );
-    QNetworkReply *reply;
-    reply =_manager->post(request, prequest.toUtf8());
-
-    if (!waitForHTTP())
-    {
-      //TODO? handle waitForHTTP returning false => timeout
-    }
-    QApplication::restoreOverrideCursor();
-
     if(reply->error() != QNetworkReply::NoError)
     {
       _errorMsg = errorMsg(-18)
-                        .arg(ccurl.toString())
+                        .arg(reply->url().toString())
                         .arg(reply->error())
                         .arg(reply->errorString());
+      reply->deleteLater();
       return -18;
     }
     presponse = reply->readAll();
+    reply->deleteLater();
 #endif
   }
   else
@@ -2096,19 +2100,82 @@ int CreditCardProcessor::sendViaHTTP(const QString &prequest,
   return 0;
 }
 
-/** @brief Wait for the HTTP request sent by _manager to finish.
-           Added for Qt5.
+/** @brief Post a message to the service without waiting for the response.
+
+    The request goes out on the network session shared by all
+    processors, so it reuses an open connection to the service if
+    there is one. The caller owns the reply.
+
+    @param[in]  prequest  The string to send via HTTP
+    @return The reply, which will signal finished() when the service
+            has responded
+ */
+QNetworkReply *CreditCardProcessor::postViaHTTP(const QString &prequest)
+{
+#if QT_VERSION >= 0x050000
+  QNetworkRequest request;
+  QUrl ccurl(buildURL(_metrics->value("CCServer"), _metrics->value("CCPort"), true));
 
-    @todo Add a timeout parameter and return false if it is exceeded.
+  request.setUrl(ccurl);
+
+  if (!_extraHeaders.isEmpty())
+  {
+    QPair<QString,QString> pair;
+    foreach(pair, _extraHeaders)
+      request.setRawHeader(pair.first.toLatin1(), pair.second.toLatin1());
+  }
+
+  if(ccurl.scheme().compare("https", Qt::CaseInsensitive) == 0)
+     request.setSslConfiguration(QSslConfiguration::defaultConfiguration());
+
+  QNetworkProxy proxy(QNetworkProxy::DefaultProxy);
+  if(_metrics->boolean("CCUseProxyServer"))
+    proxy = QNetworkProxy(QNetworkProxy::HttpProxy,
+                          _metrics->value("CCProxyServer"),
+                          _metrics->value("CCProxyPort").toInt(),
+                          _metricsenc->value("CCProxyLogin"),
+                          _metricsenc->value("CCPassword"));
+  if (_manager->proxy() != proxy)
+    _manager->setProxy(proxy);
+
+  QNetworkReply *reply = _manager->post(request, prequest.toUtf8());
+  connect(reply, SIGNAL(sslErrors(const QList<QSslError> &)),
+          this,  SLOT(sslErrors(const QList<QSslError> &)));
+  return reply;
+#else
+  Q_UNUSED(prequest);
+  return 0;
+#endif
+}
+
+/** @brief Wait for an HTTP request sent by postViaHTTP to finish.
+
+    The request is aborted if the service takes longer than
+    HTTPTIMEOUT to respond.
+
+    @return false if the request timed out
   */
-bool CreditCardProcessor::waitForHTTP()
+bool CreditCardProcessor::waitForHTTP(QNetworkReply *preply)
 {
 #if QT_VERSION >= 0x050000
-  QEventLoop loop;
+  if (! preply || preply->isFinished())
+    return true;
 
-  connect(_manager, SIGNAL(finished(QNetworkReply *)),
-          &loop, SLOT(quit()));
+  QEventLoop loop;
+  QTimer     timer;
+  timer.setSingleShot(true);
+  connect(preply, SIGNAL(finished()), &loop, SLOT(quit()));
+  connect(&timer, SIGNAL(timeout()),  &loop, SLOT(quit()));
+  timer.start(HTTPTIMEOUT);
   loop.exec();
+
+  if (! preply->isFinished())
+  {
+    preply->abort();
+    return false;
+  }
+#else
+  Q_UNUSED(preply);
 #endif
   return true;
 }
@@ -3219,6 +3286,204 @@ ParameterList CreditCardProcessor::voidPrevious(const ParameterList &pinput)
   return *poutput;
 }
 
+/** @brief Processes many pre-authorization transactions at once.
+
+    This is intended for end-of-day and other bulk processing, usually
+    from %scripts. Each element of pinputs holds the same parameters as
+    authorize(const ParameterList &pinput) and is authorized on its own
+    processor, but up to pmaxrunning of them wait on the service at
+    the same time. Each transaction is recorded as soon as its response
+    arrives, whatever happens to the rest of the batch.
+
+    @code
+      var batch = [];
+      for (var i = 0; i < pending.length; i++)
+        batch.push({ ccard_id: pending[i].ccard_id, amount: pending[i].amount,
+                     curr_id: pending[i].curr_id, ... });
+      var results = toolbox.getProcessor().authorizeBatch(batch, 4);
+      for (var i = 0; i < results.length; i++)
+        if (results[i].returnVal < 0)
+          // handle results[i].errorMsg
+    @endcode
+
+    @param pinputs     The parameter lists to pass to authorize
+    @param pmaxrunning The most transactions to have in progress at once
+    @return One parameter list per element of pinputs, in the same order,
+            holding the output of authorize plus the errorMsg it left
+
+    @see CreditCardBatch
+ */
+QList<ParameterList> CreditCardProcessor::authorizeBatch(const QList<ParameterList> &pinputs, int pmaxrunning)
+{
+  return CreditCardBatch(Authorize, pinputs, pmaxrunning).exec();
+}
+
+/** @brief Captures many preauthorized transactions at once.
+
+    Each element of pinputs holds the same parameters as
+    chargePreauthorized(const ParameterList &pinput), usually the
+    ccpay_id, amount, and curr_id of a preauthorized ccpay record.
+
+    @param pinputs     The parameter lists to pass to chargePreauthorized
+    @param pmaxrunning The most transactions to have in progress at once
+    @return One parameter list per element of pinputs, in the same order,
+            holding the output of chargePreauthorized plus the errorMsg
+            it left
+
+    @see authorizeBatch
+ */
+QList<ParameterList> CreditCardProcessor::chargePreauthorizedBatch(const QList<ParameterList> &pinputs, int pmaxrunning)
+{
+  return CreditCardBatch(Capture, pinputs, pmaxrunning).exec();
+}
+
+CreditCardBatch::CreditCardBatch(CreditCardProcessor::CCTransaction ptype,
+                                 const QList<ParameterList> &pinputs,
+                                 int pmaxrunning)
+  : _current(-1),
+    _inputs(pinputs),
+    _loop(0),
+    _maxRunning(qMax(1, pmaxrunning)),
+    _next(0),
+    _resuming(false),
+    _running(0),
+    _type(ptype)
+{
+  for (int i = 0; i < _inputs.size(); i++)
+  {
+    _outputs.append(ParameterList());
+    _replies.append(0);
+  }
+}
+
+/* run every transaction and return their results. this waits in one
+   event loop for the whole batch; each reply is handled by sFinished.
+ */
+QList<ParameterList> CreditCardBatch::exec()
+{
+  QEventLoop loop;
+  _loop = &loop;
+
+  startNext();
+  if (_running > 0 || _next < _inputs.size())
+    loop.exec();
+
+  _loop = 0;
+  return _outputs;
+}
+
+/* called by sendViaHTTP after posting a request. if that request belongs
+   to the first pass of a batch transaction, the batch takes the reply and
+   the transaction stops there until the reply finishes.
+ */
+bool CreditCardBatch::defer(QNetworkReply *preply)
+{
+  if (! _batch || _batch->_resuming || _batch->_current < 0 || ! preply ||
+      _batch->_replies.at(_batch->_current))
+    return false;
+
+  _batch->_replies[_batch->_current] = preply;
+
+  QTimer *timer = new QTimer(preply);
+  timer->setSingleShot(true);
+  connect(timer,  SIGNAL(timeout()),  preply, SLOT(abort()));
+  connect(preply, SIGNAL(finished()), _batch, SLOT(sFinished()));
+  timer->start(HTTPTIMEOUT);
+
+  return true;
+}
+
+/* true while a transaction is being finished with its reply, so
+   the user isn't asked to confirm it a second time
+ */
+bool CreditCardBatch::resuming()
+{
+  return _batch && _batch->_resuming;
+}
+
+/* called by sendViaHTTP before posting a request. on the second pass
+   of a batch transaction this returns the finished reply, once.
+ */
+QNetworkReply *CreditCardBatch::takeReply()
+{
+  if (! _batch || ! _batch->_resuming || _batch->_current < 0)
+    return 0;
+
+  QNetworkReply *reply = _batch->_replies.at(_batch->_current);
+  _batch->_replies[_batch->_current] = 0;
+  return reply;
+}
+
+/* run one pass of a transaction. a confirmation dialog can let another
+   reply finish in the middle of this, so the state is put back after.
+ */
+void CreditCardBatch::run(int pindex, bool presuming)
+{
+  CreditCardBatch *batch    = _batch;
+  int              current  = _current;
+  bool             resuming = _resuming;
+
+  _batch    = this;
+  _current  = pindex;
+  _resuming = presuming;
+
+  ParameterList output;
+  if (_type == CreditCardProcessor::Authorize)
+    output = CreditCardProcessor::authorize(_inputs.at(pindex));
+  else
+    output = CreditCardProcessor::chargePreauthorized(_inputs.at(pindex));
+
+  _batch    = batch;
+  _current  = current;
+  _resuming = resuming;
+
+  if (_replies.at(pindex) && ! presuming)
+    return;       // waiting for the service
+
+  if (_replies.at(pindex))
+  {
+    _replies.at(pindex)->deleteLater();
+    _replies[pindex] = 0;
+  }
+
+  output.append("errorMsg", CreditCardProcessor::errorMsg());
+  _outputs[pindex] = output;
+  _running--;
+}
+
+/* start transactions until the batch has as many in flight as it may */
+void CreditCardBatch::startNext()
+{
+  while (_running < _maxRunning && _next < _inputs.size())
+  {
+    int i = _next++;
+    _running++;
+
+    if (DEBUG)
+      qDebug("CreditCardBatch::startNext() %d of %d, %d running",
+             i + 1, _inputs.size(), _running);
+
+    run(i, false);
+  }
+
+  if (_loop && _running == 0 && _next >= _inputs.size())
+    _loop->quit();
+}
+
+/* the service responded to one transaction; record it and start the next */
+void CreditCardBatch::sFinished()
+{
+  int i = _replies.indexOf(qobject_cast<QNetworkReply*>(sender()));
+  if (i < 0)
+    return;
+
+  if (DEBUG)
+    qDebug("CreditCardBatch::sFinished() %d of %d", i + 1, _inputs.size());
+
+  run(i, true);
+  startNext();
+}
+
 CreditCardProcessor::FraudCheckResult *CreditCardProcessor::avsCodeLookup(QChar pcode)
 {
   for (int i = 0; i < _avsCodes.length(); i++)
@@ -3237,6 +3502,11 @@ CreditCardProcessor::FraudCheckResult *CreditCardProcessor::cvvCodeLookup(QChar
   return 0;
 }
 #if QT_VERSION >= 0x050000
+void CreditCardProcessor::sslErrors(const QList<QSslError> &errors)
+{
+  sslErrors(qobject_cast<QNetworkReply*>(sender()), errors);
+}
+
 void CreditCardProcessor::sslErrors(QNetworkReply *reply, const QList<QSslError> &errors)
 {
   if (DEBUG)
@@ -21,6 +21,8 @@
 #endif
 #include <parameter.h>
 
+class QEventLoop;
+class QNetworkReply;
 class QSslCertificate;
 
 class CreditCardProcessor : public QObject
@@ -72,6 +74,8 @@ class CreditCardProcessor : public QObject
     Q_INVOKABLE static ParameterList chargePreauthorized(const ParameterList &);
     Q_INVOKABLE static ParameterList credit(const ParameterList &);
     Q_INVOKABLE static ParameterList voidPrevious(const ParameterList &);
+    Q_INVOKABLE static QList<ParameterList> authorizeBatch(const QList<ParameterList> &, int = 4);
+    Q_INVOKABLE static QList<ParameterList> chargePreauthorizedBatch(const QList<ParameterList> &, int = 4);
 
     // these are support methods that typically won't be overridden
     Q_INVOKABLE virtual int     canProcessCCTrans(int pCardId, int pCurrId);
@@ -108,9 +112,10 @@ class CreditCardProcessor : public QObject
     virtual FraudCheckResult *cvvCodeLookup(QChar pcode);
     static  double  currToCurr(const int, const int, const double, int * = 0);
     virtual int     fraudChecks();
+    virtual QNetworkReply *postViaHTTP(const QString&);
     virtual int     sendViaHTTP(const QString&, QString&);
     virtual int     updateCCPay(int &, ParameterList &);
-    virtual bool    waitForHTTP();
+    virtual bool    waitForHTTP(QNetworkReply *);
 
     QList<FraudCheckResult*> _avsCodes;
     QList<FraudCheckResult*> _cvvCodes;
@@ -137,12 +142,52 @@ class CreditCardProcessor : public QObject
     QList<QPair<QString, QString> > _extraHeaders;
 
     protected slots:
-    #if QT_VERSION < 0x050000
       void sslErrors(const QList<QSslError> &errors);
-    #else
+    #if QT_VERSION >= 0x050000
       void sslErrors(QNetworkReply *reply, const QList<QSslError> &errors);
     #endif
 
 };
 
+/* CreditCardBatch runs many transactions of one kind against the
+   gateway, keeping up to a given number of requests in flight at once.
+   Each transaction goes through the usual CreditCardProcessor method
+   twice. The first pass does the checks, builds the request, and posts
+   it without waiting. When that reply finishes, the second pass repeats
+   the same steps with the reply in hand instead of sending again, so the
+   response is parsed and recorded in ccpay as soon as it arrives.
+ */
+class CreditCardBatch : public QObject
+{
+  Q_OBJECT
+
+  public:
+    CreditCardBatch(CreditCardProcessor::CCTransaction ptype,
+                    const QList<ParameterList> &pinputs, int pmaxrunning);
+
+    QList<ParameterList> exec();
+
+    static bool           defer(QNetworkReply *preply);
+    static bool           resuming();
+    static QNetworkReply *takeReply();
+
+  protected slots:
+    void sFinished();
+
+  private:
+    void run(int pindex, bool presuming);
+    void startNext();
+
+    int                                 _current;
+    QList<ParameterList>                _inputs;
+    QEventLoop                         *_loop;
+    int                                 _maxRunning;
+    int                                 _next;
+    QList<ParameterList>                _outputs;
+    QList<QNetworkReply*>               _replies;
+    bool                                _resuming;
+    int                                 _running;
+    CreditCardProcessor::CCTransaction  _type;
+};
+
 #endif // CREDITCARDPROCESSOR_H
@@ -22,7 +22,6 @@
 #include <QTranslator>
 
 #include <parameter.h>
-#include <gunzip.h>
 #include <tarfile.h>
 
 dictionaries::dictionaries(QWidget* parent, const char* name, Qt::WindowFlags fl)
@@ -66,66 +65,51 @@ void dictionaries::finished(QNetworkReply * nwrep)
       if(!ba.isEmpty())
       {
         #if QT_VERSION >= 0x050000
-        QDir dir(QStandardPaths::writableLocation(QStandardPaths::DataLocation));
-        if(!dir.exists())
-          dir.mkpath(QStandardPaths::writableLocation(QStandardPaths::DataLocation));
-        QFile file(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/spell." + langext + ".tar.gz");
+        QString dataLocation = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
         #else
-        QDir dir(QDesktopServices::storageLocation(QDesktopServices::DataLocation));
-        if(!dir.exists())
-           dir.mkpath(QDesktopServices::storageLocation(QDesktopServices::DataLocation));
-        QFile file(QDesktopServices::storageLocation(QDesktopServices::DataLocation) + "/spell." + langext + ".tar.gz");
+        QString dataLocation = QDesktopServices::storageLocation(QDesktopServices::DataLocation);
         #endif
+        QDir dir(dataLocation);
+        if(!dir.exists())
+          dir.mkpath(dataLocation);
+        QFile file(dataLocation + "/spell." + langext + ".tar.gz");
         if(file.open(QIODevice::WriteOnly | QIODevice::Truncate))
         {
           file.write(ba);
           file.close();
-          QByteArray data = gunzipFile(file.fileName());
-          if(!data.isEmpty())
+          ba.clear();
+
+          // unpack each file straight to disk as it comes out of the archive
+          TarReader archive(file.fileName());
+          bool error = false;
+          int  count = 0;
+          while (archive.next())
           {
-            TarFile *_files = new TarFile(data);
-            if(_files->isValid())
+            count++;
+            if (! archive.extract(dataLocation))
             {
-              bool error = false;
-              QMapIterator<QString, QByteArray> i(_files->_list);
-              while (i.hasNext())
-              {
-                i.next();
-                //cout << i.key() << ": " << i.value() << endl;
-                #if QT_VERSION >= 0x050000
-                QFile ff(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/" + i.key());
-                #else
-                QFile ff(QDesktopServices::storageLocation(QDesktopServices::DataLocation) + "/" + i.key());
-                #endif
-                if(ff.open(QIODevice::WriteOnly | QIODevice::Truncate))
-                {
-                  ff.write(i.value());
-                  ff.close();
-                }
-                else
-                {
-                  error = true;
-                }
-              }
-              if(error)
-              {
-                _label->setText(tr("Could not save one or more files."));
-              }
-              else
-              {
-                _label->setText(tr("Dictionaries downloaded."));
-              }
+              qDebug() << "Error: " << archive.errorString();
+              error = true;
             }
-            else
-            {
-              _label->setText(tr("Could not read archive format."));
-            }
-            delete _files;
           }
-          else
+
+          if (! archive.isValid())
+          {
+            qDebug() << "Error: " << archive.errorString();
+            _label->setText(tr("Could not read archive format."));
+          }
+          else if (count == 0)
           {
             _label->setText(tr("Could not uncompress file."));
           }
+          else if(error)
+          {
+            _label->setText(tr("Could not save one or more files."));
+          }
+          else
+          {
+            _label->setText(tr("Dictionaries downloaded."));
+          }
         }
         else
         {
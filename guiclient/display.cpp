@@ -12,11 +12,14 @@
 #include "display.h"
 #include "ui_display.h"
 
+#include <QGridLayout>
+#include <QSqlDriver>
 #include <QSqlError>
 #include <QMessageBox>
 #include <QPrinter>
 #include <QPrintDialog>
 #include <QShortcut>
+#include <QTimer>
 #include <QToolButton>
 
 #include <metasql.h>
@@ -27,9 +30,11 @@
 #include <parameter.h>
 #include <previewdialog.h>
 
+#include "backgroundquery.h"
 #include "parameterlistsetup.h"
 #include "errorReporter.h"
 #include "displayprivate.h"
+#include "xtreewidgetmodel.h"
 
 displayPrivate::displayPrivate(::display *parent)
     : QObject(parent),
@@ -37,6 +42,14 @@ displayPrivate::displayPrivate(::display *parent)
       _queryOnStartEnabled(false),
       _autoUpdateEnabled(false),
       _filterChanged(false),
+      _virtualList(false),
+      _vlist(0),
+      _fill(0),
+      _fillId(-1),
+      _fillStarted(false),
+      _fillStyle(XTreeWidget::Replace),
+      _autoUpdateTimer(0),
+      _refreshing(false),
       _parent(parent)
 {
   setupUi(_parent);
@@ -121,6 +134,12 @@ displayPrivate::displayPrivate(::display *parent)
   _queryBtn->setFocusPolicy(Qt::NoFocus);
   _queryAct = _toolBar->addWidget(_queryBtn);
 
+  _cancelBtn = new QToolButton(_toolBar);
+  _cancelBtn->setObjectName("_cancelBtn");
+  _cancelBtn->setFocusPolicy(Qt::NoFocus);
+  _cancelAct = _toolBar->addWidget(_cancelBtn);
+  _cancelAct->setVisible(false); // only while a query is running
+
   // Menu actions for query options
   _queryMenu = new QMenu(_queryBtn);
   _queryOnStartAct = new QAction(_queryMenu);
@@ -135,6 +154,11 @@ displayPrivate::displayPrivate(::display *parent)
 
   _parent->layout()->setContentsMargins(0,0,0,0);
   _parent->layout()->setSpacing(0);
+
+  _autoUpdateTimer = new QTimer(this);
+  _autoUpdateTimer->setSingleShot(true);
+  _autoUpdateTimer->setInterval(1000);
+  connect(_autoUpdateTimer, SIGNAL(timeout()), this, SLOT(sAutoUpdate()));
 }
 
 void displayPrivate::sFilterChanged()
@@ -142,6 +166,89 @@ void displayPrivate::sFilterChanged()
   _filterChanged = true;
 }
 
+/* an automatic update patches the rows already in the list, or just the
+   rows that changed if the query understands the modifiedSince parameter
+ */
+void displayPrivate::sAutoUpdate()
+{
+  if (_fill && _fill->isActive())   // still working on the last one
+    return;
+
+  _refreshing = true;
+  _parent->sFillList();
+  _refreshing = false;
+}
+
+void displayPrivate::sNotified(const QString &note)
+{
+  if (_autoUpdateNotices.contains(note))
+    _autoUpdateTimer->start();  // let a burst of changes settle first
+}
+
+/* queries that take modifiedSince return their start time in an
+   xtfilltime column so the next update can ask for what changed since
+   then without another round trip to the server
+ */
+void displayPrivate::noteFillTime(const QList<QSqlRecord> &rows)
+{
+  if (! _fillTime.isValid() && ! rows.isEmpty() && rows.first().contains("xtfilltime"))
+    _fillTime = rows.first().value("xtfilltime").toDateTime();
+}
+
+void displayPrivate::sFillRows()
+{
+  QList<QSqlRecord> rows = _fill->takeRows();
+  if (rows.isEmpty())
+    return;
+
+  noteFillTime(rows);
+
+  _list->populate(rows, _fillId, _useAltId,
+                  (_fillStarted && _fillStyle == XTreeWidget::Replace) ? XTreeWidget::Append : _fillStyle,
+                  true);
+  _fillStarted = true;
+}
+
+// hand the list whatever is left so it can total, sort and select
+void displayPrivate::finishFill()
+{
+  QList<QSqlRecord> rows = _fill->takeRows();
+  noteFillTime(rows);
+  _list->populate(rows, _fillId, _useAltId,
+                  (_fillStarted && _fillStyle == XTreeWidget::Replace) ? XTreeWidget::Append : _fillStyle,
+                  false);
+  _fillStarted = false;
+  _cancelAct->setVisible(false);
+}
+
+void displayPrivate::sFillFinished(bool ok)
+{
+  finishFill();
+  if (! ok)
+  {
+    ErrorReporter::error(QtCriticalMsg, _parent, ::display::tr("Error Retrieving Information"),
+                         _fill->lastError(), __FILE__, __LINE__);
+    return;
+  }
+  if (_fillTime.isValid())
+    _lastFill = _fillTime;
+  emit _parent->fillListAfter();
+}
+
+/* keep the rows that have already arrived. fillListAfter() is still
+   emitted so scripts that disable things in fillListBefore() recover,
+   whether the user cancelled or sFillList() started another fill.
+ */
+void displayPrivate::sCancelFill()
+{
+  if (! _fill || ! _fill->isActive())
+    return;
+
+  _fill->cancel();
+  finishFill();
+  emit _parent->fillListAfter();
+}
+
 void displayPrivate::print(ParameterList pParams, bool showPreview, bool forceSetParams)
 {
   int numCopies = 1;
@@ -352,6 +459,7 @@ display::display(QWidget* parent, const char* name, Qt::WindowFlags flags)
   _data->_printBtn->setText(tr("Print"));
   _data->_previewBtn->setText(tr("Preview"));
   _data->_queryBtn->setText(tr("Query"));
+  _data->_cancelBtn->setText(tr("Cancel"));
   _data->_queryOnStartAct->setText(tr("Query on start"));
   _data->_autoUpdateAct->setText(tr("Automatically Update"));
 
@@ -374,6 +482,7 @@ display::display(QWidget* parent, const char* name, Qt::WindowFlags flags)
   _data->_printBtn->setToolTip(_data->_printBtn->text() + " " + _data->_printAct->shortcut().toString(QKeySequence::NativeText));
   _data->_expandBtn->setToolTip(_data->_expandBtn->text());
   _data->_collapseBtn->setToolTip(_data->_collapseBtn->text());
+  _data->_cancelBtn->setToolTip(tr("Stop retrieving rows"));
 
   connect(_data->_newBtn, SIGNAL(clicked()), _data->_newAct, SLOT(trigger()));
   connect(_data->_closeBtn, SIGNAL(clicked()), _data->_closeAct, SLOT(trigger()));
@@ -383,6 +492,7 @@ display::display(QWidget* parent, const char* name, Qt::WindowFlags flags)
   connect(_data->_printBtn, SIGNAL(clicked()), _data->_printAct, SLOT(trigger()));
   connect(_data->_previewBtn, SIGNAL(clicked()), _data->_previewAct, SLOT(trigger()));
   connect(_data->_queryBtn, SIGNAL(clicked()), _data->_queryAct, SLOT(trigger()));
+  connect(_data->_cancelBtn, SIGNAL(clicked()), _data->_cancelAct, SLOT(trigger()));
   // Connect these two simply so checkbox takes care of pref. memory.  Could separate out later.
   connect(_data->_autoupdate, SIGNAL(toggled(bool)), _data->_autoUpdateAct, SLOT(setChecked(bool)));
   connect(_data->_autoUpdateAct, SIGNAL(triggered(bool)), _data->_autoupdate, SLOT(setChecked(bool)));
@@ -393,6 +503,7 @@ display::display(QWidget* parent, const char* name, Qt::WindowFlags flags)
   connect(_data->_newAct, SIGNAL(triggered()), this, SLOT(sNew()));
   connect(_data->_closeAct, SIGNAL(triggered()), this, SLOT(close()));
   connect(_data->_queryAct, SIGNAL(triggered()), this, SLOT(sFillList()));
+  connect(_data->_cancelAct, SIGNAL(triggered()), _data, SLOT(sCancelFill()));
   connect(_data->_expandAct, SIGNAL(triggered()), this, SLOT(sExpand()));
   connect(_data->_collapseAct, SIGNAL(triggered()), this, SLOT(sCollapse()));
   connect(_data->_printAct, SIGNAL(triggered()), this, SLOT(sPrint()));
@@ -443,6 +554,11 @@ XTreeWidget * display::list()
   return _data->_list;
 }
 
+XTreeWidgetView * display::virtualList()
+{
+  return _data->_vlist;
+}
+
 ParameterWidget * display::parameterWidget()
 {
   return _data->_parameterWidget;
@@ -709,19 +825,79 @@ bool display::autoUpdateEnabled() const
   return _data->_autoUpdateEnabled;
 }
 
+/* Automatic updates normally re-run the query on every GUIClient::tick().
+   Given a space-separated list of database notifications, they run only
+   after one of those notifications arrives instead. Either way an update
+   patches the list in place, keeping the selection and scroll position.
+   If the MetaSQL uses the modifiedSince parameter, it is set to the time
+   of the previous fill and the query should return only the rows changed
+   since then; such updates never remove rows. The query reports that time
+   itself by returning CURRENT_TIMESTAMP in a column named xtfilltime.
+ */
+void display::setAutoUpdateNotifications(const QString &notices)
+{
+  _data->_autoUpdateNotices = notices.split(" ", QString::SkipEmptyParts);
+  sAutoUpdateToggled();
+}
+
+QString display::autoUpdateNotifications() const
+{
+  return _data->_autoUpdateNotices.join(" ");
+}
+
+/* Show query results in an XTreeWidgetView instead of the XTreeWidget.
+   Rows stay in the view's columnar buffer and are formatted as they are
+   painted, so very large results display quickly and use little memory.
+   list() keeps the column layout and holds only the current row, so
+   id(), altId(), currentItem() and sPopulateMenu() still work, but code
+   that walks every item in list() after sFillList() will not see them.
+ */
+void display::setVirtualListEnabled(bool on)
+{
+  if (on && ! _data->_vlist)
+  {
+    _data->_vlist = new XTreeWidgetView(_data->_list, this);
+    _data->_vlist->setObjectName("_vlist");
+    QGridLayout *grid = qobject_cast<QGridLayout*>(layout());
+    if (grid)
+      grid->addWidget(_data->_vlist, 2, 0, 1, 2);
+  }
+
+  if (_data->_virtualList != on)
+  {
+    _data->_list->clear();
+    if (_data->_vlist)
+      _data->_vlist->clear();
+  }
+
+  _data->_virtualList = on;
+  _data->_list->setVisible(! on);
+  if (_data->_vlist)
+    _data->_vlist->setVisible(on);
+}
+
+bool display::virtualListEnabled() const
+{
+  return _data->_virtualList;
+}
+
 void display::sNew()
 {
 }
 
 void display::sExpand()
 {
-    if (_data->_list)
+    if (_data->_virtualList)
+        _data->_vlist->expandAll();
+    else if (_data->_list)
         _data->_list->expandAll();
 }
 
 void display::sCollapse()
 {
-    if (_data->_list)
+    if (_data->_virtualList)
+        _data->_vlist->collapseAll();
+    else if (_data->_list)
         _data->_list->collapseAll();
 }
 
@@ -753,6 +929,7 @@ void display::sFillList()
 
 void display::sFillList(ParameterList pParams, bool forceSetParams)
 {
+  _data->sCancelFill();   // a new fill replaces one still streaming in
   emit fillListBefore();
   if (forceSetParams || !pParams.count())
   {
@@ -760,8 +937,22 @@ void display::sFillList(ParameterList pParams, bool forceSetParams)
       return;
   }
   int itemid = _data->_list->id();
-  MetaSQLQuery mql(omfgThis->_mqlhash->value(_data->metasqlGroup, _data->metasqlName));
-  XSqlQuery xq = mql.toQuery(pParams, QSqlDatabase(), false);
+  QString mqltext = omfgThis->_mqlhash->value(_data->metasqlGroup, _data->metasqlName);
+
+  XTreeWidget::PopulateStyle style = XTreeWidget::Replace;
+  if (_data->_refreshing && ! _data->_virtualList)
+    style = XTreeWidget::Merge;
+  if (mqltext.contains("modifiedSince"))
+  {
+    if (style == XTreeWidget::Merge && _data->_lastFill.isValid())
+    {
+      pParams.append("modifiedSince", _data->_lastFill);
+      style = XTreeWidget::Update;
+    }
+  }
+  _data->_fillTime = QDateTime();
+
+  XSqlQuery xq = omfgThis->_mqlhash->parse(mqltext)->toQuery(pParams, QSqlDatabase(), false);
 
   QString column;
   QVariant param;
@@ -802,15 +993,48 @@ void display::sFillList(ParameterList pParams, bool forceSetParams)
       xq.bindValue(QString(":%1").arg(column), param.toString());
   }
 
+  /* lists that populate in the background anyway can get their rows
+     from a background connection as well, so the window stays usable
+     while the server works. lists that have to be complete when
+     sFillList() returns, and the virtual list, still run the query here.
+   */
+  if (! _data->_virtualList && ! _data->_list->populateLinear())
+  {
+    if (! _data->_fill)
+    {
+      _data->_fill = new BackgroundQuery(_data);
+      connect(_data->_fill, SIGNAL(rowsReady()),    _data, SLOT(sFillRows()));
+      connect(_data->_fill, SIGNAL(finished(bool)), _data, SLOT(sFillFinished(bool)));
+    }
+    _data->_fillId      = itemid;
+    _data->_fillStarted = false;
+    _data->_fillStyle   = style;
+    if (! _data->_fill->exec(xq))
+    {
+      ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Information"),
+                           tr("Could not start the query."), __FILE__, __LINE__);
+      return;
+    }
+    _data->_cancelAct->setVisible(true);
+    return;     // displayPrivate::sFillFinished() emits fillListAfter()
+  }
+
   xq.exec();
+  if (xq.first())
+    _data->noteFillTime(QList<QSqlRecord>() << xq.record());
 
-  _data->_list->populate(xq, itemid, _data->_useAltId);
+  if (_data->_virtualList)
+    _data->_vlist->populate(xq, itemid, _data->_useAltId);
+  else
+    _data->_list->populate(xq, itemid, _data->_useAltId, style);
   if (xq.lastError().type() != QSqlError::NoError)
   {
     ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Information"),
                            xq, __FILE__, __LINE__);
     return;
   }
+  if (_data->_fillTime.isValid())
+    _data->_lastFill = _data->_fillTime;
   emit fillListAfter();
 }
 
@@ -825,10 +1049,29 @@ void display::sPopulateHeaderMenu(QMenu *, QTreeWidgetItem *, int)
 void display::sAutoUpdateToggled()
 {
   bool update = _data->_autoUpdateEnabled && _data->_autoupdate->isChecked();
-  if (update)
-    connect(omfgThis, SIGNAL(tick()), this, SLOT(sFillList()));
-  else
-    disconnect(omfgThis, SIGNAL(tick()), this, SLOT(sFillList()));
+  QSqlDatabase db = QSqlDatabase::database();
+
+  disconnect(omfgThis, SIGNAL(tick()), _data, SLOT(sAutoUpdate()));
+  if (db.driver())
+    disconnect(db.driver(), SIGNAL(notification(const QString&)),
+               _data,       SLOT(sNotified(const QString&)));
+  _data->_autoUpdateTimer->stop();
+
+  if (! update)
+    return;
+
+  if (_data->_autoUpdateNotices.isEmpty())
+    connect(omfgThis, SIGNAL(tick()), _data, SLOT(sAutoUpdate()));
+  else if (db.driver())
+  {
+    foreach (QString notice, _data->_autoUpdateNotices)
+    {
+      if (! db.driver()->subscribedToNotifications().contains(notice))
+        db.driver()->subscribeToNotification(notice);
+    }
+    connect(db.driver(), SIGNAL(notification(const QString&)),
+            _data,       SLOT(sNotified(const QString&)));
+  }
 }
 
 ParameterList display::getParams()
@@ -15,6 +15,7 @@
 
 class QTreeWidgetItem;
 class XTreeWidget;
+class XTreeWidgetView;
 class displayPrivate;
 class ParameterWidget;
 
@@ -60,8 +61,14 @@ public:
 
     Q_INVOKABLE void setAutoUpdateEnabled(bool);
     Q_INVOKABLE bool autoUpdateEnabled() const;
+    Q_INVOKABLE void setAutoUpdateNotifications(const QString &);
+    Q_INVOKABLE QString autoUpdateNotifications() const;
+
+    Q_INVOKABLE void setVirtualListEnabled(bool);
+    Q_INVOKABLE bool virtualListEnabled() const;
 
     Q_INVOKABLE XTreeWidget * list();
+    Q_INVOKABLE XTreeWidgetView * virtualList();
     Q_INVOKABLE ParameterWidget * parameterWidget();
     Q_INVOKABLE QWidget * optionsWidget();
     Q_INVOKABLE QToolBar * toolBar();
@@ -13,11 +13,18 @@
 
 #include "ui_display.h"
 
+#include <QDateTime>
+#include <QSqlRecord>
+#include <QStringList>
+
 #include <parameter.h>
 
 #include "parameterlistsetup.h"
 
+class QTimer;
 class QToolButton;
+class BackgroundQuery;
+class XTreeWidgetView;
 class display;
 
 class displayPrivate : public QObject, public Ui::display
@@ -30,6 +37,7 @@ class displayPrivate : public QObject, public Ui::display
     bool setParams(ParameterList &params);
     void setupCharacteristics(QStringList uses);
     void print(ParameterList pParams, bool showPreview, bool forceSetParams);
+    void noteFillTime(const QList<QSqlRecord> &rows);
 
     QString reportName;
     QString metasqlName;
@@ -39,6 +47,20 @@ class displayPrivate : public QObject, public Ui::display
     bool _queryOnStartEnabled;
     bool _autoUpdateEnabled;
     bool _filterChanged;
+    bool _virtualList;
+
+    XTreeWidgetView *_vlist;
+
+    BackgroundQuery *_fill;
+    int              _fillId;
+    bool             _fillStarted;
+    XTreeWidget::PopulateStyle _fillStyle;
+
+    QStringList _autoUpdateNotices;
+    QTimer     *_autoUpdateTimer;
+    bool        _refreshing;  // sFillList() is an automatic update
+    QDateTime   _lastFill;    // server time the last good fill started
+    QDateTime   _fillTime;    // and the one still running
 
     QAction *_newAct;
     QAction *_closeAct;
@@ -54,6 +76,7 @@ class displayPrivate : public QObject, public Ui::display
     QAction *_sep3;
     QAction *_searchAct;
     QAction *_queryAct;
+    QAction *_cancelAct;
     QAction *_queryOnStartAct;
     QAction *_autoUpdateAct;
 
@@ -63,6 +86,7 @@ class displayPrivate : public QObject, public Ui::display
     QToolButton *_closeBtn;
     QToolButton *_moreBtn;
     QToolButton *_queryBtn;
+    QToolButton *_cancelBtn;
     QToolButton *_previewBtn;
     QToolButton *_printBtn;
     QToolButton *_expandBtn;
@@ -74,8 +98,15 @@ class displayPrivate : public QObject, public Ui::display
 
   public slots:
     void sFilterChanged();
+    void sAutoUpdate();
+    void sNotified(const QString &note);
+    void sCancelFill();
+    void sFillFinished(bool ok);
+    void sFillRows();
 
   private:
+    void finishFill();
+
     ::display *_parent;
 };
 
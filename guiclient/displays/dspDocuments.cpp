@@ -19,6 +19,7 @@
 #include <QUrl>
 
 #include "errorReporter.h"
+#include "xblobcache.h"
 #include "scriptablewidget.h"
 #include "parameterwidget.h"
 
@@ -136,7 +137,8 @@ void dspDocuments::sOpenDoc(QString mode)
   }
 
   XSqlQuery qfile;
-  qfile.prepare("SELECT url_id, url_source_id, url_source, url_title, url_url, url_stream"
+  qfile.prepare("SELECT url_id, url_source_id, url_source, url_title, url_url,"
+                "       md5(url_stream) AS checksum"
                 " FROM url"
                 " WHERE (url_id=:url_id);");
 
@@ -170,7 +172,8 @@ void dspDocuments::sOpenDoc(QString mode)
                             tr("Could Not Create File %1.").arg(tfile.fileName()) );
       return;
     }
-    tfile.write(qfile.value("url_stream").toByteArray());
+    tfile.write(XBlobCache::document(qfile.value("url_id").toInt(),
+                                     qfile.value("checksum").toString()));
     url.setUrl(tfile.fileName());
 #ifndef Q_OS_WIN
     url.setScheme("file");
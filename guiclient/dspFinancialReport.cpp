@@ -10,14 +10,20 @@
 
 #include "dspFinancialReport.h"
 
+#include <algorithm>
+
 #include <QAction>
+#include <QApplication>
 #include <QCloseEvent>
+#include <QEventLoop>
 #include <QInputDialog>
 #include <QList>
 #include <QMenu>
 #include <QMessageBox>
 #include "guiErrorCheck.h"
 #include <QSqlError>
+#include <QSqlField>
+#include <QSqlRecord>
 #include <QToolBar>
 #include <QToolButton>
 #include <QVariant>
@@ -32,12 +38,15 @@
 #include "financialReportNotes.h"
 #include "storedProcErrorLookup.h"
 #include "errorReporter.h"
+#include "backgroundquery.h"
 
 #define cFlRoot  0
 #define cFlItem  1
 #define cFlGroup 2
 #define cFlSpec  3
 
+#define TRENDCONNECTIONS 4   // run at most this many periods at once
+
 #define cBegining 0
 #define cEnding   1
 #define cDebits   2
@@ -45,6 +54,65 @@
 #define cBudget   4
 #define cDiff     5
 
+/* a value shown for every period of a trend report, the flgrp flag that
+   says whether a group shows it, and the _columnLabels entry naming it
+   (-1 for the report's custom label)
+ */
+struct TrendColumn
+{
+  TrendColumn(const char *pField, const char *pGroupFlag, bool pPercent, int pLabel)
+    : field(pField), groupFlag(pGroupFlag), percent(pPercent), label(pLabel)
+  {
+  }
+
+  const char *field;
+  const char *groupFlag;
+  bool        percent;
+  int         label;
+};
+
+/* every period's flrpt rows for a trend report, with the names and flgrp
+   settings the list needs
+ */
+static const char *trendSql =
+  "SELECT flrpt_period_id, flrpt_order, flrpt_level, flrpt_type, flrpt_type_id,"
+  "       flrpt_accnt_id,"
+  "       CASE flrpt_type WHEN 'G' THEN flgrp_name"
+  "<? if exists('shownumbers') ?>"
+  "                       WHEN 'I' THEN (formatGLAccount(accnt_id) || '-' || accnt_descrip)"
+  "<? else ?>"
+  "                       WHEN 'I' THEN accnt_descrip"
+  "<? endif ?>"
+  "                       WHEN 'S' THEN flspec_name"
+  "            ELSE CASE WHEN(flrpt_type='T' AND flrpt_level=0) THEN COALESCE(flrpt_altname, 'Total')"
+  "                      WHEN(flrpt_type='T') THEN COALESCE(flrpt_altname, 'Subtotal')"
+  "                      ELSE ('Type ' || flrpt_type || ' ' || text(flrpt_type_id))"
+  "                 END"
+  "       END AS name,"
+  "       flgrp_summarize,"
+  "       flgrp_showstart,  flgrp_showstartprcnt,  flgrp_showdelta,  flgrp_showdeltaprcnt,"
+  "       flgrp_showend,    flgrp_showendprcnt,    flgrp_showbudget, flgrp_showbudgetprcnt,"
+  "       flgrp_showdiff,   flgrp_showdiffprcnt,   flgrp_showcustom, flgrp_showcustomprcnt,"
+  "       flrpt_beginning,  flrpt_beginningprcnt,  flrpt_debits,     flrpt_debitsprcnt,"
+  "       flrpt_credits,    flrpt_creditsprcnt,    flrpt_ending,     flrpt_endingprcnt,"
+  "       flrpt_budget,     flrpt_budgetprcnt,     flrpt_diff,       flrpt_diffprcnt,"
+  "       flrpt_custom,     flrpt_customprcnt"
+  "  FROM flrpt"
+  "  LEFT OUTER JOIN flgrp  ON (flrpt_type='G' AND flgrp_id=flrpt_type_id)"
+  "  LEFT OUTER JOIN flitem ON (flrpt_type='I' AND flitem_id=flrpt_type_id)"
+  "  LEFT OUTER JOIN accnt  ON (flrpt_type='I' AND accnt_id=flrpt_accnt_id"
+  "                             AND accnt_id IN (SELECT accnt_id FROM flaccnt))"
+  "  LEFT OUTER JOIN flspec ON (flrpt_type='S' AND flspec_id=flrpt_type_id)"
+  " WHERE ((flrpt_flhead_id=<? value('flhead_id') ?>)"
+  "   AND (flrpt_period_id IN (<? literal('periodids') ?>))"
+  "   AND (flrpt_username=getEffectiveXtUser())"
+  "   AND (flrpt_interval=<? value('interval') ?>)"
+  "   AND CASE flrpt_type WHEN 'G' THEN flgrp_id IS NOT NULL"
+  "                       WHEN 'I' THEN flitem_id IS NOT NULL AND accnt_id IS NOT NULL"
+  "                       WHEN 'S' THEN flspec_id IS NOT NULL"
+  "                       ELSE true"
+  "       END);";
+
 dspFinancialReport::dspFinancialReport(QWidget* parent, const char*, Qt::WindowFlags fl)
   : display(parent, "dspFinancialReport", fl)
 {
@@ -566,298 +634,272 @@ void dspFinancialReport::sFillListTrend()
   list()->setColumnCount(0);
   list()->addColumn( tr("Group\n  Account Name"), -1, Qt::AlignLeft, true, "name");
 
-  dspFillListTrend.prepare("SELECT financialReport(:flhead_id, :period_id, :interval, :prjid) AS result;");
+  QList<TrendColumn> columns;
+  if (_typeCode == "A")
+  {
+    if(_showBegBal->isChecked())
+      columns << TrendColumn("flrpt_beginning",      "flgrp_showstart",       false, cBegining);
+    if(_showBegBalPrcnt->isChecked())
+      columns << TrendColumn("flrpt_beginningprcnt", "flgrp_showstartprcnt",  true,  cBegining);
+    if(_showDebits->isChecked())
+      columns << TrendColumn("flrpt_debits",         "flgrp_showdelta",       false, cDebits);
+    if(_showDebitsPrcnt->isChecked())
+      columns << TrendColumn("flrpt_debitsprcnt",    "flgrp_showdeltaprcnt",  true,  cDebits);
+    if(_showCredits->isChecked())
+      columns << TrendColumn("flrpt_credits",        "flgrp_showdelta",       false, cCredits);
+    if(_showCreditsPrcnt->isChecked())
+      columns << TrendColumn("flrpt_creditsprcnt",   "flgrp_showdeltaprcnt",  true,  cCredits);
+  }
+  if ((_showEndBal->isChecked()) ||
+      (_actuals->isChecked() && _typeCode == "B"))
+    columns << TrendColumn("flrpt_ending",           "flgrp_showend",         false, cEnding);
+  if(_showEndBalPrcnt->isChecked() && _typeCode=="A")
+    columns << TrendColumn("flrpt_endingprcnt",      "flgrp_showendprcnt",    true,  cEnding);
+  if(_showBudget->isChecked() || _budgets->isChecked())
+    columns << TrendColumn("flrpt_budget",           "flgrp_showbudget",      false, cBudget);
+  if(_showBudgetPrcnt->isChecked() && _typeCode=="A")
+    columns << TrendColumn("flrpt_budgetprcnt",      "flgrp_showbudgetprcnt", true,  cBudget);
+  if ((_showDiff->isChecked()) ||
+      (_actuals->isChecked() &&
+       ((_typeCode == "I") || (_typeCode == "C"))))
+    columns << TrendColumn("flrpt_diff",             "flgrp_showdiff",        false, cDiff);
+  if (_typeCode=="A")
+  {
+    if(_showDiffPrcnt->isChecked())
+      columns << TrendColumn("flrpt_diffprcnt",      "flgrp_showdiffprcnt",   true,  cDiff);
+    if(_showCustom->isChecked())
+      columns << TrendColumn("flrpt_custom",         "flgrp_showcustom",      false, -1);
+    if(_showCustomPrcnt->isChecked())
+      columns << TrendColumn("flrpt_customprcnt",    "flgrp_showcustomprcnt", true,  -1);
+  }
+
+  // the rows the list gets: one per flrpt_order, with every period's values
+  QSqlRecord rowTemplate;
+  rowTemplate.append(QSqlField("accnt_id",     QVariant::Int));
+  rowTemplate.append(QSqlField("orderby",      QVariant::Int));
+  rowTemplate.append(QSqlField("xtindentrole", QVariant::Int));
+  rowTemplate.append(QSqlField("type",         QVariant::Int));
+  rowTemplate.append(QSqlField("id",           QVariant::Int));
+  rowTemplate.append(QSqlField("name",         QVariant::String));
 
-  QString q1c = QString("SELECT -1, r0.flrpt_order AS orderby, r0.flrpt_level AS xtindentrole,"
-                        "       :group AS type, flgrp_id AS id,"
-                        "       flgrp_name AS name");
-  QString q1f = QString(" FROM flgrp");
-  QString q1w = QString(" WHERE ((true)");
+  bool hasZeroTest = false;
+  for(c = 0; c < periodsRef.count(); c++)
+  {
+    for (int i = 0; i < columns.size(); i++)
+    {
+      const TrendColumn &col = columns.at(i);
+      QString label = col.label < 0 ? customlabel : _columnLabels.value(col.label);
+      QString name  = QString("r%1%2").arg(c).arg(col.field);
+      if (col.percent)
+        list()->addColumn(tr("%1\n%2 %").arg(periods.at(c)).arg(label),
+                          _ynColumn, Qt::AlignRight, true, name);
+      else
+        list()->addColumn(tr("%1\n%2").arg(periods.at(c)).arg(label),
+                          _bigMoneyColumn, Qt::AlignRight, true, name);
+      rowTemplate.append(QSqlField(name, QVariant::Double));
+      rowTemplate.append(QSqlField(name + "_xtnumericrole", QVariant::String));
+      hasZeroTest = hasZeroTest || ! col.percent;
+    }
+  }
 
-  QString q2c = QString("SELECT r0.flrpt_accnt_id, r0.flrpt_order AS orderby, r0.flrpt_level AS xtindentrole,"
-                        "       :item AS type, flitem_id AS id,");
-  if (_shownumbers->isChecked())
-    q2c += " (formatGLAccount(accnt_id) || '-' || accnt_descrip) AS name ";
-  else
-    q2c += " accnt_descrip AS name ";
+  //Grand Total for Trend Reports
+  bool budgsum = false;
+  bool diffsum = false;
+  if ((_trend->isChecked()) && ((_typeCode == "I") || (_typeCode == "C")))
+  {
+    if (_budgets->isChecked())
+    {
+      list()->addColumn( tr("Budget\nTotal"), _bigMoneyColumn, Qt::AlignRight, true, "budgsum");
+      rowTemplate.append(QSqlField("budgsum", QVariant::Double));
+      rowTemplate.append(QSqlField("budgsum_xtnumericrole", QVariant::String));
+      budgsum = true;
+    }
+    if (_actuals->isChecked())
+    {
+      list()->addColumn( tr("Grand\nTotal"), _bigMoneyColumn, Qt::AlignRight, true, "diffsum");
+      rowTemplate.append(QSqlField("diffsum", QVariant::Double));
+      rowTemplate.append(QSqlField("diffsum_xtnumericrole", QVariant::String));
+      diffsum = true;
+    }
+  }
 
-  QString q2f = QString(" FROM flitem, accnt ");
-  QString q2w = QString(" WHERE ((true) AND accnt_id IN (SELECT accnt_id FROM flaccnt WHERE flitem_id=flitem_id) ");
+  if (! runFinancialReports(periodsRef, interval))
+    return;
 
-  QString q3c = QString("SELECT -1, r0.flrpt_order AS orderby, r0.flrpt_level AS xtindentrole,"
-                        "       :spec AS type, flspec_id AS id,"
-                        "       flspec_name AS name");
-  QString q3f = QString(" FROM flspec");
-  QString q3w = QString(" WHERE ((true)");
+  // fetch every period's rows at once and line them up here
+  ParameterList flparams;
+  flparams.append("flhead_id", _flhead->id());
+  flparams.append("interval",  interval);
+  flparams.append("periodids", periodList.join(","));
+  if (_shownumbers->isChecked())
+    flparams.append("shownumbers");
+  MetaSQLQuery flmql(trendSql);
+  XSqlQuery flrpt = flmql.toQuery(flparams);
+  if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Financial Information"),
+                           flrpt, __FILE__, __LINE__))
+    return;
 
-  QString q4c = QString("SELECT -1, r0.flrpt_order AS orderby, r0.flrpt_level AS xtindentrole,"
-                        "       -1 AS type, r0.flrpt_type_id AS id,"
-                        "       CASE WHEN(r0.flrpt_type='T' AND r0.flrpt_level=0) THEN COALESCE(r0.flrpt_altname, 'Total')"
-                        "            WHEN(r0.flrpt_type='T') THEN COALESCE(r0.flrpt_altname, 'Subtotal')"
-                        "            ELSE ('Type ' || r0.flrpt_type || ' ' || text(r0.flrpt_type_id))"
-                        "       END AS name");
-  QString q4f = QString(" FROM");
-  QString q4w = QString(" WHERE ((true)");
+  QHash<int, int> periodIndex;
+  for (c = 0; c < periodsRef.count(); c++)
+    periodIndex.insert(periodsRef.at(c), c);
 
-  QStringList qbList;
-  QStringList qtList;
-  QStringList qzList;
+  QVector<QHash<int, QSqlRecord> > byPeriod(periodsRef.count());
+  while (flrpt.next())
+    byPeriod[periodIndex.value(flrpt.value("flrpt_period_id").toInt())]
+      .insert(flrpt.value("flrpt_order").toInt(), flrpt.record());
 
-  QString colname;
-  QString sharedColumns;
+  QList<int> orders = byPeriod.at(0).keys();
+  std::sort(orders.begin(), orders.end());
 
-  for(c = 0; c < periodsRef.count(); c++)
+  QList<QSqlRecord> rows;
+  foreach (int order, orders)
   {
-    sharedColumns = QString();
-    if (_typeCode == "A")
-    {
-      if(_showBegBal->isChecked())
-      {
-        colname = "flrpt_beginning";
-        list()->addColumn(tr("%1\n%2").arg(periods.at(c)).arg(_columnLabels.value(cBegining)),
-                          _bigMoneyColumn, Qt::AlignRight, true, QString("r%1%2").arg(c).arg(colname));
-        q1c += QString(",CASE WHEN(flgrp_summarize AND flgrp_showstart) THEN r%1.%2 ELSE NULL END AS r%3%4, 'curr' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-        sharedColumns += QString(",r%1.%2 AS r%3%4, 'curr' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-        qzList << QString("(r%1.%2 <> 0)").arg(c).arg(colname);
-      }
-      if(_showBegBalPrcnt->isChecked())
-      {
-        colname = "flrpt_beginningprcnt";
-        list()->addColumn(tr("%1\n%2 %").arg(periods.at(c)).arg(_columnLabels.value(cBegining)),
-                          _ynColumn, Qt::AlignRight, true, QString("r%1%2").arg(c).arg(colname));
-        q1c += QString(",CASE WHEN(flgrp_summarize AND flgrp_showstartprcnt) THEN r%1.%2 ELSE NULL END AS r%3%4, 'percent' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-        sharedColumns += QString(",r%1.%2, 'percent' AS r%3%4_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname);
-      }
-      if(_showDebits->isChecked())
-      {
-        colname = "flrpt_debits";
-        list()->addColumn(tr("%1\n%2").arg(periods.at(c)).arg(_columnLabels.value(cDebits)),
-                          _bigMoneyColumn, Qt::AlignRight, true, QString("r%1%2").arg(c).arg(colname));
-        q1c += QString(",CASE WHEN(flgrp_summarize AND flgrp_showdelta) THEN r%1.%2 ELSE NULL END AS r%3%4, 'curr' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-        sharedColumns += QString(",r%1.%2 AS r%3%4, 'curr' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-        qzList << QString("(r%1.%2 <> 0)").arg(c).arg(colname);
-      }
-      if(_showDebitsPrcnt->isChecked())
-      {
-        colname = "flrpt_debitsprcnt";
-        list()->addColumn( tr("%1\n%2 %").arg(periods.at(c)).arg(_columnLabels.value(cDebits)),
-                           _ynColumn, Qt::AlignRight, true, QString("r%1%2").arg(c).arg(colname));
-        q1c += QString(",CASE WHEN(flgrp_summarize AND flgrp_showdeltaprcnt) THEN r%1.%2 ELSE NULL END AS r%3%4, 'percent' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-        sharedColumns += QString(",r%1.%2, 'percent' AS r%3%4_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname);
-      }
-      if(_showCredits->isChecked())
-      {
-        colname = "flrpt_credits";
-        list()->addColumn(tr("%1\n%2").arg(periods.at(c)).arg(_columnLabels.value(cCredits)),
-                          _bigMoneyColumn, Qt::AlignRight, true, QString("r%1%2").arg(c).arg(colname));
-        q1c += QString(",CASE WHEN(flgrp_summarize AND flgrp_showdelta) THEN r%1.%2 ELSE NULL END AS r%3%4, 'curr' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-        sharedColumns += QString(",r%1.%2 AS r%3%4, 'curr' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-        qzList << QString("(r%1.%2 <> 0)").arg(c).arg(colname);
-      }
-      if(_showCreditsPrcnt->isChecked())
-      {
-        colname = "flrpt_creditsprcnt";
-        list()->addColumn(tr("%1\n%2 %").arg(periods.at(c)).arg(_columnLabels.value(cCredits)),
-                          _ynColumn, Qt::AlignRight, true, QString("r%1%2").arg(c).arg(colname));
-        q1c += QString(",CASE WHEN(flgrp_summarize AND flgrp_showdeltaprcnt) THEN r%1.%2 ELSE NULL END AS r%3%4, 'percent' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-        sharedColumns += QString(",r%1.%2, 'percent' AS r%3%4_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname);
-      }
-    }
-    if ((_showEndBal->isChecked()) ||
-        (_actuals->isChecked() && _typeCode == "B"))
+    const QSqlRecord &first = byPeriod.at(0)[order];
+    QString type = first.value("flrpt_type").toString();
+
+    // like the joins this replaces, skip lines missing from some period
+    bool complete = true;
+    for (c = 1; c < byPeriod.size() && complete; c++)
     {
-      colname = "flrpt_ending";
-      list()->addColumn( tr("%1\n%2").arg(periods.at(c)).arg(_columnLabels.value(cEnding)),
-                         _bigMoneyColumn, Qt::AlignRight, true, QString("r%1%2").arg(c).arg(colname));
-      q1c += QString(",CASE WHEN(flgrp_summarize AND flgrp_showend) THEN r%1.%2 ELSE NULL END AS r%3%4, 'curr' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-      sharedColumns += QString(",r%1.%2 AS r%3%4, 'curr' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-      qzList << QString("(r%1.%2 <> 0)").arg(c).arg(colname);
+      QHash<int, QSqlRecord>::const_iterator r = byPeriod.at(c).constFind(order);
+      complete = (r != byPeriod.at(c).constEnd() &&
+                  r.value().value("flrpt_type")    == first.value("flrpt_type") &&
+                  r.value().value("flrpt_type_id") == first.value("flrpt_type_id"));
     }
-    if(_showEndBalPrcnt->isChecked() && _typeCode=="A")
+    if (! complete)
+      continue;
+
+    bool group     = (type == "G");
+    bool summarize = group && first.value("flgrp_summarize").toBool();
+
+    QSqlRecord row = rowTemplate;
+    row.setValue("accnt_id",     type == "I" ? first.value("flrpt_accnt_id") : QVariant(-1));
+    row.setValue("orderby",      order);
+    row.setValue("xtindentrole", first.value("flrpt_level"));
+    row.setValue("type",         type == "G" ? cFlGroup : type == "I" ? cFlItem
+                                 : type == "S" ? cFlSpec : -1);
+    row.setValue("id",           first.value("flrpt_type_id"));
+    row.setValue("name",         first.value("name"));
+
+    bool   nonzero  = false;
+    bool   budgnull = false;
+    bool   diffnull = false;
+    double budgtotal = 0;
+    double difftotal = 0;
+    int    field = 6;
+    for (c = 0; c < byPeriod.size(); c++)
     {
-      colname = "flrpt_endingprcnt";
-      list()->addColumn(tr("%1\n%2 %").arg(periods.at(c)).arg(_columnLabels.value(cEnding)),
-                        _ynColumn, Qt::AlignRight, true, QString("r%1%2").arg(c).arg(colname));
-      q1c += QString(",CASE WHEN(flgrp_summarize AND flgrp_showendprcnt) THEN r%1.%2 ELSE NULL END AS r%3%4, 'percent' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-      sharedColumns += QString(",r%1.%2, 'percent' AS r%3%4_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname);
+      const QSqlRecord &period = byPeriod.at(c)[order];
+      for (int i = 0; i < columns.size(); i++, field += 2)
+      {
+        const TrendColumn &col = columns.at(i);
+        QVariant value = period.value(col.field);
+
+        if (! col.percent && ! value.isNull() && value.toDouble() != 0)
+          nonzero = true;
+        if (qstrcmp(col.field, "flrpt_budget") == 0)
+        {
+          budgnull  = budgnull || value.isNull();
+          budgtotal += value.toDouble();
+        }
+        else if (qstrcmp(col.field, "flrpt_diff") == 0)
+        {
+          diffnull  = diffnull || value.isNull();
+          difftotal += value.toDouble();
+        }
+
+        if (value.isNull() || (group && ! (summarize && first.value(col.groupFlag).toBool())))
+          row.setNull(field);
+        else
+          row.setValue(field, value.toDouble());
+        row.setValue(field + 1, col.percent ? "percent" : "curr");
+      }
     }
-    if(_showBudget->isChecked() || _budgets->isChecked())
+
+    if (budgsum)
     {
-      colname = "flrpt_budget";
-      list()->addColumn(tr("%1\n%2").arg(periods.at(c)).arg(_columnLabels.value(cBudget)),
-                        _bigMoneyColumn, Qt::AlignRight, true, QString("r%1%2").arg(c).arg(colname));
-      q1c += QString(",CASE WHEN(flgrp_summarize AND flgrp_showbudget) THEN r%1.%2 ELSE NULL END AS r%3%4, 'curr' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-      sharedColumns += QString(",r%1.%2 AS r%3%4, 'curr' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-      qbList << QString("r%1.%2").arg(c).arg(colname);
-      qzList << QString("(r%1.%2 <> 0)").arg(c).arg(colname);
+      if (budgnull || (group && ! (summarize && first.value("flgrp_showbudget").toBool())))
+        row.setNull("budgsum");
+      else
+        row.setValue("budgsum", budgtotal);
+      row.setValue("budgsum_xtnumericrole", "curr");
     }
-    if(_showBudgetPrcnt->isChecked() && _typeCode=="A")
+    if (diffsum)
     {
-      colname = "flrpt_budgetprcnt";
-      list()->addColumn( tr("%1\n%2 %").arg(periods.at(c)).arg(_columnLabels.value(cBudget)),
-                         _ynColumn, Qt::AlignRight, true, QString("r%1%2").arg(c).arg(colname));
-      q1c += QString(",CASE WHEN(flgrp_summarize AND flgrp_showbudgetprcnt) THEN r%1.%2 ELSE NULL END AS r%3%4, 'percent' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-      sharedColumns += QString(",r%1.%2, 'percent' AS r%3%4_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname);
+      if (diffnull || (group && ! (summarize && first.value("flgrp_showdiff").toBool())))
+        row.setNull("diffsum");
+      else
+        row.setValue("diffsum", difftotal);
+      row.setValue("diffsum_xtnumericrole", "curr");
     }
-    if ((_showDiff->isChecked()) ||
-        (_actuals->isChecked() &&
-         ((_typeCode == "I") || (_typeCode == "C"))))
-    {
-      colname = "flrpt_diff";
-      list()->addColumn(tr("%1\n%2").arg(periods.at(c)).arg(_columnLabels.value(cDiff)),
-                        _bigMoneyColumn, Qt::AlignRight, true, QString("r%1%2").arg(c).arg(colname));
-      q1c += QString(",CASE WHEN(flgrp_summarize AND flgrp_showdiff) THEN r%1.%2 ELSE NULL END AS r%3%4, 'curr' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-      sharedColumns += QString(",r%1.%2 AS r%3%4, 'curr' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
 
-      qtList << QString("r%1.%2").arg(c).arg(colname);
+    if (! _showzeros->isChecked() && hasZeroTest && ! nonzero &&
+        (type == "I" || type == "S"))
+      continue;
 
-      qzList << QString("(r%1.%2 <> 0)").arg(c).arg(colname);
-    }
-    if (_typeCode=="A")
+    rows.append(row);
+  }
+
+  list()->populate(rows, list()->id(), true);
+  list()->expandAll();
+}
+
+/* run financialReport() for each period a few at a time, each on its own
+   background connection, rather than one after another
+ */
+bool dspFinancialReport::runFinancialReports(const QList<int> &periodIds, const QString &interval)
+{
+  while (_trendPool.size() < qMin(periodIds.size(), TRENDCONNECTIONS))
+    _trendPool.append(new BackgroundQuery(this));
+
+  QEventLoop loop;
+  foreach (BackgroundQuery *query, _trendPool)
+    connect(query, SIGNAL(finished(bool)), &loop, SLOT(quit()));
+
+  QVector<bool> busy(_trendPool.size(), false);
+  int           next    = 0;
+  int           running = 0;
+  QSqlError     error;
+
+  QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+  while (error.type() == QSqlError::NoError && (next < periodIds.size() || running > 0))
+  {
+    for (int i = 0; i < _trendPool.size(); i++)
     {
-      if(_showDiffPrcnt->isChecked())
+      BackgroundQuery *query = _trendPool.at(i);
+      if (busy.at(i) && ! query->isActive())
       {
-        colname = "flrpt_diffprcnt";
-        list()->addColumn(tr("%1\n%2 %").arg(periods.at(c)).arg(_columnLabels.value(cDiff)),
-                          _ynColumn, Qt::AlignRight, true, QString("r%1%2").arg(c).arg(colname));
-        q1c += QString(",CASE WHEN(flgrp_summarize AND flgrp_showdiffprcnt) THEN r%1.%2 ELSE NULL END AS r%3%4, 'percent' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-        sharedColumns += QString(",%1, 'percent' AS %2_xtnumericrole").arg(colname).arg(colname);
+        busy[i] = false;
+        running--;
+        if (query->lastError().type() != QSqlError::NoError)
+          error = query->lastError();
       }
-      if(_showCustom->isChecked())
-      {
-        colname = "flrpt_custom";
-        list()->addColumn(tr("%1\n%2").arg(periods.at(c)).arg(customlabel),
-                          _bigMoneyColumn, Qt::AlignRight, true, QString("r%1%2").arg(c).arg(colname));
-        q1c += QString(",CASE WHEN(flgrp_summarize AND flgrp_showcustom) THEN r%1.%2 ELSE NULL END AS r%3%4, 'curr' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-        sharedColumns += QString(",r%1.%2 AS r%3%4, 'curr' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-        qzList << QString("(r%1.%2 <> 0)").arg(c).arg(colname);
-      }
-      if(_showCustomPrcnt->isChecked())
+
+      if (! busy.at(i) && next < periodIds.size() && error.type() == QSqlError::NoError)
       {
-        colname = "flrpt_customprcnt";
-        list()->addColumn(tr("%1\n%2 %").arg(periods.at(c)).arg(customlabel),
-                          _ynColumn, Qt::AlignRight, true, QString("r%1%2").arg(c).arg(colname));
-        q1c += QString(",CASE WHEN(flgrp_summarize AND flgrp_showcustomprcnt) THEN r%1.%2 ELSE NULL END AS r%3%4, 'percent' AS r%5%6_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname).arg(c).arg(colname);
-        sharedColumns += QString(",r%1.%2, 'percent' AS r%3%4_xtnumericrole").arg(c).arg(colname).arg(c).arg(colname);
+        QVariantMap bindings;
+        bindings.insert(":flhead_id", _flhead->id());
+        bindings.insert(":period_id", periodIds.at(next));
+        bindings.insert(":interval",  interval);
+        bindings.insert(":prjid",     _prjid);
+        query->exec("SELECT financialReport(:flhead_id, :period_id, :interval, :prjid) AS result;",
+                    bindings);
+        busy[i] = true;
+        running++;
+        next++;
       }
     }
-    q2c += sharedColumns;
-    q3c += sharedColumns;
-    q4c += sharedColumns;
-
-    q1f += QString(", flrpt AS r%1").arg(c);
-
-    q1w += QString(" AND (r%1.flrpt_type='G')").arg(c);
-    q1w += QString(" AND (r%1.flrpt_type_id=flgrp_id)").arg(c);
-    q1w += QString(" AND (r%1.flrpt_flhead_id=:flhead_id)").arg(c);
-    q1w += QString(" AND (r%1.flrpt_period_id=%2)").arg(c).arg(periodsRef.at(c));
-    q1w += QString(" AND (r%1.flrpt_username=getEffectiveXtUser())").arg(c);
-    q1w += QString(" AND (r%1.flrpt_interval='%2')").arg(c).arg(interval);
-    if(c > 0)
-      q1w += QString(" AND (r0.flrpt_order=r%1.flrpt_order)").arg(c);
-
-
-    q2f += QString(", flrpt AS r%1").arg(c);
-
-    q2w += QString(" AND (r%1.flrpt_type='I')").arg(c);
-    q2w += QString(" AND (r%1.flrpt_type_id=flitem_id)").arg(c);
-    q2w += QString(" AND (r%1.flrpt_flhead_id=:flhead_id)").arg(c);
-    q2w += QString(" AND (r%1.flrpt_period_id=%2)").arg(c).arg(periodsRef.at(c));
-    q2w += QString(" AND (r%1.flrpt_username=getEffectiveXtUser())").arg(c);
-    q2w += QString(" AND (r%1.flrpt_accnt_id=accnt_id)").arg(c);
-    q2w += QString(" AND (r%1.flrpt_interval='%2')").arg(c).arg(interval);
-    if(c > 0)
-      q2w += QString(" AND (r0.flrpt_order=r%1.flrpt_order)").arg(c);
-
-
-    q3f += QString(", flrpt AS r%1").arg(c);
-
-    q3w += QString(" AND (r%1.flrpt_type='S')").arg(c);
-    q3w += QString(" AND (r%1.flrpt_type_id=flspec_id)").arg(c);
-    q3w += QString(" AND (r%1.flrpt_flhead_id=:flhead_id)").arg(c);
-    q3w += QString(" AND (r%1.flrpt_period_id=%2)").arg(c).arg(periodsRef.at(c));
-    q3w += QString(" AND (r%1.flrpt_username=getEffectiveXtUser())").arg(c);
-    q3w += QString(" AND (r%1.flrpt_interval='%2')").arg(c).arg(interval);
-    if(c > 0)
-      q3w += QString(" AND (r0.flrpt_order=r%1.flrpt_order)").arg(c);
-
-    if(c > 0)
-      q4f += QString(", flrpt AS r%1").arg(c);
-    else
-      q4f += QString(" flrpt AS r%1").arg(c);
-
-    q4w += QString(" AND (NOT (r%1.flrpt_type IN ('G','I','S')))").arg(c);
-    q4w += QString(" AND (r%1.flrpt_flhead_id=:flhead_id)").arg(c);
-    q4w += QString(" AND (r%1.flrpt_period_id=%2)").arg(c).arg(periodsRef.at(c));
-    q4w += QString(" AND (r%1.flrpt_username=getEffectiveXtUser())").arg(c);
-    q4w += QString(" AND (r%1.flrpt_interval='%2')").arg(c).arg(interval);
-    if(c > 0)
-      q4w += QString(" AND (r0.flrpt_order=r%1.flrpt_order)").arg(c);
-
-    dspFillListTrend.bindValue(":flhead_id", _flhead->id());
-    dspFillListTrend.bindValue(":period_id", periodsRef.at(c));
-    dspFillListTrend.bindValue(":interval", interval);
-    dspFillListTrend.bindValue(":prjid", _prjid);
-    dspFillListTrend.exec();
-  }
 
-  //Grand Total for Trend Reports
-  if ((_trend->isChecked()) && ((_typeCode == "I") || (_typeCode == "C")))
-  {
-    if (_budgets->isChecked())
-    {
-      list()->addColumn( tr("Budget\nTotal"), _bigMoneyColumn, Qt::AlignRight, true, "budgsum");
-      q1c += ",CASE WHEN(flgrp_summarize AND flgrp_showbudget) THEN (" +
-             qbList.join(" + ") +
-             ") ELSE NULL END AS budgsum, 'curr' AS budgsum_xtnumericrole";
-      q2c += ", " + qbList.join(" + ") + " AS budgsum, 'curr' AS budgsum_xtnumericrole";
-      q3c += ", " + qbList.join(" + ") + " AS budgsum, 'curr' AS budgsum_xtnumericrole";
-      q4c += ", " + qbList.join(" + ") + " AS budgsum, 'curr' AS budgsum_xtnumericrole";
-    }
-    if (_actuals->isChecked())
-    {
-      list()->addColumn( tr("Grand\nTotal"), _bigMoneyColumn, Qt::AlignRight, true, "diffsum");
-      q1c += ",CASE WHEN(flgrp_summarize AND flgrp_showdiff) THEN (" +
-             qtList.join(" + ") +
-             ") ELSE NULL END AS diffsum, 'curr' AS diffsum_xtnumericrole";
-      q2c += ", " + qtList.join(" + ") + " AS diffsum, 'curr' AS diffsum_xtnumericrole";
-      q3c += ", " + qtList.join(" + ") + " AS diffsum, 'curr' AS diffsum_xtnumericrole";
-      q4c += ", " + qtList.join(" + ") + " AS diffsum, 'curr' AS diffsum_xtnumericrole";
-    }
+    if (running > 0 && error.type() == QSqlError::NoError)
+      loop.exec(QEventLoop::ExcludeUserInputEvents);
   }
 
-  if (!_showzeros->isChecked())
-  {
-    q2w += " AND (" + qzList.join(" OR ") + ")";
-    q3w += " AND (" + qzList.join(" OR ") + ")";
-  }
+  foreach (BackgroundQuery *query, _trendPool)
+    query->cancel();
+  QApplication::restoreOverrideCursor();
 
-  q1w += ")";
-  q2w += ")";
-  q3w += ")";
-  q4w += ")";
-
-  QString query = q1c + q1f + q1w +
-                  QString(" UNION ") +
-                  q2c + q2f + q2w +
-                  QString(" UNION ") +
-                  q3c + q3f + q3w +
-                  QString(" UNION ") +
-                  q4c + q4f + q4w +
-                  QString(" ORDER BY orderby;");
-  dspFillListTrend.prepare(query);
-  dspFillListTrend.bindValue(":flhead_id", _flhead->id());
-  dspFillListTrend.bindValue(":item", cFlItem);
-  dspFillListTrend.bindValue(":group", cFlGroup);
-  dspFillListTrend.bindValue(":spec", cFlSpec);
-  dspFillListTrend.exec();
-  list()->populate(dspFillListTrend, true);
-  if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Financial Information"),
-                                dspFillListTrend, __FILE__, __LINE__))
-  {
-    return;
-  }
-  list()->expandAll();
+  return ! ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Financial Information"),
+                                error, __FILE__, __LINE__);
 }
 
 void dspFinancialReport::sFillPeriods()
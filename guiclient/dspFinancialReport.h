@@ -11,6 +11,7 @@
 #ifndef DSPFINANCIALREPORT_H
 #define DSPFINANCIALREPORT_H
 
+class BackgroundQuery;
 class GroupBalances;
 
 #include "display.h"
@@ -62,6 +63,7 @@ protected slots:
 
 protected:
     virtual bool forwardUpdate();
+    virtual bool runFinancialReports(const QList<int> &, const QString &);
     Q_INVOKABLE ParameterList getParams();
     
 private:
@@ -71,6 +73,7 @@ private:
     QMap<int, QPair<QDate, QDate> > _columnDates;
     QAction *_notesAct;
     QString _typeCode;
+    QList<BackgroundQuery*> _trendPool;
 };
 
 #endif // DSPFINANCIALREPORT_H
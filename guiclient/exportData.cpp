@@ -12,6 +12,7 @@
 
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QProgressDialog>
 #include <QSqlError>
 
 #include <metasql.h>
@@ -159,10 +160,16 @@ void exportData::sExport()
   QString errmsg;
 
   ParameterList params = _paramedit->getParameterList();
+  QProgressDialog progress(tr("Exporting to %1").arg(filename), tr("Cancel"),
+                           0, 0, this);
+  progress.setWindowModality(Qt::WindowModal);
+  progress.setMinimumDuration(1000);
   bool success = ExportHelper::exportXML(_qrySetList->id(), params,
                                          filename,          errmsg,
                                          (_otherXML->isChecked() ?
-                                                    _exportList->id() : -1));
+                                                    _exportList->id() : -1),
+                                         &progress);
+  progress.reset();
   if (success)
     QMessageBox::information(this, tr("Processing Complete"),
                              tr("The export to %1 is complete").arg(filename));
@@ -33,7 +33,9 @@
 #include <QScriptValue>
 #include <QBuffer>
 #include <QDesktopServices>
+#include <QPointer>
 #include <QScriptEngineDebugger>
+#include <QtConcurrentRun>
 
 #include <parameter.h>
 #include <dbtools.h>
@@ -52,6 +54,7 @@
 #include "storedProcErrorLookup.h"
 #include "metasql.h"
 #include "mqlhash.h"
+#include "sessionBootstrap.h"
 
 #include "systemMessage.h"
 #include "menuProducts.h"
@@ -69,6 +72,7 @@
 #include "idleShutdown.h"
 #include "inputManager.h"
 #include "xdoublevalidator.h"
+#include "xtextedit.h"
 
 #include "distributeInventory.h"
 #include "documents.h"
@@ -152,6 +156,71 @@ static SaveSizePositionEventFilter * __saveSizePositionEventFilter = 0;
 static int __interval = 0;
 static int __intervalCount = 0;
 
+/** @brief The Actions to re-evaluate when the user's privileges change. */
+static QList<QPointer<QAction> > __actions;
+
+/** @brief The module menus, in menu bar order.
+
+    GUIClient::initMenuBar builds the modules whose menu or toolbar the
+    user has chosen to see. The rest are left as placeholders in the menu
+    bar until something asks for one of their actions.
+  */
+enum { ProductsModule, InventoryModule, ScheduleModule, PurchaseModule,
+       ManufactureModule, CRMModule, SalesModule, AccountingModule, ModuleCount };
+
+static const struct {
+  const char *menu;
+  const char *toolbar;
+  const char *menuPref;
+  const char *toolbarPref;
+  const char *message;
+  const char *actions;  // prefixes of the action names the module defines
+} __modules[] = {
+  { "menu.prod",  "Products Tools",    "ShowPDMenu",  "ShowPDToolbar",  QT_TRANSLATE_NOOP("GUIClient", "Initializing the Products Module"),    "pd"       },
+  { "menu.im",    "Inventory Tools",   "ShowIMMenu",  "ShowIMToolbar",  QT_TRANSLATE_NOOP("GUIClient", "Initializing the Inventory Module"),   "im sr"    },
+  { "menu.sched", "Schedule Tools",    "ShowMSMenu",  "ShowMSToolbar",  QT_TRANSLATE_NOOP("GUIClient", "Initializing the Scheduling Module"),  "ms"       },
+  { "menu.purch", "Purchase Tools",    "ShowPOMenu",  "ShowPOToolbar",  QT_TRANSLATE_NOOP("GUIClient", "Initializing the Purchase Module"),    "po wo"    },
+  { "menu.manu",  "Manufacture Tools", "ShowWOMenu",  "ShowWOToolbar",  QT_TRANSLATE_NOOP("GUIClient", "Initializing the Manufacture Module"), "wo"       },
+  { "menu.crm",   "CRM Tools",         "ShowCRMMenu", "ShowCRMToolbar", QT_TRANSLATE_NOOP("GUIClient", "Initializing the CRM Module"),         "crm pm"   },
+  { "menu.sales", "Sales Tools",       "ShowSOMenu",  "ShowSOToolbar",  QT_TRANSLATE_NOOP("GUIClient", "Initializing the Sales Module"),       "so sa"    },
+  { "menu.accnt", "Accounting Tools",  "ShowGLMenu",  "ShowGLToolbar",  QT_TRANSLATE_NOOP("GUIClient", "Initializing the Accounting Module"),  "gl ar ap so" }
+};
+
+/** @brief The hot key preference for each action name that has one. */
+static QHash<QString, QString> __hotkeys;
+static bool                    __hotkeysLoaded = false;
+
+static void __loadHotkeys()
+{
+  QStringList keys;
+  for (int i = 0; i <= 9; i++)
+    keys << QString("C%1").arg(i);
+  for (int i = 1; i <= 12; i++)
+    keys << QString("F%1").arg(i);
+  keys.sort();  // if two keys name the same action, Parameters::parent() found the first
+
+  __hotkeys.clear();
+  foreach (QString key, keys)
+  {
+    QString action = _preferences->value(key);
+    if (!action.isEmpty() && !__hotkeys.contains(action))
+      __hotkeys.insert(action, key);
+  }
+  __hotkeysLoaded = true;
+}
+
+/** @brief Return the hot key preference naming the given action, if any.
+
+    This is what @c _preferences->parent() would return for a hot key but
+    doesn't search every preference for each of the hundreds of Actions.
+  */
+static QString __hotkeyFor(const QString &pName)
+{
+  if (!__hotkeysLoaded)
+    __loadHotkeys();
+  return __hotkeys.value(pName);
+}
+
 /** @brief Check if the current user has privileges to use the given Action.
     @sa    Action
   */
@@ -260,9 +329,8 @@ void Action::init(QWidget *pParent, const char *pName, const QString &pDisplayNa
   Q_UNUSED(pDisplayName);
   setObjectName(pName);
 
-  QString hotkey;
-  hotkey = _preferences->parent(pName);
-  if (!hotkey.isNull() && !_hotkeyList.contains(hotkey))
+  QString hotkey = __hotkeyFor(pName);
+  if (!hotkey.isEmpty() && !_hotkeyList.contains(hotkey))
   {
     _hotkeyList << hotkey;
     setShortcutContext(Qt::ApplicationShortcut);
@@ -279,7 +347,8 @@ void Action::init(QWidget *pParent, const char *pName, const QString &pDisplayNa
   if(!pEnabled.isEmpty())
     setData(pEnabled);
   __menuEvaluate(this);
-  if (QRegExp(".*\\.setup").exactMatch(pName))
+  __actions.append(this);
+  if (QString(pName).endsWith(".setup"))
   {
     setMenuRole(QAction::NoRole);
   }
@@ -317,6 +386,7 @@ GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
     _shuttingDown(false),
     _spellCodec(0),
     _spellChecker(0),
+    _spellLoader(0),
     _menu(0)
 {
   XSqlQuery qry;
@@ -329,8 +399,13 @@ GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
   _showTopLevel = (_preferences->value("InterfaceWindowOption") != "Workspace");
   _mqlhash = new MqlHash(this);
 
-  qry.exec("SELECT startOfTime() AS sot, endOfTime() AS eot;");
-  if (qry.first())
+  SessionBootstrap *bootstrap = SessionBootstrap::instance();
+  if (bootstrap && bootstrap->isValid())
+  {
+    _startOfTime = QDate::fromString(bootstrap->value("session", "startoftime"), Qt::ISODate);
+    _endOfTime   = QDate::fromString(bootstrap->value("session", "endoftime"),   Qt::ISODate);
+  }
+  else if (qry.exec("SELECT startOfTime() AS sot, endOfTime() AS eot;") && qry.first())
   {
     _startOfTime = qry.value("sot").toDate();
     _endOfTime   = qry.value("eot").toDate();
@@ -412,7 +487,7 @@ GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
   _timeoutHandler->setIdleMinutes(_preferences->value("IdleTimeout").toInt());
   _reportHandler = 0;
 
-  connect(_privileges, SIGNAL(loaded()), this, SLOT(initMenuBar()));
+  connect(_privileges, SIGNAL(loaded()), this, SLOT(sPrivilegesLoaded()));
 
   ScriptableWidget::_guiClientInterface = new xTupleGuiClientInterface(this);
   ScriptableWidget::_guiClientInterface->setMqlHash(_mqlhash);
@@ -497,15 +572,20 @@ GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
   }
 
   //  Populate the menu bar
-  XSqlQuery window;
-  window.prepare("SELECT usr_window "
-                 "  FROM usr "
-                 " WHERE (usr_username=getEffectiveXtUser());");
-  window.exec();
   // keep synchronized with user.ui.h
   _singleWindow = "";
-  if (window.first())
-    _singleWindow = window.value("usr_window").toString();
+  if (bootstrap && bootstrap->isValid())
+    _singleWindow = bootstrap->value("user", "usr_window");
+  else
+  {
+    XSqlQuery window;
+    window.prepare("SELECT usr_window "
+                   "  FROM usr "
+                   " WHERE (usr_username=getEffectiveXtUser());");
+    window.exec();
+    if (window.first())
+      _singleWindow = window.value("usr_window").toString();
+  }
   if (_singleWindow.isEmpty())
     initMenuBar();
   else
@@ -604,6 +684,8 @@ void GUIClient::initMenuBar()
 
   qApp->setOverrideCursor(Qt::WaitCursor);
 
+  __loadHotkeys();
+
   if(!firstRun)
   {
     QList<QMenu*> menulist = findChildren<QMenu*>();
@@ -613,89 +695,161 @@ void GUIClient::initMenuBar()
       for(int i = 0; i < actionlist.size(); ++i)
         __menuEvaluate(actionlist.at(i));
     }
+
+    // the user may have just turned on a module that hasn't been built
+    for (int module = 0; module < ModuleCount; module++)
+      if (_preferences->boolean(__modules[module].menuPref) ||
+          _preferences->boolean(__modules[module].toolbarPref))
+        buildModuleMenu(module);
   }
   else
   {
     menuBar()->clear();
     _hotkeyList.clear();
+    _deferredModules.clear();
 
     QList<QToolBar *> toolbars = this->findChildren<QToolBar *>();
     while(!toolbars.isEmpty())
       delete toolbars.takeFirst();
 
-    _splash->showMessage(tr("Initializing the Products Module"), SplashTextAlignment, SplashTextColor);
-    qApp->processEvents();
-    productsMenu = new menuProducts(this);
+    for (int module = 0; module < ModuleCount; module++)
+    {
+      if (module == ScheduleModule && _metrics->value("Application") == "PostBooks")
+        continue;
 
-    _splash->showMessage(tr("Initializing the Inventory Module"), SplashTextAlignment, SplashTextColor);
+      QAction *placeholder = menuBar()->addAction(QString());
+      placeholder->setVisible(false);
+      _deferredModules.insert(module, placeholder);
+    }
+
+    for (int module = 0; module < ModuleCount; module++)
+      if (_preferences->boolean(__modules[module].menuPref) ||
+          _preferences->boolean(__modules[module].toolbarPref))
+        buildModuleMenu(module);
+
+    windowMenu = new menuWindow(this);
+
+    _splash->showMessage(tr("Initializing the System Module"), SplashTextAlignment, SplashTextColor);
     qApp->processEvents();
-    inventoryMenu = new menuInventory(this);
+    systemMenu = new menuSystem(this);
 
-    if(_metrics->value("Application") != "PostBooks")
+    /* hot keys work even if their menu is hidden, so build the modules
+       that could define the actions they name. a name no module uses,
+       like a stale one or a script's, doesn't build anything.
+     */
+    foreach (QString action, __hotkeys.keys())
     {
-      _splash->showMessage(tr("Initializing the Scheduling Module"), SplashTextAlignment, SplashTextColor);
-      qApp->processEvents();
-      scheduleMenu = new menuSchedule(this);
+      QString prefix = action.section('.', 0, 0);
+      for (int module = 0; module < ModuleCount; module++)
+      {
+        if (_deferredModules.contains(module) &&
+            QString(__modules[module].actions).split(' ').contains(prefix) &&
+            !findChild<QAction*>(action))
+          buildModuleMenu(module);
+      }
     }
+  }
 
-    _splash->showMessage(tr("Initializing the Purchase Module"), SplashTextAlignment, SplashTextColor);
-    qApp->processEvents();
-    purchaseMenu = new menuPurchase(this);
+  // Restore toolbar positions from local machine
+  restoreState(xtsettingsValue("MainWindowState", QByteArray()).toByteArray(), 1);
 
-    _splash->showMessage(tr("Initializing the Manufacture Module"), SplashTextAlignment, SplashTextColor);
-    qApp->processEvents();
-    manufactureMenu = new menuManufacture(this);
+  // Set visibility of menus and toolbars based on preferences stored in the database
+  for (int module = 0; module < ModuleCount; module++)
+    setModuleVisibility(module);
 
-    _splash->showMessage(tr("Initializing the CRM Module"), SplashTextAlignment, SplashTextColor);
-    qApp->processEvents();
-    crmMenu = new menuCRM(this);
+  firstRun = false;
+  qApp->restoreOverrideCursor();
+}
 
-    _splash->showMessage(tr("Initializing the Sales Module"), SplashTextAlignment, SplashTextColor);
-    qApp->processEvents();
-    salesMenu = new menuSales(this);
+/** @brief Build every module menu that initMenuBar left for later.
 
-    _splash->showMessage(tr("Initializing the Accounting Module"), SplashTextAlignment, SplashTextColor);
-    qApp->processEvents();
-    accountingMenu = new menuAccounting(this);
+    Call this before looking for a menu or action by name if it might
+    belong to a module the user has hidden.
+  */
+void GUIClient::buildModuleMenus()
+{
+  for (int module = 0; module < ModuleCount; module++)
+    buildModuleMenu(module);
+}
 
-    windowMenu = new menuWindow(this);
+/** @brief Add a module's menu to the menu bar, in its usual place even if
+           the modules before it haven't been built yet.
+  */
+QAction *GUIClient::addModuleMenu(QMenu *menu)
+{
+  for (int module = 0; module < ModuleCount; module++)
+  {
+    QAction *placeholder = _deferredModules.value(module);
+    if (placeholder && menu->objectName() == __modules[module].menu)
+      return menuBar()->insertMenu(placeholder, menu);
+  }
+  return menuBar()->addMenu(menu);
+}
 
-    _splash->showMessage(tr("Initializing the System Module"), SplashTextAlignment, SplashTextColor);
-    qApp->processEvents();
-    systemMenu = new menuSystem(this);
+void GUIClient::buildModuleMenu(int module)
+{
+  if (!_deferredModules.contains(module))
+    return;
 
+  if (!_shown)
+  {
+    _splash->showMessage(tr(__modules[module].message), SplashTextAlignment, SplashTextColor);
+    qApp->processEvents();
   }
 
-  findChild<QMenu*>("menu.prod")->menuAction()->setVisible(_preferences->boolean("ShowPDMenu"));
-  findChild<QMenu*>("menu.im")->menuAction()->setVisible(_preferences->boolean("ShowIMMenu"));
-  if(_metrics->value("Application") != "PostBooks")
+  switch (module)
   {
-    findChild<QMenu*>("menu.sched")->menuAction()->setVisible(_preferences->boolean("ShowMSMenu"));
+    case ProductsModule:    productsMenu    = new menuProducts(this);    break;
+    case InventoryModule:   inventoryMenu   = new menuInventory(this);   break;
+    case ScheduleModule:    scheduleMenu    = new menuSchedule(this);    break;
+    case PurchaseModule:    purchaseMenu    = new menuPurchase(this);    break;
+    case ManufactureModule: manufactureMenu = new menuManufacture(this); break;
+    case CRMModule:         crmMenu         = new menuCRM(this);         break;
+    case SalesModule:       salesMenu       = new menuSales(this);       break;
+    case AccountingModule:  accountingMenu  = new menuAccounting(this);  break;
   }
-  findChild<QMenu*>("menu.purch")->menuAction()->setVisible(_preferences->boolean("ShowPOMenu"));
-  findChild<QMenu*>("menu.manu")->menuAction()->setVisible(_preferences->boolean("ShowWOMenu"));
-  findChild<QMenu*>("menu.crm")->menuAction()->setVisible(_preferences->boolean("ShowCRMMenu"));
-  findChild<QMenu*>("menu.sales")->menuAction()->setVisible(_preferences->boolean("ShowSOMenu"));
-  findChild<QMenu*>("menu.accnt")->menuAction()->setVisible(_preferences->boolean("ShowGLMenu"));
 
-  // Restore toolbar positions from local machine
-  restoreState(xtsettingsValue("MainWindowState", QByteArray()).toByteArray(), 1);
+  delete _deferredModules.take(module);
+  setModuleVisibility(module);
+}
+
+void GUIClient::setModuleVisibility(int module)
+{
+  QMenu *menu = findChild<QMenu*>(__modules[module].menu);
+  if (menu)
+    menu->menuAction()->setVisible(_preferences->boolean(__modules[module].menuPref));
 
-  // Set visibility of toolbars based on preferences stored in the database
-  findChild<QToolBar*>("Products Tools")->setVisible(_preferences->boolean("ShowPDToolbar"));
-  findChild<QToolBar*>("Inventory Tools")->setVisible(_preferences->boolean("ShowIMToolbar"));
-  if(_metrics->value("Application") != "PostBooks")
+  QToolBar *toolbar = findChild<QToolBar*>(__modules[module].toolbar);
+  if (toolbar)
+    toolbar->setVisible(_preferences->boolean(__modules[module].toolbarPref));
+}
+
+/** @brief Enable and disable every Action to match the user's privileges
+           after they have been reloaded. The menus themselves don't change.
+
+    Plain QActions in the menus, such as ones a script created with its
+    privileges in data(), aren't registered, so they're found the old way.
+  */
+void GUIClient::sPrivilegesLoaded()
+{
+  for (int i = __actions.size() - 1; i >= 0; i--)
   {
-    findChild<QToolBar*>("Schedule Tools")->setVisible(_preferences->boolean("ShowMSToolbar"));
+    if (__actions.at(i).isNull())
+      __actions.removeAt(i);
+    else
+      __menuEvaluate(__actions.at(i));
   }
-  findChild<QToolBar*>("Purchase Tools")->setVisible(_preferences->boolean("ShowPOToolbar"));
-  findChild<QToolBar*>("Manufacture Tools")->setVisible(_preferences->boolean("ShowWOToolbar"));
-  findChild<QToolBar*>("CRM Tools")->setVisible(_preferences->boolean("ShowCRMToolbar"));
-  findChild<QToolBar*>("Sales Tools")->setVisible(_preferences->boolean("ShowSOToolbar"));
-  findChild<QToolBar*>("Accounting Tools")->setVisible(_preferences->boolean("ShowGLToolbar"));
 
-  firstRun = false;
-  qApp->restoreOverrideCursor();
+  QList<QMenu*> menulist = findChildren<QMenu*>();
+  for (int m = 0; m < menulist.size(); ++m)
+  {
+    QList<QAction*> actionlist = menulist.at(m)->actions();
+    for (int i = 0; i < actionlist.size(); ++i)
+    {
+      if (! dynamic_cast<Action*>(actionlist.at(i)))
+        __menuEvaluate(actionlist.at(i));
+    }
+  }
 }
 
 /** @brief Save the position and visibility of application toolbars in
@@ -705,16 +859,14 @@ void GUIClient::saveToolbarPositions()
 {
   xtsettingsSetValue("MainWindowState", saveState(1));
 
-  // Set preferences base on visibility of toolbars
-  _preferences->set("ShowPDToolbar", findChild<QToolBar*>("Products Tools")->isVisible());
-  _preferences->set("ShowIMToolbar", findChild<QToolBar*>("Inventory Tools")->isVisible());
-  if(_metrics->value("Application") != "PostBooks")
-    _preferences->set("ShowMSToolbar", findChild<QToolBar*>("Schedule Tools")->isVisible());
-  _preferences->set("ShowPOToolbar", findChild<QToolBar*>("Purchase Tools")->isVisible());
-  _preferences->set("ShowWOToolbar", findChild<QToolBar*>("Manufacture Tools")->isVisible());
-  _preferences->set("ShowCRMToolbar", findChild<QToolBar*>("CRM Tools")->isVisible());
-  _preferences->set("ShowSOToolbar", findChild<QToolBar*>("Sales Tools")->isVisible());
-  _preferences->set("ShowGLToolbar", findChild<QToolBar*>("Accounting Tools")->isVisible());
+  // Set preferences base on visibility of toolbars. Modules that were never
+  // built keep the preference they had.
+  for (int module = 0; module < ModuleCount; module++)
+  {
+    QToolBar *toolbar = findChild<QToolBar*>(__modules[module].toolbar);
+    if (toolbar)
+      _preferences->set(__modules[module].toolbarPref, toolbar->isVisible());
+  }
 }
 
 /** @brief Save information about the current state of the application
@@ -798,6 +950,8 @@ void GUIClient::showEvent(QShowEvent *event)
       bool found_one = false;
       while(sq.next())
       {
+        if (!found_one)
+          buildModuleMenus();   // scripts expect to find every menu
         found_one = true;
         QString script = sq.value("script_source").toString();
         if(!engine)
@@ -830,9 +984,8 @@ void GUIClient::showEvent(QShowEvent *event)
             QAction* act = actionlist.at(i);
             if(!act->objectName().isEmpty())
             {
-              QString hotkey;
-              hotkey = _preferences->parent(act->objectName());
-              if (!hotkey.isNull() && !_hotkeyList.contains(hotkey))
+              QString hotkey = __hotkeyFor(act->objectName());
+              if (!hotkey.isEmpty() && !_hotkeyList.contains(hotkey))
               {
                 _hotkeyList << hotkey;
                 act->setShortcutContext(Qt::ApplicationShortcut);
@@ -2254,6 +2407,10 @@ void GUIClient::loadScriptGlobals(QScriptEngine * engine)
   if(!engine)
     return;
 
+  // pooled engines arrive with the globals already loaded
+  if (engine->globalObject().property("mainwindow").toQObject() == this)
+    return;
+
 #if QT_VERSION >= 0x040500
   engine->installTranslatorFunctions();
 #endif
@@ -2328,7 +2485,6 @@ void GUIClient::loadScriptGlobals(QScriptEngine * engine)
   mainwindowval.setProperty("cTransScraps", QScriptValue(engine, cTransScraps), ro);
   mainwindowval.setProperty("cNoReportDefinition", QScriptValue(engine, cNoReportDefinition), ro);
 
-  setupScriptApi(engine);
   setupWidgetsScriptApi(engine, ScriptableWidget::_guiClientInterface); // what's a better way?
   setupSetupApi(engine);
   setupGuiErrorCheck(engine);
@@ -2397,16 +2553,28 @@ void GUIClient::handleDocument(QString path)
   addDocumentWatch(path, id);
 }
 
+/** @brief Build the spell checker. This runs on a worker thread.
+ */
+static Hunspell *__loadSpellChecker(QByteArray pAff, QByteArray pDic, QByteArray pUserDic)
+{
+  Hunspell *checker = new Hunspell(pAff.constData(), pDic.constData());
+  if (! pUserDic.isEmpty())
+    checker->add_dic(pUserDic.constData());
+  return checker;
+}
+
 /** @brief Initialize the spell-checking system.
 
     Load the dictionary for the user's current language and
-    the user's personal additions.
+    the user's personal additions. Parsing the dictionary takes a while
+    so it happens on a worker thread; hunspell_ready() is false until
+    it's done.
  */
 void GUIClient::hunspell_initialize()
 {
   // TODO: handle user changing languages
   QString appPath, fullPathWithoutExt;
-  if (! _spellChecker)
+  if (! _spellChecker && ! _spellLoader)
   {
     QStringList filename;
     filename << QLocale::languageToString(QLocale().language()) // eg English
@@ -2446,24 +2614,53 @@ void GUIClient::hunspell_initialize()
                              .arg(filename.join("</li><li> "), dirname.join("</li><li>")));
     } else {
       if (DEBUG) qDebug() << "loading" << appPath;
-      _spellChecker = new Hunspell(fullPathWithoutExt.toLatin1() + ".aff",
-                                   fullPathWithoutExt.toLatin1() + ".dic");
-
-      QString spell_encoding = QString(_spellChecker->get_dic_encoding());
-      _spellCodec = QTextCodec::codecForName(spell_encoding.toLocal8Bit());
-
       QFile file(QDir::homePath() + "/xTuple/user.dic");
-      if (file.exists())
-      {
-        if (DEBUG) qDebug() << "loading" << file.fileName();
-        _spellChecker->add_dic(file.fileName().toLatin1());
-      }
+
+      _spellLoader = new QFutureWatcher<Hunspell*>(this);
+      connect(_spellLoader, SIGNAL(finished()), this, SLOT(sSpellCheckerLoaded()));
+      _spellLoader->setFuture(QtConcurrent::run(__loadSpellChecker,
+                                                fullPathWithoutExt.toLatin1() + ".aff",
+                                                fullPathWithoutExt.toLatin1() + ".dic",
+                                                file.exists() ? file.fileName().toLatin1()
+                                                              : QByteArray()));
     }
   }
 }
 
+void GUIClient::sSpellCheckerLoaded()
+{
+  if (! _spellLoader)
+    return;
+
+  _spellChecker = _spellLoader->result();
+  _spellLoader->deleteLater();
+  _spellLoader = 0;
+
+  QString spell_encoding = QString(_spellChecker->get_dic_encoding());
+  _spellCodec = QTextCodec::codecForName(spell_encoding.toLocal8Bit());
+  if (DEBUG) qDebug() << "spelling dictionary loaded" << spell_encoding;
+
+  // words added while the dictionary was loading
+  foreach (QString word, _spellAddWords)
+    _spellChecker->add(_spellCodec->fromUnicode(word).data());
+
+  // editors opened during the load haven't been checked yet
+  foreach (QWidget *widget, QApplication::allWidgets())
+  {
+    XTextEdit *edit = qobject_cast<XTextEdit *>(widget);
+    if (edit)
+      edit->recheckSpelling();
+  }
+}
+
 void GUIClient::hunspell_uninitialize()
 {
+    if (_spellLoader)   // don't leave the worker thread parsing on its own
+    {
+      _spellLoader->waitForFinished();
+      sSpellCheckerLoaded();
+    }
+
     QString homePath = QDir::homePath().toLatin1();
     QFile file(homePath + tr("/xTuple/user.dic"));
 
@@ -2516,8 +2713,14 @@ bool GUIClient::hunspell_ready()
   return (_spellChecker != 0);
 }
 
+/* until the dictionary has loaded every word is spelled correctly
+   and has no suggestions
+ */
 int GUIClient::hunspell_check(const QString word)
 {
+  if (! _spellChecker)
+    return 1;
+
   QByteArray encodedString = _spellCodec->fromUnicode(word);
   return _spellChecker->spell(encodedString.data());
 }
@@ -2526,6 +2729,9 @@ const QStringList GUIClient::hunspell_suggest(const QString word)
 {
     char **wlst;
     QStringList wordList;
+    if (! _spellChecker)
+      return wordList;
+
     QByteArray encodedString = _spellCodec->fromUnicode(word);
     if(_spellChecker->spell(encodedString.data()) < 1)
     {
@@ -2542,6 +2748,13 @@ const QStringList GUIClient::hunspell_suggest(const QString word)
 
 int GUIClient::hunspell_add(const QString word)
 {
+    if (! _spellChecker)    // sSpellCheckerLoaded() adds it
+    {
+      if (!_spellAddWords.contains(word))
+        _spellAddWords.append(word);
+      return 0;
+    }
+
     QByteArray encodedString = _spellCodec->fromUnicode(word);
     //check if word has been added before
     if(!_spellAddWords.contains(encodedString.data()))
@@ -2551,6 +2764,9 @@ int GUIClient::hunspell_add(const QString word)
 
 int GUIClient::hunspell_ignore(const QString word)
 {
+    if (! _spellChecker)
+      return 0;
+
     QByteArray encodedString = _spellCodec->fromUnicode(word);
     return _spellChecker->add(encodedString.data());
 }
@@ -13,6 +13,8 @@
 
 #include <QAction>
 #include <QDate>
+#include <QFutureWatcher>
+#include <QHash>
 #include <QMainWindow>
 #include <QTimer>
 
@@ -214,6 +216,8 @@ class GUIClient : public QMainWindow
     Q_INVOKABLE bool showTopLevel() const { return _showTopLevel; }
     Q_INVOKABLE QWidgetList windowList();
     Q_INVOKABLE void populateCustomMenu(QMenu*, const QString &);
+    Q_INVOKABLE void buildModuleMenus();
+    QAction *addModuleMenu(QMenu *);
 
     Q_INVOKABLE void handleNewWindow(QWidget *, Qt::WindowModality = Qt::NonModal, bool forceFloat = false);
     Q_INVOKABLE QMenuBar *menuBar();
@@ -405,8 +409,13 @@ class GUIClient : public QMainWindow
   private slots:
     void handleDocument(QString path);
     void hunspell_uninitialize();
+    void sSpellCheckerLoaded();
+    void sPrivilegesLoaded();
 
   private:
+    void buildModuleMenu(int);
+    void setModuleVisibility(int);
+
     QMdiArea   *_workspace;
     QTimer       _tick;
     QPushButton  *_eventButton;
@@ -430,6 +439,7 @@ class GUIClient : public QMainWindow
     menuAccounting  *accountingMenu;
     menuWindow      *windowMenu;
     menuSystem      *systemMenu;
+    QHash<int, QAction*> _deferredModules; // module -> its place in the menu bar
 
     QDate _startOfTime;
     QDate _endOfTime;
@@ -461,6 +471,7 @@ class GUIClient : public QMainWindow
     QMap<QString, int>  _fileMap;
     QTextCodec *_spellCodec;
     Hunspell   *_spellChecker;
+    QFutureWatcher<Hunspell*> *_spellLoader;
     QStringList _spellAddWords;
 
     QMenu *_menu;
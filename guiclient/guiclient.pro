@@ -3,7 +3,7 @@ include( ../global.pri )
 TARGET   = xtuple
 CONFIG   += qt warn_on
 
-QT += xml sql script scripttools network
+QT += concurrent xml sql script scripttools network
 QT += webkit xmlpatterns printsupport webkitwidgets
 
 isEqual(QT_MAJOR_VERSION, 5) {
@@ -1141,6 +1141,7 @@ HEADERS = ../common/format.h                    \
           selectPayments.h                      \
           selectShippedOrders.h                 \
           selectedPayments.h                    \
+          sessionBootstrap.h                    \
           setup.h                               \
           shipOrder.h                           \
           shipTo.h                              \
@@ -1761,6 +1762,7 @@ SOURCES = absoluteCalendarItem.cpp              \
           selectPayments.cpp                    \
           selectShippedOrders.cpp               \
           selectedPayments.cpp                  \
+          sessionBootstrap.cpp                  \
           setup.cpp                             \
           shipOrder.cpp                         \
           shipTo.cpp                            \
@@ -72,6 +72,7 @@ hotkey::hotkey(QWidget* parent, const char* name, bool modal, Qt::WindowFlags fl
 
   QStringList addedactions;
   XTreeWidgetItem *last = 0;
+  omfgThis->buildModuleMenus();   // so hidden modules' actions are listed too
   QList<QMenu*> menulist = omfgThis->findChildren<QMenu*>();
   for(int m = 0; m < menulist.size(); ++m)
   {
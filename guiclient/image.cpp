@@ -19,6 +19,8 @@
 #include <QScrollArea>
 #include <quuencode.h>
 
+#include "xblobcache.h"
+
 image::image(QWidget* parent, const char* name, bool modal, Qt::WindowFlags fl)
     : XDialog(parent, name, modal, fl)
 {
@@ -102,7 +104,7 @@ enum SetResponse image::set(const ParameterList &pParams)
 void image::populate()
 {
   XSqlQuery image;
-  image.prepare( "SELECT image_name, image_descrip, image_data "
+  image.prepare( "SELECT image_name, image_descrip, md5(image_data) AS checksum "
                  "FROM image "
                  "WHERE (image_id=:image_id);" );
   image.bindValue(":image_id", _imageid);
@@ -112,7 +114,7 @@ void image::populate()
     _name->setText(image.value("image_name").toString());
     _descrip->setText(image.value("image_descrip").toString());
 
-    __image.loadFromData(QUUDecode(image.value("image_data").toString()));
+    __image.loadFromData(XBlobCache::image(_imageid, image.value("checksum").toString()));
     _image->setPixmap(QPixmap::fromImage(__image));
   }
 }
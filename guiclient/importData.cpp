@@ -13,6 +13,7 @@
 #include <QDirIterator>
 #include <QInputDialog>
 #include <QMessageBox>
+#include <QProgressDialog>
 #include <QVariant>
 
 #include "configureIE.h"
@@ -264,7 +265,13 @@ bool importData::importOne(const QString &pFileName, int pType)
   QString warnmsg;
   if (filetype == Xml || QFileInfo(pFileName).suffix().toUpper() == "XML")
   {
-    if (! ImportHelper::importXML(pFileName, errmsg, warnmsg))
+    QProgressDialog progress(tr("Importing %1").arg(pFileName), tr("Cancel"),
+                             0, 0, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(1000);
+    bool ok = ImportHelper::importXML(pFileName, errmsg, warnmsg, &progress);
+    progress.reset();
+    if (! ok)
     {
       ErrorReporter::error(QtCriticalMsg, this, tr("XML Import Error"),
                            tr("%1: %2 ").arg(windowTitle(),errmsg),__FILE__,__LINE__);
@@ -127,6 +127,7 @@
 #include "userPreferences.h"
 #include "xtNetworkRequestManager.h"
 
+#include "sessionBootstrap.h"
 #include "sysLocale.h"
 
 #include "splashconst.h"
@@ -270,20 +271,39 @@ int main(int argc, char *argv[])
       }
     }
   }
+  _splash->showMessage(QObject::tr("Loading Session Data"), SplashTextAlignment, SplashTextColor);
+  qApp->processEvents();
+  SessionBootstrap bootstrap(databaseURL, username, _ConnAppName);
+
 //{
   _splash->showMessage(QObject::tr("Loading Translations"), SplashTextAlignment, SplashTextColor);
   qApp->processEvents();
-  XSqlQuery langq("SELECT lang_abbr2,   lang_qt_number,"
-                  "       country_abbr, country_qt_number"
-                  "  FROM usr"
-                  "  JOIN locale  ON usr_locale_id     = locale_id"
-                  "  JOIN lang    ON locale_lang_id    = lang_id"
-                  "  LEFT OUTER JOIN country ON locale_country_id = country_id"
-                  " WHERE usr_username = getEffectiveXtUser();");
-  if (langq.first())
+  MetricMap langMap;
+  if (bootstrap.isValid())
+    langMap = bootstrap.section("lang");
+  else
   {
-    QString langAbbr    = langq.value("lang_abbr2").toString();
-    QString countryAbbr = langq.value("country_abbr").toString().toUpper();
+    XSqlQuery langq("SELECT lang_abbr2,   lang_qt_number,"
+                    "       country_abbr, country_qt_number"
+                    "  FROM usr"
+                    "  JOIN locale  ON usr_locale_id     = locale_id"
+                    "  JOIN lang    ON locale_lang_id    = lang_id"
+                    "  LEFT OUTER JOIN country ON locale_country_id = country_id"
+                    " WHERE usr_username = getEffectiveXtUser();");
+    if (langq.first())
+    {
+      langMap.insert("lang_abbr2",        langq.value("lang_abbr2").toString());
+      langMap.insert("lang_qt_number",    langq.value("lang_qt_number").toString());
+      langMap.insert("country_abbr",      langq.value("country_abbr").toString());
+      langMap.insert("country_qt_number", langq.value("country_qt_number").toString());
+    }
+    ErrorReporter::error(QtCriticalMsg, 0, QObject::tr("Error Getting Locale"),
+                         langq, __FILE__, __LINE__);
+  }
+  if (! langMap.isEmpty())
+  {
+    QString langAbbr    = langMap.value("lang_abbr2");
+    QString countryAbbr = langMap.value("country_abbr").toUpper();
 
     if (! langAbbr.isEmpty() && ! countryAbbr.isEmpty())
       lang.prepend(langAbbr + "_" + countryAbbr.toLower());
@@ -300,30 +320,37 @@ int main(int argc, char *argv[])
       QLocale::setDefault(QLocale(langAbbr + "_" + countryAbbr));
     else if (! langAbbr.isEmpty())
       QLocale::setDefault(QLocale(langAbbr));
-    else if (langq.value("lang_qt_number").toInt() &&
-             langq.value("country_qt_number").toInt())
+    else if (langMap.value("lang_qt_number").toInt() &&
+             langMap.value("country_qt_number").toInt())
       QLocale::setDefault(
-          QLocale(QLocale::Language(langq.value("lang_qt_number").toInt()),
-                  QLocale::Country(langq.value("country_qt_number").toInt())));
+          QLocale(QLocale::Language(langMap.value("lang_qt_number").toInt()),
+                  QLocale::Country(langMap.value("country_qt_number").toInt())));
     else
       QLocale::setDefault(sysl);
 
     qDebug() << "Locale set to language" << QLocale();
   }
-  ErrorReporter::error(QtCriticalMsg, 0, QObject::tr("Error Getting Locale"),
-                       langq, __FILE__, __LINE__);
 
   (void)lang.removeDuplicates();
 
   QList<QPair<QString, QString> > transfile;
   transfile << qMakePair(QString("xTuple"), QString()) << qMakePair(QString("openrpt"), QString()) << qMakePair(QString("reports"), QString());
-  XSqlQuery pkglist("SELECT pkghead_name, pkghead_version "
-                    "  FROM pkghead"
-                    " WHERE packageIsEnabled(pkghead_name);");
-  while (pkglist.next())
-    transfile << qMakePair(pkglist.value("pkghead_name").toString(), pkglist.value("pkghead_version").toString());
-  ErrorReporter::error(QtCriticalMsg, 0, QObject::tr("Error Getting Extension Names"),
-                       pkglist, __FILE__, __LINE__);
+  if (bootstrap.isValid())
+  {
+    MetricMap pkgs = bootstrap.section("pkg");
+    for (MetricMap::const_iterator pkg = pkgs.constBegin(); pkg != pkgs.constEnd(); ++pkg)
+      transfile << qMakePair(pkg.key(), pkg.value());
+  }
+  else
+  {
+    XSqlQuery pkglist("SELECT pkghead_name, pkghead_version "
+                      "  FROM pkghead"
+                      " WHERE packageIsEnabled(pkghead_name);");
+    while (pkglist.next())
+      transfile << qMakePair(pkglist.value("pkghead_name").toString(), pkglist.value("pkghead_version").toString());
+    ErrorReporter::error(QtCriticalMsg, 0, QObject::tr("Error Getting Extension Names"),
+                         pkglist, __FILE__, __LINE__);
+  }
 
   QTranslator *translator = new QTranslator(&app);
   QPair<QString, QString> f;
@@ -349,7 +376,10 @@ int main(int argc, char *argv[])
 
   _splash->showMessage(QObject::tr("Loading Database Metrics"), SplashTextAlignment, SplashTextColor);
   qApp->processEvents();
-  _metrics = new Metrics();
+  if (bootstrap.isValid())
+    _metrics = new Metrics(bootstrap.section("metric"));
+  else
+    _metrics = new Metrics();
 
   // TODO: we should compose the splash screen on the fly from parts
   QString edition("PostBooks");
@@ -359,18 +389,20 @@ int main(int argc, char *argv[])
   splashMap.insert("Manufacturing", ":/images/splashMfgEdition.png");
   splashMap.insert("PostBooks",     ":/images/splashPostBooks.png");
 
-  XSqlQuery q("SELECT getEdition() AS result;");
-  if (q.first())
-  {
-    edition = q.value("result").toString();
-  }
+  QString editionResult;
+  if (bootstrap.isValid())
+    editionResult = edition = bootstrap.value("session", "edition");
   else
   {
-    edition = _metrics->value("Application");
+    XSqlQuery q("SELECT getEdition() AS result;");
+    if (q.first())
+      editionResult = edition = q.value("result").toString();
+    else
+      edition = _metrics->value("Application");
   }
 
   qDebug() << edition;
-  _splash->setPixmap(QPixmap(splashMap[q.value("result").toString()]));
+  _splash->setPixmap(QPixmap(splashMap[editionResult]));
 
   _Name = _Name.arg(edition);
 
@@ -381,24 +413,33 @@ int main(int argc, char *argv[])
   int tot = 50000;
 
   XSqlQuery metric;
-  metric.prepare("SELECT numOfDatabaseUsers(:appName) AS xt_client_count,"
-                 "       numOfServerUsers() as total_client_count;");
-  metric.bindValue(":appName", _ConnAppName);
-  metric.exec();
-  if(metric.first())
+  bool xtweb = false;
+  if (bootstrap.isValid())
   {
-    cnt = metric.value("xt_client_count").toInt();
-    tot = metric.value("total_client_count").toInt();
+    cnt   = bootstrap.value("live", "xt_client_count").toInt();
+    tot   = bootstrap.value("live", "total_client_count").toInt();
+    xtweb = QVariant(bootstrap.value("live", "drupaluserinfo")).toBool();
   }
   else
   {
-    ErrorReporter::error(QtCriticalMsg, 0, QObject::tr("Error Counting Users"),
-                         metric, __FILE__, __LINE__);
+    metric.prepare("SELECT numOfDatabaseUsers(:appName) AS xt_client_count,"
+                   "       numOfServerUsers() as total_client_count;");
+    metric.bindValue(":appName", _ConnAppName);
+    metric.exec();
+    if(metric.first())
+    {
+      cnt = metric.value("xt_client_count").toInt();
+      tot = metric.value("total_client_count").toInt();
+    }
+    else
+    {
+      ErrorReporter::error(QtCriticalMsg, 0, QObject::tr("Error Counting Users"),
+                           metric, __FILE__, __LINE__);
+    }
+    metric.exec("SELECT packageIsEnabled('drupaluserinfo') AS result;");
+    if(metric.first())
+      xtweb = metric.value("result").toBool();
   }
-  metric.exec("SELECT packageIsEnabled('drupaluserinfo') AS result;");
-  bool xtweb = false;
-  if(metric.first())
-    xtweb = metric.value("result").toBool();
   bool forceLimit = _metrics->boolean("ForceLicenseLimit");
   bool forced = false;
   bool checkPass = true;
@@ -575,11 +616,17 @@ int main(int argc, char *argv[])
 
   _splash->showMessage(QObject::tr("Loading User Preferences"), SplashTextAlignment, SplashTextColor);
   qApp->processEvents();
-  _preferences = new Preferences(username);
+  if (bootstrap.isValid())
+    _preferences = new Preferences(username, bootstrap.section("pref"));
+  else
+    _preferences = new Preferences(username);
 
   _splash->showMessage(QObject::tr("Loading User Privileges"), SplashTextAlignment, SplashTextColor);
   qApp->processEvents();
-  _privileges = new Privileges();
+  if (bootstrap.isValid())
+    _privileges = new Privileges(bootstrap.value("user", "username"), bootstrap.section("priv"));
+  else
+    _privileges = new Privileges();
 
   qApp->processEvents();
 
@@ -639,9 +686,16 @@ int main(int argc, char *argv[])
 
 // START code for updating the locale settings if they haven't been already
   XSqlQuery lc;
-  lc.exec("SELECT count(*) FROM metric WHERE metric_name='AutoUpdateLocaleHasRun';");
-  lc.first();
-  if(lc.value(0).toInt() == 0)
+  bool localeHasRun;
+  if (bootstrap.isValid())
+    localeHasRun = bootstrap.contains("metric", "AutoUpdateLocaleHasRun");
+  else
+  {
+    lc.exec("SELECT count(*) FROM metric WHERE metric_name='AutoUpdateLocaleHasRun';");
+    lc.first();
+    localeHasRun = lc.value(0).toInt() != 0;
+  }
+  if(! localeHasRun)
   {
     lc.exec("INSERT INTO metric (metric_name, metric_value) values('AutoUpdateLocaleHasRun', 't');");
     lc.exec("SELECT locale_id from locale;");
@@ -701,10 +755,11 @@ int main(int argc, char *argv[])
   // be selected or created
   XSqlQuery baseCurrency;
   baseCurrency.prepare("SELECT COUNT(*) AS count FROM curr_symbol WHERE curr_base=TRUE;");
-  baseCurrency.exec();
-  if(baseCurrency.first())
+  if(bootstrap.isValid() || (baseCurrency.exec() && baseCurrency.first()))
   {
-    if(baseCurrency.value("count").toInt() != 1)
+    int baseCount = bootstrap.isValid() ? bootstrap.value("live", "basecurrencies").toInt()
+                                        : baseCurrency.value("count").toInt();
+    if(baseCount != 1)
     {
       currenciesDialog newdlg(0, "", true);
       newdlg.exec();
@@ -755,23 +810,37 @@ int main(int argc, char *argv[])
   }
 
 //  Check for valid current Fiscal period
-  XSqlQuery periodCheck;
-  periodCheck.prepare("SELECT EXISTS(SELECT 1 FROM period "
-            "     WHERE ((current_date BETWEEN period_start AND period_end) "
-            "       AND (NOT period_closed))) AS found; ");
-  periodCheck.exec();
-  if(periodCheck.first() && ! periodCheck.value("found").toBool())
+  bool noPeriod = false;
+  if (bootstrap.isValid())
+    noPeriod = ! QVariant(bootstrap.value("live", "openperiod")).toBool();
+  else
+  {
+    XSqlQuery periodCheck;
+    periodCheck.prepare("SELECT EXISTS(SELECT 1 FROM period "
+              "     WHERE ((current_date BETWEEN period_start AND period_end) "
+              "       AND (NOT period_closed))) AS found; ");
+    periodCheck.exec();
+    noPeriod = periodCheck.first() && ! periodCheck.value("found").toBool();
+  }
+  if(noPeriod)
   {
     createFiscalYear newdlg(NULL);
     (void)newdlg.exec();
   }
 
 //  Check for valid current exchange rates
-  XSqlQuery xrateCheck("SELECT curr_abbr"
-	          "  FROM curr_symbol s JOIN curr_rate r ON s.curr_id = r.curr_id"
-	          "  GROUP BY curr_abbr"
-	          "  HAVING NOT BOOL_OR(current_date BETWEEN curr_effective AND curr_expires);");
-  if (xrateCheck.first())
+  bool missingRates = false;
+  if (bootstrap.isValid())
+    missingRates = ! bootstrap.value("live", "missingrates").isEmpty();
+  else
+  {
+    XSqlQuery xrateCheck("SELECT curr_abbr"
+                "  FROM curr_symbol s JOIN curr_rate r ON s.curr_id = r.curr_id"
+                "  GROUP BY curr_abbr"
+                "  HAVING NOT BOOL_OR(current_date BETWEEN curr_effective AND curr_expires);");
+    missingRates = xrateCheck.first();
+  }
+  if (missingRates)
     QMessageBox::warning( omfgThis, QObject::tr("Additional Configuration Required"),
       QObject::tr("<p>Your system has alternate currencies without exchange rates "
                   "entered for the current date. "
@@ -780,19 +849,31 @@ int main(int argc, char *argv[])
                   "transactions in the system.") );
 
 // Check for presence of password reset requirement and user last reset days
-  XSqlQuery resetCheck("SELECT fetchmetricbool('EnforcePasswordReset') as passreset, "
-                       "       fetchmetricvalue('PasswordResetDays')::TEXT as resetdays, "
-                       "(SELECT current_date - fetchmetricvalue('PasswordResetDays')::INTEGER > "
-                       "(SELECT usrpref_value FROM usrpref WHERE ((usrpref_username = geteffectivextuser()) "
-                       " AND (usrpref_name = 'PasswordResetDate')))::DATE) AS lastreset;");
-  resetCheck.exec();
-  if(resetCheck.first())
+  MetricMap reset;
+  if (bootstrap.isValid())
+    reset = bootstrap.section("live");
+  else
+  {
+    XSqlQuery resetCheck("SELECT fetchmetricbool('EnforcePasswordReset') as passreset, "
+                         "       fetchmetricvalue('PasswordResetDays')::TEXT as resetdays, "
+                         "(SELECT current_date - fetchmetricvalue('PasswordResetDays')::INTEGER > "
+                         "(SELECT usrpref_value FROM usrpref WHERE ((usrpref_username = geteffectivextuser()) "
+                         " AND (usrpref_name = 'PasswordResetDate')))::DATE) AS lastreset;");
+    resetCheck.exec();
+    if(resetCheck.first())
+    {
+      reset.insert("passreset", resetCheck.value("passreset").toString());
+      reset.insert("resetdays", resetCheck.value("resetdays").toString());
+      reset.insert("lastreset", resetCheck.value("lastreset").toString());
+    }
+  }
+  if(reset.contains("passreset"))
   {
-    if(resetCheck.value("passreset").toBool() && resetCheck.value("lastreset").toBool())
+    if(QVariant(reset.value("passreset")).toBool() && QVariant(reset.value("lastreset")).toBool())
     {
       QMessageBox::warning( omfgThis, QObject::tr("New Password Required"),
         QObject::tr("<p>Your company has a policy of updating passwords every %1 days.  "
-                  "Please change your password before logging out.").arg(resetCheck.value("resetdays").toString()));
+                  "Please change your password before logging out.").arg(reset.value("resetdays")));
       if (_privileges->check("MaintainPreferencesSelf"))
       {
         ParameterList params;
@@ -454,7 +454,7 @@ menuAccounting::menuAccounting(GUIClient *Pparent) :
   addActionsToMenu(acts, sizeof(acts) / sizeof(acts[0]));
   
   parent->populateCustomMenu(mainMenu, "Accounting");
-  QAction * m = parent->menuBar()->addMenu(mainMenu);
+  QAction * m = parent->addModuleMenu(mainMenu);
   if(m)
     m->setText(tr("Accountin&g"));
 }
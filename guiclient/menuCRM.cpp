@@ -145,7 +145,7 @@ menuCRM::menuCRM(GUIClient *Pparent) :
   addActionsToMenu(acts, sizeof(acts) / sizeof(acts[0]));
 
   parent->populateCustomMenu(crmMenu, "CRM");
-  QAction * m = parent->menuBar()->addMenu(crmMenu);
+  QAction * m = parent->addModuleMenu(crmMenu);
   if(m)
     m->setText(tr("C&RM"));
 }
@@ -416,7 +416,7 @@ menuInventory::menuInventory(GUIClient *Pparent) :
 #endif
 
   parent->populateCustomMenu(mainMenu, "Inventory");
-  QAction * m = parent->menuBar()->addMenu(mainMenu);
+  QAction * m = parent->addModuleMenu(mainMenu);
   if(m)
     m->setText(tr("&Inventory"));
 
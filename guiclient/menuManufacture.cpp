@@ -194,7 +194,7 @@ menuManufacture::menuManufacture(GUIClient *Pparent) :
   addActionsToMenu(acts, sizeof(acts) / sizeof(acts[0]));
 
   parent->populateCustomMenu(mainMenu, "Manufacture");
-  QAction * m = parent->menuBar()->addMenu(mainMenu);
+  QAction * m = parent->addModuleMenu(mainMenu);
   if(m)
     m->setText(tr("&Manufacture"));
 }
@@ -226,7 +226,7 @@ menuProducts::menuProducts(GUIClient *Pparent) :
   addActionsToMenu(acts, sizeof(acts) / sizeof(acts[0]));
 
   parent->populateCustomMenu(mainMenu, "Products");
-  QAction * m = parent->menuBar()->addMenu(mainMenu);
+  QAction * m = parent->addModuleMenu(mainMenu);
   if(m)
     m->setText(tr("Produc&ts"));
 }
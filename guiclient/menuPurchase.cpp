@@ -247,7 +247,7 @@ menuPurchase::menuPurchase(GUIClient *Pparent) :
   addActionsToMenu(acts, sizeof(acts) / sizeof(acts[0]));
 
   parent->populateCustomMenu(mainMenu, "Purchase");
-  QAction * m = parent->menuBar()->addMenu(mainMenu);
+  QAction * m = parent->addModuleMenu(mainMenu);
   if(m)
     m->setText(tr("P&urchase"));
 }
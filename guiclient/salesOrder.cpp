@@ -68,6 +68,94 @@ enum OrderModeType  { QuoteMode = 1, OrderMode = 2 };
 
 #define DEBUG false
 
+// the rounded tax on an order or quote, shared by sCalculateTax and summarySql
+static QString taxSql(
+  "(SELECT SUM(tax)"
+  "   FROM (SELECT ROUND(SUM(taxdetail_tax),2) AS tax"
+  "           FROM tax"
+  "           JOIN calculateTaxDetailSummary(<? value('taxtype') ?>, <? value('head_id') ?>, 'T')"
+  "             ON (taxdetail_tax_id=tax_id)"
+  "          GROUP BY tax_id) AS data)");
+
+/* the header totals sFillItemList shows, for orders and quotes alike, in
+   one row so a line edit costs one round trip for them instead of one
+   per total. the lines themselves still come from the salesOrderItems
+   and quoteItems queries.
+ */
+static QString summarySql(
+  "<? if exists('isQuote') ?>"
+  "SELECT COALESCE(getQuoteSchedDate(<? value('head_id') ?>),"
+  "                <? value('ship_date') ?>) AS shipdate,"
+  "       0.0 AS shippingamount,"
+  "       totals.subtotal, totals.totalcost, weight.grossweight,"
+  "<? if exists('calcFreight') ?>"
+  "       (SELECT SUM(freightdata_total)"
+  "          FROM freightDetail('QU', <? value('head_id') ?>, <? value('cust_id') ?>,"
+  "                             <? value('shipto_id') ?>, <? value('orderdate') ?>,"
+  "                             <? value('shipvia') ?>, <? value('curr_id') ?>)) AS freight,"
+  "<? else ?>"
+  "       NULL AS freight,"
+  "<? endif ?>"
+  "       " + taxSql + " AS tax"
+  "  FROM (SELECT SUM(ROUND((quitem_qtyord * quitem_qty_invuomratio) *"
+  "                         (quitem_price / quitem_price_invuomratio),2)) AS subtotal,"
+  "               SUM(ROUND((quitem_qtyord * quitem_qty_invuomratio) *"
+  "                         (quitem_unitcost / quitem_price_invuomratio),2)) AS totalcost"
+  "          FROM quitem"
+  "         WHERE (quitem_quhead_id=<? value('head_id') ?>)) AS totals,"
+  "       (SELECT SUM(COALESCE(quitem_qtyord * quitem_qty_invuomratio, 0.00) *"
+  "                   (COALESCE(item_prodweight, 0.00) +"
+  "                    COALESCE(item_packweight, 0.00))) AS grossweight"
+  "          FROM quitem"
+  "          JOIN item ON (quitem_item_id=item_id)"
+  "         WHERE (quitem_quhead_id=<? value('head_id') ?>)) AS weight;"
+  "<? else ?>"
+  "SELECT COALESCE(getSoSchedDate(<? value('head_id') ?>),"
+  "                <? value('ship_date') ?>) AS shipdate,"
+  "       (SELECT SUM(shippingamount)"
+  "          FROM (SELECT ROUND(((COALESCE(SUM(shipitem_qty),0)-coitem_qtyshipped) *"
+  "                              coitem_qty_invuomratio) *"
+  "                             (coitem_price / coitem_price_invuomratio),2) AS shippingamount"
+  "                  FROM coitem"
+  "                  LEFT OUTER JOIN"
+  "                       (shipitem JOIN shiphead ON (shipitem_shiphead_id=shiphead_id"
+  "                                               AND shiphead_order_id=<? value('head_id') ?>"
+  "                                               AND shiphead_order_type='SO'))"
+  "                    ON (shipitem_orderitem_id=coitem_id)"
+  "                 WHERE ((coitem_cohead_id=<? value('head_id') ?>)"
+  "<? if exists('excludeCancelled') ?>"
+  "                   AND (coitem_status != 'X')"
+  "<? endif ?>"
+  "                       )"
+  "                 GROUP BY coitem_id, coitem_qtyshipped, coitem_qty_invuomratio,"
+  "                          coitem_price, coitem_price_invuomratio) AS shipping) AS shippingamount,"
+  "       totals.subtotal, totals.totalcost, weight.grossweight,"
+  "<? if exists('calcFreight') ?>"
+  "       (SELECT SUM(freightdata_total)"
+  "          FROM freightDetail('SO', <? value('head_id') ?>, <? value('cust_id') ?>,"
+  "                             <? value('shipto_id') ?>, <? value('orderdate') ?>,"
+  "                             <? value('shipvia') ?>, <? value('curr_id') ?>)) AS freight,"
+  "<? else ?>"
+  "       NULL AS freight,"
+  "<? endif ?>"
+  "       " + taxSql + " AS tax"
+  "  FROM (SELECT SUM(ROUND((coitem_qtyord * coitem_qty_invuomratio) *"
+  "                         (coitem_price / coitem_price_invuomratio),2)) AS subtotal,"
+  "               SUM(ROUND((coitem_qtyord * coitem_qty_invuomratio) *"
+  "                         (coitem_unitcost / coitem_price_invuomratio),2)) AS totalcost"
+  "          FROM coitem"
+  "         WHERE ((coitem_cohead_id=<? value('head_id') ?>)"
+  "           AND  (coitem_status <> 'X'))) AS totals,"
+  "       (SELECT SUM(COALESCE(coitem_qtyord * coitem_qty_invuomratio, 0.00) *"
+  "                   (COALESCE(item_prodweight, 0.00) +"
+  "                    COALESCE(item_packweight, 0.00))) AS grossweight"
+  "          FROM coitem"
+  "          JOIN itemsite ON (coitem_itemsite_id=itemsite_id)"
+  "          JOIN item     ON (itemsite_item_id=item_id)"
+  "         WHERE ((coitem_cohead_id=<? value('head_id') ?>)"
+  "           AND  (coitem_status <> 'X'))) AS weight;"
+  "<? endif ?>");
+
 salesOrder::salesOrder(QWidget *parent, const char *name, Qt::WindowFlags fl)
   : XDocumentWindow(parent, name, fl),
     _saved         (false),
@@ -3038,30 +3126,10 @@ void salesOrder::populate()
 void salesOrder::sFillItemList()
 {
   ENTERED;
-  XSqlQuery fillSales;
-  if (ISORDER(_mode))
-    fillSales.prepare( "SELECT COALESCE(getSoSchedDate(:head_id),:ship_date) AS shipdate;" );
-  else
-    fillSales.prepare( "SELECT COALESCE(getQuoteSchedDate(:head_id),:ship_date) AS shipdate;" );
-
-  fillSales.bindValue(":head_id", _soheadid);
-  fillSales.bindValue(":ship_date", _shipDate->date());
-  fillSales.exec();
-  if (fillSales.first())
-  {
-    _shipDateCache = fillSales.value("shipdate").toDate();
-    _shipDate->setDate(_shipDateCache);
-
-    if (ISNEW(_mode) && !_packDate->isValid())
-      _packDate->setDate(fillSales.value("shipdate").toDate());
-  }
-  else if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Sales Order Information"),
-                                fillSales, __FILE__, __LINE__))
-  {
-    return;
-  }
-
-  _soitem->clear();
+  /* merge the lines into the list so the rows that didn't change, and the
+     selection, stay where they are
+   */
+  int lines = 0;
   if (ISORDER(_mode))
   {
     MetaSQLQuery mql(omfgThis->_mqlhash->value("salesOrderItems", "list"));
@@ -3074,41 +3142,15 @@ void salesOrder::sFillItemList()
     if (_metrics->boolean("EnableSOReservations"))
       params.append("includeReservations");
     XSqlQuery fl = mql.toQuery(params);
-    _soitem->populate(fl, true);
+    _soitem->populate(fl, true, XTreeWidget::Merge);
     if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retreiving Sales Order Information"),
                                   fl, __FILE__, __LINE__))
     {
       return;
     }
 
-    _cust->setReadOnly(fl.size() || !ISNEW(_mode));
-    _amountAtShipping->setLocalValue(0.0);
-    QString sql = "SELECT ROUND(((COALESCE(SUM(shipitem_qty),0)-coitem_qtyshipped) *"
-          "                  coitem_qty_invuomratio) *"
-          "           (coitem_price / coitem_price_invuomratio),2) AS shippingAmount "
-          "  FROM coitem LEFT OUTER JOIN "
-          "       (shipitem JOIN shiphead ON (shipitem_shiphead_id=shiphead_id"
-          "                               AND shiphead_order_id=:cohead_id"
-          "                               AND shiphead_order_type='SO')) ON (shipitem_orderitem_id=coitem_id)"
-          " WHERE ((coitem_cohead_id=:cohead_id)";
-
-    if (!_showCanceled->isChecked())
-      sql += " AND (coitem_status != 'X') ";
-
-    sql += ") GROUP BY coitem_id, coitem_qtyshipped, coitem_qty_invuomratio,"
-           "coitem_price, coitem_price_invuomratio;";
-    fillSales.prepare(sql);
-    fillSales.bindValue(":cohead_id", _soheadid);
-    fillSales.bindValue(":cust_id", _cust->id());
-    fillSales.exec();
-    while (fillSales.next())
-      _amountAtShipping->setLocalValue(_amountAtShipping->localValue() +
-                                       fillSales.value("shippingAmount").toDouble());
-    if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Sales Order Information"),
-                                  fillSales, __FILE__, __LINE__))
-    {
-      return;
-    }
+    lines = fl.size();
+    _cust->setReadOnly(lines || !ISNEW(_mode));
   }
   else if (ISQUOTE(_mode))
   {
@@ -3117,8 +3159,9 @@ void salesOrder::sFillItemList()
     ParameterList params;
     params.append("quhead_id", _soheadid);
     XSqlQuery fl = mql.toQuery(params);
-    _cust->setReadOnly(fl.size() || !ISNEW(_mode));
-    _soitem->populate(fl);
+    lines = fl.size();
+    _cust->setReadOnly(lines || !ISNEW(_mode));
+    _soitem->populate(fl, false, XTreeWidget::Merge);
     if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Sales Order Information"),
                                   fl, __FILE__, __LINE__))
     {
@@ -3126,28 +3169,34 @@ void salesOrder::sFillItemList()
     }
   }
 
-  //  Determine the subtotal
-  if (ISORDER(_mode))
-    fillSales.prepare( "SELECT SUM(round((coitem_qtyord * coitem_qty_invuomratio) * (coitem_price / coitem_price_invuomratio),2)) AS subtotal,"
-                       "       SUM(round((coitem_qtyord * coitem_qty_invuomratio) * (coitem_unitcost / coitem_price_invuomratio),2)) AS totalcost "
-                       "FROM cohead JOIN coitem ON (coitem_cohead_id=cohead_id) "
-                       "WHERE ( (cohead_id=:head_id)"
-                       " AND (coitem_status <> 'X') );" );
-  else
-    fillSales.prepare( "SELECT SUM(round((quitem_qtyord * quitem_qty_invuomratio) * (quitem_price / quitem_price_invuomratio),2)) AS subtotal,"
-                       "       SUM(round((quitem_qtyord * quitem_qty_invuomratio) * (quitem_unitcost / quitem_price_invuomratio),2)) AS totalcost "
-                       "FROM quhead JOIN quitem ON (quitem_quhead_id=quhead_id) "
-                       "WHERE (quhead_id=:head_id);" );
-  fillSales.bindValue(":head_id", _soheadid);
-  fillSales.exec();
+  _orderCurrency->setEnabled(lines == 0);
+
+  // the header totals come after the lines so a failure here leaves them shown
+  ParameterList summaryp;
+  if (ISQUOTE(_mode))
+    summaryp.append("isQuote");
+  else if (!_showCanceled->isChecked())
+    summaryp.append("excludeCancelled", true);
+  if (_calcfreight)
+    summaryp.append("calcFreight");
+  summaryp.append("taxtype",   ISQUOTE(_mode) ? "Q" : "S");
+  summaryp.append("head_id",   _soheadid);
+  summaryp.append("ship_date", _shipDate->date());
+  summaryp.append("cust_id",   _cust->id());
+  summaryp.append("shipto_id", _shipTo->id());
+  summaryp.append("orderdate", _orderDate->date());
+  summaryp.append("shipvia",   _shipVia->currentText());
+  summaryp.append("curr_id",   _orderCurrency->id());
+
+  MetaSQLQuery summarymql(summarySql);
+  XSqlQuery fillSales = summarymql.toQuery(summaryp);
   if (fillSales.first())
   {
-    _subtotal->setLocalValue(fillSales.value("subtotal").toDouble());
-    _margin->setLocalValue(fillSales.value("subtotal").toDouble() - fillSales.value("totalcost").toDouble());
-    if (_subtotal->localValue() > 0.0)
-      _marginPercent->setDouble(_margin->localValue() / _subtotal->localValue() * 100.0);
-    else
-      _marginPercent->setDouble(0.0);
+    _shipDateCache = fillSales.value("shipdate").toDate();
+    _shipDate->setDate(_shipDateCache);
+
+    if (ISNEW(_mode) && !_packDate->isValid())
+      _packDate->setDate(fillSales.value("shipdate").toDate());
   }
   else if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Sales Order Information"),
                                 fillSales, __FILE__, __LINE__))
@@ -3156,71 +3205,28 @@ void salesOrder::sFillItemList()
   }
 
   if (ISORDER(_mode))
-    fillSales.prepare("SELECT SUM(COALESCE(coitem_qtyord * coitem_qty_invuomratio, 0.00) *"
-              "           COALESCE(item_prodweight, 0.00)) AS netweight,"
-              "       SUM(COALESCE(coitem_qtyord * coitem_qty_invuomratio, 0.00) *"
-              "           (COALESCE(item_prodweight, 0.00) +"
-              "            COALESCE(item_packweight, 0.00))) AS grossweight "
-              "FROM coitem, itemsite, item, cohead "
-              "WHERE ((coitem_itemsite_id=itemsite_id)"
-              " AND (itemsite_item_id=item_id)"
-              " AND (coitem_cohead_id=cohead_id)"
-              " AND (coitem_status<>'X')"
-              " AND (coitem_cohead_id=:head_id)) "
-              "GROUP BY cohead_freight;");
-  else if (ISQUOTE(_mode))
-    fillSales.prepare("SELECT SUM(COALESCE(quitem_qtyord * quitem_qty_invuomratio, 0.00) *"
-              "           COALESCE(item_prodweight, 0.00)) AS netweight,"
-              "       SUM(COALESCE(quitem_qtyord * quitem_qty_invuomratio, 0.00) *"
-              "           (COALESCE(item_prodweight, 0.00) +"
-              "            COALESCE(item_packweight, 0.00))) AS grossweight "
-              "  FROM quitem, item, quhead "
-              " WHERE ( (quitem_item_id=item_id)"
-              "   AND   (quitem_quhead_id=quhead_id)"
-              "   AND   (quitem_quhead_id=:head_id)) "
-              " GROUP BY quhead_freight;");
-  fillSales.bindValue(":head_id", _soheadid);
-  fillSales.exec();
-  if (fillSales.first())
-    _weight->setDouble(fillSales.value("grossweight").toDouble());
-  else if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Sales Order Information"),
-                                fillSales, __FILE__, __LINE__))
-  {
-    return;
-  }
+    _amountAtShipping->setLocalValue(fillSales.value("shippingamount").toDouble());
+
+  _subtotal->setLocalValue(fillSales.value("subtotal").toDouble());
+  _margin->setLocalValue(fillSales.value("subtotal").toDouble() - fillSales.value("totalcost").toDouble());
+  if (_subtotal->localValue() > 0.0)
+    _marginPercent->setDouble(_margin->localValue() / _subtotal->localValue() * 100.0);
+  else
+    _marginPercent->setDouble(0.0);
+
+  _weight->setDouble(fillSales.value("grossweight").toDouble());
 
   if (_calcfreight)
   {
-    if (ISORDER(_mode))
-      fillSales.prepare("SELECT SUM(freightdata_total) AS freight "
-                "FROM freightDetail('SO', :head_id, :cust_id, :shipto_id, :orderdate, :shipvia, :curr_id);");
-    else if (ISQUOTE(_mode))
-      fillSales.prepare("SELECT SUM(freightdata_total) AS freight "
-                "FROM freightDetail('QU', :head_id, :cust_id, :shipto_id, :orderdate, :shipvia, :curr_id);");
-    fillSales.bindValue(":head_id", _soheadid);
-    fillSales.bindValue(":cust_id", _cust->id());
-    fillSales.bindValue(":shipto_id", _shipTo->id());
-    fillSales.bindValue(":orderdate", _orderDate->date());
-    fillSales.bindValue(":shipvia", _shipVia->currentText());
-    fillSales.bindValue(":curr_id", _orderCurrency->id());
-    fillSales.exec();
-    if (fillSales.first())
-    {
-      disconnect(_freight, SIGNAL(valueChanged()), this, SLOT(sFreightChanged()));
-      _freight->setLocalValue(fillSales.value("freight").toDouble());
-      connect(_freight, SIGNAL(valueChanged()), this, SLOT(sFreightChanged()), Qt::UniqueConnection);
-      _freightCache = _freight->localValue();
-    }
-    else if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Sales Order Information"),
-                                  fillSales, __FILE__, __LINE__))
-    {
-      return;
-    }
+    disconnect(_freight, SIGNAL(valueChanged()), this, SLOT(sFreightChanged()));
+    _freight->setLocalValue(fillSales.value("freight").toDouble());
+    connect(_freight, SIGNAL(valueChanged()), this, SLOT(sFreightChanged()), Qt::UniqueConnection);
+    _freightCache = _freight->localValue();
   }
 
-  sCalculateTax();  // triggers sCalculateTotal();
-
-  _orderCurrency->setEnabled(_soitem->topLevelItemCount() == 0);
+  // the same tax sCalculateTax() would get, without asking again
+  _tax->setLocalValue(fillSales.value("tax").toDouble());
+  sCalculateTotal();
 }
 
 void salesOrder::sCalculateTotal()
@@ -4884,20 +4890,12 @@ void salesOrder::sFreightChanged()
 void salesOrder::sCalculateTax()
 {
   ENTERED;
-  XSqlQuery taxq;
-  taxq.prepare( "SELECT SUM(tax) AS tax "
-                "FROM ("
-                "SELECT ROUND(SUM(taxdetail_tax),2) AS tax "
-                "FROM tax "
-                " JOIN calculateTaxDetailSummary(:type, :cohead_id, 'T') ON (taxdetail_tax_id=tax_id)"
-                "GROUP BY tax_id) AS data;" );
-
-  taxq.bindValue(":cohead_id", _soheadid);
-  if (ISQUOTE(_mode))
-    taxq.bindValue(":type","Q");
-  else
-    taxq.bindValue(":type","S");
-  taxq.exec();
+  ParameterList params;
+  params.append("taxtype", ISQUOTE(_mode) ? "Q" : "S");
+  params.append("head_id", _soheadid);
+
+  MetaSQLQuery mql("SELECT " + taxSql + " AS tax;");
+  XSqlQuery taxq = mql.toQuery(params);
   if (taxq.first())
     _tax->setLocalValue(taxq.value("tax").toDouble());
   else if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Tax Information"),
@@ -143,8 +143,7 @@ ScriptToolbox::~ScriptToolbox()
 XSqlQuery ScriptToolbox::executeQuery(const QString & query)
 {
   ParameterList params;
-  MetaSQLQuery mql(query);
-  return mql.toQuery(params);
+  return omfgThis->_mqlhash->parse(query)->toQuery(params);
 }
 /** @example initMenu_executeQueryExample.js */
 
@@ -180,8 +179,7 @@ XSqlQuery ScriptToolbox::executeQuery(const QString & query)
  */
 XSqlQuery ScriptToolbox::executeQuery(const QString & query, const ParameterList & params)
 {
-  MetaSQLQuery mql(query);
-  return mql.toQuery(params);
+  return omfgThis->_mqlhash->parse(query)->toQuery(params);
 }
 /** @example itemSiteViewItem.js */
 
@@ -210,8 +208,7 @@ XSqlQuery ScriptToolbox::executeQuery(const QString & query, const ParameterList
 XSqlQuery ScriptToolbox::executeDbQuery(const QString & group, const QString & name)
 {
   ParameterList params;
-  MetaSQLQuery mql(omfgThis->_mqlhash->value(group, name));
-  return mql.toQuery(params);
+  return omfgThis->_mqlhash->query(group, name)->toQuery(params);
 }
 
 /** @brief Execute a MetaSQL query loaded from the @c metasql table.
@@ -252,8 +249,7 @@ XSqlQuery ScriptToolbox::executeDbQuery(const QString & group, const QString & n
  */
 XSqlQuery ScriptToolbox::executeDbQuery(const QString & group, const QString & name, const ParameterList & params)
 {
-  MetaSQLQuery mql(omfgThis->_mqlhash->value(group, name));
-  return mql.toQuery(params);
+  return omfgThis->_mqlhash->query(group, name)->toQuery(params);
 }
 /** @example ccvoid.js */
 
@@ -1560,8 +1556,7 @@ QString scriptHandleIncludes(QString source)
         ParameterList params;
         params.append("jsonlist", QString("{\"1\": \"%1\"}").arg(name));
         params.append("order", order);
-        MetaSQLQuery mql(omfgThis->_mqlhash->value("scripts", "fetch"));
-        XSqlQuery inclq = mql.toQuery(params);
+        XSqlQuery inclq = omfgThis->_mqlhash->query("scripts", "fetch")->toQuery(params);
         bool found = false;
         while (inclq.next())
         {
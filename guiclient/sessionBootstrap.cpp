@@ -0,0 +1,271 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "sessionBootstrap.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSqlError>
+#include <QStandardPaths>
+#include <QVariant>
+
+#include "version.h"
+#include "xsqlquery.h"
+
+#define DEBUG false
+
+#define SNAPSHOTMAGIC   0x78545342      // xTSB
+#define SNAPSHOTFORMAT  1
+
+/* everything here ends up in the snapshot. keep each value TEXT so the
+   branches of the UNION line up.
+ */
+static QString cachedSql(
+  "WITH boot(section, key, value) AS ("
+  "  SELECT 'user', 'username', getEffectiveXtUser()"
+  "  UNION ALL"
+  "  SELECT 'user', 'usr_window', usr_window"
+  "    FROM usr"
+  "   WHERE usr_username = getEffectiveXtUser()"
+  "  UNION ALL"
+  "  SELECT 'lang',"
+  "         unnest(ARRAY['lang_abbr2', 'lang_qt_number',"
+  "                      'country_abbr', 'country_qt_number']),"
+  "         unnest(ARRAY[lang_abbr2, lang_qt_number::TEXT,"
+  "                      country_abbr, country_qt_number::TEXT])"
+  "    FROM usr"
+  "    JOIN locale  ON usr_locale_id     = locale_id"
+  "    JOIN lang    ON locale_lang_id    = lang_id"
+  "    LEFT OUTER JOIN country ON locale_country_id = country_id"
+  "   WHERE usr_username = getEffectiveXtUser()"
+  "  UNION ALL"
+  "  SELECT 'pkg', pkghead_name, pkghead_version"
+  "    FROM pkghead"
+  "   WHERE packageIsEnabled(pkghead_name)"
+  "  UNION ALL"
+  "  SELECT 'session', 'edition', getEdition()"
+  "  UNION ALL"
+  "  SELECT 'session', 'startoftime', to_char(startOfTime(), 'YYYY-MM-DD')"
+  "  UNION ALL"
+  "  SELECT 'session', 'endoftime', to_char(endOfTime(), 'YYYY-MM-DD')"
+  "  UNION ALL"
+  "  SELECT 'metric', metric_name, metric_value"
+  "    FROM metric"
+  "  UNION ALL"
+  "  SELECT 'pref', usrpref_name, usrpref_value"
+  "    FROM usrpref"
+  "   WHERE usrpref_username = :username"
+  "  UNION ALL"
+  "  SELECT 'priv', priv_name, 't'"
+  "    FROM (SELECT priv_name"
+  "            FROM usrpriv"
+  "            JOIN priv ON usrpriv_priv_id = priv_id"
+  "           WHERE usrpriv_username = getEffectiveXtUser()"
+  "           UNION"
+  "          SELECT priv_name"
+  "            FROM usrgrp"
+  "            JOIN grppriv ON usrgrp_grp_id = grppriv_grp_id"
+  "            JOIN priv    ON grppriv_priv_id = priv_id"
+  "           WHERE usrgrp_username = getEffectiveXtUser()) AS privs"
+  ") ");
+
+static QString checksumSql(
+  "SELECT 'checksum', 'boot',"
+  "       md5(string_agg(section || '|' || quote_nullable(key) || '|' || quote_nullable(value),"
+  "                      E'\\n' ORDER BY section, key, value))"
+  "  FROM boot ");
+
+// things main() checks that must never come from the snapshot
+static QString liveSql(
+  "SELECT 'live', 'xt_client_count',    numOfDatabaseUsers(:appName)::TEXT"
+  " UNION ALL "
+  "SELECT 'live', 'total_client_count', numOfServerUsers()::TEXT"
+  " UNION ALL "
+  "SELECT 'live', 'drupaluserinfo',     packageIsEnabled('drupaluserinfo')::TEXT"
+  " UNION ALL "
+  "SELECT 'live', 'basecurrencies',"
+  "       (SELECT COUNT(*) FROM curr_symbol WHERE curr_base)::TEXT"
+  " UNION ALL "
+  "SELECT 'live', 'openperiod',"
+  "       EXISTS(SELECT 1 FROM period"
+  "               WHERE ((current_date BETWEEN period_start AND period_end)"
+  "                 AND (NOT period_closed)))::TEXT"
+  " UNION ALL "
+  "SELECT 'live', 'missingrates',"
+  "       (SELECT string_agg(curr_abbr, ' ')"
+  "          FROM (SELECT curr_abbr"
+  "                  FROM curr_symbol s JOIN curr_rate r ON s.curr_id = r.curr_id"
+  "                 GROUP BY curr_abbr"
+  "                HAVING NOT BOOL_OR(current_date BETWEEN curr_effective AND curr_expires)) AS missing)"
+  " UNION ALL "
+  "SELECT 'live', 'passreset',          fetchmetricbool('EnforcePasswordReset')::TEXT"
+  " UNION ALL "
+  "SELECT 'live', 'resetdays',          fetchmetricvalue('PasswordResetDays')::TEXT"
+  " UNION ALL "
+  "SELECT 'live', 'lastreset',"
+  "       (SELECT current_date - fetchmetricvalue('PasswordResetDays')::INTEGER >"
+  "               (SELECT usrpref_value FROM usrpref"
+  "                 WHERE ((usrpref_username = geteffectivextuser())"
+  "                   AND (usrpref_name = 'PasswordResetDate')))::DATE)::TEXT;");
+
+static SessionBootstrap *_instance = 0;
+
+SessionBootstrap::SessionBootstrap(const QString &pDatabaseURL,
+                                   const QString &pUsername,
+                                   const QString &pAppName)
+  : _appName(pAppName),
+    _fromSnapshot(false),
+    _username(pUsername),
+    _valid(false)
+{
+  _instance = this;
+
+  QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/bootstrap";
+  QByteArray identity = QCryptographicHash::hash((pDatabaseURL + "\n" + pUsername).toUtf8(),
+                                                 QCryptographicHash::Sha1).toHex();
+  _file = dir + "/" + QString::fromLatin1(identity) + ".snapshot";
+
+  if (readSnapshot())
+  {
+    QString snapshotChecksum = _checksum;
+    if (fetch(true) && _checksum == snapshotChecksum)
+    {
+      _valid        = true;
+      _fromSnapshot = true;
+      if (DEBUG)
+        qDebug("SessionBootstrap using snapshot %s", qPrintable(_file));
+      return;
+    }
+    _sections.clear();
+  }
+
+  _valid = fetch(false);
+  if (_valid)
+    writeSnapshot();
+}
+
+SessionBootstrap::~SessionBootstrap()
+{
+  if (_instance == this)
+    _instance = 0;
+}
+
+/* the bootstrap main() is using, if it's still starting up */
+SessionBootstrap *SessionBootstrap::instance()
+{
+  return _instance;
+}
+
+bool SessionBootstrap::contains(const QString &pSection, const QString &pKey) const
+{
+  return _sections.value(pSection).contains(pKey);
+}
+
+MetricMap SessionBootstrap::section(const QString &pSection) const
+{
+  return _sections.value(pSection);
+}
+
+QString SessionBootstrap::value(const QString &pSection, const QString &pKey) const
+{
+  return _sections.value(pSection).value(pKey);
+}
+
+/* get the live values and either the cached sections or just their
+   checksum, all in one query
+ */
+bool SessionBootstrap::fetch(bool pChecksumOnly)
+{
+  QString sql = cachedSql;
+  if (! pChecksumOnly)
+    sql += "SELECT section, key, value FROM boot UNION ALL ";
+  sql += checksumSql + " UNION ALL " + liveSql;
+
+  XSqlQuery q;
+  q.prepare(sql);
+  q.bindValue(":username", _username);
+  q.bindValue(":appName",  _appName);
+  if (! q.exec())
+  {
+    qWarning("SessionBootstrap could not fetch the session data: %s",
+             qPrintable(q.lastError().text()));
+    return false;
+  }
+
+  _sections.remove("live");
+  while (q.next())
+  {
+    QString section = q.value(0).toString();
+    if (section == "checksum")
+      _checksum = q.value(2).toString();
+    else
+      _sections[section].insert(q.value(1).toString(), q.value(2).toString());
+  }
+
+  return true;
+}
+
+bool SessionBootstrap::readSnapshot()
+{
+  QFile file(_file);
+  if (! file.open(QIODevice::ReadOnly))
+    return false;
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_0);
+
+  quint32 magic   = 0;
+  qint32  format  = 0;
+  QString version;
+  in >> magic >> format;
+  if (magic != SNAPSHOTMAGIC || format != SNAPSHOTFORMAT)
+    return false;
+
+  in >> version >> _checksum >> _sections;
+  if (in.status() != QDataStream::Ok || version != _Version)
+  {
+    _checksum.clear();
+    _sections.clear();
+    return false;
+  }
+
+  return true;
+}
+
+/* the snapshot holds metrics and privileges so only the user can read it */
+void SessionBootstrap::writeSnapshot()
+{
+  QDir().mkpath(QFileInfo(_file).absolutePath());
+
+  QSaveFile file(_file);
+  if (! file.open(QIODevice::WriteOnly))
+  {
+    qWarning("SessionBootstrap could not save %s: %s",
+             qPrintable(_file), qPrintable(file.errorString()));
+    return;
+  }
+  file.setPermissions(QFile::ReadOwner | QFile::WriteOwner);
+
+  QHash<QString, MetricMap> cached = _sections;
+  cached.remove("live");
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_5_0);
+  out << (quint32)SNAPSHOTMAGIC << (qint32)SNAPSHOTFORMAT
+      << _Version << _checksum << cached;
+
+  if (! file.commit())
+    qWarning("SessionBootstrap could not save %s: %s",
+             qPrintable(_file), qPrintable(file.errorString()));
+}
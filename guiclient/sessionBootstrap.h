@@ -0,0 +1,63 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __SESSIONBOOTSTRAP_H__
+#define __SESSIONBOOTSTRAP_H__
+
+#include <QHash>
+#include <QString>
+
+#include "metrics.h"
+
+/* SessionBootstrap gets everything the client needs from the database
+   before the main window can appear - the user's locale, the enabled
+   packages, metrics, preferences, privileges, and the handful of checks
+   main() makes - in one round trip instead of a dozen.
+
+   Most of that rarely changes, so it's also kept in a snapshot on disk,
+   keyed by database URL and user. If there's a snapshot, the bootstrap
+   only asks the server for a checksum of the same data, plus the values
+   that are never cached, and uses the snapshot when the checksums match.
+
+   If the bootstrap query fails, e.g. because the database predates one of
+   the functions it calls, isValid() is false and callers should query for
+   themselves the way they always have.
+ */
+class SessionBootstrap
+{
+  public:
+    SessionBootstrap(const QString &pDatabaseURL, const QString &pUsername,
+                     const QString &pAppName);
+    ~SessionBootstrap();
+
+    static SessionBootstrap *instance();
+
+    bool      isValid()      const { return _valid;        }
+    bool      fromSnapshot() const { return _fromSnapshot; }
+
+    bool      contains(const QString &pSection, const QString &pKey) const;
+    MetricMap section(const QString &pSection) const;
+    QString   value(const QString &pSection, const QString &pKey) const;
+
+  private:
+    bool      fetch(bool pChecksumOnly);
+    bool      readSnapshot();
+    void      writeSnapshot();
+
+    QString                    _appName;
+    QString                    _checksum;   // of the cached sections
+    QString                    _file;
+    bool                       _fromSnapshot;
+    QHash<QString, MetricMap>  _sections;
+    QString                    _username;
+    bool                       _valid;
+};
+
+#endif
@@ -70,7 +70,13 @@ QWidget* xTupleGuiClientInterface::openWindow(const QString      pname,
 
 QAction* xTupleGuiClientInterface::findAction(const QString pname)
 {
- return omfgThis->findChild<QAction*>(pname);
+  QAction *action = omfgThis->findChild<QAction*>(pname);
+  if (! action)
+  {
+    omfgThis->buildModuleMenus();     // it may be in a hidden module
+    action = omfgThis->findChild<QAction*>(pname);
+  }
+  return action;
 }
 
 void xTupleGuiClientInterface::addDocumentWatch(QString path, int id)
@@ -147,3 +153,12 @@ void xTupleGuiClientInterface::setScriptCache(ScriptCache *pCache)
 {
   _scriptCache = pCache;
 }
+
+bool xTupleGuiClientInterface::loadScriptGlobals(QScriptEngine *engine)
+{
+  if (! omfgThis)
+    return false;
+
+  omfgThis->loadScriptGlobals(engine);
+  return true;
+}
@@ -35,6 +35,7 @@ class xTupleGuiClientInterface : public GuiClientInterface
     virtual void         setMqlHash(MqlHash *pHash);
     virtual ScriptCache *getScriptCache();
     virtual void         setScriptCache(ScriptCache *pCache);
+    virtual bool         loadScriptGlobals(QScriptEngine *engine);
 
   protected:
     MqlHash     *_mqlhash;
@@ -67,8 +67,7 @@ QScriptValue includeScript(QScriptContext *context, QScriptEngine *engine)
     QString scriptname = context->argument(count).toString();
     ParameterList params;
     params.append("jsonlist", QString("{\"1\": \"%1\"}").arg(scriptname));
-    MetaSQLQuery mql(includeMqlHash.value("scripts", "fetch"));
-    XSqlQuery scriptq = mql.toQuery(params);
+    XSqlQuery scriptq = includeMqlHash.query("scripts", "fetch")->toQuery(params);
 
     while (scriptq.next())
     {
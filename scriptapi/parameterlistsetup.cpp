@@ -45,4 +45,5 @@ void ParameterListfromScriptValue(const QScriptValue &obj, ParameterList &params
 void setupParameterList(QScriptEngine *engine)
 {
   qScriptRegisterMetaType(engine, ParameterListtoScriptValue, ParameterListfromScriptValue);
+  qScriptRegisterSequenceMetaType<QList<ParameterList> >(engine);
 }
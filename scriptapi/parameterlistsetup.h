@@ -17,6 +17,7 @@
 class QScriptEngine;
 
 Q_DECLARE_METATYPE(ParameterList)
+Q_DECLARE_METATYPE(QList<ParameterList>)
 
 void setupParameterList(QScriptEngine *engine);
 
@@ -27,6 +27,7 @@
 
 #include "documents.h"
 #include "errorReporter.h"
+#include "xblobcache.h"
 #include "imageview.h"
 #include "imageAssignment.h"
 #include "docAttach.h"
@@ -315,7 +316,8 @@ void Documents::sOpenDoc(QString mode)
     }
 
     XSqlQuery qfile;
-    qfile.prepare("SELECT url_id, url_source_id, url_source, url_title, url_url, url_stream"
+    qfile.prepare("SELECT url_id, url_source_id, url_source, url_title, url_url,"
+                  "       md5(url_stream) AS checksum"
                   " FROM url"
                   " WHERE (url_id=:url_id);");
 
@@ -351,7 +353,8 @@ void Documents::sOpenDoc(QString mode)
                              tr("Could Not Create File %1.").arg(tfile.fileName()) );
         return;
       }
-      tfile.write(qfile.value("url_stream").toByteArray());
+      tfile.write(XBlobCache::document(qfile.value("url_id").toInt(),
+                                       qfile.value("checksum").toString()));
       url.setUrl(tfile.fileName());
 #ifndef Q_OS_WIN
       url.setScheme("file");
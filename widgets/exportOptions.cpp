@@ -23,6 +23,8 @@ ExportOptions::ExportOptions(QWidget* parent, Qt::WindowFlags fl): QDialog(paren
   connect(txtRB, SIGNAL(clicked()), this, SLOT(sEnableCB()));
   connect(htmlRB, SIGNAL(clicked()), this, SLOT(sEnableCB()));
   connect(odtRB, SIGNAL(clicked()), this, SLOT(sEnableCB()));
+  connect(odsRB, SIGNAL(clicked()), this, SLOT(sEnableCB()));
+  connect(xlsxRB, SIGNAL(clicked()), this, SLOT(sEnableCB()));
 
   populateDelim();
   _filetype = csvRB->text();
@@ -61,6 +63,16 @@ void ExportOptions::sEnableCB()
     delimCB->setEnabled(false);
     _filetype = odtRB->text();
   }     
+  else if(odsRB->isChecked())
+  {
+    delimCB->setEnabled(false);
+    _filetype = odsRB->text();
+  }
+  else if(xlsxRB->isChecked())
+  {
+    delimCB->setEnabled(false);
+    _filetype = xlsxRB->text();
+  }
 }
 
 void ExportOptions::populateDelim()
@@ -21,6 +21,7 @@ class Metrics;
 class Metricsenc;
 class Preferences;
 class Privileges;
+class QScriptEngine;
 class ScriptCache;
 
 class GuiClientInterface : public QObject
@@ -52,6 +53,9 @@ class GuiClientInterface : public QObject
     virtual ScriptCache *getScriptCache()           = 0;
     virtual void         setScriptCache(ScriptCache *pCache) = 0;
 
+    // add application-level script globals; false if there are none
+    virtual bool loadScriptGlobals(QScriptEngine *engine) { Q_UNUSED(engine); return false; }
+
   signals:
     void dbConnectionLost();
 };
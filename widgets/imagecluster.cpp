@@ -15,14 +15,17 @@
 #include <QPixmap>
 #include <QScrollArea>
 
-#include <quuencode.h>
 #include <xsqlquery.h>
 
+#include "xblobcache.h"
 #include "xcheckbox.h"
 #include "xtreewidget.h"
 
 #define DEBUG   false
 
+// images bigger than this are shown scaled down
+#define THUMBNAILSIZE QSize(512, 512)
+
 ImageCluster::ImageCluster(QWidget* pParent, const char* pName) :
     VirtualCluster(pParent, pName)
 {
@@ -65,20 +68,13 @@ void ImageCluster::sRefresh()
   }
   else
   {
-    XSqlQuery data;
-    data.prepare("SELECT image_data FROM image WHERE image_id=:image_id");
-    data.bindValue(":image_id", id());
-    data.exec();
-    if (data.first())
-    {
-      if (DEBUG)
-        qDebug("ImageCluster::sRefresh() has picture %s, %d",
-               qPrintable(_description->text().right(128)),
-               data.value("image_data").toString().length());
-      QImage tmpImage;
-      tmpImage.loadFromData(QUUDecode(data.value("image_data").toString()));
+    QImage tmpImage = XBlobCache::thumbnail(id(), THUMBNAILSIZE);
+    if (DEBUG)
+      qDebug("ImageCluster::sRefresh() has picture %s, %dx%d",
+             qPrintable(_description->text().right(128)),
+             tmpImage.width(), tmpImage.height());
+    if (! tmpImage.isNull())
       _image->setPixmap(QPixmap::fromImage(tmpImage));
-    }
   }
 
   if (DEBUG)
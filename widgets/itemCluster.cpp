@@ -541,84 +541,53 @@ void ItemLineEdit::sCopy()
   return;
 }
 
-void ItemLineEdit::sHandleCompleter()
+QString ItemLineEdit::completerSql(int limit) const
 {
-  ENTERED;
-  if (!hasFocus())
-    return;
-
-  QString stripped = text().trimmed().toUpper();
-  if (stripped.isEmpty())
-    return;
-
-  int width = 0;
-  QSqlQueryModel* model = static_cast<QSqlQueryModel *>(_completer->model());
-  QTreeView * view = static_cast<QTreeView *>(_completer->popup());
-  _parsed = true;
-  XSqlQuery numQ;
-
   if (_useQuery)
   {
     QString clause;
     if (_type & (cActive | cItemActive))
       clause = "AND item_active";
-    numQ.prepare(QString("SELECT *"
-                         "  FROM (%1) data"
-                         " WHERE (POSITION(:number IN item_number)=1) %2"
-                         " ORDER BY item_number LIMIT 10")
-                 .arg(QString(_sql)).remove(";")
-                 .arg(clause));
-    numQ.bindValue(":number", stripped);
+    return QString("SELECT *"
+                   "  FROM (%1) data"
+                   " WHERE (POSITION(:number IN item_number)=1) %2"
+                   " ORDER BY item_number LIMIT %3")
+           .arg(QString(_sql)).remove(";")
+           .arg(clause).arg(limit);
   }
-  else
-  {
-    QString pre( "SELECT DISTINCT item_id, item_number, "
-                 "(item_descrip1 || ' ' || item_descrip2) AS itemdescrip, "
-                 "item_upccode AS description " );
 
-    QStringList clauses;
-    clauses = _extraClauses;
-    clauses << "((POSITION(:searchString IN item_number) = 1)"
-            " OR (POSITION(:searchString IN item_upccode) = 1))";
-    if (_crmacct > 0)
-      clauses << QString("(itemalias_crmacct_id IS NULL OR itemalias_crmacct_id = %1)")
-                    .arg(_crmacct);
-    numQ.prepare(buildItemLineEditQuery(pre, clauses, QString::null, _type, true)
-                              .replace(";"," ORDER BY item_number LIMIT 10;"));
-    numQ.bindValue(":searchString", QString(text().trimmed().toUpper()));
-  }
+  QString pre( "SELECT DISTINCT item_id, item_number, "
+               "(item_descrip1 || ' ' || item_descrip2) AS itemdescrip, "
+               "item_upccode AS description " );
 
-  numQ.exec();
-  if (numQ.first())
-  {
-    int numberCol = numQ.record().indexOf("item_number");
-    int descripCol = numQ.record().indexOf("itemdescrip");
-    model->setQuery(numQ);
-    _completer->setCompletionPrefix(stripped);
-    for (int i = 0; i < model->columnCount(); i++)
-    {
-      if ( (i == numberCol) ||
-           (i == descripCol) )
-      {
-        view->resizeColumnToContents(i);
-        width += view->columnWidth(i);
-      }
-      else
-        view->hideColumn(i);
-    }
-  }
-  else
-    model->setQuery(QSqlQuery());
+  QStringList clauses;
+  clauses = _extraClauses;
+  clauses << "((POSITION(:searchString IN item_number) = 1)"
+          " OR (POSITION(:searchString IN item_upccode) = 1))";
+  if (_crmacct > 0)
+    clauses << QString("(itemalias_crmacct_id IS NULL OR itemalias_crmacct_id = %1)")
+                  .arg(_crmacct);
+  return buildItemLineEditQuery(pre, clauses, QString::null, _type, true)
+                .replace(";", QString(" ORDER BY item_number LIMIT %1;").arg(limit));
+}
 
-  if (width > 350)
-    width = 350;
+QVariantMap ItemLineEdit::completerBindings(const QString &prefix) const
+{
+  QVariantMap bindings;
+  bindings.insert(_useQuery ? ":number" : ":searchString", prefix);
+  return bindings;
+}
 
-  QRect rect;
-  rect.setHeight(height());
-  rect.setWidth(width);
-  rect.setBottomLeft(QPoint(0, height() - 2));
-  _completer->complete(rect);
-  _parsed = false;
+bool ItemLineEdit::completerMatches(const QSqlRecord &row, const QString &prefix) const
+{
+  if (row.value("item_number").toString().startsWith(prefix))
+    return true;
+  return ! _useQuery && row.value("description").toString().startsWith(prefix);
+}
+
+QStringList ItemLineEdit::completerColumns() const
+{
+  return QStringList() << "item_number" << "itemdescrip";
 }
 
 void ItemLineEdit::sUpdateMenu()
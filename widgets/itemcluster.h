@@ -167,7 +167,6 @@ friend class itemSearch;
     Q_INVOKABLE void setCRMAcctId(unsigned int);
 
   public slots:
-    void sHandleCompleter();
     void sInfo();
     void sCopy();
     void sList();
@@ -197,6 +196,11 @@ friend class itemSearch;
     void valid(bool);
 
   protected:
+    QString     completerSql(int limit) const;
+    QVariantMap completerBindings(const QString &prefix) const;
+    bool        completerMatches(const QSqlRecord &row, const QString &prefix) const;
+    QStringList completerColumns() const;
+
     QStringList _alias;
 
   protected slots:
@@ -22,6 +22,7 @@
 #include "include.h"
 #include "qtsetup.h"
 #include "scriptcache.h"
+#include "scriptenginepool.h"
 #include "setupscriptapi.h"
 #include "parameterlistsetup.h"
 #include "widgets.h"
@@ -33,6 +34,7 @@
 
 GuiClientInterface *ScriptableWidget::_guiClientInterface = 0;
 ScriptCache        *ScriptableWidget::_cache              = 0;
+ScriptEnginePool   *ScriptableWidget::_pool               = 0;
 
 ScriptableWidget::ScriptableWidget(QWidget *self)
   : _debugger(0),
@@ -42,6 +44,8 @@ ScriptableWidget::ScriptableWidget(QWidget *self)
   _self = (self ? self : dynamic_cast<QWidget *>(this));
   if (! _cache)
     _cache = new ScriptCache(_guiClientInterface);
+  if (! _pool)
+    _pool = new ScriptEnginePool(_guiClientInterface, _guiClientInterface);
 }
 
 ScriptableWidget::~ScriptableWidget()
@@ -53,17 +57,13 @@ QScriptEngine *ScriptableWidget::engine()
   QWidget *w = _self;
   if (w && ! _engine)
   {
-    _engine = new QScriptEngine(w);
+    _engine = _pool->take(w);
     if (_x_preferences && _x_preferences->boolean("EnableScriptDebug"))
     {
       _debugger = new QScriptEngineDebugger(w);
       _debugger->attachTo(_engine);
     }
 
-    setupQt(_engine);
-    setupInclude(_engine);
-    setupScriptApi(_engine, _x_preferences);
-    setupWidgetsScriptApi(_engine, _guiClientInterface);
     QScriptValue mywidget = _engine->newQObject(w);
     _engine->globalObject().setProperty("mywidget",  mywidget);
   }
@@ -97,8 +97,7 @@ void ScriptableWidget::loadScript(const QStringList &list)
 
     ParameterList params;
     params.append("jsonlist", "{" + pair.join(", ") + "}");
-    MetaSQLQuery mql(_guiClientInterface->getMqlHash()->value("scripts", "fetch"));
-    XSqlQuery q = mql.toQuery(params);
+    XSqlQuery q = _guiClientInterface->getMqlHash()->query("scripts", "fetch")->toQuery(params);
     while (q.next())
     {
       _cache->_scriptsById.insert(q.value("script_id").toInt(),
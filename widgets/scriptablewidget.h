@@ -20,6 +20,7 @@ class QScriptEngineDebugger;
 
 class GuiClientInterface;
 class ScriptCache;
+class ScriptEnginePool;
 
 class ScriptableWidget
 {
@@ -36,11 +37,12 @@ class ScriptableWidget
     Q_INVOKABLE virtual bool  setScriptableParams(ParameterList &);
 
   protected:
-    static ScriptCache    *_cache;
-    QScriptEngineDebugger *_debugger;
-    QScriptEngine         *_engine;
-    bool                   _scriptLoaded;
-    QWidget               *_self;
+    static ScriptCache      *_cache;
+    static ScriptEnginePool *_pool;
+    QScriptEngineDebugger   *_debugger;
+    QScriptEngine           *_engine;
+    bool                     _scriptLoaded;
+    QWidget                 *_self;
 };
 
 #endif
@@ -0,0 +1,89 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "scriptenginepool.h"
+
+#include <QScriptEngine>
+#include <QTimer>
+
+#include "guiclientinterface.h"
+#include "include.h"
+#include "qtsetup.h"
+#include "widgets.h"
+
+#define DEBUG false
+
+// how many spare engines to keep and how long to let the GUI settle first
+#define POOLSIZE      2
+#define FILLDELAYMSEC 500
+
+ScriptEnginePool::ScriptEnginePool(GuiClientInterface *client, QObject *parent)
+  : QObject(parent),
+    _client(client),
+    _fillPending(false)
+{
+  if (_client)
+    connect(_client, SIGNAL(dbConnectionLost()), this, SLOT(clear()));
+  scheduleFill();
+}
+
+ScriptEnginePool::~ScriptEnginePool()
+{
+  clear();
+}
+
+/* create an engine and load everything a scripted widget expects to find.
+   the application gets a chance to add its own globals; without it we
+   fall back to the widget-level API.
+ */
+QScriptEngine *ScriptEnginePool::build()
+{
+  QScriptEngine *engine = new QScriptEngine(this);
+  setupQt(engine);
+  setupInclude(engine);
+  if (! _client || ! _client->loadScriptGlobals(engine))
+    setupWidgetsScriptApi(engine, _client);
+
+  if (DEBUG)
+    qDebug("ScriptEnginePool::build() built %p", engine);
+  return engine;
+}
+
+/* hand a ready engine to owner, building one on the spot if the pool ran dry */
+QScriptEngine *ScriptEnginePool::take(QObject *owner)
+{
+  QScriptEngine *engine = _ready.isEmpty() ? build() : _ready.takeFirst();
+  engine->setParent(owner);
+  scheduleFill();
+  return engine;
+}
+
+void ScriptEnginePool::clear()
+{
+  while (! _ready.isEmpty())
+    delete _ready.takeFirst();
+}
+
+void ScriptEnginePool::scheduleFill()
+{
+  if (_fillPending || _ready.size() >= POOLSIZE)
+    return;
+  _fillPending = true;
+  QTimer::singleShot(FILLDELAYMSEC, this, SLOT(sFill()));
+}
+
+/* build one engine at a time so the user never notices a long pause */
+void ScriptEnginePool::sFill()
+{
+  _fillPending = false;
+  if (_ready.size() < POOLSIZE)
+    _ready.append(build());
+  scheduleFill();
+}
@@ -0,0 +1,48 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __SCRIPTENGINEPOOL_H__
+#define __SCRIPTENGINEPOOL_H__
+
+#include <QList>
+#include <QObject>
+
+class QScriptEngine;
+class GuiClientInterface;
+
+/* keeps a few script engines with the whole script API already loaded so
+   scripted windows don't have to wait while hundreds of prototypes get
+   registered. engines are handed out once and never returned - scripts
+   change their globals - so the pool builds replacements while idle.
+ */
+class ScriptEnginePool : public QObject
+{
+  Q_OBJECT
+
+  public:
+    ScriptEnginePool(GuiClientInterface *client, QObject *parent = 0);
+    virtual ~ScriptEnginePool();
+
+    virtual QScriptEngine *take(QObject *owner);
+
+  public slots:
+    virtual void clear();
+    virtual void sFill();
+
+  protected:
+    virtual QScriptEngine *build();
+    virtual void           scheduleFill();
+
+    GuiClientInterface    *_client;
+    QList<QScriptEngine *> _ready;
+    bool                   _fillPending;
+};
+
+#endif
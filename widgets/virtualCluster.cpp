@@ -20,12 +20,16 @@
 #include <QMessageBox>
 #include <QPushButton>
 #include <QSqlQueryModel>
+#include <QRegExp>
+#include <QRegularExpression>
 #include <QSqlRecord>
+#include <QTimer>
 #include <QVBoxLayout>
 
 #include "errorReporter.h"
 #include "guiclientinterface.h"
 #include "shortcuts.h"
+#include "virtualclustercompleter.h"
 #include "xcheckbox.h"
 #include "xdatawidgetmapper.h"
 #include "xsqlquery.h"
@@ -35,6 +39,10 @@
 
 #define DEBUG false
 
+// wait this long after the last keystroke before asking the server
+#define COMPLETERDELAYMSEC 200
+#define COMPLETERLIMIT     10
+
 void VirtualCluster::init()
 {
   if (DEBUG)
@@ -323,6 +331,7 @@ VirtualClusterLineEdit::VirtualClusterLineEdit(QWidget* pParent,
     _parsed = true;
     _strict = true;
     _completer = 0;
+    _completerTimer = 0;
     _showInactive = false;
     _completerId = 0;
 
@@ -339,7 +348,7 @@ VirtualClusterLineEdit::VirtualClusterLineEdit(QWidget* pParent,
 
     if (_x_metrics && ! _x_metrics->boolean("DisableAutoComplete"))
     {
-        QSqlQueryModel* hints = new QSqlQueryModel(this);
+        VirtualClusterHints* hints = new VirtualClusterHints(this);
         hints->setObjectName("hints");
 
         _completer = new QCompleter(hints, this);
@@ -357,6 +366,12 @@ VirtualClusterLineEdit::VirtualClusterLineEdit(QWidget* pParent,
         _completer->setCompletionColumn(1);
         _completer->setMaxVisibleItems(10); // TODO: make this configurable?
 
+        _completerTimer = new QTimer(this);
+        _completerTimer->setObjectName("_completerTimer");
+        _completerTimer->setSingleShot(true);
+        _completerTimer->setInterval(COMPLETERDELAYMSEC);
+        connect(_completerTimer, SIGNAL(timeout()), this, SLOT(sRunCompleter()));
+
         connect(this, SIGNAL(textEdited(QString)), this, SLOT(sHandleCompleter()));
         connect(_completer, SIGNAL(activated(const QModelIndex &)), this, SLOT(completerActivated(const QModelIndex &)));
         connect(_completer, SIGNAL(highlighted(const QModelIndex &)), this, SLOT(completerHighlighted(const QModelIndex &)));
@@ -548,52 +563,94 @@ void VirtualClusterLineEdit::setMenu(QMenu *menu)
   _menu = menu;
 }
 
+/* answer from the completion cache if possible. otherwise wait for a pause
+   in the typing before asking the server, so a fast typist doesn't send
+   one query per keystroke.
+ */
 void VirtualClusterLineEdit::sHandleCompleter()
 {
-  if (!hasFocus())
+  if (!hasFocus() || !_completer)
+    return;
+
+  QString stripped = text().trimmed().toUpper();
+  if (stripped.isEmpty())
+  {
+    _completerTimer->stop();
+    VirtualClusterCompleter::completer()->cancel();
+    return;
+  }
+
+  QList<QSqlRecord> rows;
+  if (VirtualClusterCompleter::completer()->lookup(this, completerSql(COMPLETERLIMIT),
+                                                   stripped, rows))
+  {
+    _completerTimer->stop();
+    showCompletions(rows);
+  }
+  else
+    _completerTimer->start();
+}
+
+void VirtualClusterLineEdit::sRunCompleter()
+{
+  if (!hasFocus() || !_completer)
     return;
 
   QString stripped = text().trimmed().toUpper();
   if (stripped.isEmpty())
     return;
 
+  VirtualClusterCompleter::completer()->fetch(this, completerSql(COMPLETERLIMIT),
+                                              completerBindings(stripped),
+                                              stripped, COMPLETERLIMIT);
+}
+
+/* called when the server answers. the text may have changed since the
+   question was asked, so look again for whatever is there now.
+ */
+void VirtualClusterLineEdit::sShowCompletions()
+{
+  if (!hasFocus() || !_completer)
+    return;
+
+  QString stripped = text().trimmed().toUpper();
+  QList<QSqlRecord> rows;
+  if (! stripped.isEmpty() &&
+      VirtualClusterCompleter::completer()->lookup(this, completerSql(COMPLETERLIMIT),
+                                                   stripped, rows))
+    showCompletions(rows);
+}
+
+void VirtualClusterLineEdit::showCompletions(const QList<QSqlRecord> &rows)
+{
   int width = 0;
-  QSqlQueryModel *model = static_cast<QSqlQueryModel *>(_completer->model());
+  VirtualClusterHints *model = static_cast<VirtualClusterHints *>(_completer->model());
   QTreeView *view = static_cast<QTreeView *>(_completer->popup());
+  QString stripped = text().trimmed().toUpper();
   _parsed = true;
-  XSqlQuery numQ;
-  numQ.prepare(_query + _numClause +
-               (_extraClause.isEmpty() || !_strict ? "" : " AND " + _extraClause) +
-               ((_hasActive && ! _showInactive) ? _activeClause : "") +
-               QString(" ORDER BY %1 %2 LIMIT 10;")
-                       .arg(QString(_hasActive ? "active DESC," : ""), _numColName));
-  numQ.bindValue(":number", "^" + stripped);
-  numQ.exec();
-  if (numQ.first())
+  model->setRows(rows);
+  if (! rows.isEmpty())
   {
-    model->setQuery(numQ);
     _completer->setCompletionPrefix(stripped);
 
+    QSqlRecord  columns = model->columns();
+    QStringList visible = completerColumns();
     for (int i = 0; i < model->columnCount(); i++)
     {
-      if (i != numQ.record().indexOf("number") &&
-          (! _hasName        || i != numQ.record().indexOf("name")) &&
-          (! _hasDescription || i != numQ.record().indexOf("description")) &&
-          (! _hasActive      || i != numQ.record().indexOf("active_qtdisplayrole")))
+      if (! visible.contains(columns.fieldName(i)))
       {
         if (DEBUG) qDebug() << "hiding" << i;
         view->hideColumn(i);
       }
       else
       {
+        view->showColumn(i);
         view->resizeColumnToContents(i);
         width += view->columnWidth(i);
         if (DEBUG) qDebug() << "width changed to" << width;
       }
     }
   }
-  else
-    model->clear();
 
   QRect rect;
   rect.setHeight(height());
@@ -603,6 +660,48 @@ void VirtualClusterLineEdit::sHandleCompleter()
   _parsed = false;
 }
 
+/* the completion query. only the prefix may be bound - the text is also
+   the key the results are cached under.
+ */
+QString VirtualClusterLineEdit::completerSql(int limit) const
+{
+  return _query + _numClause +
+         (_extraClause.isEmpty() || !_strict ? "" : " AND " + _extraClause) +
+         ((_hasActive && ! _showInactive) ? _activeClause : "") +
+         QString(" ORDER BY %1 %2 LIMIT %3;")
+                 .arg(QString(_hasActive ? "active DESC," : ""), _numColName)
+                 .arg(limit);
+}
+
+QVariantMap VirtualClusterLineEdit::completerBindings(const QString &prefix) const
+{
+  QVariantMap bindings;
+  bindings.insert(":number", "^" + QRegularExpression::escape(prefix));
+  return bindings;
+}
+
+/* does row belong in the completions for prefix? this has to agree with
+   the server so cached rows for a shorter prefix can be filtered locally.
+ */
+bool VirtualClusterLineEdit::completerMatches(const QSqlRecord &row, const QString &prefix) const
+{
+  QRegularExpression match("^" + QRegularExpression::escape(prefix),
+                           QRegularExpression::CaseInsensitiveOption);
+  return match.match(row.value("number").toString()).hasMatch();
+}
+
+QStringList VirtualClusterLineEdit::completerColumns() const
+{
+  QStringList columns("number");
+  if (_hasName)
+    columns << "name";
+  if (_hasDescription)
+    columns << "description";
+  if (_hasActive)
+    columns << "active_qtdisplayrole";
+  return columns;
+}
+
 void VirtualClusterLineEdit::completerActivated(const QModelIndex &pIndex)
 {
   _completerId = _completer->completionModel()->data(pIndex.sibling(pIndex.row(), 0)).toInt();
@@ -1169,17 +1268,8 @@ void VirtualList::sSelect()
 
 void VirtualList::sSearch(const QString& pTarget)
 {
-  for (int i = 0; i < _listTab->columnCount(); i++)
-  {
-    QList<XTreeWidgetItem*> matches = _listTab->findItems(pTarget, Qt::MatchStartsWith, i);
-
-    if (matches.size() > 0)
-    {
-      _listTab->setCurrentItem(matches[0]);
-      _listTab->scrollToItem(matches[0]);
-      return;
-    }
-  }
+  _listTab->sFilter(pTarget);
+  _listTab->sSearch(pTarget);
 }
 
 void VirtualList::sFillList()
@@ -18,6 +18,9 @@
 
 #include <QDialog>
 #include <QSqlQuery>
+#include <QSqlRecord>
+#include <QStringList>
+#include <QVariantMap>
 #include <QWidget>
 
 class GuiClientInterface;
@@ -30,6 +33,7 @@ class QMenu;
 class QPushButton;
 class QSpacerItem;
 class QSqlQueryModel;
+class QTimer;
 class QVBoxLayout;
 class VirtualClusterLineEdit;
 class XCheckBox;
@@ -222,6 +226,8 @@ class XTUPLEWIDGETS_EXPORT VirtualClusterLineEdit : public XLineEdit
 
         virtual void setStrikeOut(bool enable = false);
         virtual void sHandleCompleter();
+        virtual void sRunCompleter();
+        virtual void sShowCompletions();
         virtual void sHandleNullStr();
         virtual void sParse();
         virtual void sUpdateMenu();
@@ -288,12 +294,21 @@ class XTUPLEWIDGETS_EXPORT VirtualClusterLineEdit : public XLineEdit
 
         virtual void silentSetId(const int);
 
+        virtual QString     completerSql(int limit) const;
+        virtual QVariantMap completerBindings(const QString &prefix) const;
+        virtual bool        completerMatches(const QSqlRecord &row, const QString &prefix) const;
+        virtual QStringList completerColumns() const;
+
         QSqlQueryModel* _model;
+        QTimer* _completerTimer;
 
     private:
         void positionMenuLabel();
+        void showCompletions(const QList<QSqlRecord> &rows);
 
         QString _cText;
+
+        friend class VirtualClusterCompleter;
 };
 
 /*
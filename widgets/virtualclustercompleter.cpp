@@ -0,0 +1,207 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "virtualclustercompleter.h"
+
+#include <QApplication>
+
+#include "backgroundquery.h"
+#include "virtualCluster.h"
+
+#define DEBUG false
+
+// how long a cached completion stays good and how many prefixes per query
+#define COMPLETERCACHESECS 120
+#define COMPLETERPREFIXES  30
+
+VirtualClusterHints::VirtualClusterHints(QObject *parent)
+  : QSqlQueryModel(parent),
+    _setting(false)
+{
+  // callers still clear the hints with setQuery(QSqlQuery())
+  connect(this, SIGNAL(modelAboutToBeReset()), this, SLOT(sAboutToBeReset()));
+}
+
+bool VirtualClusterHints::canFetchMore(const QModelIndex &parent) const
+{
+  Q_UNUSED(parent);
+  return false;
+}
+
+void VirtualClusterHints::clear()
+{
+  setRows(QList<QSqlRecord>());
+}
+
+int VirtualClusterHints::columnCount(const QModelIndex &parent) const
+{
+  return parent.isValid() || _rows.isEmpty() ? 0 : _rows.first().count();
+}
+
+QSqlRecord VirtualClusterHints::columns() const
+{
+  return _rows.isEmpty() ? QSqlRecord() : _rows.first();
+}
+
+QVariant VirtualClusterHints::data(const QModelIndex &item, int role) const
+{
+  if (! item.isValid() || item.row() >= _rows.size() ||
+      (role != Qt::DisplayRole && role != Qt::EditRole))
+    return QVariant();
+
+  return _rows.at(item.row()).value(item.column());
+}
+
+int VirtualClusterHints::rowCount(const QModelIndex &parent) const
+{
+  return parent.isValid() ? 0 : _rows.size();
+}
+
+void VirtualClusterHints::setRows(const QList<QSqlRecord> &rows)
+{
+  _setting = true;
+  beginResetModel();
+  _rows = rows;
+  endResetModel();
+  _setting = false;
+}
+
+void VirtualClusterHints::sAboutToBeReset()
+{
+  if (! _setting)
+    _rows.clear();
+}
+
+VirtualClusterCompleter *VirtualClusterCompleter::completer()
+{
+  static QPointer<VirtualClusterCompleter> instance;
+  if (! instance)
+    instance = new VirtualClusterCompleter(qApp);
+  return instance;
+}
+
+VirtualClusterCompleter::VirtualClusterCompleter(QObject *parent)
+  : QObject(parent),
+    _query(0),
+    _limit(0)
+{
+}
+
+/* find rows for prefix without asking the server. an entry for the same
+   prefix is used as is; otherwise the rows of the longest complete entry
+   for a shorter prefix are filtered by the cluster's own matching rule.
+ */
+bool VirtualClusterCompleter::lookup(VirtualClusterLineEdit *edit, const QString &key,
+                                     const QString &prefix, QList<QSqlRecord> &rows)
+{
+  if (! _entries.contains(key))
+    return false;
+
+  QDateTime    stale = QDateTime::currentDateTime().addSecs(-COMPLETERCACHESECS);
+  QList<Entry> &entries = _entries[key];
+  for (int i = entries.size() - 1; i >= 0; i--)
+  {
+    if (entries.at(i).loaded < stale)
+      entries.removeAt(i);
+  }
+
+  const Entry *best = 0;
+  for (int i = 0; i < entries.size(); i++)
+  {
+    const Entry &entry = entries.at(i);
+    if (entry.prefix == prefix)
+    {
+      rows = entry.rows;
+      return true;
+    }
+    if (entry.complete && prefix.startsWith(entry.prefix) &&
+        (! best || entry.prefix.length() > best->prefix.length()))
+      best = &entry;
+  }
+
+  if (! best)
+    return false;
+
+  rows.clear();
+  foreach (const QSqlRecord &row, best->rows)
+  {
+    if (edit->completerMatches(row, prefix))
+      rows.append(row);
+  }
+
+  if (DEBUG)
+    qDebug("VirtualClusterCompleter::lookup() filtered %s to %d rows",
+           qPrintable(prefix), rows.size());
+  return true;
+}
+
+/* start looking up prefix for edit, abandoning any earlier request.
+   the sql is also the cache key, so everything but the prefix has to be
+   part of its text rather than bound.
+ */
+void VirtualClusterCompleter::fetch(VirtualClusterLineEdit *edit, const QString &sql,
+                                    const QVariantMap &bindings, const QString &prefix,
+                                    int limit)
+{
+  if (! _query)
+  {
+    _query = new BackgroundQuery(this);
+    connect(_query, SIGNAL(finished(bool)), this, SLOT(sFinished(bool)));
+  }
+
+  _edit   = edit;
+  _key    = sql;
+  _prefix = prefix;
+  _limit  = limit;
+  _query->exec(sql, bindings);
+}
+
+void VirtualClusterCompleter::cancel()
+{
+  if (_query)
+    _query->cancel();
+  _edit = 0;
+}
+
+void VirtualClusterCompleter::clear()
+{
+  _entries.clear();
+}
+
+void VirtualClusterCompleter::sFinished(bool ok)
+{
+  QList<QSqlRecord> rows = _query->takeRows();
+  if (! ok)
+  {
+    if (DEBUG)
+      qDebug("VirtualClusterCompleter::sFinished() %s",
+             qPrintable(_query->lastError().text()));
+    return;
+  }
+
+  Entry entry;
+  entry.prefix   = _prefix;
+  entry.rows     = rows;
+  entry.complete = rows.size() < _limit;
+  entry.loaded   = QDateTime::currentDateTime();
+
+  QList<Entry> &entries = _entries[_key];
+  for (int i = entries.size() - 1; i >= 0; i--)
+  {
+    if (entries.at(i).prefix == _prefix)
+      entries.removeAt(i);
+  }
+  entries.append(entry);
+  while (entries.size() > COMPLETERPREFIXES)
+    entries.removeFirst();
+
+  if (_edit)
+    _edit->sShowCompletions();
+}
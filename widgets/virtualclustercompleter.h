@@ -0,0 +1,103 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __VIRTUALCLUSTERCOMPLETER_H__
+#define __VIRTUALCLUSTERCOMPLETER_H__
+
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QSqlQueryModel>
+#include <QSqlRecord>
+#include <QString>
+#include <QVariantMap>
+
+class BackgroundQuery;
+class VirtualClusterLineEdit;
+
+/* the rows shown in a VirtualClusterLineEdit's completer popup. it looks
+   like the QSqlQueryModel it replaced, including being cleared by
+   setQuery(QSqlQuery()), but holds rows that came from the completion
+   cache or a background query instead of a live query.
+ */
+class VirtualClusterHints : public QSqlQueryModel
+{
+  Q_OBJECT
+
+  public:
+    VirtualClusterHints(QObject *parent = 0);
+
+    virtual bool      canFetchMore(const QModelIndex &parent = QModelIndex()) const;
+    virtual void      clear();
+    virtual int       columnCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual QVariant  data(const QModelIndex &item, int role = Qt::DisplayRole) const;
+    virtual int       rowCount(const QModelIndex &parent = QModelIndex()) const;
+
+    QSqlRecord        columns() const;
+    void              setRows(const QList<QSqlRecord> &rows);
+
+  protected slots:
+    void sAboutToBeReset();
+
+  private:
+    QList<QSqlRecord> _rows;
+    bool              _setting;
+};
+
+/* one completion engine shared by every cluster. it runs at most one
+   query at a time, on a background connection, and remembers the results
+   by query text and prefix. when a prefix comes back with fewer rows
+   than the limit, longer prefixes are answered by filtering those rows
+   instead of asking the server again. the server doesn't say when the
+   tables behind a cluster change, so entries only expire after
+   COMPLETERCACHESECS; edits made since then show up after that.
+ */
+class VirtualClusterCompleter : public QObject
+{
+  Q_OBJECT
+
+  public:
+    static VirtualClusterCompleter *completer();
+
+    bool lookup(VirtualClusterLineEdit *edit, const QString &key,
+                const QString &prefix, QList<QSqlRecord> &rows);
+    void fetch(VirtualClusterLineEdit *edit, const QString &sql,
+               const QVariantMap &bindings, const QString &prefix, int limit);
+
+  public slots:
+    void cancel();
+    void clear();
+
+  protected slots:
+    void sFinished(bool ok);
+
+  protected:
+    VirtualClusterCompleter(QObject *parent = 0);
+
+    class Entry
+    {
+      public:
+        QString           prefix;
+        QList<QSqlRecord> rows;
+        bool              complete;   // every match, not just the first few
+        QDateTime         loaded;
+    };
+
+    BackgroundQuery                 *_query;
+    QHash<QString, QList<Entry> >    _entries;
+    QPointer<VirtualClusterLineEdit> _edit;
+    QString                          _key;
+    QString                          _prefix;
+    int                              _limit;
+};
+
+#endif
@@ -3,7 +3,7 @@ include( ../global.pri )
 TARGET   = xtuplewidgets
 TEMPLATE = lib
 CONFIG  += qt warn_on plugin
-QT      += core network printsupport script scripttools sql \
+QT      += concurrent core network printsupport script scripttools sql \
            webkit webkitwidgets widgets xml
 
 greaterThan(QT_MAJOR_VERSION, 4) {
@@ -122,6 +122,7 @@ HEADERS += plugins/addressclusterplugin.h \
 SOURCES += widgets.cpp \
     scriptablewidget.cpp                \
     scriptcache.cpp                     \
+    scriptenginepool.cpp                \
     addressCluster.cpp \
     alarmMaint.cpp \
     alarms.cpp \
@@ -193,6 +194,7 @@ SOURCES += widgets.cpp \
     vendorcluster.cpp \
     vendorgroup.cpp \
     virtualCluster.cpp \
+    virtualclustercompleter.cpp \
     voucherCluster.cpp \
     warehouseCluster.cpp \
     warehousegroup.cpp \
@@ -200,6 +202,7 @@ SOURCES += widgets.cpp \
     workcenterCluster.cpp \
     xcheckbox.cpp \
     xcombobox.cpp \
+    xcomboboxcache.cpp \
     xdatawidgetmapper.cpp \
     xdoccopysetter.cpp \
     xdoublevalidator.cpp \
@@ -214,12 +217,17 @@ SOURCES += widgets.cpp \
     xtextedit.cpp \
     xtreeview.cpp \
     xtreewidget.cpp \
+    xtreewidgetexporter.cpp \
+    xtreewidgetmodel.cpp \
     xtreewidgetprogress.cpp \
+    xtreewidgetsearchindex.cpp \
+    xtreewidgetsorter.cpp \
     xurllabel.cpp \
 
 HEADERS += widgets.h \
     scriptablewidget.h          \
     scriptcache.h               \
+    scriptenginepool.h          \
     xtupleplugin.h \
     guiclientinterface.h \
     addresscluster.h \
@@ -294,6 +302,7 @@ HEADERS += widgets.h \
     vendorcluster.h \
     vendorgroup.h \
     virtualCluster.h \
+    virtualclustercompleter.h \
     voucherCluster.h \
     warehouseCluster.h \
     warehousegroup.h \
@@ -301,6 +310,7 @@ HEADERS += widgets.h \
     workcentercluster.h \
     xcheckbox.h \
     xcombobox.h \
+    xcomboboxcache.h \
     xcomboboxprivate.h \
     xdatawidgetmapper.h \
     xdoccopysetter.h \
@@ -316,7 +326,11 @@ HEADERS += widgets.h \
     xtextedit.h \
     xtreeview.h \
     xtreewidget.h \
+    xtreewidgetexporter.h \
+    xtreewidgetmodel.h \
     xtreewidgetprogress.h \
+    xtreewidgetsearchindex.h \
+    xtreewidgetsorter.h \
     xurllabel.h \
 
 FORMS += alarmMaint.ui \
@@ -25,6 +25,7 @@
 #include <xsqlquery.h>
 
 #include "xcombobox.h"
+#include "xcomboboxcache.h"
 #include "xcomboboxprivate.h"
 #include "xdatawidgetmapper.h"
 #include "xsqltablemodel.h"
@@ -62,7 +63,6 @@ QHash<XComboBox::XComboBoxTypes, XComboBoxDescrip*> XComboBoxPrivate::typeDescri
 
 XComboBoxDescrip::XComboBoxDescrip()
   : type(XComboBox::Adhoc),
-    isDirty(true),
     isEditable(false)
 {
 }
@@ -79,7 +79,6 @@ XComboBoxDescrip::XComboBoxDescrip(XComboBox::XComboBoxTypes pType,
     uiName(pUi),
     privilege(pPriv),
     queryStr(pQry),
-    isDirty(true),
     isEditable(pEditable),
     notification(pNotification)
 {
@@ -90,42 +89,12 @@ XComboBoxDescrip::XComboBoxDescrip(XComboBox::XComboBoxTypes pType,
 
   if (QSqlDatabase::database().isOpen())
     query = MetaSQLQuery(queryStr).toQuery(params, QSqlDatabase(), false);
-  if (XComboBox::_guiClientInterface)
-    connect(XComboBox::_guiClientInterface, SIGNAL(dbConnectionLost()), this, SLOT(sDbConnectionLost()));
-
-  sListen();
 }
 
 XComboBoxDescrip::~XComboBoxDescrip()
 {
 }
 
-void XComboBoxDescrip::sDbConnectionLost()
-{
-  if (DEBUG) qDebug() << "XComboBoxDescrip::sDbConnectionLost()";
-  isDirty = true;
-}
-
-void XComboBoxDescrip::sListen()
-{
-  QSqlDatabase db = QSqlDatabase::database();
-  foreach (QString notice,
-           notification.split(" ", QString::SkipEmptyParts))
-  {
-    if (! db.driver()->subscribedToNotifications().contains(notice))
-      db.driver()->subscribeToNotification(notice);
-
-    connect(db.driver(), SIGNAL(notification(const QString&)),
-            this,        SLOT(sNotified(const QString&)));
-  }
-}
-
-void XComboBoxDescrip::sNotified(const QString &pNotification)
-{
-  Q_UNUSED(pNotification);
-  isDirty = true;
-}
-
 static QString bankaccntMQL("SELECT bankaccnt_id,"
                             "       bankaccnt_name || '-' || bankaccnt_descrip,"
                             "       bankaccnt_name"
@@ -802,8 +771,6 @@ XComboBoxPrivate::~XComboBoxPrivate()
 
 void XComboBoxPrivate::sEdit()
 {
-  if (_descrip)
-    _descrip->isDirty = true;
   if (_editor && ! _slot->isEmpty())
   {
     QMetaObject::invokeMethod(_editor, _slot->data(), Qt::DirectConnection);
@@ -880,12 +847,6 @@ void XComboBoxPrivate::setType(XComboBox::XComboBoxTypes ptype)
 
   _type    = ptype;
   _descrip = typeDescrip.value(_type);
-  if (_descrip && _descrip->isDirty)
-  {
-    _descrip->sListen();
-    _descrip->query.exec();
-    _descrip->isDirty = _descrip->notification.isEmpty(); // empty => there's no notification to listen for
-  }
 
   addEditButton();
 }
@@ -1128,7 +1089,8 @@ void XComboBox::setType(XComboBoxTypes pType)
   }
 
   if (_data->typeDescrip.contains(pType)) {     // allow for Adhoc
-    populate(_data->_descrip->query);
+    XComboBoxRowsPtr rows = XComboBoxCache::cache()->rows(pType);
+    populate(rows ? *rows : XComboBoxRows());
   }
 
   switch (pType)
@@ -1379,6 +1341,9 @@ void XComboBox::clear()
 // allow repopulating after the underlying contents have changed (e.g. #3698)
 void XComboBox::populate()
 {
+  // the change may not have been announced yet so don't trust the cache
+  if (_x_metrics && _data->typeDescrip.contains(_data->_type))
+    XComboBoxCache::cache()->invalidate(_data->_type);
   setType(_data->_type);
 }
 
@@ -1388,21 +1353,43 @@ void XComboBox::populate(XSqlQuery pQuery, int pSelected)
     qDebug("%s::populate(%s, %d) entered",
            qPrintable(objectName()), qPrintable(pQuery.lastQuery()), pSelected);
 
-  int selected = (pSelected >= 0) ? pSelected : id();
-  clear();
-
   if (! pQuery.isActive())
     pQuery.exec();
 
-  // strange if/loop construct lets multiple comboboxes share a query instance
-  if (pQuery.first())
-    do
-    {
-      if (pQuery.record().count() < 3)
-        append(pQuery.value(0).toInt(), pQuery.value(1).toString());
-      else
-        append(pQuery.value(0).toInt(), pQuery.value(1).toString(), pQuery.value(2).toString());
-    } while (pQuery.next());
+  populate(*XComboBoxCache::fromQuery(pQuery), pSelected);
+}
+
+void XComboBox::populate(const QString & pSql, int pSelected)
+{
+  XSqlQuery query(pSql);
+  populate(query, pSelected);
+}
+
+/* fill the list with rows, sharing their storage when there's no null
+   item in the way
+ */
+void XComboBox::populate(const XComboBoxRows &rows, int pSelected)
+{
+  int selected = (pSelected >= 0) ? pSelected : id();
+  clear();
+
+  if (_data->_ids.isEmpty())
+  {
+    _data->_ids   = rows.ids;
+    _data->_codes = rows.codes;
+    addItems(rows.text);
+  }
+  else if (! rows.hasNullId)
+  {
+    _data->_ids   += rows.ids;
+    _data->_codes += rows.codes;
+    addItems(rows.text);
+  }
+  else
+  {
+    for (int i = 0; i < rows.ids.size(); i++)
+      append(rows.ids.at(i), rows.text.at(i), rows.codes.at(i));
+  }
 
   setId(selected);
 
@@ -1414,12 +1401,6 @@ void XComboBox::populate(XSqlQuery pQuery, int pSelected)
   }
 }
 
-void XComboBox::populate(const QString & pSql, int pSelected)
-{
-  XSqlQuery query(pSql);
-  populate(query, pSelected);
-}
-
 void XComboBox::append(int pId, const QString &pText)
 {
   append(pId,pText,pText);
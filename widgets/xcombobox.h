@@ -23,6 +23,7 @@ class QMouseEvent;
 class QWheelEvent;
 class QScriptEngine;
 class XComboBoxPrivate;
+struct XComboBoxRows;
 class XDataWidgetMapper;
 
 class XTUPLEWIDGETS_EXPORT XComboBox : public QComboBox
@@ -167,6 +168,7 @@ class XTUPLEWIDGETS_EXPORT XComboBox : public QComboBox
   protected:
     QString      currentDefault();
     void         mousePressEvent(QMouseEvent *);
+    void         populate(const XComboBoxRows &rows, int pSelected = -1);
     void         wheelEvent(QWheelEvent *);
 
     bool              _allowNull;
@@ -0,0 +1,163 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xcomboboxcache.h"
+
+#include <QApplication>
+#include <QSqlRecord>
+#include <QTimer>
+
+#include <metasql.h>
+#include <xsqlquery.h>
+
+#include "xcomboboxprivate.h"
+
+#define DEBUG false
+
+#define TYPEPREFIX QString("#type ")
+
+static XComboBoxCache *_cache = 0;
+
+XComboBoxCache::XComboBoxCache(QObject *pParent)
+  : XCachedHash<QString, XComboBoxRowsPtr>(pParent, QStringList()),
+    _expiring(false)
+{
+  if (XComboBox::_guiClientInterface)
+    connect(XComboBox::_guiClientInterface, SIGNAL(dbConnectionLost()), this, SLOT(sConnectionLost()));
+}
+
+XComboBoxCache *XComboBoxCache::cache()
+{
+  if (! _cache)
+    _cache = new XComboBoxCache(qApp);
+  return _cache;
+}
+
+/* the rows for a type. they're null if the query failed */
+XComboBoxRowsPtr XComboBoxCache::rows(XComboBox::XComboBoxTypes type)
+{
+  return value(TYPEPREFIX + QString::number(type));
+}
+
+/* forget a type's rows, e.g. because the caller just changed them and the
+   notification saying so hasn't arrived yet
+ */
+void XComboBoxCache::invalidate(XComboBox::XComboBoxTypes type)
+{
+  QString key = TYPEPREFIX + QString::number(type);
+  remove(key);
+  _noticesByKey.remove(key);
+  _transient.remove(key);
+}
+
+XComboBoxRowsPtr XComboBoxCache::fromQuery(XSqlQuery &query)
+{
+  QSharedPointer<XComboBoxRows> rows(new XComboBoxRows);
+  QSet<int> seen;
+  bool      hasCode = query.record().count() >= 3;
+
+  // strange if/loop construct lets multiple comboboxes share a query instance
+  if (query.first())
+    do
+    {
+      int id = query.value(0).toInt();
+      if (seen.contains(id))
+        continue;
+      seen.insert(id);
+
+      QString text = query.value(1).toString();
+      rows->ids.append(id);
+      rows->text.append(text);
+      rows->codes.append(hasCode ? query.value(2).toString() : text);
+      if (id == -1)
+        rows->hasNullId = true;
+    } while (query.next());
+
+  return rows;
+}
+
+void XComboBoxCache::clear()
+{
+  XCachedHash<QString, XComboBoxRowsPtr>::clear();
+  _noticesByKey.clear();
+  _transient.clear();
+}
+
+bool XComboBoxCache::refresh(const QString &key)
+{
+  if (! key.startsWith(TYPEPREFIX))
+    return false;
+
+  XComboBox::XComboBoxTypes type = (XComboBox::XComboBoxTypes)key.mid(TYPEPREFIX.length()).toInt();
+  XComboBoxDescrip *descrip = XComboBoxPrivate::typeDescrip.value(type);
+  if (! descrip)
+    return false;
+
+  if (descrip->query.lastQuery().isEmpty())   // the db wasn't open when the descrip was made
+    descrip->query = MetaSQLQuery(descrip->queryStr).toQuery(descrip->params, QSqlDatabase(), false);
+  if (! descrip->query.exec())
+    return false;
+
+  keep(key, fromQuery(descrip->query),
+       descrip->notification.split(" ", QString::SkipEmptyParts));
+  descrip->query.finish();
+  return true;
+}
+
+void XComboBoxCache::keep(const QString &key, XComboBoxRowsPtr rows, const QStringList &notices)
+{
+  if (DEBUG)
+    qDebug("XComboBoxCache::keep(%s) %d rows, notices %s", qPrintable(key.left(64)),
+           rows->ids.size(), qPrintable(notices.join(" ")));
+
+  insert(key, rows);
+  if (notices.isEmpty())
+  {
+    _transient.insert(key);
+    if (! _expiring)
+    {
+      _expiring = true;
+      QTimer::singleShot(0, this, SLOT(sExpire()));
+    }
+    return;
+  }
+
+  _noticesByKey.insert(key, notices);
+  QStringList added;
+  foreach (QString notice, notices)
+    if (! _notice.contains(notice))
+      added << notice;
+  if (! added.isEmpty())
+    setNotification(added);
+}
+
+void XComboBoxCache::sExpire()
+{
+  _expiring = false;
+  foreach (QString key, _transient)
+    remove(key);
+  _transient.clear();
+}
+
+/* drop just the rows that depend on the table that changed */
+void XComboBoxCache::sNotified(const QString &pNotification)
+{
+  QStringList stale;
+  QHash<QString, QStringList>::const_iterator it;
+  for (it = _noticesByKey.constBegin(); it != _noticesByKey.constEnd(); ++it)
+    if (it.value().contains(pNotification))
+      stale << it.key();
+
+  foreach (QString key, stale)
+  {
+    remove(key);
+    _noticesByKey.remove(key);
+  }
+}
@@ -0,0 +1,84 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __XCOMBOBOXCACHE_H__
+#define __XCOMBOBOXCACHE_H__
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+#include "xcachedhash.h"
+#include "xcombobox.h"
+
+class XSqlQuery;
+
+/* The rows of one XComboBox query, ready to hand to a combo box.
+   Duplicate ids have already been dropped, the way XComboBox::append()
+   would have, so the lists can be shared with the combo as they are.
+ */
+struct XComboBoxRows
+{
+  XComboBoxRows() : hasNullId(false) { }
+
+  QList<int>  ids;
+  QStringList text;
+  QStringList codes;
+  bool        hasNullId;  // one of the ids is -1, the id of the null item
+};
+
+typedef QSharedPointer<const XComboBoxRows> XComboBoxRowsPtr;
+
+/* XComboBoxCache keeps the results of the queries behind XComboBoxTypes
+   so every combo box of the same type, in every open window, shares one
+   copy of the rows instead of running the query again. A type's rows are
+   dropped when one of the notifications in its XComboBoxDescrip arrives.
+   Types without notifications are only kept until control returns to the
+   event loop: long enough for the combos of one window to share a query
+   but not long enough to go stale. Ad hoc query text passed to
+   XComboBox::populate() isn't cached; callers often run it again right
+   after changing the rows it reads.
+ */
+class XComboBoxCache : public XCachedHash<QString, XComboBoxRowsPtr>
+{
+  Q_OBJECT
+
+  public:
+    static XComboBoxCache *cache();
+
+    XComboBoxRowsPtr rows(XComboBox::XComboBoxTypes type);
+    void             invalidate(XComboBox::XComboBoxTypes type);
+
+    static XComboBoxRowsPtr fromQuery(XSqlQuery &query);
+
+  public slots:
+    virtual void sNotified(const QString &pNotification);
+
+  protected:
+    XComboBoxCache(QObject *pParent = 0);
+
+    virtual void clear();
+    virtual bool refresh(const QString &key);
+
+  protected slots:
+    virtual void sExpire();
+
+  private:
+    void keep(const QString &key, XComboBoxRowsPtr rows, const QStringList &notices);
+
+    QHash<QString, QStringList> _noticesByKey;
+    QSet<QString>               _transient;
+    bool                        _expiring;
+};
+
+#endif
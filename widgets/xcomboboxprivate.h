@@ -34,19 +34,11 @@ class XComboBoxDescrip : public QObject
     QString                   uiName;
     QString                   privilege;
     QString                   queryStr;
-    bool                      isDirty;
     bool                      isEditable;
     QString                   notification;
 
     ParameterList             params;
-    XSqlQuery                 query;
-
-  public slots:
-    virtual void sDbConnectionLost();
-    virtual void sListen();
-
-  protected slots:
-    virtual void sNotified(const QString &pNotification);
+    XSqlQuery                 query;    // run by XComboBoxCache
 };
 
 class XComboBoxPrivate : public QObject
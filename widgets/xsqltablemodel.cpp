@@ -14,6 +14,7 @@
 #include <QSqlField>
 #include <QSqlIndex>
 #include <QSqlRelation>
+#include <QSqlResult>
 #include <QtScript>
 
 #include "format.h"
@@ -22,6 +23,48 @@
 
 #define DEBUG false
 
+// parent keys per query when loading a child node
+#define LOADKEYS 1000
+
+/* a result set kept in memory, so a model can show rows that were
+   fetched for it along with rows for other models.
+ */
+class XSqlRecordResult : public QSqlResult
+{
+  public:
+    XSqlRecordResult(const QSqlDriver *driver, const QSqlRecord &record,
+                     const QList<QSqlRecord> &rows)
+      : QSqlResult(driver),
+        _record(record),
+        _rows(rows)
+    {
+      setSelect(true);
+      setActive(true);
+      setAt(QSql::BeforeFirstRow);
+    }
+
+  protected:
+    QVariant   data(int i)                 { return _rows.at(at()).value(i); }
+    bool       isNull(int i)               { return _rows.at(at()).isNull(i); }
+    bool       reset(const QString &)      { return false; }
+    bool       fetchFirst()                { return fetch(0); }
+    bool       fetchLast()                 { return fetch(_rows.count() - 1); }
+    int        size()                      { return _rows.count(); }
+    int        numRowsAffected()           { return 0; }
+    QSqlRecord record() const              { return _record; }
+    bool       fetch(int i)
+    {
+      if (i < 0 || i >= _rows.count())
+        return false;
+      setAt(i);
+      return true;
+    }
+
+  private:
+    QSqlRecord        _record;
+    QList<QSqlRecord> _rows;
+};
+
 XSqlTableNode::XSqlTableNode(const QString tableName, ParameterList relations, XSqlTableNode *parent)
     : QObject(parent)
 {
@@ -62,71 +105,236 @@ XSqlTableNode* XSqlTableNode::child(const QString &tableName)
   return 0;
 }
 
+/*! Returns the model holding this node's rows for the given row of the
+    parent model. Rows are fetched a whole level at a time by load(), so
+    the model is only built from memory the first time it is asked for.
+*/
 XSqlTableModel* XSqlTableNode::model(XSqlTableModel* parent, int row)
 {
   QPair<XSqlTableModel*, int> key;
   key.first = parent;
   key.second = row;
-  return _modelMap.value(key);
+  if (_modelMap.contains(key) || ! parent || row < 0 || row >= parent->rowCount())
+    return _modelMap.value(key);
+
+  QString rkey = rowKey(parent->record(row), false);
+  if (rkey.isNull() || ! _rows.contains(rkey))
+    return 0;
+
+  XSqlTableModel* cmodel = new XSqlTableModel(this);
+  cmodel->setTable(_tableName);
+  ParameterList cparams = XSqlTableModel::buildParams(parent, row, _relations);
+  cmodel->setFilter(XSqlTableModel::buildFilter(cparams));
+  cmodel->setRecords(_record, _rows.value(rkey));
+  _modelMap.insert(key, cmodel);
+
+  return cmodel;
 }
 
 /*! Clears the model map of the current node and recursively clears all child nodes */
 void XSqlTableNode::clear()
 {
   for (int n = 0; n < _children.count(); n++)
-  {
     _children.at(n)->clear();
-    _modelMap.clear();
+
+  qDeleteAll(_modelMap);
+  _modelMap.clear();
+  _rows.clear();
+  _record = QSqlRecord();
+}
+
+/*! Drops the models built for the given row of the parent model, or for
+    all of its rows if row is negative, and everything below them.
+*/
+void XSqlTableNode::forget(XSqlTableModel *parent, int row)
+{
+  QMutableMapIterator<QPair<XSqlTableModel*, int>, XSqlTableModel* > i(_modelMap);
+  while (i.hasNext())
+  {
+    i.next();
+    if (i.key().first != parent || (row >= 0 && i.key().second != row))
+      continue;
+
+    XSqlTableModel* cmodel = i.value();
+    i.remove();
+    for (int n = 0; n < _children.count(); n++)
+      _children.at(n)->forget(cmodel);
+    delete cmodel;
+  }
+}
+
+/* the values relating a row of this node to a row of its parent, as a
+   hash key. local picks this node's columns, otherwise the parent's.
+   returns a null string if any value is null since that cannot match.
+ */
+QString XSqlTableNode::rowKey(const QSqlRecord &record, bool local) const
+{
+  QString key("");
+  for (int i = 0; i < _relations.count(); i++)
+  {
+    QString column = local ? _relations.at(i).name()
+                           : _relations.at(i).value().toString();
+    if (record.isNull(column))
+      return QString();
+    if (i > 0)
+      key.append(QChar(0x1f));
+    key.append(record.value(column).toString());
   }
+  return key;
 }
 
 void XSqlTableNode::load(QPair<XSqlTableModel*, int> key)
 {
   XSqlTableModel* pmodel = key.first;
   int row = key.second;
+  if (! pmodel || row < 0 || row >= pmodel->rowCount())
+    return;
 
-  // Loop through each node and create a model parent model/row passed
+  QList<QSqlRecord> parents;
+  parents.append(pmodel->record(row));
   for (int n = 0; n < _children.count(); n++)
   {
     XSqlTableNode* node = _children.at(n);
+    node->forget(pmodel, row);
+    node->load(parents);
+  }
+}
 
-    XSqlTableModel* cmodel = new XSqlTableModel();
-    cmodel->setTable(_tableName);
-    ParameterList cparams = XSqlTableModel::buildParams(pmodel, row, _relations);
-    cmodel->setFilter(XSqlTableModel::buildFilter(cparams));
-    cmodel->select();
-    node->modelMap().insert(key, cmodel);
-
-    // Cascade recursively
-    QPair<XSqlTableModel*, int> ckey;
-    ckey.first = cmodel;
-    for (int r = 0; r < cmodel->rowCount(); r++)
+/*! Fetches this node's rows for all of the given parent rows with one
+    query per batch of parent keys instead of one query per parent row,
+    sorts them by parent in memory, then does the same for the child nodes
+    using all of the rows just fetched as their parents.
+*/
+void XSqlTableNode::load(const QList<QSqlRecord> &parents)
+{
+  QStringList keys;
+  QStringList tuples;
+  QSqlDriver *driver = QSqlDatabase::database().driver();
+  for (int p = 0; p < parents.count(); p++)
+  {
+    QString key = rowKey(parents.at(p), false);
+    if (key.isNull() || keys.contains(key))
+      continue;
+    keys.append(key);
+
+    QStringList values;
+    for (int i = 0; i < _relations.count(); i++)
     {
-      key.second = r;
-      node->load(ckey);
+      QString column = _relations.at(i).value().toString();
+      QSqlField field(column, parents.at(p).field(column).type());
+      field.setValue(parents.at(p).value(column));
+      values.append(driver->formatValue(field));
     }
+    tuples.append(values.count() == 1 ? values.first()
+                                      : values.join(", ").prepend("(").append(")"));
   }
+
+  if (keys.isEmpty())
+    return;
+
+  QStringList columns;
+  for (int i = 0; i < _relations.count(); i++)
+    columns.append(_relations.at(i).name());
+  QString match = columns.count() == 1 ? columns.first()
+                                       : columns.join(", ").prepend("(").append(")");
+
+  XSqlTableModel tmpl;
+  tmpl.setTable(_tableName);
+
+  QList<QSqlRecord> fetched;
+  for (int k = 0; k < keys.count(); k += LOADKEYS)
+  {
+    QString filter = QString("%1 IN (%2)")
+                       .arg(match, QStringList(tuples.mid(k, LOADKEYS)).join(", "));
+    tmpl.setFilter(filter);
+
+    XSqlQuery qry;
+    qry.setForwardOnly(true);
+    qry.exec(tmpl.selectStatement());
+    if (qry.lastError().type() != QSqlError::NoError)
+    {
+      qWarning("XSqlTableNode::load() %s: %s", qPrintable(_tableName),
+               qPrintable(qry.lastError().text()));
+      return;
+    }
+    _record = qry.record();
+    for (int i = k; i < keys.count() && i < k + LOADKEYS; i++)
+      _rows.insert(keys.at(i), QList<QSqlRecord>());
+    while (qry.next())
+    {
+      QSqlRecord record = qry.record();
+      _rows[rowKey(record, true)].append(record);
+      fetched.append(record);
+    }
+  }
+
+  if (DEBUG)
+    qDebug("XSqlTableNode::load() %s: %d rows for %d parents", qPrintable(_tableName),
+           fetched.count(), keys.count());
+
+  for (int n = 0; n < _children.count(); n++)
+    _children.at(n)->load(fetched);
 }
 
-/* Saves the current model to the database*/
-bool XSqlTableNode::save()
+/* queue the changes to every model on this node and below it, parents
+   first, so they can go to the server together.
+ */
+bool XSqlTableNode::submit(QStringList &statements, QList<XSqlTableModel*> &submitted)
 {
-  // Submit all models on this node
   QMapIterator<QPair<XSqlTableModel*, int>, XSqlTableModel* > i(_modelMap);
   while (i.hasNext())
   {
     i.next();
-    if (!i.value()->submitAll())
+    if (! i.value()->isDirty())
+      continue;
+    if (! i.value()->submitBatch(statements))
       return false;
+    submitted.append(i.value());
   }
 
-  // Save child nodes
   for (int n = 0; n < _children.count(); n++)
   {
-    if (!_children.at(n)->save())
+    if (! _children.at(n)->submit(statements, submitted))
+      return false;
+  }
+
+  return true;
+}
+
+/* Saves the current model to the database. Unchanged models are skipped
+   and the changes to the others are sent in one round trip. this runs in
+   XSqlTableModel::save()'s transaction, so the statements go inside a
+   savepoint; if they fail it's rolled back and the models get their
+   changes back, still pending, so the user can fix them and try again.
+ */
+bool XSqlTableNode::save()
+{
+  QStringList statements;
+  QList<XSqlTableModel*> submitted;
+  if (! submit(statements, submitted))
+    return false;
+
+  if (! statements.isEmpty())
+  {
+    XSqlQuery saveq;
+    saveq.exec(statements.join(";\n")
+                         .prepend("SAVEPOINT xsqltablenode;\n")
+                         .append(";\nRELEASE SAVEPOINT xsqltablenode;"));
+    if (saveq.lastError().type() != QSqlError::NoError)
+    {
+      qWarning("XSqlTableNode::save() %s: %s", qPrintable(_tableName),
+               qPrintable(saveq.lastError().text()));
+      saveq.exec("ROLLBACK TO SAVEPOINT xsqltablenode;"
+                 "RELEASE SAVEPOINT xsqltablenode;");
+      for (int m = 0; m < submitted.count(); m++)
+        submitted.at(m)->restoreBatch();
       return false;
+    }
   }
 
+  for (int m = 0; m < submitted.count(); m++)
+    submitted.at(m)->select();
+
   return true;
 }
 
@@ -134,7 +342,8 @@ bool XSqlTableNode::save()
 
 
 XSqlTableModel::XSqlTableModel(QObject *parent) :
-  QSqlRelationalTableModel(parent)
+  QSqlRelationalTableModel(parent),
+  _batch(0)
 {
   _locales << "money" << "qty" << "curr" << "percent" << "cost" << "qtyper"
     << "salesprice" << "purchprice" << "uomratio" << "extprice" << "weight";
@@ -148,6 +357,9 @@ XSqlTableModel::~XSqlTableModel()
 bool XSqlTableModel::select()
 {
   if (DEBUG) qDebug("selecting ");
+  if (_batch)
+    return true;        // submitBatch() - the changes haven't been sent yet
+
   bool result;
   result = QSqlRelationalTableModel::select();
   applyColumnRoles();
@@ -156,6 +368,178 @@ bool XSqlTableModel::select()
   return result;
 }
 
+bool XSqlTableModel::selectRow(int row)
+{
+  if (_batch)
+    return true;
+
+  return QSqlRelationalTableModel::selectRow(row);
+}
+
+/* show rows already fetched elsewhere instead of selecting them. the
+   filter is left alone so the next select() gets the same rows.
+ */
+void XSqlTableModel::setRecords(const QSqlRecord &record, const QList<QSqlRecord> &rows)
+{
+  QSqlRelationalTableModel::setQuery(QSqlQuery(new XSqlRecordResult(database().driver(),
+                                                                    record, rows)));
+  applyColumnRoles();
+}
+
+/* submit all pending changes, but append the statements to the list
+   instead of executing them. the caller must run them and then select().
+ */
+bool XSqlTableModel::submitBatch(QStringList &statements)
+{
+  _batchChanges.clear();
+  _batch = &statements;
+  bool result = submitAll();
+  _batch = 0;
+  return result;
+}
+
+/* the statements from submitBatch() failed but submitAll() has already
+   marked the rows clean. select them again and make the same changes so
+   they are pending again.
+ */
+bool XSqlTableModel::restoreBatch()
+{
+  QList<BatchChange> changes = _batchChanges;
+  _batchChanges.clear();
+  if (changes.isEmpty())
+    return true;
+
+  if (! select())
+    return false;
+
+  for (int c = 0; c < changes.count(); c++)
+  {
+    const BatchChange &change = changes.at(c);
+    if (change.type == BatchChange::Insert)
+    {
+      insertRecord(-1, change.values);
+      continue;
+    }
+
+    int row = findRow(change.key);
+    if (row < 0)
+      continue;
+
+    if (change.type == BatchChange::Delete)
+      removeRow(row);
+    else
+    {
+      for (int i = 0; i < change.values.count(); i++)
+      {
+        if (change.values.isGenerated(i))
+          QSqlRelationalTableModel::setData(index(row, fieldIndex(change.values.fieldName(i))),
+                                            change.values.value(i));
+      }
+    }
+  }
+
+  return true;
+}
+
+int XSqlTableModel::findRow(const QSqlRecord &key)
+{
+  while (canFetchMore())
+    fetchMore();
+
+  for (int row = 0; row < rowCount(); row++)
+  {
+    QSqlRecord rec   = record(row);
+    bool       match = true;
+    for (int i = 0; match && i < key.count(); i++)
+      match = (rec.value(key.fieldName(i)) == key.value(i));
+    if (match)
+      return row;
+  }
+
+  return -1;
+}
+
+/* the record names relation columns after their display column, as
+   QSqlRelationalTableModel does before it writes a row. name them after
+   the table's own columns again so the statements can be built here.
+ */
+QSqlRecord XSqlTableModel::tableRecord(const QSqlRecord &values) const
+{
+  QSqlRecord rec(values);
+  QSqlRecord base = database().record(tableName());
+  for (int i = 0; i < rec.count() && i < base.count(); i++)
+  {
+    if (relation(i).isValid())
+    {
+      QVariant value     = rec.value(i);
+      bool     generated = rec.isGenerated(i);
+      rec.replace(i, base.field(i));
+      rec.setValue(i, value);
+      rec.setGenerated(i, generated);
+    }
+  }
+  return rec;
+}
+
+bool XSqlTableModel::deleteRowFromTable(int row)
+{
+  if (! _batch)
+    return QSqlRelationalTableModel::deleteRowFromTable(row);
+
+  emit beforeDelete(row);
+  QSqlDriver *driver = database().driver();
+  QString stmt  = driver->sqlStatement(QSqlDriver::DeleteStatement, tableName(),
+                                       QSqlRecord(), false);
+  QString where = driver->sqlStatement(QSqlDriver::WhereStatement, tableName(),
+                                       primaryValues(row), false);
+  if (stmt.isEmpty() || where.isEmpty())
+    return false;
+
+  BatchChange change = { BatchChange::Delete, primaryValues(row), QSqlRecord() };
+  _batchChanges.append(change);
+  _batch->append(stmt + " " + where);
+  return true;
+}
+
+bool XSqlTableModel::insertRowIntoTable(const QSqlRecord &values)
+{
+  if (! _batch)
+    return QSqlRelationalTableModel::insertRowIntoTable(values);
+
+  QSqlRecord rec(values);
+  emit beforeInsert(rec);
+  QString stmt = database().driver()->sqlStatement(QSqlDriver::InsertStatement,
+                                                   tableName(), tableRecord(rec), false);
+  if (stmt.isEmpty())
+    return false;
+
+  BatchChange change = { BatchChange::Insert, QSqlRecord(), values };
+  _batchChanges.append(change);
+  _batch->append(stmt);
+  return true;
+}
+
+bool XSqlTableModel::updateRowInTable(int row, const QSqlRecord &values)
+{
+  if (! _batch)
+    return QSqlRelationalTableModel::updateRowInTable(row, values);
+
+  QSqlRecord rec(values);
+  emit beforeUpdate(row, rec);
+  QSqlDriver *driver = database().driver();
+  QString stmt  = driver->sqlStatement(QSqlDriver::UpdateStatement, tableName(),
+                                       tableRecord(rec), false);
+  QString where = driver->sqlStatement(QSqlDriver::WhereStatement, tableName(),
+                                       primaryValues(row), false);
+  if (stmt.isEmpty() || where.isEmpty())
+    return false;
+
+  BatchChange change = { BatchChange::Update, primaryValues(row), values };
+  _batchChanges.append(change);
+  _batch->append(stmt + " " + where);
+  return true;
+}
+
 void XSqlTableModel::clear()
 {
   clearChildren();
@@ -479,57 +863,43 @@ void XSqlTableModel::clearChildren()
     _children.at(i)->clear();
 }
 
+/*! Selects this model and loads every child node for all of its rows,
+    with one query per child node rather than one per row.
+*/
 void XSqlTableModel::loadAll()
 {
-  qDebug("filter: %s", qPrintable(buildFilter(_params)));
+  if (DEBUG) qDebug("filter: %s", qPrintable(buildFilter(_params)));
   setFilter(buildFilter(_params));
   if (!query().isActive())
     select();
+  while (canFetchMore())
+    fetchMore();
+
+  QList<QSqlRecord> parents;
+  for (int r = 0; r < rowCount(); r++)
+    parents.append(record(r));
 
-  // Reset all nodes
   for (int n = 0; n < _children.count(); n++)
   {
-    qDebug("clearing node %d", n);
     XSqlTableNode* node = _children.at(n);
-    QList<XSqlTableModel* > mlist;
     node->clear();
-  }
-  // Loop through and reload models for each row
-  for (int r = 0; r < rowCount(); r++)
-  {
-    qDebug("Loading row %d", r);
-    load(r);
+    node->load(parents);
   }
 }
 
 void XSqlTableModel::load(int row)
 {
-  // Loop through each node to create models
+  if (row < 0 || row >= rowCount())
+    return;
+
+  QList<QSqlRecord> parents;
+  parents.append(record(row));
   for (int n = 0; n < _children.count(); n++)
   {
-    qDebug("loading child node %d", n);
+    if (DEBUG) qDebug("loading child node %d", n);
     XSqlTableNode* node = _children.at(n);
-    QPair<XSqlTableModel*, int> key;
-    key.first = this;
-    key.second = row;
-
-    // Generate child model for the row passed
-    XSqlTableModel* model = new XSqlTableModel(this);
-    qDebug("Setting table %s", qPrintable(node->tableName()));
-    model->setTable(node->tableName());
-    ParameterList params = buildParams(this, row, node->relations());
-    qDebug("Filter is %s", qPrintable(buildFilter(params)));
-    model->setFilter(buildFilter(params));
-    model->select();
-    node->modelMap().insert(key, model);
-
-    // Cascade recursively
-    key.first = model;
-    for (int r = 0; r < model->rowCount(); r++)
-    {
-      key.second = r;
-      node->load(key);
-    }
+    node->forget(this, row);
+    node->load(parents);
   }
 }
 
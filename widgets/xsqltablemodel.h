@@ -12,9 +12,11 @@
 #define XSQLTABLEMODEL_H
 
 #include <QHash>
+#include <QList>
 #include <QSize>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QSqlRecord>
 #include <QSqlRelationalTableModel>
 #include <QStringList>
 
@@ -45,12 +47,19 @@ public:
   XSqlTableModel* model(XSqlTableModel* parent = 0, int row = 0);
 
   void clear();
+  void forget(XSqlTableModel *parent, int row = -1);
   void load(QPair<XSqlTableModel*, int> key);
+  void load(const QList<QSqlRecord> &parents);
   bool save();
+  bool submit(QStringList &statements, QList<XSqlTableModel*> &submitted);
 
 private:
+  QString rowKey(const QSqlRecord &record, bool local) const;
+
   ParameterList _relations;
   QMap<QPair<XSqlTableModel*, int>, XSqlTableModel* >_modelMap;
+  QHash<QString, QList<QSqlRecord> > _rows;
+  QSqlRecord _record;
   QList<XSqlTableNode *> _children;
   QString _filter;
   QString _tableName;
@@ -127,6 +136,7 @@ class XSqlTableModel : public QSqlRelationalTableModel
     Q_INVOKABLE void setColumnRole(int column, int role, QVariant value);
     Q_INVOKABLE QVariant formatValue(const QVariant &dataValue, const QVariant &formatValue) const;
     Q_INVOKABLE bool select();
+    Q_INVOKABLE virtual bool selectRow(int row);
     Q_INVOKABLE bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
     Q_INVOKABLE void setKeys(int keyColumns);
 
@@ -154,7 +164,30 @@ class XSqlTableModel : public QSqlRelationalTableModel
     Q_INVOKABLE virtual bool save();
     Q_INVOKABLE virtual QString toString() const;
 
+    void setRecords(const QSqlRecord &record, const QList<QSqlRecord> &rows);
+    bool submitBatch(QStringList &statements);
+    bool restoreBatch();
+
+  protected:
+    virtual bool deleteRowFromTable(int row);
+    virtual bool insertRowIntoTable(const QSqlRecord &values);
+    virtual bool updateRowInTable(int row, const QSqlRecord &values);
+
   private:
+    // a change queued by submitBatch(), kept until the statements succeed
+    struct BatchChange
+    {
+      enum Type { Insert, Update, Delete } type;
+      QSqlRecord key;       // primary values of the changed row
+      QSqlRecord values;
+    };
+
+    int        findRow(const QSqlRecord &key);
+    QSqlRecord tableRecord(const QSqlRecord &values) const;
+
+    QStringList        *_batch;
+    QList<BatchChange>  _batchChanges;
+
     QHash<QPair<QModelIndex, int>, QVariant> roles;
     QMultiHash<int, QPair<QVariant, int> > _columnRoles;
     QList<QString> _locales;
@@ -9,13 +9,39 @@
  */
 
 #include "xtextedit.h"
+#include <QCache>
 #include <QTextCursor>
 #include <QContextMenuEvent>
 #include <QColor>
 
+#define SPELLCACHESIZE 5000
+
 GuiClientInterface* XTextEditHighlighter::_guiClientInterface = 0;
 GuiClientInterface* XTextEdit::_guiClientInterface = 0;
 
+// hunspell_check() results, shared by every XTextEdit. the value is
+// true if the word is misspelled.
+static QCache<QString, bool> _spellCache(SPELLCACHESIZE);
+
+/* word may be raw data borrowed from the text being highlighted, so the
+   cache gets its own copy
+ */
+static bool isMisspelled(GuiClientInterface *gci, const QString &word)
+{
+  bool *cached = _spellCache.object(word);
+  if (cached)
+    return *cached;
+
+  bool misspelled = gci->hunspell_check(word) < 1;
+  _spellCache.insert(QString(word.constData(), word.size()), new bool(misspelled));
+  return misspelled;
+}
+
+static inline bool isWordChar(const QChar &c)
+{
+  return c.isLetterOrNumber() || c.isMark() || c == QLatin1Char('_');
+}
+
 XTextEdit::XTextEdit(QWidget *pParent) :
   QTextEdit(pParent)
 {
@@ -69,9 +95,9 @@ void XTextEdit::contextMenuEvent(QContextMenuEvent *event)
        int end = textBlock.indexOf(QRegExp("\\W+"),pos);
        int begin = textBlock.left(pos).lastIndexOf(QRegExp("\\W+"),pos);
        textBlock = textBlock.mid(begin+1,end-begin-1).trimmed();
-       QStringList wordList = _guiClientInterface->hunspell_suggest(textBlock);
-       if (_guiClientInterface->hunspell_check(textBlock) < 1)
+       if (isMisspelled(_guiClientInterface, textBlock))
        {
+         QStringList wordList = _guiClientInterface->hunspell_suggest(textBlock);
          menu->addSeparator();
 
          (void)menu->addAction(tr("Add Word"), this, SLOT(sAddWord()));
@@ -116,10 +142,18 @@ void XTextEdit::sAddWord()
     int begin = textBlock.left(pos).lastIndexOf(QRegExp("\\W+"),pos);
     textBlock = textBlock.mid(begin+1,end-begin-1);
     _guiClientInterface->hunspell_add(textBlock);
+    _spellCache.clear();
     _highlighter->rehighlight();
 }
 
 
+/* the spelling dictionary changed or finished loading */
+void XTextEdit::recheckSpelling()
+{
+    _spellCache.clear();
+    _highlighter->rehighlight();
+}
+
 void XTextEdit::sIgnoreWord()
 {
     QTextCursor cursor = cursorForPosition(_lastPos);
@@ -129,6 +163,7 @@ void XTextEdit::sIgnoreWord()
     int begin = textBlock.left(pos).lastIndexOf(QRegExp("\\W+"),pos);
     textBlock = textBlock.mid(begin+1,end-begin-1);
     _guiClientInterface->hunspell_ignore(textBlock);
+    _spellCache.clear();
     _highlighter->rehighlight();
 }
 
@@ -136,67 +171,87 @@ void XTextEdit::sIgnoreWord()
 XTextEditHighlighter::XTextEditHighlighter(QObject *parent)
   : QSyntaxHighlighter(parent)
 {
-    HighlightingRule rule;
-    _spellCheckFormat.setUnderlineColor(QColor(Qt::red));
-    _spellCheckFormat.setUnderlineStyle(QTextCharFormat::SpellCheckUnderline);
+    init();
 }
 
 XTextEditHighlighter::XTextEditHighlighter(QTextDocument *document)
   : QSyntaxHighlighter(document)
 {
-    HighlightingRule rule;
-    _spellCheckFormat.setUnderlineColor(QColor(Qt::red));
-    _spellCheckFormat.setUnderlineStyle(QTextCharFormat::SpellCheckUnderline);
+    init();
 }
 
 XTextEditHighlighter::XTextEditHighlighter(QTextEdit *editor)
   : QSyntaxHighlighter(editor)
 {
-    HighlightingRule rule;
+    init();
+}
+
+XTextEditHighlighter::~XTextEditHighlighter()
+{
+}
+
+void XTextEditHighlighter::init()
+{
     _spellCheckFormat.setUnderlineColor(QColor(Qt::red));
     _spellCheckFormat.setUnderlineStyle(QTextCharFormat::SpellCheckUnderline);
+
+    _spellPref = false;
+    if (_x_preferences)
+    {
+      _spellPref = (_x_preferences->value("SpellCheck")=="t");
+      connect(_x_preferences, SIGNAL(loaded()), this, SLOT(sPreferencesLoaded()));
+    }
 }
 
-XTextEditHighlighter::~XTextEditHighlighter()
+void XTextEditHighlighter::sPreferencesLoaded()
 {
+    bool spellPref = (_x_preferences->value("SpellCheck")=="t");
+    if (spellPref != _spellPref)
+    {
+      _spellPref = spellPref;
+      rehighlight();
+    }
 }
 
+/* QSyntaxHighlighter only calls this for the blocks that changed. words
+   are found in one pass and checked against the shared cache before
+   bothering hunspell.
+ */
 void XTextEditHighlighter::highlightBlock(const QString &text)
 {
     XTextEdit* textEdit = qobject_cast<XTextEdit *>(this->parent());
 
-    bool enableSpellPref = false;
-    if(_x_preferences)
-       enableSpellPref = (_x_preferences->value("SpellCheck")=="t");
-
-    if(_guiClientInterface && _guiClientInterface->hunspell_ready()
-       && enableSpellPref
+    if(_spellPref
+       && _guiClientInterface && _guiClientInterface->hunspell_ready()
        && textEdit && textEdit->spellEnabled()
        && textEdit->isEnabled() && !textEdit->isReadOnly())
     {
-      QString widgetText = text.simplified();
-      if (!widgetText.isEmpty())
+      const QChar *data = text.constData();
+      int          length = text.length();
+      int          pos = 0;
+      while (pos < length)
       {
-         QStringList widgetWords = widgetText.split(QRegExp("([^\\w,^\\\\]|(?=\\\\))+"),
-                                                       QString::SkipEmptyParts);
-         foreach(QString word, widgetWords)
-         {            
-            if (word.length() > 1 && !word.startsWith('\\'))
-            {
-                if (_guiClientInterface->hunspell_check(word) < 1)
-                {
-                   int wordCount = text.count(QRegExp("\\b" + word + "\\b"));
-                   //loop through all repeated words in Line Edit
-                   int wordStartPos=-1;
-                   for (int repeatCount=0;repeatCount < wordCount; ++repeatCount)
-                   {
-                     wordStartPos = text.indexOf(QRegExp("\\b" + word + "\\b"),wordStartPos+1);
-                     if (wordStartPos>=0)
-                         setFormat(wordStartPos, word.length(), _spellCheckFormat);
-                   }
-                }
-             }
-          }
-       }
-    }   
+        if (!isWordChar(data[pos]))
+        {
+          // skip escapes like \n along with the text they're attached to
+          if (data[pos] == QLatin1Char('\\'))
+            while (++pos < length && isWordChar(data[pos]))
+              ;
+          else
+            pos++;
+          continue;
+        }
+
+        int start = pos;
+        while (pos < length && isWordChar(data[pos]))
+          pos++;
+
+        if (pos - start > 1)
+        {
+          QString word = QString::fromRawData(data + start, pos - start);
+          if (isMisspelled(_guiClientInterface, word))
+            setFormat(start, pos - start, _spellCheckFormat);
+        }
+      }
+    }
 }
@@ -46,6 +46,7 @@ class XTUPLEWIDGETS_EXPORT XTextEdit : public QTextEdit
     virtual void setFieldName(QString p) { _fieldName = p; };
     virtual void updateMapperData();
     virtual void setSpellEnable(bool p)  { _spellStatus = p; }
+    virtual void recheckSpelling();
 
   private slots:
     void contextMenuEvent(QContextMenuEvent *event);
@@ -79,7 +80,14 @@ public:
 protected:
     virtual void highlightBlock(const QString &text);
 
+private slots:
+    void sPreferencesLoaded();
+
 private:
+    void init();
+
+    bool _spellPref;
+
     struct HighlightingRule
      {
         QRegExp _pattern;
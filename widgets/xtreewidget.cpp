@@ -19,6 +19,7 @@
 #include <QDate>
 #include <QDateTime>
 #include <QDrag>
+#include <QFile>
 #include <QFileDialog>
 #include <QFont>
 #include <QHeaderView>
@@ -26,7 +27,10 @@
 #include <QMimeData>
 #include <QMouseEvent>
 #include <QProgressBar>
+#include <QProgressDialog>
 #include <QPushButton>
+#include <QScrollBar>
+#include <QSet>
 #include <QSqlError>
 #include <QSqlRecord>
 #include <QTextCharFormat>
@@ -37,12 +41,16 @@
 #include <QTextTable>
 #include <QTextTableCell>
 #include <QTextTableFormat>
+#include <QTreeWidgetItemIterator>
 #include <QtScript>
 #include <QMessageBox>
 #include <QInputDialog>
 #include <QDesktopServices>
 
+#include "xtreewidgetexporter.h"
 #include "xtreewidgetprogress.h"
+#include "xtreewidgetsearchindex.h"
+#include "xtreewidgetsorter.h"
 #include "xtsettings.h"
 #include "xsqlquery.h"
 #include "format.h"
@@ -53,28 +61,6 @@
 #define WORKERINTERVAL 0
 #define WORKERROWS     500
 
-/* make sure the colroles are kept in sync with
-   QStringList knownroles in populate() below,
-   both in count and order
-   */
-#define COLROLE_DISPLAY       0
-#define COLROLE_TEXTALIGNMENT 1
-#define COLROLE_BACKGROUND    2
-#define COLROLE_FOREGROUND    3
-#define COLROLE_TOOLTIP       4
-#define COLROLE_STATUSTIP     5
-#define COLROLE_FONT          6
-#define COLROLE_KEY           7
-#define COLROLE_RUNNING       8
-#define COLROLE_RUNNINGINIT   9
-#define COLROLE_GROUPRUNNING  10
-#define COLROLE_TOTAL         11
-#define COLROLE_NUMERIC       12
-#define COLROLE_NULL          13
-#define COLROLE_ID            14
-// make sure COLROLE_COUNT = last COLROLE + 1
-#define COLROLE_COUNT         15
-
 #define yesStr QObject::tr("Yes")
 #define noStr  QObject::tr("No")
 
@@ -114,6 +100,9 @@ XTreeWidget::XTreeWidget(QWidget *pParent) :
   _savedId = false; // was -1;
   _linear  = false;
   _alwaysLinear = true;
+  _streaming    = false;
+  _merging      = false;
+  _mergePos     = -1;
 
   _colIdx     = 0;  // querycol = _colIdx[xtreecol]
   _colRole    = 0;  // querycol = _colRole[xtreecol][roleid]
@@ -122,6 +111,7 @@ XTreeWidget::XTreeWidget(QWidget *pParent) :
   for (int i = 0; i < ROWROLE_COUNT; i++)
     _rowRole[i] = 0;
   _progress = 0;
+  _searchIndex = 0;
   _subtotals = 0;
 
   setUniformRowHeights(true); //#13439 speed improvement if all rows are known to be the same height
@@ -238,12 +228,15 @@ void XTreeWidget::populate(XSqlQuery pQuery, bool pUseAltId, PopulateStyle popst
 void XTreeWidget::populate(XSqlQuery pQuery, int pIndex, bool pUseAltId, PopulateStyle popstyle)
 {
   XTreeWidgetPopulateParams args;
-  args._workingQuery     = pQuery;
+  args._workingRows      = XTreeWidgetRows(pQuery);
   args._workingIndex     = pIndex;
   args._workingUseAlt    = pUseAltId;
+  args._workingMore      = false;
+  args._workingContinued = false;
   args._workingPopstyle  = popstyle;
 
   pQuery.seek(-1);
+  _streaming = false;
 
   if (popstyle == Replace)
   {
@@ -259,6 +252,125 @@ void XTreeWidget::populate(XSqlQuery pQuery, int pIndex, bool pUseAltId, Populat
     _workingTimer.start(WORKERINTERVAL);
 }
 
+/* Populate from one batch of a result that is being fetched elsewhere,
+   for example by a BackgroundQuery. Pass pMore = true for every batch
+   but the last; rows keep their indentation, running totals and
+   subtotals across batches, and calculated columns, sorting and the
+   populated() signal wait for the batch with pMore = false, which may
+   be empty. The first batch should use Replace and the rest Append, or
+   every batch Merge or Update.
+ */
+void XTreeWidget::populate(const QList<QSqlRecord> &pRecords, int pIndex,
+                           bool pUseAltId, PopulateStyle popstyle, bool pMore)
+{
+  XTreeWidgetPopulateParams args;
+  args._workingRows      = XTreeWidgetRows(pRecords);
+  args._workingIndex     = pIndex;
+  args._workingUseAlt    = pUseAltId;
+  args._workingMore      = pMore;
+  args._workingContinued = (popstyle != Replace && _streaming);
+  args._workingPopstyle  = popstyle;
+
+  _streaming = pMore;
+
+  if (popstyle == Replace)
+  {
+    clear();
+    _workingParams.clear();
+  }
+  _workingParams.append(args);
+
+  _linear = _alwaysLinear;
+  if (_linear)
+    populateWorker();
+  else if (! _workingTimer.isActive())
+    _workingTimer.start(WORKERINTERVAL);
+}
+
+XTreeWidgetRows::XTreeWidgetRows()
+{
+}
+
+XTreeWidgetRows::XTreeWidgetRows(XSqlQuery pQuery)
+  : _query(pQuery)
+{
+}
+
+XTreeWidgetRows::XTreeWidgetRows(const QList<QSqlRecord> &pRecords)
+  : _records(new Records)
+{
+  _records->rows = pRecords;
+  _records->at   = QSql::BeforeFirstRow;
+}
+
+int XTreeWidgetRows::at() const
+{
+  return _records ? _records->at : _query.at();
+}
+
+int XTreeWidgetRows::count() const
+{
+  if (! _records)
+    return _query.record().count();
+  return _records->rows.isEmpty() ? 0 : _records->rows.first().count();
+}
+
+int XTreeWidgetRows::size() const
+{
+  return _records ? _records->rows.size() : _query.size();
+}
+
+bool XTreeWidgetRows::first()
+{
+  return _records ? seek(0) : _query.first();
+}
+
+bool XTreeWidgetRows::next()
+{
+  if (! _records)
+    return _query.next();
+  if (_records->at == QSql::AfterLastRow)
+    return false;
+  return seek(_records->at + 1);
+}
+
+bool XTreeWidgetRows::seek(int pRow)
+{
+  if (! _records)
+    return _query.seek(pRow);
+
+  if (pRow < 0)
+  {
+    _records->at = QSql::BeforeFirstRow;
+    return false;
+  }
+  if (pRow >= _records->rows.size())
+  {
+    _records->at = QSql::AfterLastRow;
+    return false;
+  }
+  _records->at = pRow;
+  return true;
+}
+
+QSqlRecord XTreeWidgetRows::record() const
+{
+  if (! _records)
+    return _query.record();
+  if (_records->at >= 0)
+    return _records->rows.at(_records->at);
+  return _records->rows.isEmpty() ? QSqlRecord() : _records->rows.first();
+}
+
+QVariant XTreeWidgetRows::value(int pField) const
+{
+  if (! _records)
+    return _query.value(pField);
+  if (_records->at < 0)
+    return QVariant();
+  return _records->rows.at(_records->at).value(pField);
+}
+
 void XTreeWidget::populateWorker()
 {
   if (_workingParams.isEmpty())
@@ -270,12 +382,13 @@ void XTreeWidget::populateWorker()
   }
 
   XTreeWidgetPopulateParams args = _workingParams.first();
-  XSqlQuery     pQuery     = args._workingQuery;
+  XTreeWidgetRows pQuery   = args._workingRows;
   int           pIndex     = args._workingIndex;
   bool          pUseAltId  = args._workingUseAlt;
   //PopulateStyle popstyle   = args._workingPopstyle;
 
   QList<XTreeWidgetItem*> topLevelItems; //#13439
+  bool merging = (args._workingPopstyle == Merge || args._workingPopstyle == Update);
 
   if (_linear)
     qApp->setOverrideCursor(Qt::WaitCursor);
@@ -311,9 +424,12 @@ void XTreeWidget::populateWorker()
 
   /* initialize if we haven't started reading data from the query,
      taking into account that some places call xsqlquery::first() before
-     xtreewidget::populate()
+     xtreewidget::populate(). the next batch of a streamed result picks
+     up where the last one stopped.
    */
-  if (pQuery.at() == QSql::BeforeFirstRow || (pQuery.at() == 0 && ! _colIdx))
+  if (args._workingContinued && _colIdx && pQuery.at() == QSql::BeforeFirstRow)
+    pQuery.first();
+  else if (pQuery.at() == QSql::BeforeFirstRow || (pQuery.at() == 0 && ! _colIdx))
   {
     if (pQuery.first())
     {
@@ -337,91 +453,10 @@ void XTreeWidget::populateWorker()
 
       QSqlRecord  currRecord = pQuery.record();
 
-      // apply indent, hidden and delete roles to col 0 if the caller requested them
-      // keep synchronized with #define ROWROLE_* above
-      if (rootIsDecorated())
-      {
-        _rowRole[ROWROLE_INDENT] = currRecord.indexOf("xtindentrole");
-        if (_rowRole[ROWROLE_INDENT] < 0)
-          _rowRole[ROWROLE_INDENT] = 0;
-      }
-      else
-        _rowRole[ROWROLE_INDENT] = 0;
-
-      _rowRole[ROWROLE_HIDDEN] = currRecord.indexOf("xthiddenrole");
-      if (_rowRole[ROWROLE_HIDDEN] < 0)
-        _rowRole[ROWROLE_HIDDEN] = 0;
-
-      _rowRole[ROWROLE_DELETED] = currRecord.indexOf("xtdeletedrole");
-      if (_rowRole[ROWROLE_DELETED] < 0)
-        _rowRole[ROWROLE_DELETED] = 0;
-
-      // keep synchronized with #define COLROLE_* above
-      // TODO: get rid of COLROLE_* above and replace this QStringList
-      // with a map or vector of known roles and their Qt:: role or Xt
-      // enum values
-      QStringList knownroles;
-      knownroles << "qtdisplayrole"      << "qttextalignmentrole"<<
-      "qtbackgroundrole"   << "qtforegroundrole"<<
-      "qttooltiprole"      << "qtstatustiprole"<<
-      "qtfontrole" << "xtkeyrole"<<
-      "xtrunningrole"      << "xtrunninginit"<<
-      "xtgrouprunningrole" << "xttotalrole"<<
-      "xtnumericrole" << "xtnullrole"<<
-      "xtidrole";
-      for (int wcol = 0; wcol < _roles.size(); wcol++)
-      {
-        QVariantMap *role = _roles.value(wcol);
-        if (!role)
-        {
-          qWarning("XTreeWidget::populate() there is no role for column %d", wcol);
-          continue;
-        }
-        QString colname = role->value("qteditrole").toString();
-        (*_colIdx)[wcol] = currRecord.indexOf(colname);
+      mapColumnRoles(currRecord, *_colIdx, *_colRole, _rowRole);
 
-        for (int k = 0; k < knownroles.size(); k++)
-        {
-          // apply Qt roles to a whole row by applying to each column
-          (*_colRole)[wcol][k] = knownroles.at(k).startsWith("qt") ?
-                             currRecord.indexOf(knownroles.at(k)) :
-                             0;
-          if ((*_colRole)[wcol][k] > 0)
-          {
-            role->insert(knownroles.at(k),
-                          QString(knownroles.at(k)));
-          }
-          else
-            (*_colRole)[wcol][k] = 0;
-
-          // apply column-specific roles second to override entire row settings
-          if (currRecord.indexOf(colname + "_" + knownroles.at(k)) >=0)
-          {
-            (*_colRole)[wcol][k] = currRecord.indexOf(colname + "_" + knownroles.at(k));
-            role->insert(knownroles.at(k),
-                          QString(colname + "_" + knownroles.at(k)));
-            if (knownroles.at(k) == "xtrunningrole")
-              headerItem()->setData(wcol, Qt::UserRole, "xtrunningrole");
-            else if (knownroles.at(k) == "xttotalrole")
-                          headerItem()->setData(wcol, Qt::UserRole, "xttotalrole");
-          }
-        }
-
-        // Negative NUMERIC ROLE => default for column instead of column index
-        // see below
-        if (!(*_colRole)[wcol][COLROLE_NUMERIC] &&
-                          headerItem()->data(wcol, Xt::ScaleRole).isValid())
-        {
-          bool  ok;
-          int   tmpscale = headerItem()->data(wcol, Xt::ScaleRole).toInt(&ok);
-          if (ok)
-          {
-            if (DEBUG)
-              qDebug("setting _colRole[%d][COLROLE_NUMERIC]: %d", wcol, 0-tmpscale);
-            (*_colRole)[wcol][COLROLE_NUMERIC] = 0 - tmpscale;
-          }
-        }
-      }
+      if (merging && ! _merging)
+        prepareMerge(args._workingPopstyle == Merge);
 
       if (_rowRole[ROWROLE_INDENT])
         setIndentation( 10);
@@ -436,7 +471,7 @@ void XTreeWidget::populateWorker()
       if (_progress)
       {
         _progress->setValue(0);
-        _progress->setMaximum(pQuery.size());
+        _progress->setMaximum(args._workingMore ? 0 : pQuery.size());
         _progress->show();
       }
     }
@@ -451,7 +486,10 @@ void XTreeWidget::populateWorker()
       ++cnt;
       if (!_linear && cnt % WORKERROWS == 0)
       {
-        this->addTopLevelItems(topLevelItems); //#13439
+        if (merging)
+          mergeTopLevelItems(topLevelItems);
+        else
+          this->addTopLevelItems(topLevelItems); //#13439
         _progress->setValue(pQuery.at());
         return;
       }
@@ -747,9 +785,27 @@ void XTreeWidget::populateWorker()
 
     } while (pQuery.next());
 
-  this->addTopLevelItems(topLevelItems); //#13439
+  if (merging)
+    mergeTopLevelItems(topLevelItems);
+  else
+    this->addTopLevelItems(topLevelItems); //#13439
 
-  setId(pIndex);
+  if (args._workingMore)  // keep the populate state for the next batch
+  {
+    if (_workingParams.size())
+      _workingParams.takeFirst();
+    if (_workingParams.isEmpty())
+      _workingTimer.stop();
+    if (_linear)
+      qApp->restoreOverrideCursor();
+    return;
+  }
+
+  int scrollPos = verticalScrollBar()->value();
+  if (merging)
+    finishMerge(args._workingPopstyle == Merge);  // the selection is still there
+  else
+    setId(pIndex);
   emit valid(currentItem() != 0);
 
   // clean up. we won't reach here until the query is done, even if ! _linear
@@ -764,6 +820,8 @@ void XTreeWidget::populateWorker()
     populateCalculatedColumns();
     if (!_sort.isEmpty())
       sortItems(sortColumn(), header()->sortIndicatorOrder());
+    if (merging)
+      verticalScrollBar()->setValue(scrollPos);
 
     if (DEBUG)
       qDebug("%s::populateWorker() done", qPrintable(objectName()));
@@ -774,6 +832,102 @@ void XTreeWidget::populateWorker()
     qApp->restoreOverrideCursor();
 }
 
+/* Find the query fields that feed each column and each known role.
+   The results are written to pColIdx (query field of each column's raw value),
+   pColRole (query field of each role of each column, 0 if none) and
+   pRowRole (query field of the whole-row roles, 0 if none).
+   Callers must size pColIdx and pColRole to the number of columns first.
+ */
+void XTreeWidget::mapColumnRoles(const QSqlRecord &currRecord, QVector<int> &pColIdx,
+                                 QVector<int *> &pColRole, int *pRowRole)
+{
+  // apply indent, hidden and delete roles to col 0 if the caller requested them
+  // keep synchronized with #define ROWROLE_* in xtreewidget.h
+  if (rootIsDecorated())
+  {
+    pRowRole[ROWROLE_INDENT] = currRecord.indexOf("xtindentrole");
+    if (pRowRole[ROWROLE_INDENT] < 0)
+      pRowRole[ROWROLE_INDENT] = 0;
+  }
+  else
+    pRowRole[ROWROLE_INDENT] = 0;
+
+  pRowRole[ROWROLE_HIDDEN] = currRecord.indexOf("xthiddenrole");
+  if (pRowRole[ROWROLE_HIDDEN] < 0)
+    pRowRole[ROWROLE_HIDDEN] = 0;
+
+  pRowRole[ROWROLE_DELETED] = currRecord.indexOf("xtdeletedrole");
+  if (pRowRole[ROWROLE_DELETED] < 0)
+    pRowRole[ROWROLE_DELETED] = 0;
+
+  // keep synchronized with #define COLROLE_* in xtreewidget.h
+  // TODO: get rid of COLROLE_* and replace this QStringList
+  // with a map or vector of known roles and their Qt:: role or Xt
+  // enum values
+  QStringList knownroles;
+  knownroles << "qtdisplayrole"      << "qttextalignmentrole"<<
+  "qtbackgroundrole"   << "qtforegroundrole"<<
+  "qttooltiprole"      << "qtstatustiprole"<<
+  "qtfontrole" << "xtkeyrole"<<
+  "xtrunningrole"      << "xtrunninginit"<<
+  "xtgrouprunningrole" << "xttotalrole"<<
+  "xtnumericrole" << "xtnullrole"<<
+  "xtidrole";
+  for (int wcol = 0; wcol < _roles.size(); wcol++)
+  {
+    QVariantMap *role = _roles.value(wcol);
+    if (!role)
+    {
+      qWarning("XTreeWidget::populate() there is no role for column %d", wcol);
+      continue;
+    }
+    QString colname = role->value("qteditrole").toString();
+    pColIdx[wcol] = currRecord.indexOf(colname);
+
+    for (int k = 0; k < knownroles.size(); k++)
+    {
+      // apply Qt roles to a whole row by applying to each column
+      pColRole[wcol][k] = knownroles.at(k).startsWith("qt") ?
+                         currRecord.indexOf(knownroles.at(k)) :
+                         0;
+      if (pColRole[wcol][k] > 0)
+      {
+        role->insert(knownroles.at(k),
+                      QString(knownroles.at(k)));
+      }
+      else
+        pColRole[wcol][k] = 0;
+
+      // apply column-specific roles second to override entire row settings
+      if (currRecord.indexOf(colname + "_" + knownroles.at(k)) >=0)
+      {
+        pColRole[wcol][k] = currRecord.indexOf(colname + "_" + knownroles.at(k));
+        role->insert(knownroles.at(k),
+                      QString(colname + "_" + knownroles.at(k)));
+        if (knownroles.at(k) == "xtrunningrole")
+          headerItem()->setData(wcol, Qt::UserRole, "xtrunningrole");
+        else if (knownroles.at(k) == "xttotalrole")
+          headerItem()->setData(wcol, Qt::UserRole, "xttotalrole");
+      }
+    }
+
+    // Negative NUMERIC ROLE => default for column instead of column index
+    // see populateWorker()
+    if (!pColRole[wcol][COLROLE_NUMERIC] &&
+        headerItem()->data(wcol, Xt::ScaleRole).isValid())
+    {
+      bool  ok;
+      int   tmpscale = headerItem()->data(wcol, Xt::ScaleRole).toInt(&ok);
+      if (ok)
+      {
+        if (DEBUG)
+          qDebug("setting _colRole[%d][COLROLE_NUMERIC]: %d", wcol, 0-tmpscale);
+        pColRole[wcol][COLROLE_NUMERIC] = 0 - tmpscale;
+      }
+    }
+  }
+}
+
 void XTreeWidget::cleanupAfterPopulate()
 {
   if (_progress)
@@ -804,6 +958,105 @@ void XTreeWidget::cleanupAfterPopulate()
   _fieldCount = 0;
 }
 
+/* Get ready to Merge or Update: index the rows that are already there by
+   id and altId, drop the totals row, which populateCalculatedColumns()
+   adds back, and restart the running totals. a Merge puts rows in the
+   result's order, which running totals depend on, so it counts them off.
+ */
+void XTreeWidget::prepareMerge(bool pInOrder)
+{
+  _merging  = true;
+  _mergePos = pInOrder ? 0 : -1;
+  _mergeItems.clear();
+
+  if (_subtotals)
+  {
+    for (int i = 0; i < _subtotals->size(); i++)
+      (*_subtotals)[i]->clear();
+  }
+
+  if (_rowRole[ROWROLE_INDENT])   // can't match up a tree row by row
+  {
+    QTreeWidget::clear();
+    return;
+  }
+
+  for (int i = QTreeWidget::topLevelItemCount() - 1; i >= 0; i--)
+  {
+    QTreeWidgetItem *qitem = QTreeWidget::topLevelItem(i);
+    XTreeWidgetItem *item  = dynamic_cast<XTreeWidgetItem *>(qitem);
+    if (! item || item->data(0, Qt::UserRole).toString() == "totalrole")
+      delete qitem;
+    else
+      _mergeItems.insert(qMakePair(item->id(), item->altId()), item);
+  }
+}
+
+/* matched rows keep their item, so selection and expansion survive. for
+   a Merge each row goes to the next position; rows that are already
+   there, the usual case, don't move. rows that aren't in the result
+   collect at the end and finishMerge() removes them.
+ */
+void XTreeWidget::mergeTopLevelItems(const QList<XTreeWidgetItem *> &items)
+{
+  if (! _merging)
+    prepareMerge(false);
+
+  QList<QTreeWidgetItem *> added;
+  foreach (XTreeWidgetItem *item, items)
+  {
+    XTreeWidgetItem *old = _mergeItems.take(qMakePair(item->id(), item->altId()));
+    if (old)
+    {
+      QVariant filterHidden = old->data(0, Xt::FilterHiddenRole);
+      *static_cast<QTreeWidgetItem *>(old) = *item;   // column data and flags
+      if (filterHidden.isValid())
+        old->setData(0, Xt::FilterHiddenRole, filterHidden);
+      old->emitDataChanged();
+      delete item;
+      item = old;
+    }
+
+    if (_mergePos < 0)
+    {
+      if (! old)
+        added.append(item);
+      continue;
+    }
+
+    if (! old)
+      QTreeWidget::insertTopLevelItem(_mergePos, item);
+    else if (QTreeWidget::topLevelItem(_mergePos) != old)
+    {
+      bool selected = old->isSelected();
+      bool current  = (QTreeWidget::currentItem() == old);
+      bool expanded = old->isExpanded();
+      QTreeWidget::takeTopLevelItem(QTreeWidget::indexOfTopLevelItem(old));
+      QTreeWidget::insertTopLevelItem(_mergePos, old);
+      old->setSelected(selected);
+      old->setExpanded(expanded);
+      if (current)
+        selectionModel()->setCurrentIndex(indexFromItem(old),
+                                          QItemSelectionModel::NoUpdate);
+    }
+    _mergePos++;
+  }
+  QTreeWidget::addTopLevelItems(added);
+}
+
+void XTreeWidget::finishMerge(bool pRemoveMissing)
+{
+  if (! _merging)   // the result was empty
+    prepareMerge(pRemoveMissing);
+
+  if (pRemoveMissing)
+    qDeleteAll(_mergeItems);
+
+  _mergeItems.clear();
+  _merging  = false;
+  _mergePos = -1;
+}
+
 void XTreeWidget::addColumn(const QString &pString, int pWidth, int pAlignment, bool pVisible, const QString pEditColumn, const QString pDisplayColumn, const int scale)
 {
   if (!_settingsLoaded)
@@ -1112,48 +1365,6 @@ bool XTreeWidgetItem::operator>(const XTreeWidgetItem &other) const
   return !(this < other || this == other);
 }
 */
-void XTreeWidget::mergeSort(int low, int high){
-    int mid;
-    if(low<high){
-        mid=(low+high)/2;
-        // Split the data into two half.
-        mergeSort(low, mid);
-        mergeSort(mid+1, high);
-
-        // Merge them to get sorted output.
-        merge(low, high, mid);
-    }
-}
-void XTreeWidget::merge(int low, int high, int mid){
-
-    QList<QTreeWidgetItem *> temp;
-    int i = low, j = mid + 1;//i is for left-hand,j is for right-hand
-    int k = 0;//k is for the temporary array
-
-   while(i <= mid && j <=high){
-        XTreeWidgetItem *lhsItem = static_cast<XTreeWidgetItem *>(topLevelItem(i));
-        XTreeWidgetItem *rhsItem = static_cast<XTreeWidgetItem *>(topLevelItem(j));
-
-        if(*lhsItem < *rhsItem || *lhsItem == *rhsItem)
-            temp.insert(k++, static_cast<XTreeWidgetItem *>(topLevelItem(i++)->clone()));
-        else
-            temp.insert(k++, static_cast<XTreeWidgetItem *>(topLevelItem(j++)->clone()));
-    }
-    //rest elements of left-half
-    while(i <= mid)
-        temp.insert(k++, static_cast<XTreeWidgetItem *>(topLevelItem(i++)->clone()));
-    //rest elements of right-half
-    while(j <= high)
-        temp.insert(k++, static_cast<XTreeWidgetItem *>(topLevelItem(j++)->clone()));
-
-    //copy the mergered temporary array to the original array
-    for(k = 0, i = low; i <= high; ++i, ++k){
-        QTreeWidgetItem *item =  topLevelItem(i);
-        //XTreeWidgetItem *delItem = (XTreeWidgetItem*)item;
-        *item = *temp.at(k);
-
-    }
-}
 void XTreeWidget::sortItems(int column, Qt::SortOrder order)
 {
   // if old style then maintain backwards compatibility
@@ -1197,84 +1408,93 @@ void XTreeWidget::sortItems(int column, Qt::SortOrder order)
 
   int previd = id();
 
-  // simple insertion sort using binary search to find the right insertion pt
-  QString totalrole("totalrole");
-  int     itemcount      = topLevelItemCount();
-   
-#ifdef USENEWSORT
-  mergeSort(0,itemcount-1);
-#else
-  XTreeWidgetItem *prev  = dynamic_cast<XTreeWidgetItem *>(topLevelItem(0));
-  for (int i = 1; i < itemcount; i++)
-  {
-    XTreeWidgetItem *item = dynamic_cast<XTreeWidgetItem *>(topLevelItem(i));
-    if (!item)
+  // same rules as XTreeWidgetItem::operator<: stop at the first unusable column
+  QList<QPair<int, Qt::SortOrder> > keys;
+  foreach (sort, _sort)
+  {
+    if (sort.first < 0 || sort.first >= columnCount() ||
+        headerItem()->data(sort.first, Qt::UserRole).toString() == "xtrunningrole")
+      break;
+    keys.append(sort);
+  }
+
+  // taking items out of the tree loses their view state so remember it
+  QList<QTreeWidgetItem *> expanded;
+  QList<QTreeWidgetItem *> hidden;
+  for (QTreeWidgetItemIterator it(this); *it; ++it)
+  {
+    if ((*it)->isHidden())
+      hidden.append(*it);
+    if ((*it)->childCount() > 0 && (*it)->isExpanded())
+      expanded.append(*it);
+  }
+
+  // take everything out once, sort, and put it back in one pass
+  QList<QTreeWidgetItem *> items = QTreeWidget::invisibleRootItem()->takeChildren();
+  for (int i = items.size() - 1; i >= 0; i--)
+  {
+    if (! dynamic_cast<XTreeWidgetItem *>(items.at(i)))
     {
       qWarning("removing a non-XTreWidgetItem from an XTreeWidget");
-      takeTopLevelItem(i);
-      itemcount--;
-      i--;
+      delete items.takeAt(i);
     }
-    else if (item->data(0, Qt::UserRole).toString() == totalrole)
+    else if (items.at(i)->data(0, Qt::UserRole).toString() == "totalrole")
     {
       if (DEBUG)
         qDebug("sortItems() removing row %d because it's a totalrole", i);
-      takeTopLevelItem(i);
-      itemcount--;
-      i--;
+      delete items.takeAt(i);
     }
-    else if (*item < *prev)
-    {
-      int left   = 0;
-      int right  = i;
-      int middle = 0;
-      XTreeWidgetItem *test = 0;
-      while (left <= right)
-      {
-        middle = (left + right) / 2;
-        test   = static_cast<XTreeWidgetItem *>(topLevelItem(middle));
-        if (*test == *item)
-          break;
-        else if (*test < *item)
-        {
-          if (*item < *(static_cast<XTreeWidgetItem *>(topLevelItem(middle + 1))))
-            break;
-          else
-            left = middle + 1;
-        }
-        else
-          right = middle - 1;
-      }
-      // can't call takeTopLevelItem() until after < and == are done
-      if (*item < *test || *item == *test)
-      {
-        if (DEBUG)
-          qDebug("<= so moving %d to %d", i, middle);
-        takeTopLevelItem(i);
-        insertTopLevelItem(middle, item);
-      }
-      else
-      {
-        if (DEBUG)
-          qDebug("> so moving %d to %d", i, middle + 1);
-        takeTopLevelItem(i);
-        insertTopLevelItem(middle + 1, item);
-      }
-    }
-    else if (*item == *prev)
-    {
-      ; // nothing to do - make the > case easier to write
-    }
-    // can't reuse item because the thing in position i may have changed
-    prev = static_cast<XTreeWidgetItem *>(topLevelItem(i));
   }
-#endif
+
+  sortItemList(items, keys);
+  QTreeWidget::addTopLevelItems(items);
+  foreach (QTreeWidgetItem *item, hidden)
+    item->setHidden(true);
+  foreach (QTreeWidgetItem *item, expanded)
+    item->setExpanded(true);
+
   populateCalculatedColumns();
 
   setId(previd);
   emit resorted();
 }
 
+/* Sort pItems by pKeys, then do the same for the children of each item
+   to keep xtindentrole hierarchies sorted within each parent.
+ */
+void XTreeWidget::sortItemList(QList<QTreeWidgetItem *> &pItems,
+                               const QList<QPair<int, Qt::SortOrder> > &pKeys)
+{
+  if (pItems.size() > 1)
+  {
+    XTreeWidgetSorter sorter(pItems.size(), pKeys);
+    for (int row = 0; row < pItems.size(); row++)
+    {
+      QTreeWidgetItem *item = pItems.at(row);
+      for (int k = 0; k < sorter.columnCount(); k++)
+        sorter.setKey(row, k, XTreeWidgetSortKey(item->data(sorter.column(k), Xt::RawRole),
+                                                 item->data(sorter.column(k), Qt::DisplayRole)));
+    }
+
+    QVector<int> order = sorter.sorted();
+    QList<QTreeWidgetItem *> sorted;
+    sorted.reserve(pItems.size());
+    for (int i = 0; i < order.size(); i++)
+      sorted.append(pItems.at(order.at(i)));
+    pItems = sorted;
+  }
+
+  foreach (QTreeWidgetItem *item, pItems)
+  {
+    if (item->childCount() > 0)
+    {
+      QList<QTreeWidgetItem *> children = item->takeChildren();
+      sortItemList(children, pKeys);
+      item->addChildren(children);
+    }
+  }
+}
+
 QList<QPair<int, Qt::SortOrder> > XTreeWidget::sortColumnOrder()
 {
   return _sort;
@@ -1499,6 +1719,9 @@ void XTreeWidget::clear()
   }
   emit valid(false);
   _savedId = false; // was -1;
+  _mergeItems.clear();
+  _merging  = false;
+  _mergePos = -1;
 
   QTreeWidget::clear();
 }
@@ -1647,46 +1870,64 @@ void XTreeWidget::sExport()
   QFileInfo fi(QFileDialog::getSaveFileName(this, tr("Export Save Filename"), path,
                                              filetype ));
 
-  if (!fi.filePath().isEmpty())
-  {
-    QTextDocument       *doc = new QTextDocument();
-    QTextDocumentWriter writer;
-    if (fi.suffix().isEmpty())
-      fi.setFile(fi.filePath() += ".csv"); 
-    xtsettingsSetValue(_settingsName + "/exportPath", fi.path());
-    writer.setFileName(fi.filePath());
+  if (fi.filePath().isEmpty())
+    return;
+
+  if (fi.suffix().isEmpty())
+    fi.setFile(fi.filePath() += ".csv");
+  xtsettingsSetValue(_settingsName + "/exportPath", fi.path());
 
-    if (fi.suffix() == "txt")
+  XTreeWidgetExporter::Format format;
+  if (XTreeWidgetExporter::formatForSuffix(fi.suffix(), format))
+  {
+    QFile file(fi.filePath());
+    if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate))
     {
-      doc->setPlainText(toTxt());
-      writer.setFormat("plaintext");
+      QMessageBox::critical(this, tr("Export Error"),
+                            tr("Could not open %1: %2")
+                              .arg(fi.filePath(), file.errorString()));
+      return;
     }
-    else if (fi.suffix() == "csv")
+
+    QProgressDialog progress(tr("Exporting..."), tr("Cancel"), 0, 0, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
+
+    XTreeWidgetExporter exporter(this);
+    exporter.setDelimiter(fi.suffix().toLower() == "tsv" ? QString("\t") : delimSelected);
+    exporter.setProgress(&progress);
+    bool ok = exporter.write(&file, format);
+    file.close();
+    if (! ok)
     {
-      doc->setPlainText(toSV(delimSelected));
-      writer.setFormat("plaintext");
+      file.remove();
+      if (! progress.wasCanceled())
+        QMessageBox::critical(this, tr("Export Error"), exporter.errorString());
+      return;
     }
-    else if (fi.suffix() == "vcf")
+  }
+  else
+  {
+    QTextDocument       doc;
+    QTextDocumentWriter writer;
+    writer.setFileName(fi.filePath());
+
+    if (fi.suffix() == "vcf")
     {
-      doc->setPlainText(toVcf());
+      doc.setPlainText(toVcf());
       writer.setFormat("plaintext");
     }
     else if (fi.suffix() == "odt")
     {
-      doc->setHtml(toHtml());
+      doc.setHtml(toHtml());
       writer.setFormat("odf");
     }
-    else if (fi.suffix() == "html")
-    {
-      doc->setHtml(toHtml());
-      writer.setFormat("HTML");
-    }
-    else 
+    else
     {
-      doc->setPlainText(toSV(delimSelected));
+      doc.setPlainText(toSV(delimSelected));
       writer.setFormat("plaintext");
     }
-    writer.write(doc);
+    writer.write(&doc);
   }
 
   if(openAutomatically)
@@ -2413,14 +2654,29 @@ void XTreeWidget::sCopyCellToClipboard()
 
 void XTreeWidget::sCopyVisibleToClipboard()
 {
-  QMimeData   *mime      = new QMimeData();
-  QClipboard  *clipboard = QApplication::clipboard();
+  bool plain = _x_preferences->boolean("CopyListsPlainText");
 
-  if (_x_preferences->boolean("CopyListsPlainText"))
-    mime->setText(toTxt());
+  QProgressDialog progress(tr("Copying..."), tr("Cancel"), 0, 0, this);
+  progress.setWindowModality(Qt::WindowModal);
+  progress.setMinimumDuration(500);
+
+  XTreeWidgetExporter exporter(this);
+  exporter.setProgress(&progress);
+  if (! plain)
+    exporter.setDataLimit(dataLimit());
+  QString text = exporter.toString(plain ? XTreeWidgetExporter::Text
+                                         : XTreeWidgetExporter::Html);
+  if (progress.wasCanceled())
+    return;
+  if (exporter.limitReached())
+    dataLimitWarning(exporter);
+
+  QMimeData *mime = new QMimeData();
+  if (plain)
+    mime->setText(text);
   else
-    mime->setHtml(toHtml());
-  clipboard->setMimeData(mime);
+    mime->setHtml(text);
+  QApplication::clipboard()->setMimeData(mime);
 }
 
 void XTreeWidget::sCopyColumnToClipboard()
@@ -2445,110 +2701,59 @@ void XTreeWidget::sCopyColumnToClipboard()
   clipboard->setMimeData(mime);
 }
 
-void XTreeWidget::sSearch(const QString &pTarget)
+XTreeWidgetSearchIndex *XTreeWidget::searchIndex()
 {
-  clearSelection();
-  int i;
-  for (i = 0; i < topLevelItemCount(); i++)
-  {
-    // Currently this only looks at the first column
-    if (topLevelItem(i)->text(0).contains(pTarget, Qt::CaseInsensitive))
-      break;
-  }
-
-  if (i < topLevelItemCount())
-  {
-    setCurrentItem(topLevelItem(i));
-    scrollToItem(topLevelItem(i));
-  }
+  if (! _searchIndex)
+    _searchIndex = new XTreeWidgetSearchIndex(this);
+  return _searchIndex;
 }
 
-QString XTreeWidget::toTxt() const
+/* select the first row, in display order, with pTarget in any visible column */
+void XTreeWidget::sSearch(const QString &pTarget)
 {
-  QString line;
-  QString opText;
-  int     counter;
+  clearSelection();
+  QList<QTreeWidgetItem *> matches = searchIndex()->find(pTarget);
+  if (matches.isEmpty())
+    return;
 
-  QTreeWidgetItem *header = headerItem();
-  for (counter = 0; counter < header->columnCount(); counter++)
+  QSet<QTreeWidgetItem *> found = matches.toSet();
+  for (QTreeWidgetItemIterator it(this, QTreeWidgetItemIterator::NotHidden); *it; ++it)
   {
-    if (!QTreeWidget::isColumnHidden(counter))
-      line = line + header->text(counter).replace("\r\n"," ") + "\t";
-  }
-  opText = line + "\r\n";
-
-  XTreeWidgetItem *item = topLevelItem(0);
-  if (item)
-  {
-    for (QModelIndex idx = indexFromItem(item); idx.isValid(); idx = indexBelow(idx))
+    if (found.contains(*it))
     {
-      item = (XTreeWidgetItem *)itemFromIndex(idx);
-      if (item)
-      {
-        line = "";
-        for (counter = 0; counter < item->columnCount(); counter++)
-        {
-          if (!QTreeWidget::isColumnHidden(counter))
-            line = line + item->text(counter) + "\t";
-        }
-      }
-      opText = opText + line + "\r\n";
+      setCurrentItem(*it);
+      scrollToItem(*it);
+      return;
     }
   }
-  return opText;
 }
 
+/* hide the rows without pTarget in any visible column. the filter stays
+   in effect for later populate() calls until it is set to an empty string.
+ */
+void XTreeWidget::sFilter(const QString &pTarget)
+{
+  if (pTarget.isEmpty() && ! _searchIndex)
+    return;
+  searchIndex()->filter(pTarget);
+}
 
-
-QString XTreeWidget::toSV(QString pSep) const
+QString XTreeWidget::filterText() const
 {
-  QString line;
-  QString opText;
-  int     counter;
-  int     colcount         = 0;
+  return _searchIndex ? _searchIndex->filterText() : QString();
+}
 
-  QTreeWidgetItem *header  = headerItem();
-  for (counter = 0; counter < header->columnCount(); counter++)
-  {
-    if (!QTreeWidget::isColumnHidden(counter))
-    {
-      if (colcount)
-        line = line + pSep;
-      line = line + header->text(counter).replace("\"","\"\"").replace("\r\n"," ").replace("\n"," ");
-      colcount++;
-    }
-  }
-  opText = line + "\r\n";
+QString XTreeWidget::toTxt() const
+{
+  XTreeWidgetExporter exporter(const_cast<XTreeWidget*>(this));
+  return exporter.toString(XTreeWidgetExporter::Text);
+}
 
-  XTreeWidgetItem *item = topLevelItem(0);
-  if (item)
-  {
-    for (QModelIndex idx = indexFromItem(item); idx.isValid(); idx = indexBelow(idx))
-    {
-      colcount = 0;
-      item     = (XTreeWidgetItem *)itemFromIndex(idx);
-      if (item)
-      {
-        line = "";
-        for (counter = 0; counter < item->columnCount(); counter++)
-        {
-          if (!QTreeWidget::isColumnHidden(counter))
-          {
-            if (colcount)
-              line = line + pSep;
-            if (item->data(counter,Qt::DisplayRole).type() == QVariant::String)
-              line = line + "\"";
-            line = line + item->text(counter).replace("\"","\"\"");
-            if (item->data(counter,Qt::DisplayRole).type() == QVariant::String)
-              line = line + "\"";
-            colcount++;
-          }
-        }
-      }
-      opText = opText + line + "\r\n";
-    }
-  }
-  return opText;
+QString XTreeWidget::toSV(QString pSep) const
+{
+  XTreeWidgetExporter exporter(const_cast<XTreeWidget*>(this));
+  exporter.setDelimiter(pSep);
+  return exporter.toString(XTreeWidgetExporter::Delimited);
 }
 
 QString XTreeWidget::toCsv()
@@ -2657,106 +2862,33 @@ QString XTreeWidget::toVcf() const
     return "failed to select contact for export";
 }
 
-QString XTreeWidget::toHtml() const
+/* the XTreeWidgetDataLimit preference in characters, 0 if there is none */
+qlonglong XTreeWidget::dataLimit() const
 {
-  QTextDocument     *doc     = new QTextDocument();
-  QTextCursor       *cursor  = new QTextCursor(doc);
-  QTextTableFormat  tableFormat;
-  QTextTableCell    cell;
-  QTextCharFormat   format;
-  QString font;
-  int     colcnt = 0;
-  int     rowcnt = 0;
-  int     row = 0;
-  double  limit = 0;
-  qlonglong maxDataCount = 0;
-  qlonglong dataCount = 0;
-
   if (_x_preferences)
   {
-    limit = _x_preferences->value("XTreeWidgetDataLimit").toDouble();
+    double limit = _x_preferences->value("XTreeWidgetDataLimit").toDouble();
     if (limit > 0)
-      maxDataCount = (qlonglong)(limit * 1e9);
-  }
-
-  tableFormat.setHeaderRowCount(1);
-
-  QTreeWidgetItem *header = headerItem();
-  for (int i = 0; i < header->columnCount(); i++)
-    if (!QTreeWidget::isColumnHidden(i))
-      colcnt++;
-
-  XTreeWidgetItem *item = topLevelItem(0);
-  if (item)
-  {
-    for (QModelIndex idx = indexFromItem(item); idx.isValid(); idx = indexBelow(idx))
-    {
-      item = (XTreeWidgetItem *)itemFromIndex(idx);
-      if (item)
-        rowcnt++;
-    }
-  }
-
-  cursor->insertTable(rowcnt + 1, colcnt, tableFormat);
-
-  for (int counter = 0; counter < header->columnCount(); counter++)
-  {
-    if (!QTreeWidget::isColumnHidden(counter))
-    {
-      cell   = cursor->currentTable()->cellAt(cursor->position());
-      format = cell.format();
-      format.setBackground(Qt::lightGray);
-      cell.setFormat(format);
-      cursor->insertText(header->text(counter));
-      cursor->movePosition(QTextCursor::NextCell);
-
-      dataCount += (qlonglong)(header->text(counter).size());
-    }
+      return (qlonglong)(limit * 1e9);
   }
+  return 0;
+}
 
-  item = topLevelItem(0);
-  if (item)
-  {
-    for (QModelIndex idx = indexFromItem(item); idx.isValid() && (maxDataCount <= 0 || dataCount < maxDataCount); idx = indexBelow(idx), row++)
-    {
-      item = (XTreeWidgetItem *)itemFromIndex(idx);
-      if (item)
-      {
-        for (int counter = 0; counter < item->columnCount(); counter++)
-        {
-          if (!QTreeWidget::isColumnHidden(counter))
-          {
-            cell   = cursor->currentTable()->cellAt(cursor->position());
-            format = cell.format();
-            if (item->data(counter, Qt::BackgroundRole).isValid())
-              format.setBackground(item->data(counter, Qt::BackgroundRole).value<QColor>());
-            if (item->data(counter, Qt::ForegroundRole).isValid())
-              format.setForeground(item->data(counter, Qt::ForegroundRole).value<QColor>());
-
-            if (item->data(counter,Qt::FontRole).isValid())
-            {
-              font = item->data(counter,Qt::FontRole).toString();
-              if (!font.isEmpty())
-                format.setFont(QFont(font));
-            }
-
-            cell.setFormat(format);
-            cursor->insertText(item->text(counter));
-            cursor->movePosition(QTextCursor::NextCell);
-
-            dataCount += (qlonglong)(item->text(counter).size());
-          }
-        }
-      }
-    }
+void XTreeWidget::dataLimitWarning(XTreeWidgetExporter &exporter) const
+{
+  QString overflowMsg = tr("Maximum data limit was encountered.  Only %1 of %2 rows could be processed.");
+  QMessageBox::warning(NULL, tr("Data Limit Reached"),
+                       overflowMsg.arg(exporter.rowsWritten()).arg(exporter.rowCount()));
+}
 
-    if (maxDataCount > 0 && dataCount > maxDataCount)
-    {
-      QString overflowMsg = tr("Maximum data limit was encountered.  Only %1 of %2 rows could be processed.");
-      QMessageBox::warning(NULL, tr("Data Limit Reached"), overflowMsg.arg(row).arg(rowcnt));
-    }
-  }
-  return doc->toHtml();
+QString XTreeWidget::toHtml() const
+{
+  XTreeWidgetExporter exporter(const_cast<XTreeWidget*>(this));
+  exporter.setDataLimit(dataLimit());
+  QString html = exporter.toString(XTreeWidgetExporter::Html);
+  if (exporter.limitReached())
+    dataLimitWarning(exporter);
+  return html;
 }
 
 QList<XTreeWidgetItem *> XTreeWidget::selectedItems() const
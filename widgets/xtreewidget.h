@@ -11,6 +11,10 @@
 #ifndef __XTREEWIDGET_H__
 #define __XTREEWIDGET_H__
 
+#include <QHash>
+#include <QPair>
+#include <QSharedPointer>
+#include <QSqlRecord>
 #include <QTreeWidget>
 #include <QTreeWidgetItem>
 #include <QVariant>
@@ -52,13 +56,38 @@
 // make sure ROWROLE_COUNT = last ROWROLE + 1
 #define ROWROLE_COUNT         3
 
+/* make sure the colroles are kept in sync with
+   QStringList knownroles in XTreeWidget::mapColumnRoles(),
+   both in count and order
+   */
+#define COLROLE_DISPLAY       0
+#define COLROLE_TEXTALIGNMENT 1
+#define COLROLE_BACKGROUND    2
+#define COLROLE_FOREGROUND    3
+#define COLROLE_TOOLTIP       4
+#define COLROLE_STATUSTIP     5
+#define COLROLE_FONT          6
+#define COLROLE_KEY           7
+#define COLROLE_RUNNING       8
+#define COLROLE_RUNNINGINIT   9
+#define COLROLE_GROUPRUNNING  10
+#define COLROLE_TOTAL         11
+#define COLROLE_NUMERIC       12
+#define COLROLE_NULL          13
+#define COLROLE_ID            14
+// make sure COLROLE_COUNT = last COLROLE + 1
+#define COLROLE_COUNT         15
+
 #include "xsqlquery.h"
 
 class QAction;
 class QMenu;
 class QScriptEngine;
+class QSqlRecord;
 class XTreeWidget;
+class XTreeWidgetExporter;
 class XTreeWidgetProgress;
+class XTreeWidgetSearchIndex;
 
 class XTUPLEWIDGETS_EXPORT XTreeWidgetItem : public QObject, public QTreeWidgetItem
 {
@@ -167,8 +196,24 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
   Q_PROPERTY( QString altDragString READ altDragString WRITE setAltDragString)
   Q_PROPERTY( bool populateLinear READ populateLinear WRITE setPopulateLinear)
 
+  friend class XTreeWidgetModel;
+  friend class XTreeWidgetSearchIndex;
+  friend class XTreeWidgetView;
+
   public :
-    enum PopulateStyle { Replace, Append };
+    /* Replace: clear the list first
+       Append:  add the rows after the ones already there
+       Merge:   rows with the id and altId of a row already in the list
+                replace its values, other rows are added, rows that
+                aren't in the result are removed, and the list ends up in
+                the result's order. selection, expansion and scroll
+                position are kept. indented lists can't be matched row
+                by row so they are replaced.
+       Update:  like Merge but the result only holds changed rows, so
+                rows that aren't in it stay, changed rows stay where
+                they are and new ones go at the end
+     */
+    enum PopulateStyle { Replace, Append, Merge, Update };
     Q_ENUM(PopulateStyle)
 
     XTreeWidget(QWidget *);
@@ -178,6 +223,8 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     Q_INVOKABLE void  populate(XSqlQuery, int, bool = false, PopulateStyle = Replace);
     void    populate(const QString&, bool = false);
     void    populate(const QString&, int, bool = false);
+    void    populate(const QList<QSqlRecord> &, int, bool = false,
+                     PopulateStyle = Replace, bool pMore = false);
 
     QString dragString() const;
     void    setDragString(QString);
@@ -187,8 +234,6 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void    setPopulateLinear(bool alwaysLinear = true);
 
     void keyPressEvent(QKeyEvent* e);
-    void mergeSort(int low, int high);
-    void merge(int low, int high, int mid);
     
     Q_INVOKABLE int   altId() const;
     Q_INVOKABLE int   id()    const;
@@ -211,6 +256,7 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     Q_INVOKABLE XTreeWidgetItem         *findXTreeWidgetItemWithId(const XTreeWidget *ptree, const int pid);
     Q_INVOKABLE XTreeWidgetItem         *findXTreeWidgetItemWithId(const XTreeWidgetItem *ptreeitem, const int pid);
 
+    Q_INVOKABLE QString filterText() const;
     Q_INVOKABLE QString toTxt() const;
     Q_INVOKABLE QString toSV(QString pSep) const;
     Q_INVOKABLE QString toCsv();
@@ -268,6 +314,7 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void  sCopyRowToClipboard();
     void  sCopyCellToClipboard();
     void  sCopyColumnToClipboard();
+    void  sFilter(const QString&);
     void  sSearch(const QString&);
 
   signals:
@@ -313,6 +360,9 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     virtual void  resizeEvent(QResizeEvent *);
 
   private:
+    qlonglong dataLimit() const;
+    void      dataLimitWarning(XTreeWidgetExporter &exporter) const;
+
     QString _dragString;
     QString _altDragString;
     QMenu   *_menu;
@@ -335,6 +385,10 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     QTimer        _workingTimer;
     bool          _alwaysLinear;
     bool          _linear;
+    bool          _streaming;
+    bool          _merging;
+    QMultiHash<QPair<int, int>, XTreeWidgetItem *> _mergeItems; // rows not matched yet
+    int           _mergePos;    // where the next Merge row goes, -1 for Update
 
     QVector<int>    *_colIdx;
     QVector<int *>  *_colRole;
@@ -342,7 +396,16 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     XTreeWidgetItem *_last;
     int              _rowRole[ROWROLE_COUNT];
     void             cleanupAfterPopulate();
+    void             prepareMerge(bool pInOrder);
+    void             mergeTopLevelItems(const QList<XTreeWidgetItem *> &);
+    void             finishMerge(bool pRemoveMissing);
+    void             mapColumnRoles(const QSqlRecord &, QVector<int> &,
+                                    QVector<int *> &, int *);
+    void             sortItemList(QList<QTreeWidgetItem *> &,
+                                  const QList<QPair<int, Qt::SortOrder> > &);
+    XTreeWidgetSearchIndex *searchIndex();
     XTreeWidgetProgress *_progress;
+    XTreeWidgetSearchIndex *_searchIndex;
     QList<QMap<int, double> *> *_subtotals;
 
   private slots:
@@ -361,12 +424,46 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void  popupMenuActionTriggered(QAction *);
 };
 
+/* The rows XTreeWidget::populateWorker() reads, either from an XSqlQuery
+   or from a batch of records fetched somewhere else, such as on a
+   background connection. Copies share the current row position the same
+   way copies of a QSqlQuery do.
+ */
+class XTreeWidgetRows
+{
+  public:
+    XTreeWidgetRows();
+    XTreeWidgetRows(XSqlQuery pQuery);
+    XTreeWidgetRows(const QList<QSqlRecord> &pRecords);
+
+    int         at()    const;
+    int         count() const;
+    int         size()  const;
+    bool        first();
+    bool        next();
+    bool        seek(int);
+    QSqlRecord  record() const;
+    QVariant    value(int) const;
+
+  private:
+    struct Records
+    {
+      QList<QSqlRecord> rows;
+      int               at;
+    };
+
+    XSqlQuery               _query;
+    QSharedPointer<Records> _records;   // null when reading from _query
+};
+
 class XTreeWidgetPopulateParams
 {
   public:
-    XSqlQuery _workingQuery;
+    XTreeWidgetRows _workingRows;
     int       _workingIndex;
     bool      _workingUseAlt;
+    bool      _workingMore;       // more batches of the same result will follow
+    bool      _workingContinued;  // continues the result of the previous batch
     XTreeWidget::PopulateStyle _workingPopstyle;
 };
 
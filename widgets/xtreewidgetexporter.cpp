@@ -0,0 +1,523 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetexporter.h"
+
+#include <QBuffer>
+#include <QColor>
+#include <QFont>
+#include <QProgressDialog>
+#include <QTextCodec>
+#include <QTextStream>
+#include <QTreeView>
+#include <QXmlStreamWriter>
+
+#include "xt.h"
+#include "zipwriter.h"
+
+#define DEBUG false
+
+// check for cancel and update the progress dialog this often
+#define PROGRESSROWS 500
+
+#define ODSNS   "urn:oasis:names:tc:opendocument:xmlns:office:1.0"
+#define ODSTABLENS "urn:oasis:names:tc:opendocument:xmlns:table:1.0"
+#define ODSTEXTNS  "urn:oasis:names:tc:opendocument:xmlns:text:1.0"
+#define XLSXNS  "http://schemas.openxmlformats.org/spreadsheetml/2006/main"
+#define XLSXRELNS "http://schemas.openxmlformats.org/officeDocument/2006/relationships"
+#define PKGRELNS  "http://schemas.openxmlformats.org/package/2006/relationships"
+
+XTreeWidgetExporter::XTreeWidgetExporter(QTreeView *view)
+  : _view(view),
+    _delimiter(","),
+    _dataLimit(0),
+    _limitReached(false),
+    _progress(0),
+    _rowsWritten(0)
+{
+  if (_view && _view->model())
+  {
+    for (int i = 0; i < _view->model()->columnCount(_view->rootIndex()); i++)
+      if (! _view->isColumnHidden(i))
+        _columns.append(i);
+  }
+}
+
+/* pick the format for a file name suffix. returns false for suffixes
+   this class can't write, such as vcf and odt.
+ */
+bool XTreeWidgetExporter::formatForSuffix(const QString &suffix, Format &format)
+{
+  QString lower = suffix.toLower();
+  if (lower == "csv" || lower == "tsv")
+    format = Delimited;
+  else if (lower == "txt")
+    format = Text;
+  else if (lower == "html" || lower == "htm")
+    format = Html;
+  else if (lower == "ods")
+    format = Ods;
+  else if (lower == "xlsx")
+    format = Xlsx;
+  else
+    return false;
+
+  return true;
+}
+
+/* stop writing html after roughly this many characters of cell text */
+void XTreeWidgetExporter::setDataLimit(qlonglong chars)
+{
+  _dataLimit = chars;
+}
+
+void XTreeWidgetExporter::setDelimiter(const QString &delimiter)
+{
+  _delimiter = delimiter;
+}
+
+void XTreeWidgetExporter::setProgress(QProgressDialog *progress)
+{
+  _progress = progress;
+}
+
+QModelIndex XTreeWidgetExporter::first() const
+{
+  if (! _view || ! _view->model())
+    return QModelIndex();
+
+  QModelIndex root = _view->rootIndex();
+  for (int r = 0; r < _view->model()->rowCount(root); r++)
+  {
+    if (! _view->isRowHidden(r, root))
+      return _view->model()->index(r, 0, root);
+  }
+  return QModelIndex();
+}
+
+/* move to the next row the user can see, reporting progress in terms of
+   top level rows since counting all of the visible rows would take
+   another pass.
+ */
+bool XTreeWidgetExporter::next(QModelIndex &index)
+{
+  _rowsWritten++;
+  if (_progress && _rowsWritten % PROGRESSROWS == 0)
+  {
+    QModelIndex top = index;
+    while (top.parent().isValid() && top.parent() != _view->rootIndex())
+      top = top.parent();
+    _progress->setValue(top.row());
+    if (_progress->wasCanceled())
+    {
+      _error = tr("The export was canceled.");
+      index  = QModelIndex();
+      return false;
+    }
+  }
+
+  index = _view->indexBelow(index);
+  return true;
+}
+
+/* the number of rows write() would export */
+int XTreeWidgetExporter::rowCount()
+{
+  int rows = 0;
+  for (QModelIndex idx = first(); idx.isValid(); idx = _view->indexBelow(idx))
+    rows++;
+  return rows;
+}
+
+QString XTreeWidgetExporter::text(const QModelIndex &index, int column) const
+{
+  return index.sibling(index.row(), column).data(Qt::DisplayRole).toString();
+}
+
+/* spreadsheet cells keep numbers as numbers so they can be summed and
+   formatted, using the raw value rather than the localized display text.
+ */
+bool XTreeWidgetExporter::numeric(const QModelIndex &index, int column, QString &value) const
+{
+  QVariant raw = index.sibling(index.row(), column).data(Xt::RawRole);
+  switch (raw.type())
+  {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+      value = raw.toString();
+      return true;
+
+    case QVariant::Double:
+      value = QString::number(raw.toDouble(), 'g', 15);
+      return true;
+
+    default:
+      break;
+  }
+  return false;
+}
+
+QString XTreeWidgetExporter::toString(Format format)
+{
+  QByteArray bytes;
+  QBuffer    buffer(&bytes);
+  if (! buffer.open(QIODevice::WriteOnly) || ! write(&buffer, format))
+    return QString();
+  buffer.close();
+  return QString::fromUtf8(bytes);
+}
+
+bool XTreeWidgetExporter::write(QIODevice *device, Format format)
+{
+  _error.clear();
+  _limitReached = false;
+  _rowsWritten  = 0;
+
+  if (! _view || ! _view->model())
+  {
+    _error = tr("There is nothing to export.");
+    return false;
+  }
+
+  if (_progress)
+  {
+    _progress->setRange(0, _view->model()->rowCount(_view->rootIndex()));
+    _progress->setValue(0);
+  }
+
+  bool result = false;
+  if (format == Ods)
+    result = writeOds(device);
+  else if (format == Xlsx)
+    result = writeXlsx(device);
+  else
+  {
+    QTextStream out(device);
+    out.setCodec(QTextCodec::codecForName("UTF-8"));
+    if (format == Delimited)
+      result = writeDelimited(out);
+    else if (format == Text)
+      result = writeText(out);
+    else
+      result = writeHtml(out);
+    out.flush();
+    if (result && out.status() != QTextStream::Ok)
+    {
+      _error = device->errorString();
+      result = false;
+    }
+  }
+
+  if (_progress)
+    _progress->setValue(_progress->maximum());
+
+  if (DEBUG)
+    qDebug("XTreeWidgetExporter::write(%d) wrote %d rows: %s", format,
+           _rowsWritten, qPrintable(_error));
+  return result;
+}
+
+bool XTreeWidgetExporter::writeDelimited(QTextStream &out)
+{
+  QAbstractItemModel *model = _view->model();
+  for (int c = 0; c < _columns.size(); c++)
+  {
+    if (c)
+      out << _delimiter;
+    out << model->headerData(_columns.at(c), Qt::Horizontal).toString()
+                  .replace("\"", "\"\"").replace("\r\n", " ").replace("\n", " ");
+  }
+  out << "\r\n";
+
+  for (QModelIndex idx = first(); idx.isValid(); )
+  {
+    for (int c = 0; c < _columns.size(); c++)
+    {
+      QModelIndex cell = idx.sibling(idx.row(), _columns.at(c));
+      QVariant    value = cell.data(Qt::DisplayRole);
+      bool        quote = value.type() == QVariant::String;
+      if (c)
+        out << _delimiter;
+      if (quote)
+        out << '"' << value.toString().replace("\"", "\"\"") << '"';
+      else
+        out << value.toString();
+    }
+    out << "\r\n";
+
+    if (! next(idx))
+      return false;
+  }
+  return true;
+}
+
+bool XTreeWidgetExporter::writeText(QTextStream &out)
+{
+  QAbstractItemModel *model = _view->model();
+  for (int c = 0; c < _columns.size(); c++)
+    out << model->headerData(_columns.at(c), Qt::Horizontal).toString().replace("\r\n", " ")
+        << "\t";
+  out << "\r\n";
+
+  for (QModelIndex idx = first(); idx.isValid(); )
+  {
+    for (int c = 0; c < _columns.size(); c++)
+      out << text(idx, _columns.at(c)) << "\t";
+    out << "\r\n";
+
+    if (! next(idx))
+      return false;
+  }
+  return true;
+}
+
+bool XTreeWidgetExporter::writeHtml(QTextStream &out)
+{
+  QAbstractItemModel *model = _view->model();
+  qlonglong           dataCount = 0;
+
+  out << "<!DOCTYPE html>\n<html>\n<head>\n"
+         "<meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\" />\n"
+         "</head>\n<body>\n<table border=\"1\" cellspacing=\"0\" cellpadding=\"2\">\n<tr>";
+  for (int c = 0; c < _columns.size(); c++)
+  {
+    QString header = model->headerData(_columns.at(c), Qt::Horizontal).toString();
+    out << "<th style=\"background-color: " << QColor(Qt::lightGray).name() << "\">"
+        << header.toHtmlEscaped() << "</th>";
+    dataCount += header.size();
+  }
+  out << "</tr>\n";
+
+  for (QModelIndex idx = first(); idx.isValid(); )
+  {
+    if (_dataLimit > 0 && dataCount >= _dataLimit)
+    {
+      _limitReached = true;
+      break;
+    }
+
+    out << "<tr>";
+    for (int c = 0; c < _columns.size(); c++)
+    {
+      QModelIndex cell = idx.sibling(idx.row(), _columns.at(c));
+      QStringList style;
+
+      QVariant background = cell.data(Qt::BackgroundRole);
+      if (background.isValid())
+        style << "background-color: " + background.value<QColor>().name();
+      QVariant foreground = cell.data(Qt::ForegroundRole);
+      if (foreground.isValid())
+        style << "color: " + foreground.value<QColor>().name();
+
+      QVariant font = cell.data(Qt::FontRole);
+      if (font.type() == QVariant::Font)
+      {
+        QFont f = font.value<QFont>();
+        if (f.bold())
+          style << "font-weight: bold";
+        if (f.italic())
+          style << "font-style: italic";
+        if (f.strikeOut())
+          style << "text-decoration: line-through";
+      }
+      else if (! font.toString().isEmpty())
+        style << "font-family: " + font.toString().toHtmlEscaped();
+
+      QString value = cell.data(Qt::DisplayRole).toString();
+      if (style.isEmpty())
+        out << "<td>";
+      else
+        out << "<td style=\"" << style.join("; ") << "\">";
+      out << value.toHtmlEscaped() << "</td>";
+      dataCount += value.size();
+    }
+    out << "</tr>\n";
+
+    if (! next(idx))
+      return false;
+  }
+
+  out << "</table>\n</body>\n</html>\n";
+  return true;
+}
+
+bool XTreeWidgetExporter::writeOds(QIODevice *device)
+{
+  QAbstractItemModel *model = _view->model();
+  ZipWriter           zip(device);
+
+  zip.addFile("mimetype", "application/vnd.oasis.opendocument.spreadsheet", false);
+  zip.addFile("META-INF/manifest.xml",
+              "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+              "<manifest:manifest xmlns:manifest=\"urn:oasis:names:tc:opendocument:xmlns:manifest:1.0\" manifest:version=\"1.2\">\n"
+              " <manifest:file-entry manifest:full-path=\"/\" manifest:version=\"1.2\""
+              " manifest:media-type=\"application/vnd.oasis.opendocument.spreadsheet\"/>\n"
+              " <manifest:file-entry manifest:full-path=\"content.xml\" manifest:media-type=\"text/xml\"/>\n"
+              "</manifest:manifest>\n");
+  zip.beginFile("content.xml");
+
+  QXmlStreamWriter xml(&zip);
+  xml.writeStartDocument();
+  xml.writeNamespace(ODSNS,      "office");
+  xml.writeNamespace(ODSTABLENS, "table");
+  xml.writeNamespace(ODSTEXTNS,  "text");
+  xml.writeStartElement(ODSNS, "document-content");
+  xml.writeAttribute(ODSNS, "version", "1.2");
+  xml.writeStartElement(ODSNS, "body");
+  xml.writeStartElement(ODSNS, "spreadsheet");
+  xml.writeStartElement(ODSTABLENS, "table");
+  xml.writeAttribute(ODSTABLENS, "name", tr("Sheet1"));
+
+  xml.writeStartElement(ODSTABLENS, "table-row");
+  for (int c = 0; c < _columns.size(); c++)
+  {
+    xml.writeStartElement(ODSTABLENS, "table-cell");
+    xml.writeAttribute(ODSNS, "value-type", "string");
+    xml.writeTextElement(ODSTEXTNS, "p",
+                         model->headerData(_columns.at(c), Qt::Horizontal).toString());
+    xml.writeEndElement();
+  }
+  xml.writeEndElement();
+
+  bool result = true;
+  for (QModelIndex idx = first(); idx.isValid() && result; )
+  {
+    xml.writeStartElement(ODSTABLENS, "table-row");
+    for (int c = 0; c < _columns.size(); c++)
+    {
+      QString number;
+      xml.writeStartElement(ODSTABLENS, "table-cell");
+      if (numeric(idx, _columns.at(c), number))
+      {
+        xml.writeAttribute(ODSNS, "value-type", "float");
+        xml.writeAttribute(ODSNS, "value",      number);
+      }
+      else
+        xml.writeAttribute(ODSNS, "value-type", "string");
+      xml.writeTextElement(ODSTEXTNS, "p", text(idx, _columns.at(c)));
+      xml.writeEndElement();
+    }
+    xml.writeEndElement();
+
+    result = next(idx) && ! zip.hasError();
+  }
+
+  xml.writeEndDocument();
+  zip.close();
+
+  if (result && (xml.hasError() || zip.hasError()))
+  {
+    _error = device->errorString();
+    result = false;
+  }
+  return result;
+}
+
+/* A1-style cell reference for a 0-based row and column */
+static QString xlsxCellName(int row, int column)
+{
+  QString name;
+  for (int c = column + 1; c > 0; c = (c - 1) / 26)
+    name.prepend(QChar('A' + (c - 1) % 26));
+  return name + QString::number(row + 1);
+}
+
+void XTreeWidgetExporter::writeXlsxCell(QXmlStreamWriter &xml, int row, int column,
+                                        const QModelIndex &index, bool header)
+{
+  QString number;
+  xml.writeStartElement("c");
+  xml.writeAttribute("r", xlsxCellName(row, column));
+  if (! header && numeric(index, _columns.at(column), number))
+    xml.writeTextElement("v", number);
+  else
+  {
+    // inline strings let the sheet be written in one pass, without a
+    // shared string table that can only be finished at the end
+    xml.writeAttribute("t", "inlineStr");
+    xml.writeStartElement("is");
+    xml.writeStartElement("t");
+    xml.writeAttribute("xml:space", "preserve");
+    xml.writeCharacters(header ? _view->model()->headerData(_columns.at(column),
+                                                            Qt::Horizontal).toString()
+                               : text(index, _columns.at(column)));
+    xml.writeEndElement();
+    xml.writeEndElement();
+  }
+  xml.writeEndElement();
+}
+
+bool XTreeWidgetExporter::writeXlsx(QIODevice *device)
+{
+  ZipWriter zip(device);
+
+  zip.addFile("[Content_Types].xml",
+              "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+              "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+              "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+              "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+              "<Override PartName=\"/xl/workbook.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>"
+              "<Override PartName=\"/xl/worksheets/sheet1.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>"
+              "</Types>");
+  zip.addFile("_rels/.rels",
+              "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+              "<Relationships xmlns=\"" PKGRELNS "\">"
+              "<Relationship Id=\"rId1\" Type=\"" XLSXRELNS "/officeDocument\" Target=\"xl/workbook.xml\"/>"
+              "</Relationships>");
+  zip.addFile("xl/workbook.xml",
+              QString("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                      "<workbook xmlns=\"" XLSXNS "\" xmlns:r=\"" XLSXRELNS "\">"
+                      "<sheets><sheet name=\"%1\" sheetId=\"1\" r:id=\"rId1\"/></sheets>"
+                      "</workbook>").arg(tr("Sheet1").toHtmlEscaped()).toUtf8());
+  zip.addFile("xl/_rels/workbook.xml.rels",
+              "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+              "<Relationships xmlns=\"" PKGRELNS "\">"
+              "<Relationship Id=\"rId1\" Type=\"" XLSXRELNS "/worksheet\" Target=\"worksheets/sheet1.xml\"/>"
+              "</Relationships>");
+  zip.beginFile("xl/worksheets/sheet1.xml");
+
+  QXmlStreamWriter xml(&zip);
+  xml.writeStartDocument("1.0", true);
+  xml.writeDefaultNamespace(XLSXNS);
+  xml.writeStartElement(XLSXNS, "worksheet");
+  xml.writeStartElement("sheetData");
+
+  int row = 0;
+  xml.writeStartElement("row");
+  xml.writeAttribute("r", QString::number(row + 1));
+  for (int c = 0; c < _columns.size(); c++)
+    writeXlsxCell(xml, row, c, QModelIndex(), true);
+  xml.writeEndElement();
+
+  bool result = true;
+  for (QModelIndex idx = first(); idx.isValid() && result; )
+  {
+    row++;
+    xml.writeStartElement("row");
+    xml.writeAttribute("r", QString::number(row + 1));
+    for (int c = 0; c < _columns.size(); c++)
+      writeXlsxCell(xml, row, c, idx, false);
+    xml.writeEndElement();
+
+    result = next(idx) && ! zip.hasError();
+  }
+
+  xml.writeEndDocument();
+  zip.close();
+
+  if (result && (xml.hasError() || zip.hasError()))
+  {
+    _error = device->errorString();
+    result = false;
+  }
+  return result;
+}
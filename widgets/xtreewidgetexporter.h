@@ -0,0 +1,79 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __XTREEWIDGETEXPORTER_H__
+#define __XTREEWIDGETEXPORTER_H__
+
+#include <QCoreApplication>
+#include <QList>
+#include <QModelIndex>
+#include <QString>
+
+#include "widgets.h"
+
+class QIODevice;
+class QProgressDialog;
+class QTextStream;
+class QTreeView;
+class QXmlStreamWriter;
+
+/* Writes the rows an XTreeWidget (or any other tree view) is showing to
+   a device in one pass, formatting each cell as it goes rather than
+   building the whole document in memory first. Hidden columns and rows
+   are left out, as are children of collapsed rows.
+ */
+class XTUPLEWIDGETS_EXPORT XTreeWidgetExporter
+{
+  Q_DECLARE_TR_FUNCTIONS(XTreeWidgetExporter)
+
+  public:
+    enum Format { Delimited, Text, Html, Ods, Xlsx };
+
+    XTreeWidgetExporter(QTreeView *view);
+
+    static bool   formatForSuffix(const QString &suffix, Format &format);
+
+    void      setDataLimit(qlonglong chars);
+    void      setDelimiter(const QString &delimiter);
+    void      setProgress(QProgressDialog *progress);
+
+    QString   errorString()   const { return _error; }
+    bool      limitReached()  const { return _limitReached; }
+    int       rowCount();
+    int       rowsWritten()   const { return _rowsWritten; }
+
+    QString   toString(Format format);
+    bool      write(QIODevice *device, Format format);
+
+  private:
+    QModelIndex first() const;
+    bool        next(QModelIndex &index);
+    QString     text(const QModelIndex &index, int column) const;
+    bool        numeric(const QModelIndex &index, int column, QString &value) const;
+
+    bool        writeDelimited(QTextStream &out);
+    bool        writeHtml(QTextStream &out);
+    bool        writeOds(QIODevice *device);
+    bool        writeText(QTextStream &out);
+    bool        writeXlsx(QIODevice *device);
+    void        writeXlsxCell(QXmlStreamWriter &xml, int row, int column,
+                              const QModelIndex &index, bool header);
+
+    QTreeView        *_view;
+    QList<int>        _columns;
+    QString           _delimiter;
+    qlonglong         _dataLimit;
+    bool              _limitReached;
+    QProgressDialog  *_progress;
+    int               _rowsWritten;
+    QString           _error;
+};
+
+#endif
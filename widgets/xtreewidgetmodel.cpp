@@ -0,0 +1,886 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetmodel.h"
+
+#include <cmath>
+
+#include <QApplication>
+#include <QDate>
+#include <QDateTime>
+#include <QFont>
+#include <QHeaderView>
+#include <QKeyEvent>
+#include <QLocale>
+#include <QMenu>
+#include <QSqlRecord>
+
+#include "format.h"
+#include "xtreewidgetsorter.h"
+
+#define DEBUG false
+
+#define yesStr QObject::tr("Yes")
+#define noStr  QObject::tr("No")
+
+// keep rounding consistent with XTreeWidget::populateWorker() - Issue #8897
+static double cint(double x)
+{
+  double intpart, fractpart;
+  fractpart = modf(x, &intpart);
+
+  if (fabs(fractpart) >= 0.5)
+    return x>=0 ? ceil(x) : floor(x);
+  else
+    return x<0 ? ceil(x) : floor(x);
+}
+
+static double round(double r, int places)
+{
+  double off=pow(10.0,places);
+  return cint(r*off)/off;
+}
+
+XTreeWidgetModel::XTreeWidgetModel(XTreeWidget *layout, QObject *parent)
+  : QAbstractItemModel(parent),
+    _tree(layout),
+    _useAltId(false),
+    _defaultScale(0)
+{
+  for (int i = 0; i < ROWROLE_COUNT; i++)
+    _rowRole[i] = 0;
+}
+
+XTreeWidgetModel::~XTreeWidgetModel()
+{
+  releaseRoles();
+}
+
+void XTreeWidgetModel::releaseRoles()
+{
+  for (int i = 0; i < _colRole.size(); i++)
+    delete [] _colRole[i];
+  _colRole.clear();
+  _colIdx.clear();
+}
+
+void XTreeWidgetModel::clear()
+{
+  beginResetModel();
+  _slot.clear();
+  _values.clear();
+  _ids.clear();
+  _altIds.clear();
+  _parent.clear();
+  _position.clear();
+  _topLevel.clear();
+  _children.clear();
+  _hidden.clear();
+  _running.clear();
+  _totals.clear();
+  _totalScales.clear();
+  releaseRoles();
+  for (int i = 0; i < ROWROLE_COUNT; i++)
+    _rowRole[i] = 0;
+  endResetModel();
+}
+
+/* Copy the rows of pQuery into the columnar buffer.
+   Only the query fields referenced by a column or a role are kept;
+   nothing is formatted until data() is called for a visible cell.
+ */
+void XTreeWidgetModel::populate(XSqlQuery pQuery, bool pUseAltId,
+                                XTreeWidget::PopulateStyle popstyle)
+{
+  // a full result is cheap to reload here, so Merge does not match rows
+  if (popstyle == XTreeWidget::Replace || popstyle == XTreeWidget::Merge ||
+      _colIdx.isEmpty())
+    clear();
+
+  if (! pQuery.first())
+    return;
+
+  beginResetModel();
+
+  _useAltId     = pUseAltId;
+  _defaultScale = decimalPlaces("");
+
+  QSqlRecord record = pQuery.record();
+  int columns       = _tree->columnCount();
+
+  if (_colIdx.isEmpty())
+  {
+    _colIdx.fill(-1, columns);
+    _colRole.resize(columns);
+    for (int col = 0; col < columns; col++)
+    {
+      _colRole[col] = new int[COLROLE_COUNT];
+      for (int k = 0; k < COLROLE_COUNT; k++)
+        _colRole[col][k] = 0;
+    }
+    _tree->mapColumnRoles(record, _colIdx, _colRole, _rowRole);
+
+    // decide which query fields are worth keeping
+    _slot.fill(-1, record.count());
+    QList<int> used;
+    for (int col = 0; col < columns; col++)
+    {
+      used.append(_colIdx.at(col));
+      for (int k = 0; k < COLROLE_COUNT; k++)
+        used.append(_colRole.at(col)[k]);
+    }
+    for (int i = 0; i < ROWROLE_COUNT; i++)
+      used.append(_rowRole[i]);
+
+    // role fields of 0 mean "no role" but the id field may be shown as a column
+    if (_colIdx.contains(0))
+      used.append(-2);
+    foreach (int fieldidx, used)
+    {
+      if (fieldidx == -2)
+        fieldidx = 0;
+      else if (fieldidx <= 0)
+        continue;
+      if (fieldidx < _slot.size() && _slot.at(fieldidx) < 0)
+      {
+        _slot[fieldidx] = _values.size();
+        _values.append(QVector<QVariant>());
+      }
+    }
+  }
+
+  int reserve = _ids.size() + qMax(pQuery.size(), 0);
+  _ids.reserve(reserve);
+  _altIds.reserve(reserve);
+  _parent.reserve(reserve);
+  for (int i = 0; i < _values.size(); i++)
+    _values[i].reserve(reserve);
+
+  // an Append batch carries on from the previous one's last row, which
+  // leads back through _parent to every row it could be indented under
+  int last = (popstyle == XTreeWidget::Append) ? _ids.size() - 1 : -1;
+  do
+  {
+    int node = _ids.size();
+    _ids.append(pQuery.value(0).toInt());
+    _altIds.append(pUseAltId ? pQuery.value(1).toInt() : -1);
+    for (int f = 0; f < _slot.size(); f++)
+      if (_slot.at(f) >= 0)
+        _values[_slot.at(f)].append(pQuery.value(f));
+
+    // same parenting rules as XTreeWidget::populateWorker()
+    int parent = -1;
+    int indent = 0;
+    if (_rowRole[ROWROLE_INDENT])
+    {
+      indent = qMax(pQuery.value(_rowRole[ROWROLE_INDENT]).toInt(), 0);
+      int lastindent = (last >= 0) ? qMax(field(last, _rowRole[ROWROLE_INDENT]).toInt(), 0) : 0;
+      if (indent == 0 || last < 0)
+        parent = -1;
+      else if (lastindent < indent)
+        parent = last;
+      else if (lastindent == indent)
+        parent = _parent.at(last);
+      else
+      {
+        parent = _parent.at(last);
+        while (parent >= 0 && field(parent, _rowRole[ROWROLE_INDENT]).toInt() >= indent)
+          parent = _parent.at(parent);
+      }
+    }
+    _parent.append(parent);
+    if (parent < 0)
+      _topLevel.append(node);
+    else
+      _children[parent].append(node);
+
+    if (_rowRole[ROWROLE_HIDDEN] && pQuery.value(_rowRole[ROWROLE_HIDDEN]).toBool())
+      _hidden.append(node);
+    else if (indent > 0)
+    {
+      // XTreeWidget hides indented rows that have nothing to show
+      bool allNull = true;
+      for (int col = 0; allNull && col < columns; col++)
+      {
+        QVariant v = _colRole.at(col)[COLROLE_DISPLAY] &&
+                     ! pQuery.value(_colRole.at(col)[COLROLE_DISPLAY]).isNull() ?
+                       pQuery.value(_colRole.at(col)[COLROLE_DISPLAY]) :
+                       (_colIdx.at(col) >= 0 ? pQuery.value(_colIdx.at(col)) : QVariant());
+        allNull = v.isNull() || v.toString().isEmpty();
+      }
+      if (allNull)
+        _hidden.append(node);
+    }
+
+    last = node;
+  } while (pQuery.next());
+
+  _position.resize(_ids.size());
+  updatePositions(_topLevel);
+  QHashIterator<int, QVector<int> > it(_children);
+  while (it.hasNext())
+  {
+    it.next();
+    updatePositions(it.value());
+  }
+
+  computeCalculatedColumns();
+
+  endResetModel();
+
+  if (DEBUG)
+    qDebug("XTreeWidgetModel::populate() buffered %d rows in %d fields",
+           _ids.size(), _values.size());
+}
+
+void XTreeWidgetModel::updatePositions(const QVector<int> &nodes)
+{
+  for (int i = 0; i < nodes.size(); i++)
+    _position[nodes.at(i)] = i;
+}
+
+void XTreeWidgetModel::computeCalculatedColumns()
+{
+  _running.clear();
+  _totals.clear();
+  _totalScales.clear();
+
+  for (int col = 0; col < _colRole.size(); col++)
+  {
+    if (_colRole.at(col)[COLROLE_RUNNING])
+    {
+      // running values start out in query order, as in populateWorker()
+      QVector<int> all(_ids.size());
+      for (int node = 0; node < all.size(); node++)
+        all[node] = node;
+      computeRunning(col, all);
+      computeRunning(col, _topLevel);
+    }
+
+    if (_colRole.at(col)[COLROLE_TOTAL])
+    {
+      // only total set 0 is reported, see XTreeWidget::populateCalculatedColumns()
+      double total    = 0.0;
+      int    colscale = -99999;
+      for (int node = 0; node < _ids.size(); node++)
+      {
+        if (field(node, _colRole.at(col)[COLROLE_TOTAL]).toInt() == 0)
+          total += rawValue(node, col).toDouble();
+        colscale = qMax(colscale, scale(node, col));
+      }
+      _totals.insert(col, total);
+      _totalScales.insert(col, colscale);
+    }
+  }
+}
+
+void XTreeWidgetModel::computeRunning(int col, const QVector<int> &nodes)
+{
+  QVector<double> &running = _running[col];
+  running.resize(_ids.size());
+
+  QMap<int, double> subtotals;
+  foreach (int node, nodes)
+  {
+    int set = field(node, _colRole.at(col)[COLROLE_RUNNING]).toInt();
+    if (! subtotals.contains(set))
+      subtotals.insert(set, _colRole.at(col)[COLROLE_RUNNINGINIT] ?
+                            field(node, _colRole.at(col)[COLROLE_RUNNINGINIT]).toDouble() : 0.0);
+    subtotals[set] += rawValue(node, col).toDouble();
+    running[node] = subtotals.value(set);
+  }
+}
+
+int XTreeWidgetModel::nodeOf(const QModelIndex &index) const
+{
+  return index.isValid() ? (int)index.internalId() : -1;
+}
+
+QVariant XTreeWidgetModel::field(int node, int field) const
+{
+  if (field < 0 || field >= _slot.size() || _slot.at(field) < 0)
+    return QVariant();
+  return _values.at(_slot.at(field)).at(node);
+}
+
+QVariant XTreeWidgetModel::rawValue(int node, int col) const
+{
+  if (col >= _colIdx.size() || _colIdx.at(col) < 0)
+    return QVariant();
+  return field(node, _colIdx.at(col));
+}
+
+int XTreeWidgetModel::scale(int node, int col) const
+{
+  int numeric = _colRole.at(col)[COLROLE_NUMERIC];
+  if (numeric < 0)
+    return 0 - numeric;
+  else if (numeric > 0)
+    return decimalPlaces(field(node, numeric).toString());
+  return _defaultScale;
+}
+
+QVariant XTreeWidgetModel::displayValue(int node, int col) const
+{
+  const int *colrole = _colRole.at(col);
+  int        sc      = scale(node, col);
+
+  if (colrole[COLROLE_RUNNING] && _running.contains(col))
+    return QLocale().toString(_running.value(col).at(node), 'f', sc);
+
+  QVariant display = colrole[COLROLE_DISPLAY] ? field(node, colrole[COLROLE_DISPLAY]) : QVariant();
+  if (! display.isNull())
+  {
+    if (display.type() == QVariant::Int)
+      return QLocale().toString(display.toInt());
+    else if (display.type() == QVariant::Double)
+      return QLocale().toString(display.toDouble(), 'f', sc);
+    return display.toString();
+  }
+
+  QVariant raw = rawValue(node, col);
+  if (raw.isNull())
+    return colrole[COLROLE_NULL] ? field(node, colrole[COLROLE_NULL]).toString() : QString("");
+
+  if (colrole[COLROLE_NUMERIC] > 0)
+  {
+    QString numericrole = field(node, colrole[COLROLE_NUMERIC]).toString();
+    if (numericrole == "percent" || numericrole == "scrap")
+      return QLocale().toString(raw.toDouble() * 100.0, 'f', sc);
+  }
+  if (colrole[COLROLE_NUMERIC] || raw.type() == QVariant::Double)
+    return QLocale().toString(round(raw.toDouble(), sc), 'f', sc);
+  if (raw.type() == QVariant::Bool)
+    return raw.toBool() ? yesStr : noStr;
+
+  return raw;
+}
+
+QVariant XTreeWidgetModel::totalData(int col, int role) const
+{
+  switch (role)
+  {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+      if (_totals.contains(col))
+        return QLocale().toString(_totals.value(col), 'f', _totalScales.value(col));
+      else if (col == 0)
+        return (_totals.size() == 1) ? tr("Total") : tr("Totals");
+      break;
+    case Qt::TextAlignmentRole:
+      return _tree->headerItem()->textAlignment(col);
+    case Qt::UserRole:
+      if (col == 0)
+        return QString("totalrole");
+      break;
+    default:
+      break;
+  }
+  return QVariant();
+}
+
+QVariant XTreeWidgetModel::data(const QModelIndex &index, int role) const
+{
+  int node = nodeOf(index);
+  int col  = index.column();
+  if (node < 0 || col < 0 || col >= _colRole.size())
+    return QVariant();
+  if (node == totalNode())
+    return totalData(col, role);
+
+  const int *colrole = _colRole.at(col);
+  bool deleted = _rowRole[ROWROLE_DELETED] && field(node, _rowRole[ROWROLE_DELETED]).toBool();
+
+  switch (role)
+  {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+      return displayValue(node, col);
+
+    case Qt::TextAlignmentRole:
+      if (colrole[COLROLE_TEXTALIGNMENT] && ! field(node, colrole[COLROLE_TEXTALIGNMENT]).isNull())
+        return field(node, colrole[COLROLE_TEXTALIGNMENT]);
+      return _tree->headerItem()->textAlignment(col);
+
+    case Qt::ForegroundRole:
+      if (deleted)
+        return QColor(Qt::gray);
+      if (colrole[COLROLE_FOREGROUND] && ! field(node, colrole[COLROLE_FOREGROUND]).isNull())
+        return namedColor(field(node, colrole[COLROLE_FOREGROUND]).toString());
+      break;
+
+    case Qt::BackgroundRole:
+      if (colrole[COLROLE_BACKGROUND] && ! field(node, colrole[COLROLE_BACKGROUND]).isNull())
+        return namedColor(field(node, colrole[COLROLE_BACKGROUND]).toString());
+      break;
+
+    case Qt::ToolTipRole:
+      if (colrole[COLROLE_TOOLTIP])
+        return field(node, colrole[COLROLE_TOOLTIP]);
+      break;
+
+    case Qt::StatusTipRole:
+      if (colrole[COLROLE_STATUSTIP])
+        return field(node, colrole[COLROLE_STATUSTIP]);
+      break;
+
+    case Qt::FontRole:
+      if (deleted)
+      {
+        QFont font;
+        font.setStrikeOut(true);
+        return font;
+      }
+      if (colrole[COLROLE_FONT])
+        return field(node, colrole[COLROLE_FONT]);
+      break;
+
+    case Xt::RawRole:
+      return rawValue(node, col);
+
+    case Xt::ScaleRole:
+      if (colrole[COLROLE_NUMERIC] || colrole[COLROLE_RUNNING] || colrole[COLROLE_TOTAL])
+        return scale(node, col);
+      break;
+
+    case Xt::IdRole:
+      if (colrole[COLROLE_ID])
+        return field(node, colrole[COLROLE_ID]);
+      break;
+
+    case Xt::RunningSetRole:
+      if (colrole[COLROLE_RUNNING])
+        return field(node, colrole[COLROLE_RUNNING]).toInt();
+      break;
+
+    case Xt::RunningInitRole:
+      if (colrole[COLROLE_RUNNINGINIT])
+        return field(node, colrole[COLROLE_RUNNINGINIT]);
+      break;
+
+    case Xt::TotalSetRole:
+      if (colrole[COLROLE_TOTAL])
+        return field(node, colrole[COLROLE_TOTAL]).toInt();
+      break;
+
+    case Xt::IndentRole:
+      if (col == 0 && _rowRole[ROWROLE_INDENT])
+        return qMax(field(node, _rowRole[ROWROLE_INDENT]).toInt(), 0);
+      break;
+
+    case Xt::DeletedRole:
+      if (deleted)
+        return QVariant(true);
+      break;
+
+    default:
+      break;
+  }
+
+  return QVariant();
+}
+
+Qt::ItemFlags XTreeWidgetModel::flags(const QModelIndex &index) const
+{
+  if (! index.isValid())
+    return Qt::NoItemFlags;
+  return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+QVariant XTreeWidgetModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (orientation == Qt::Horizontal && section >= 0 && section < _tree->columnCount())
+    return _tree->headerItem()->data(section, role);
+  return QVariant();
+}
+
+int XTreeWidgetModel::columnCount(const QModelIndex &) const
+{
+  return _tree->columnCount();
+}
+
+int XTreeWidgetModel::rowCount(const QModelIndex &parent) const
+{
+  if (! parent.isValid())
+    return _topLevel.size() + (_totals.isEmpty() ? 0 : 1);
+  if (parent.column() > 0)
+    return 0;
+
+  int node = nodeOf(parent);
+  return _children.contains(node) ? _children.value(node).size() : 0;
+}
+
+QModelIndex XTreeWidgetModel::index(int row, int column, const QModelIndex &parent) const
+{
+  if (row < 0 || column < 0 || column >= columnCount())
+    return QModelIndex();
+
+  if (! parent.isValid())
+  {
+    if (row < _topLevel.size())
+      return createIndex(row, column, quintptr(_topLevel.at(row)));
+    else if (row == _topLevel.size() && ! _totals.isEmpty())
+      return createIndex(row, column, quintptr(totalNode()));
+    return QModelIndex();
+  }
+
+  int node = nodeOf(parent);
+  if (! _children.contains(node) || row >= _children.value(node).size())
+    return QModelIndex();
+  return createIndex(row, column, quintptr(_children.value(node).at(row)));
+}
+
+QModelIndex XTreeWidgetModel::parent(const QModelIndex &index) const
+{
+  int node = nodeOf(index);
+  if (node < 0 || node >= _parent.size() || _parent.at(node) < 0)
+    return QModelIndex();
+
+  int parent = _parent.at(node);
+  return createIndex(_position.at(parent), 0, quintptr(parent));
+}
+
+int XTreeWidgetModel::id(const QModelIndex &index) const
+{
+  int node = nodeOf(index);
+  return (node >= 0 && node < _ids.size()) ? _ids.at(node) : -1;
+}
+
+int XTreeWidgetModel::altId(const QModelIndex &index) const
+{
+  int node = nodeOf(index);
+  return (node >= 0 && node < _altIds.size()) ? _altIds.at(node) : -1;
+}
+
+QModelIndex XTreeWidgetModel::indexOfId(int pId, int pAltId) const
+{
+  for (int node = 0; node < _ids.size(); node++)
+  {
+    if (_ids.at(node) == pId && (pAltId < 0 || _altIds.at(node) == pAltId))
+      return createIndex(_position.at(node), 0, quintptr(node));
+  }
+  return QModelIndex();
+}
+
+QModelIndexList XTreeWidgetModel::hiddenIndexes() const
+{
+  QModelIndexList result;
+  foreach (int node, _hidden)
+    result.append(createIndex(_position.at(node), 0, quintptr(node)));
+  return result;
+}
+
+/* Build a stand-alone XTreeWidgetItem with the same data XTreeWidget::populate()
+   would have given the row at index. The caller owns the result.
+ */
+XTreeWidgetItem *XTreeWidgetModel::materialize(const QModelIndex &index) const
+{
+  int node = nodeOf(index);
+  if (node < 0 || node > totalNode())
+    return 0;
+
+  static const int roles[] = {
+    Qt::DisplayRole,    Qt::TextAlignmentRole, Qt::ForegroundRole,
+    Qt::BackgroundRole, Qt::ToolTipRole,       Qt::StatusTipRole,
+    Qt::FontRole,       Qt::UserRole,          Xt::RawRole,
+    Xt::ScaleRole,      Xt::IdRole,            Xt::RunningSetRole,
+    Xt::RunningInitRole, Xt::TotalSetRole,     Xt::IndentRole,
+    Xt::DeletedRole
+  };
+
+  XTreeWidgetItem *item = new XTreeWidgetItem((XTreeWidgetItem *)0, id(index), altId(index));
+  for (int col = 0; col < columnCount(); col++)
+  {
+    QModelIndex cell = index.sibling(index.row(), col);
+    for (unsigned int r = 0; r < sizeof(roles) / sizeof(roles[0]); r++)
+    {
+      QVariant value = data(cell, roles[r]);
+      if (value.isValid())
+        item->setData(col, roles[r], value);
+    }
+  }
+  return item;
+}
+
+void XTreeWidgetModel::sort(int column, Qt::SortOrder order)
+{
+  QList<QPair<int, Qt::SortOrder> > sortlist;
+  sortlist.append(qMakePair(column, order));
+  sortBy(sortlist);
+}
+
+void XTreeWidgetModel::sortNodes(QVector<int> &nodes,
+                                 const QList<QPair<int, Qt::SortOrder> > &pSort)
+{
+  XTreeWidgetSorter sorter(nodes.size(), pSort);
+  for (int row = 0; row < nodes.size(); row++)
+  {
+    for (int k = 0; k < sorter.columnCount(); k++)
+      sorter.setKey(row, k, XTreeWidgetSortKey(rawValue(nodes.at(row), sorter.column(k)),
+                                               displayValue(nodes.at(row), sorter.column(k))));
+  }
+
+  QVector<int> order = sorter.sorted();
+  QVector<int> sorted(nodes.size());
+  for (int i = 0; i < order.size(); i++)
+    sorted[i] = nodes.at(order.at(i));
+  nodes = sorted;
+  updatePositions(nodes);
+}
+
+void XTreeWidgetModel::sortBy(const QList<QPair<int, Qt::SortOrder> > &pSort)
+{
+  QList<QPair<int, Qt::SortOrder> > usable;
+  foreach (const QPair<int, Qt::SortOrder> &sort, pSort)
+  {
+    if (sort.first < 0 || sort.first >= columnCount() ||
+        _tree->headerItem()->data(sort.first, Qt::UserRole).toString() == "xtrunningrole")
+      break;
+    usable.append(sort);
+  }
+  if (usable.isEmpty() || _ids.isEmpty())
+    return;
+
+  emit layoutAboutToBeChanged();
+  QModelIndexList before = persistentIndexList();
+
+  sortNodes(_topLevel, usable);
+  QMutableHashIterator<int, QVector<int> > it(_children);
+  while (it.hasNext())
+  {
+    it.next();
+    sortNodes(it.value(), usable);
+  }
+
+  QHashIterator<int, QVector<double> > rit(_running);
+  while (rit.hasNext())
+  {
+    rit.next();
+    computeRunning(rit.key(), _topLevel);
+  }
+
+  QModelIndexList after;
+  foreach (const QModelIndex &index, before)
+  {
+    int node = nodeOf(index);
+    int row  = (node == totalNode()) ? _topLevel.size() : _position.at(node);
+    after.append(createIndex(row, index.column(), quintptr(node)));
+  }
+  changePersistentIndexList(before, after);
+  emit layoutChanged();
+}
+
+// XTreeWidgetView ////////////////////////////////////////////////////////////
+
+XTreeWidgetView::XTreeWidgetView(XTreeWidget *layout, QWidget *parent)
+  : QTreeView(parent),
+    _tree(layout),
+    _syncing(false)
+{
+  _model = new XTreeWidgetModel(_tree, this);
+  _menu  = new QMenu(this);
+  _menu->setObjectName("_menu");
+  _headerMenu = new QMenu(this);
+  _headerMenu->setObjectName("_headerMenu");
+  connect(_headerMenu, SIGNAL(triggered(QAction *)), this, SLOT(sHeaderMenuTriggered(QAction *)));
+
+  setModel(_model);
+  setUniformRowHeights(true);
+  setContextMenuPolicy(Qt::CustomContextMenu);
+  setSelectionBehavior(QAbstractItemView::SelectRows);
+  setSelectionMode(QAbstractItemView::SingleSelection);
+  setAlternatingRowColors(_tree->alternatingRowColors());
+  setRootIsDecorated(_tree->rootIsDecorated());
+  setSizePolicy(_tree->sizePolicy());
+  header()->setStretchLastSection(false);
+  header()->setSectionsClickable(true);
+  header()->setContextMenuPolicy(Qt::CustomContextMenu);
+
+  connect(selectionModel(), SIGNAL(currentChanged(const QModelIndex &, const QModelIndex &)),
+          this,             SLOT(sCurrentChanged(const QModelIndex &, const QModelIndex &)));
+  connect(this,     SIGNAL(doubleClicked(const QModelIndex &)),        this, SLOT(sItemSelected()));
+  connect(this,     SIGNAL(customContextMenuRequested(const QPoint &)), this, SLOT(sShowMenu(const QPoint &)));
+  connect(header(), SIGNAL(sectionClicked(int)),                       this, SLOT(sHeaderClicked(int)));
+  connect(header(), SIGNAL(sectionResized(int, int, int)),             this, SLOT(sSectionResized(int, int, int)));
+  connect(header(), SIGNAL(customContextMenuRequested(const QPoint &)), this, SLOT(sShowHeaderMenu(const QPoint &)));
+}
+
+void XTreeWidgetView::populate(XSqlQuery pQuery, int pIndex, bool pUseAltId,
+                               XTreeWidget::PopulateStyle popstyle)
+{
+  qApp->setOverrideCursor(Qt::WaitCursor);
+
+  if (popstyle == XTreeWidget::Replace || popstyle == XTreeWidget::Merge)
+    _tree->clear();
+  _model->populate(pQuery, pUseAltId, popstyle);
+
+  syncHeader();
+  setIndentation(_model->hasIndent() ? 10 : 0);
+  foreach (const QModelIndex &index, _model->hiddenIndexes())
+    setRowHidden(index.row(), index.parent(), true);
+
+  _model->sortBy(_tree->sortColumnOrder());
+  setId(pIndex);
+
+  qApp->restoreOverrideCursor();
+}
+
+void XTreeWidgetView::clear()
+{
+  _model->clear();
+  _tree->clear();
+}
+
+void XTreeWidgetView::syncHeader()
+{
+  _syncing = true;
+  for (int i = 0; i < _tree->header()->count() && i < header()->count(); i++)
+  {
+    header()->setSectionResizeMode(i, QHeaderView::Interactive);
+    header()->resizeSection(i, _tree->header()->sectionSize(i));
+    header()->setSectionHidden(i, _tree->header()->isSectionHidden(i));
+  }
+  _syncing = false;
+}
+
+int XTreeWidgetView::id() const
+{
+  return _model->id(currentIndex());
+}
+
+int XTreeWidgetView::altId() const
+{
+  return _model->altId(currentIndex());
+}
+
+void XTreeWidgetView::setId(int pId, int pAltId)
+{
+  if (pId < 0)
+    return;
+
+  QModelIndex found = _model->indexOfId(pId, pAltId);
+  if (found.isValid())
+  {
+    scrollTo(found);
+    selectionModel()->setCurrentIndex(found, QItemSelectionModel::ClearAndSelect |
+                                             QItemSelectionModel::Rows);
+  }
+}
+
+/* Replace whatever the layout XTreeWidget holds with the current row so
+   that code asking the XTreeWidget for its selection sees this row.
+ */
+void XTreeWidgetView::sCurrentChanged(const QModelIndex &current, const QModelIndex &)
+{
+  _tree->clear();
+
+  XTreeWidgetItem *item = _model->materialize(current);
+  if (item)
+  {
+    _tree->addTopLevelItem(item);
+    _tree->setCurrentItem(item);
+  }
+}
+
+void XTreeWidgetView::sItemSelected()
+{
+  if (currentIndex().isValid())
+    _tree->sItemSelected();
+}
+
+void XTreeWidgetView::keyPressEvent(QKeyEvent *e)
+{
+  if (e->key() == Qt::Key_Enter)
+    sItemSelected();
+  else
+    QTreeView::keyPressEvent(e);
+}
+
+void XTreeWidgetView::sHeaderClicked(int column)
+{
+  // let the XTreeWidget keep track of the sort order and header decorations
+  _tree->sHeaderClicked(column);
+  _model->sortBy(_tree->sortColumnOrder());
+  header()->viewport()->update();
+}
+
+void XTreeWidgetView::sSectionResized(int logicalIndex, int /*oldSize*/, int newSize)
+{
+  // keep the layout's saved column widths current
+  if (! _syncing)
+    _tree->header()->resizeSection(logicalIndex, newSize);
+}
+
+void XTreeWidgetView::sShowMenu(const QPoint &pnt)
+{
+  QModelIndex index = indexAt(pnt);
+  if (! index.isValid())
+    return;
+
+  if (currentIndex().internalId() != index.internalId())
+    setCurrentIndex(index);
+
+  XTreeWidgetItem *item = _tree->currentItem();
+  if (! item)
+    return;
+  _tree->setCurrentItem(item, index.column());
+
+  _menu->clear();
+  if (item->data(0, Qt::UserRole).toString() != "totalrole")
+  {
+    emit _tree->populateMenu(_menu, (QTreeWidgetItem *)item);
+    emit _tree->populateMenu(_menu, (QTreeWidgetItem *)item, index.column());
+    emit _tree->populateMenu(_menu, item);
+    emit _tree->populateMenu(_menu, item, index.column());
+  }
+
+  bool disableExport = false;
+  if (_x_preferences)
+    disableExport = (_x_preferences->value("DisableExportContents")=="t");
+  if (!disableExport)
+  {
+    _menu->addSeparator();
+    QMenu* copyMenu = _menu->addMenu(tr("Copy to Clipboard"));
+    copyMenu->addAction(tr("Row"),  _tree, SLOT(sCopyRowToClipboard()));
+    copyMenu->addAction(tr("Cell"), _tree, SLOT(sCopyCellToClipboard()));
+  }
+
+  if (! _menu->isEmpty())
+    _menu->popup(mapToGlobal(pnt));
+}
+
+void XTreeWidgetView::sShowHeaderMenu(const QPoint &pnt)
+{
+  _headerMenu->clear();
+
+  QTreeWidgetItem *hitem = _tree->headerItem();
+  for (int i = 0; i < header()->count(); i++)
+  {
+    QAction *act = _headerMenu->addAction(hitem->text(i));
+    act->setCheckable(true);
+    act->setChecked(! header()->isSectionHidden(i));
+    act->setEnabled(! _tree->_lockedColumns.contains(i));
+    act->setData(i);
+  }
+
+  if (! _headerMenu->isEmpty())
+    _headerMenu->popup(header()->mapToGlobal(pnt));
+}
+
+void XTreeWidgetView::sHeaderMenuTriggered(QAction *pAction)
+{
+  bool ok = false;
+  int column = pAction->data().toInt(&ok);
+  if (! ok || ! pAction->isCheckable())
+    return;
+
+  _tree->setColumnVisible(column, pAction->isChecked());
+  header()->setSectionHidden(column, ! pAction->isChecked());
+}
@@ -0,0 +1,152 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __XTREEWIDGETMODEL_H__
+#define __XTREEWIDGETMODEL_H__
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QTreeView>
+#include <QVector>
+
+#include "widgets.h"
+#include "xtreewidget.h"
+
+class QMenu;
+
+/* XTreeWidgetModel holds the result of an XTreeWidget-style query in
+   columnar form, one QVector per query field that any column or role
+   actually uses, and formats cells only when a view asks for them.
+   It understands the same role conventions as XTreeWidget::populate()
+   (qtdisplayrole, xtnumericrole, xtindentrole, xtrunningrole,
+   xttotalrole and so on) and takes its column definitions from an
+   XTreeWidget, which acts as the layout.
+ */
+class XTUPLEWIDGETS_EXPORT XTreeWidgetModel : public QAbstractItemModel
+{
+  Q_OBJECT
+
+  public:
+    XTreeWidgetModel(XTreeWidget *layout, QObject *parent = 0);
+    ~XTreeWidgetModel();
+
+    virtual int           columnCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual QVariant      data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    virtual Qt::ItemFlags flags(const QModelIndex &index) const;
+    virtual QVariant      headerData(int section, Qt::Orientation orientation,
+                                     int role = Qt::DisplayRole) const;
+    virtual QModelIndex   index(int row, int column,
+                                const QModelIndex &parent = QModelIndex()) const;
+    virtual QModelIndex   parent(const QModelIndex &index) const;
+    virtual int           rowCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual void          sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+    void  clear();
+    void  populate(XSqlQuery pQuery, bool pUseAltId = false,
+                   XTreeWidget::PopulateStyle popstyle = XTreeWidget::Replace);
+    void  sortBy(const QList<QPair<int, Qt::SortOrder> > &pSort);
+
+    int               id(const QModelIndex &index)    const;
+    int               altId(const QModelIndex &index) const;
+    bool              hasIndent()                     const { return _rowRole[ROWROLE_INDENT] > 0; }
+    QModelIndex       indexOfId(int pId, int pAltId = -1) const;
+    QModelIndexList   hiddenIndexes()                 const;
+    XTreeWidgetItem  *materialize(const QModelIndex &index) const;
+    int               rows()                          const { return _ids.size(); }
+
+  private:
+    int       nodeOf(const QModelIndex &index) const;
+    int       totalNode()     const { return _ids.size(); }
+    QVariant  field(int node, int field) const;
+    QVariant  rawValue(int node, int col) const;
+    int       scale(int node, int col) const;
+    QVariant  displayValue(int node, int col) const;
+    QVariant  totalData(int col, int role) const;
+    void      computeCalculatedColumns();
+    void      computeRunning(int col, const QVector<int> &nodes);
+    void      sortNodes(QVector<int> &nodes, const QList<QPair<int, Qt::SortOrder> > &pSort);
+    void      updatePositions(const QVector<int> &nodes);
+    void      releaseRoles();
+
+    XTreeWidget *_tree;
+    bool         _useAltId;
+    int          _defaultScale;
+
+    // column and role to query field mapping, see XTreeWidget::mapColumnRoles()
+    QVector<int>    _colIdx;
+    QVector<int *>  _colRole;
+    int             _rowRole[ROWROLE_COUNT];
+
+    // the columnar row buffer: _values[_slot[queryfield]][node]
+    QVector<int>                _slot;
+    QVector<QVector<QVariant> > _values;
+
+    QVector<int>              _ids;
+    QVector<int>              _altIds;
+    QVector<int>              _parent;
+    QVector<int>              _position;
+    QVector<int>              _topLevel;
+    QHash<int, QVector<int> > _children;
+    QVector<int>              _hidden;
+
+    QHash<int, QVector<double> > _running;  // col -> running value per node
+    QMap<int, double>            _totals;   // col -> total of total set 0
+    QMap<int, int>               _totalScales;
+};
+
+/* XTreeWidgetView shows an XTreeWidgetModel in place of an XTreeWidget.
+   The XTreeWidget it is given keeps the column layout and the settings
+   that go with it, and the view materializes the current row as the
+   only item in that XTreeWidget so that id(), altId(), currentItem(),
+   rawValue() and the populateMenu() and itemSelected() signals keep
+   working for code written against the XTreeWidget.
+ */
+class XTUPLEWIDGETS_EXPORT XTreeWidgetView : public QTreeView
+{
+  Q_OBJECT
+
+  public:
+    XTreeWidgetView(XTreeWidget *layout, QWidget *parent = 0);
+
+    Q_INVOKABLE void  populate(XSqlQuery pQuery, int pIndex = -1, bool pUseAltId = false,
+                               XTreeWidget::PopulateStyle popstyle = XTreeWidget::Replace);
+    Q_INVOKABLE int   id()    const;
+    Q_INVOKABLE int   altId() const;
+    Q_INVOKABLE void  setId(int pId, int pAltId = -1);
+
+    Q_INVOKABLE XTreeWidget      *layoutWidget()  const { return _tree;  }
+    Q_INVOKABLE XTreeWidgetModel *virtualModel()  const { return _model; }
+
+  public slots:
+    void  clear();
+
+  protected slots:
+    void  sCurrentChanged(const QModelIndex &current, const QModelIndex &previous);
+    void  sHeaderClicked(int column);
+    void  sHeaderMenuTriggered(QAction *pAction);
+    void  sItemSelected();
+    void  sSectionResized(int logicalIndex, int oldSize, int newSize);
+    void  sShowHeaderMenu(const QPoint &pnt);
+    void  sShowMenu(const QPoint &pnt);
+
+  protected:
+    virtual void  keyPressEvent(QKeyEvent *e);
+
+  private:
+    void  syncHeader();
+
+    XTreeWidget      *_tree;
+    XTreeWidgetModel *_model;
+    QMenu            *_menu;
+    QMenu            *_headerMenu;
+    bool              _syncing;
+};
+
+#endif
@@ -0,0 +1,310 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetsearchindex.h"
+
+#include <algorithm>
+
+#include <QElapsedTimer>
+#include <QTreeWidgetItemIterator>
+
+#include "xt.h"
+#include "xtreewidget.h"
+
+#define DEBUG false
+
+// separates the columns of a row's text so matches can't span columns
+#define COLUMNSEPARATOR QChar(0x1f)
+
+static inline quint64 trigram(const QChar *c)
+{
+  return ((quint64)c[0].unicode() << 32) | ((quint64)c[1].unicode() << 16)
+       | (quint64)c[2].unicode();
+}
+
+XTreeWidgetSearchIndex::XTreeWidgetSearchIndex(XTreeWidget *tree)
+  : QObject(tree),
+    _tree(tree),
+    _filtering(false),
+    _valid(false)
+{
+  QAbstractItemModel *model = _tree->model();
+  connect(model, SIGNAL(dataChanged(const QModelIndex &, const QModelIndex &)),
+          this,  SLOT(sDataChanged(const QModelIndex &, const QModelIndex &)));
+  connect(model, SIGNAL(rowsInserted(const QModelIndex &, int, int)),
+          this,  SLOT(sRowsInserted(const QModelIndex &, int, int)));
+  connect(model, SIGNAL(rowsAboutToBeRemoved(const QModelIndex &, int, int)),
+          this,  SLOT(invalidate()));
+  connect(model, SIGNAL(modelAboutToBeReset()), this, SLOT(invalidate()));
+  connect(model, SIGNAL(columnsInserted(const QModelIndex &, int, int)), this, SLOT(invalidate()));
+  connect(model, SIGNAL(columnsRemoved(const QModelIndex &, int, int)),  this, SLOT(invalidate()));
+  connect(_tree, SIGNAL(populated()), this, SLOT(sPopulated()));
+}
+
+/* drop the index. it is rebuilt the next time it's needed */
+void XTreeWidgetSearchIndex::invalidate()
+{
+  _valid = false;
+  _items.clear();
+  _text.clear();
+  _rows.clear();
+  _postings.clear();
+  _pending.clear();
+  _dirty.clear();
+  _lastText = QString();
+  _lastMatches.clear();
+}
+
+void XTreeWidgetSearchIndex::sRowsInserted(const QModelIndex &parent, int first, int last)
+{
+  if (! _valid)
+    return;
+
+  QAbstractItemModel *model = _tree->model();
+  for (int r = first; r <= last; r++)
+  {
+    QTreeWidgetItem *item = _tree->itemFromIndex(model->index(r, 0, parent));
+    if (item)
+      _pending.append(item);
+  }
+}
+
+void XTreeWidgetSearchIndex::sDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+  if (! _valid || _filtering)   // marking filtered rows doesn't change their text
+    return;
+
+  for (int r = topLeft.row(); r <= bottomRight.row(); r++)
+  {
+    QTreeWidgetItem *item = _tree->itemFromIndex(topLeft.sibling(r, 0));
+    QHash<QTreeWidgetItem *, int>::const_iterator row = _rows.constFind(item);
+    if (row != _rows.constEnd())
+      _dirty.insert(row.value());
+  }
+}
+
+/* a new populate() may have brought back rows the filter should hide */
+void XTreeWidgetSearchIndex::sPopulated()
+{
+  if (! _filterText.isEmpty())
+    filter(_filterText);
+}
+
+QList<int> XTreeWidgetSearchIndex::visibleColumns() const
+{
+  QList<int> columns;
+  for (int c = 0; c < _tree->columnCount(); c++)
+    if (! _tree->isColumnHidden(c))
+      columns.append(c);
+  return columns;
+}
+
+QString XTreeWidgetSearchIndex::rowText(QTreeWidgetItem *item) const
+{
+  QString text;
+  for (int c = 0; c < _columns.size(); c++)
+  {
+    if (c)
+      text.append(COLUMNSEPARATOR);
+    text.append(item->text(_columns.at(c)).toLower());
+  }
+  return text;
+}
+
+/* post row under each trigram of its text that oldText didn't already
+   have. postings stay in row order while the index is being built.
+ */
+void XTreeWidgetSearchIndex::addTrigrams(int row, const QString &oldText)
+{
+  const QString &text = _text.at(row);
+  QSet<quint64>  old;
+  for (int i = 0; i + 2 < oldText.size(); i++)
+    old.insert(trigram(oldText.constData() + i));
+
+  for (int i = 0; i + 2 < text.size(); i++)
+  {
+    const QChar *c = text.constData() + i;
+    if (c[0] == COLUMNSEPARATOR || c[1] == COLUMNSEPARATOR || c[2] == COLUMNSEPARATOR)
+      continue;
+    quint64 key = trigram(c);
+    if (old.contains(key))
+      continue;
+    QVector<int> &posting = _postings[key];
+    if (posting.isEmpty() || posting.last() != row)
+      posting.append(row);
+  }
+}
+
+/* index item and all of its descendants */
+void XTreeWidgetSearchIndex::add(QTreeWidgetItem *item)
+{
+  if (! item || _rows.contains(item))
+    return;
+
+  int row = _items.size();
+  _items.append(item);
+  _text.append(rowText(item));
+  _rows.insert(item, row);
+  addTrigrams(row, QString());
+
+  for (int i = 0; i < item->childCount(); i++)
+    add(item->child(i));
+}
+
+void XTreeWidgetSearchIndex::build()
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  invalidate();
+  _columns = visibleColumns();
+  for (int i = 0; i < _tree->topLevelItemCount(); i++)
+    add(_tree->topLevelItem(i));
+  _valid = true;
+
+  if (DEBUG)
+    qDebug("%s: indexed %d rows, %d trigrams in %lld ms", qPrintable(_tree->objectName()),
+           _items.size(), _postings.size(), timer.elapsed());
+}
+
+/* bring the index up to date with the list */
+void XTreeWidgetSearchIndex::update()
+{
+  if (! _valid || _columns != visibleColumns() || _dirty.size() > _items.size() / 2)
+  {
+    build();
+    return;
+  }
+
+  if (_pending.isEmpty() && _dirty.isEmpty())
+    return;
+
+  foreach (int row, _dirty)
+  {
+    QString old = _text.at(row);
+    _text[row] = rowText(_items.at(row));
+    if (_text.at(row) != old)
+      addTrigrams(row, old);  // stale postings just cost a failed comparison
+  }
+  _dirty.clear();
+
+  for (int i = 0; i < _pending.size(); i++)
+    add(_pending.at(i));
+  _pending.clear();
+
+  _lastText = QString();
+  _lastMatches.clear();
+}
+
+/* the index rows whose text contains text, in index order */
+QVector<int> XTreeWidgetSearchIndex::matches(const QString &text)
+{
+  update();
+
+  QString      needle = text.toLower();
+  QVector<int> result;
+  if (needle.isEmpty())
+  {
+    result.reserve(_items.size());
+    for (int r = 0; r < _items.size(); r++)
+      result.append(r);
+    return result;
+  }
+
+  // typing more of the same text can only narrow the last result
+  const QVector<int> *candidates = 0;
+  if (! _lastText.isNull() && needle.contains(_lastText))
+    candidates = &_lastMatches;
+
+  bool none = false;
+  for (int i = 0; i + 2 < needle.size() && ! none; i++)
+  {
+    QHash<quint64, QVector<int> >::const_iterator posting =
+                                      _postings.constFind(trigram(needle.constData() + i));
+    if (posting == _postings.constEnd())
+      none = true;      // some trigram appears nowhere
+    else if (! candidates || posting.value().size() < candidates->size())
+      candidates = &posting.value();
+  }
+
+  if (none)
+    result.clear();
+  else if (candidates)
+  {
+    for (int i = 0; i < candidates->size(); i++)
+    {
+      int r = candidates->at(i);
+      if (_text.at(r).contains(needle))
+        result.append(r);
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+  }
+  else
+  {
+    for (int r = 0; r < _text.size(); r++)
+      if (_text.at(r).contains(needle))
+        result.append(r);
+  }
+
+  _lastText    = needle;
+  _lastMatches = result;
+  return result;
+}
+
+/* the rows whose visible columns contain text, ignoring case */
+QList<QTreeWidgetItem *> XTreeWidgetSearchIndex::find(const QString &text)
+{
+  QVector<int>             rows = matches(text);
+  QList<QTreeWidgetItem *> items;
+  items.reserve(rows.size());
+  for (int i = 0; i < rows.size(); i++)
+    items.append(_items.at(rows.at(i)));
+  return items;
+}
+
+/* hide the rows that don't contain text, keeping the parents of rows
+   that do. an empty text shows everything the filter had hidden.
+ */
+void XTreeWidgetSearchIndex::filter(const QString &text)
+{
+  _filterText = text;
+
+  QVector<int>  rows = matches(text);
+  QVector<bool> keep(_items.size(), text.isEmpty());
+  for (int i = 0; i < rows.size(); i++)
+  {
+    int r = rows.at(i);
+    while (r >= 0 && ! keep.at(r))
+    {
+      keep[r] = true;
+      QTreeWidgetItem *parent = _items.at(r)->parent();
+      r = parent ? _rows.value(parent, -1) : -1;
+    }
+  }
+
+  _filtering = true;
+  for (int r = 0; r < _items.size(); r++)
+  {
+    QTreeWidgetItem *item   = _items.at(r);
+    bool             hidden = item->data(0, Xt::FilterHiddenRole).toBool();
+    if (keep.at(r) && hidden)
+    {
+      item->setHidden(false);
+      item->setData(0, Xt::FilterHiddenRole, QVariant());
+    }
+    else if (! keep.at(r) && ! hidden && ! item->isHidden())
+    {
+      item->setHidden(true);
+      item->setData(0, Xt::FilterHiddenRole, true);
+    }
+  }
+  _filtering = false;
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __XTREEWIDGETSEARCHINDEX_H__
+#define __XTREEWIDGETSEARCHINDEX_H__
+
+#include <QHash>
+#include <QList>
+#include <QModelIndex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include "widgets.h"
+
+class QTreeWidgetItem;
+class XTreeWidget;
+
+/* A case-insensitive substring index over the text of an XTreeWidget's
+   visible columns. It is built the first time it is searched and keeps
+   a lower-cased copy of each row's text plus trigram postings, so a
+   search only has to look at rows sharing the search text's rarest
+   trigram. Rows the list appends are indexed at the next search, rows
+   whose text changes are re-indexed, and removing rows or changing
+   which columns are visible rebuilds the index.
+
+   filter() hides the rows that don't match and shows them again when
+   the filter changes, leaving alone rows hidden for other reasons. It
+   marks the rows it hid with Xt::FilterHiddenRole, so a row the list
+   takes out and puts back, as sorting and merging do, stays marked.
+ */
+class XTUPLEWIDGETS_EXPORT XTreeWidgetSearchIndex : public QObject
+{
+  Q_OBJECT
+
+  public:
+    XTreeWidgetSearchIndex(XTreeWidget *tree);
+
+    QList<QTreeWidgetItem *>  find(const QString &text);
+    void                      filter(const QString &text);
+    QString                   filterText() const { return _filterText; }
+
+  public slots:
+    void  invalidate();
+
+  private slots:
+    void  sDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void  sPopulated();
+    void  sRowsInserted(const QModelIndex &parent, int first, int last);
+
+  private:
+    void          add(QTreeWidgetItem *item);
+    void          addTrigrams(int row, const QString &oldText);
+    void          build();
+    QVector<int>  matches(const QString &text);
+    QString       rowText(QTreeWidgetItem *item) const;
+    void          update();
+    QList<int>    visibleColumns() const;
+
+    XTreeWidget                    *_tree;
+    bool                            _filtering;
+    bool                            _valid;
+    QList<int>                      _columns;
+    QVector<QTreeWidgetItem *>      _items;
+    QVector<QString>                _text;
+    QHash<QTreeWidgetItem *, int>   _rows;
+    QHash<quint64, QVector<int> >   _postings;
+    QList<QTreeWidgetItem *>        _pending;
+    QSet<int>                       _dirty;
+
+    QString                         _lastText;
+    QVector<int>                    _lastMatches;
+
+    QString                         _filterText;
+};
+
+#endif
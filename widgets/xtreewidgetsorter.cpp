@@ -0,0 +1,213 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetsorter.h"
+
+#include <algorithm>
+
+#include <QDate>
+#include <QDateTime>
+#include <QFuture>
+#include <QThread>
+#include <QtConcurrentRun>
+
+#define DEBUG false
+
+// below this many rows it costs more to start threads than to sort
+#define PARALLELSORTROWS 20000
+
+XTreeWidgetSortKey::XTreeWidgetSortKey()
+  : _kind(Null),
+    _isInteger(false),
+    _integer(0),
+    _number(0.0)
+{
+}
+
+XTreeWidgetSortKey::XTreeWidgetSortKey(const QVariant &raw, const QVariant &display)
+  : _kind(Numeric),
+    _isInteger(true),
+    _integer(0),
+    _number(0.0)
+{
+  bool ok = false;
+
+  switch (raw.type())
+  {
+    case QVariant::Bool:
+      _integer = raw.toBool() ? 1 : 0;
+      break;
+
+    case QVariant::Date:
+      _integer = raw.toDate().toJulianDay();
+      break;
+
+    case QVariant::DateTime:
+      _integer = raw.toDateTime().toMSecsSinceEpoch();
+      break;
+
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+      _integer = raw.toLongLong();
+      break;
+
+    case QVariant::Double:
+      _isInteger = false;
+      _number    = raw.toDouble();
+      break;
+
+    case QVariant::String:
+    {
+      // bugs 17968 & 32496: sort strings according to user expectations AND preserve raw role
+      QString text = raw.toString();
+      _number = text.toDouble(&ok);
+      if (! ok && display.type() == QVariant::String)
+      {
+        (void)display.toString().toDouble(&ok);
+        if (! ok)
+          text = display.toString();
+        ok = false;
+      }
+      if (ok)
+        _isInteger = false;
+      else
+      {
+        _kind = Text;
+        _text = text.toUpper();
+      }
+      break;
+    }
+
+    default:
+      _kind      = Null;
+      _isInteger = false;
+      break;
+  }
+
+  if (_isInteger)
+    _number = (double)_integer;
+}
+
+int XTreeWidgetSortKey::compare(const XTreeWidgetSortKey &other) const
+{
+  if (_kind != other._kind)
+    return _kind < other._kind ? -1 : 1;
+
+  switch (_kind)
+  {
+    case Numeric:
+      if (_isInteger && other._isInteger)
+        return _integer < other._integer ? -1 : (_integer > other._integer ? 1 : 0);
+      return _number < other._number ? -1 : (_number > other._number ? 1 : 0);
+
+    case Text:
+      return _text < other._text ? -1 : (other._text < _text ? 1 : 0);
+
+    default:
+      break;
+  }
+  return 0;
+}
+
+XTreeWidgetSorter::XTreeWidgetSorter(int rows, const QList<QPair<int, Qt::SortOrder> > &sort)
+  : _rows(rows),
+    _sort(sort),
+    _keys(rows * sort.size())
+{
+}
+
+bool XTreeWidgetSorter::lessThan(int left, int right) const
+{
+  const XTreeWidgetSortKey *lkeys = _keys.constData() + left  * _sort.size();
+  const XTreeWidgetSortKey *rkeys = _keys.constData() + right * _sort.size();
+  for (int k = 0; k < _sort.size(); k++)
+  {
+    int cmp = lkeys[k].compare(rkeys[k]);
+    if (cmp != 0)
+      return (_sort.at(k).second == Qt::DescendingOrder) ? cmp > 0 : cmp < 0;
+  }
+  return left < right;  // keep equal rows in their original order
+}
+
+class XTreeWidgetSorterLessThan
+{
+  public:
+    XTreeWidgetSorterLessThan(const XTreeWidgetSorter *sorter) : _sorter(sorter) {}
+    inline bool operator()(int left, int right) const
+    {
+      return _sorter->lessThan(left, right);
+    }
+
+  private:
+    const XTreeWidgetSorter *_sorter;
+};
+
+static void sortRange(int *first, int *last, XTreeWidgetSorterLessThan lt)
+{
+  std::sort(first, last, lt);
+}
+
+static void mergeRange(int *first, int *middle, int *last, XTreeWidgetSorterLessThan lt)
+{
+  std::inplace_merge(first, middle, last, lt);
+}
+
+QVector<int> XTreeWidgetSorter::sorted() const
+{
+  QVector<int> perm(_rows);
+  for (int i = 0; i < _rows; i++)
+    perm[i] = i;
+
+  XTreeWidgetSorterLessThan lt(this);
+  int threads = QThread::idealThreadCount();
+  if (_rows < PARALLELSORTROWS || threads < 2)
+  {
+    std::sort(perm.begin(), perm.end(), lt);
+    return perm;
+  }
+
+  // sort one chunk per core, then merge neighboring chunks until one remains
+  int *data = perm.data();
+  QVector<int> bounds;
+  for (int t = 0; t <= threads; t++)
+    bounds.append((int)((qlonglong)_rows * t / threads));
+
+  QList<QFuture<void> > work;
+  for (int t = 0; t < threads; t++)
+    work.append(QtConcurrent::run(sortRange, data + bounds.at(t), data + bounds.at(t + 1), lt));
+  for (int t = 0; t < work.size(); t++)
+    work[t].waitForFinished();
+
+  while (bounds.size() > 2)
+  {
+    QVector<int> merged;
+    work.clear();
+    for (int b = 0; b + 2 < bounds.size(); b += 2)
+    {
+      work.append(QtConcurrent::run(mergeRange, data + bounds.at(b), data + bounds.at(b + 1),
+                                    data + bounds.at(b + 2), lt));
+      merged.append(bounds.at(b));
+    }
+    if (bounds.size() % 2 == 0)   // odd number of chunks - the last one waits a round
+      merged.append(bounds.at(bounds.size() - 2));
+    merged.append(bounds.last());
+
+    for (int t = 0; t < work.size(); t++)
+      work[t].waitForFinished();
+    bounds = merged;
+  }
+
+  if (DEBUG)
+    qDebug("XTreeWidgetSorter::sorted() sorted %d rows on %d threads", _rows, threads);
+
+  return perm;
+}
@@ -0,0 +1,73 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2019 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __XTREEWIDGETSORTER_H__
+#define __XTREEWIDGETSORTER_H__
+
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+#include "widgets.h"
+
+/* A sort key extracted once from an Xt::RawRole value (and the display
+   value, for text columns) so comparisons don't have to unpack QVariants.
+   Numbers, dates, times and booleans sort numerically, numeric strings
+   sort as numbers ahead of other strings, and other strings sort
+   case-insensitively, as XTreeWidgetItem::operator< always has.
+ */
+class XTUPLEWIDGETS_EXPORT XTreeWidgetSortKey
+{
+  public:
+    enum Kind { Null, Numeric, Text };
+
+    XTreeWidgetSortKey();
+    XTreeWidgetSortKey(const QVariant &raw, const QVariant &display = QVariant());
+
+    int compare(const XTreeWidgetSortKey &other) const;
+
+  private:
+    Kind      _kind;
+    bool      _isInteger;
+    qlonglong _integer;
+    double    _number;
+    QString   _text;
+};
+
+/* Sorts a permutation of row numbers by any number of keys per row.
+   Fill in every key with setKey() and call sorted() to get the new
+   row order. Ties keep their original order. Large sets are sorted in
+   chunks on the global thread pool and then merged.
+ */
+class XTUPLEWIDGETS_EXPORT XTreeWidgetSorter
+{
+  public:
+    XTreeWidgetSorter(int rows, const QList<QPair<int, Qt::SortOrder> > &sort);
+
+    inline int  columnCount() const       { return _sort.size(); }
+    inline int  column(int k) const       { return _sort.at(k).first; }
+    inline int  rowCount() const          { return _rows; }
+    inline void setKey(int row, int k, const XTreeWidgetSortKey &key)
+    {
+      _keys[row * _sort.size() + k] = key;
+    }
+
+    bool          lessThan(int left, int right) const;
+    QVector<int>  sorted() const;
+
+  private:
+    int                                _rows;
+    QList<QPair<int, Qt::SortOrder> >  _sort;
+    QVector<XTreeWidgetSortKey>        _keys;
+};
+
+#endif